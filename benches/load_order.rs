@@ -1,13 +1,13 @@
 use std::convert::TryFrom;
 use std::fmt;
 use std::fmt::Display;
-use std::fs::{copy, create_dir, File, FileTimes};
+use std::fs::{copy, create_dir, create_dir_all, rename, write, File, FileTimes};
 use std::io::Write;
 use std::path::{Path, PathBuf};
 use std::rc::Rc;
 use std::time::{Duration, SystemTime};
 
-use criterion::{BenchmarkId, Criterion};
+use criterion::{BatchSize, BenchmarkId, Criterion};
 use encoding_rs::WINDOWS_1252;
 use tempfile::TempDir;
 
@@ -62,13 +62,15 @@ fn set_timestamps<T: AsRef<str>>(plugins_directory: &Path, filenames: &[T]) {
 
 fn testing_plugins_dir(game_id: GameId) -> PathBuf {
     let game_folder = match game_id {
-        GameId::Morrowind => "Morrowind",
+        GameId::Morrowind | GameId::OpenMW => "Morrowind",
         GameId::Oblivion => "Oblivion",
+        GameId::SkyrimSE => "SkyrimSE",
+        GameId::Starfield => "Starfield",
         _ => "Skyrim",
     };
 
     let plugins_folder = match game_id {
-        GameId::Morrowind => "Data Files",
+        GameId::Morrowind | GameId::OpenMW => "Data Files",
         _ => "Data",
     };
 
@@ -81,7 +83,7 @@ fn copy_to_test_dir(from_path: &str, to_file: &str, game_settings: &GameSettings
     let testing_plugins_dir = testing_plugins_dir(game_settings.id());
     let data_dir = game_settings.plugins_directory();
     if !data_dir.exists() {
-        create_dir(&data_dir).unwrap();
+        create_dir_all(&data_dir).unwrap();
     }
     copy(testing_plugins_dir.join(from_path), data_dir.join(to_file)).unwrap();
 }
@@ -115,6 +117,212 @@ fn initialise_state(game_settings: &GameSettings, plugins_count: u16, active_plu
     write_active_plugins_file(game_settings, &plugins_as_ref);
 }
 
+/// The make-up of a large load order, with each ratio given as a percentage of
+/// the plugins in the load order.
+#[derive(Clone, Copy, Default)]
+struct Layout {
+    light_percent: u16,
+    medium_percent: u16,
+    ghosted_percent: u16,
+    /// The percentage of plugins that also have a copy in an additional plugins
+    /// directory, like Starfield's My Games Data folder in Microsoft Store
+    /// installs.
+    overridden_percent: u16,
+    /// If true, half the full masters depend on a master that appears after
+    /// them in the load order, so that loading needs to hoist it. This is only
+    /// supported for Skyrim Special Edition.
+    hoisted_master: bool,
+}
+
+impl Display for Layout {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        write!(
+            f,
+            "{}% light, {}% medium, {}% ghosted, {}% overridden",
+            self.light_percent, self.medium_percent, self.ghosted_percent, self.overridden_percent
+        )?;
+
+        if self.hoisted_master {
+            write!(f, ", hoisted master")?;
+        }
+
+        Ok(())
+    }
+}
+
+#[derive(Clone, Copy, PartialEq)]
+enum PluginKind {
+    Master,
+    DependentMaster,
+    Light,
+    Medium,
+    NonMaster,
+}
+
+impl PluginKind {
+    fn for_index(index: u16, layout: &Layout) -> PluginKind {
+        // Spread each kind of plugin evenly through the load order.
+        let bucket = index % 100;
+        let light_start = 10;
+        let medium_start = light_start + layout.light_percent;
+        let non_master_start = medium_start + layout.medium_percent;
+
+        if bucket < light_start {
+            if layout.hoisted_master && index % 2 == 1 {
+                PluginKind::DependentMaster
+            } else {
+                PluginKind::Master
+            }
+        } else if bucket < medium_start {
+            PluginKind::Light
+        } else if bucket < non_master_start {
+            PluginKind::Medium
+        } else {
+            PluginKind::NonMaster
+        }
+    }
+
+    fn source_and_extension(self, game_id: GameId) -> (&'static str, &'static str) {
+        match (self, game_id) {
+            (PluginKind::Master, GameId::Starfield) => ("Blank.full.esm", "esm"),
+            (PluginKind::Master, _) => ("Blank - Different.esm", "esm"),
+            (PluginKind::DependentMaster, _) => ("Blank - Master Dependent.esm", "esm"),
+            (PluginKind::Light, GameId::Starfield) => ("Blank.small.esm", "esm"),
+            (PluginKind::Light, _) => ("Blank.esl", "esl"),
+            (PluginKind::Medium, _) => ("Blank.medium.esm", "esm"),
+            (PluginKind::NonMaster, _) => ("Blank.esp", "esp"),
+        }
+    }
+
+    fn is_master(self) -> bool {
+        self != PluginKind::NonMaster
+    }
+}
+
+fn initialise_large_state(
+    game_settings: &GameSettings,
+    plugins_count: u16,
+    active_plugins_count: u16,
+    layout: &Layout,
+) {
+    let mut masters: Vec<String> = Vec::new();
+    let mut non_masters: Vec<String> = Vec::new();
+    let mut overridden: Vec<String> = Vec::new();
+
+    for i in 0..plugins_count {
+        let kind = PluginKind::for_index(i, layout);
+        let (source, extension) = kind.source_and_extension(game_settings.id());
+        let name = format!("Blank{}.{}", i, extension);
+
+        copy_to_test_dir(source, &name, game_settings);
+
+        if i % 100 < layout.overridden_percent {
+            overridden.push(name.clone());
+        }
+
+        if kind.is_master() {
+            masters.push(name);
+        } else {
+            non_masters.push(name);
+        }
+    }
+
+    if layout.hoisted_master {
+        // The dependent masters all depend on Blank.esm, so put it last.
+        copy_to_test_dir("Blank.esm", "Blank.esm", game_settings);
+        masters.push("Blank.esm".to_owned());
+    }
+
+    let plugins: Vec<&str> = masters
+        .iter()
+        .chain(non_masters.iter())
+        .map(AsRef::as_ref)
+        .collect();
+
+    if game_settings.load_order_file().is_some() {
+        write_load_order_file(game_settings, &plugins);
+    }
+    set_timestamps(&game_settings.plugins_directory(), &plugins);
+
+    for directory in game_settings.additional_plugins_directories() {
+        if !directory.exists() {
+            create_dir(directory).unwrap();
+        }
+        for name in &overridden {
+            copy(
+                game_settings.plugins_directory().join(name),
+                directory.join(name),
+            )
+            .unwrap();
+        }
+        set_timestamps(directory, &overridden);
+    }
+
+    let (active_plugins, inactive_plugins) =
+        plugins.split_at(usize::from(active_plugins_count).min(plugins.len()));
+
+    // Only inactive plugins get ghosted.
+    for (i, name) in inactive_plugins.iter().enumerate() {
+        if i % 100 < usize::from(layout.ghosted_percent) {
+            let path = game_settings.plugins_directory().join(name);
+            rename(&path, path.with_file_name(format!("{}.ghost", name))).unwrap();
+        }
+    }
+
+    write_active_plugins_file(game_settings, active_plugins);
+}
+
+/// Set up an OpenMW install with all its plugins in one data path, so that
+/// they're initially listed in lexicographical order. Most of the plugins are
+/// .omwaddon files that have Blank.esm as a master, with some .omwscripts
+/// files mixed in.
+fn initialise_openmw_state(
+    game_settings: &GameSettings,
+    plugins_count: u16,
+    active_plugins_count: u16,
+) {
+    let mut plugins: Vec<String> = Vec::new();
+
+    copy_to_test_dir("Blank.esm", "Blank.esm", game_settings);
+    plugins.push("Blank.esm".to_owned());
+
+    for i in 1..plugins_count {
+        if i % 10 == 0 {
+            let name = format!("Blank{}.omwscripts", i);
+            write(game_settings.plugins_directory().join(&name), "").unwrap();
+            plugins.push(name);
+        } else {
+            plugins.push(format!("Blank{}.omwaddon", i));
+            copy_to_test_dir(
+                "Blank - Master Dependent.esp",
+                plugins.last().unwrap(),
+                game_settings,
+            );
+        }
+    }
+
+    let cfg_path = game_settings.active_plugins_file();
+    if let Some(parent) = cfg_path.parent() {
+        create_dir_all(parent).unwrap();
+    }
+    let mut file = File::create(cfg_path).unwrap();
+    for name in plugins.iter().take(active_plugins_count.into()) {
+        writeln!(file, "content={}", name).unwrap();
+    }
+}
+
+/// If LIBLO_BENCH_DROP_CACHES is set, benchmarks that read from disk drop the
+/// OS page cache before each iteration, so that they measure cold reads.
+/// Otherwise they measure warm reads of files that are already cached in
+/// memory. Dropping the page cache is only supported on Linux, and requires
+/// root privileges.
+fn drop_page_cache_if_requested() {
+    if std::env::var_os("LIBLO_BENCH_DROP_CACHES").is_some() {
+        std::process::Command::new("sync").status().unwrap();
+        write("/proc/sys/vm/drop_caches", "3").unwrap();
+    }
+}
+
 fn to_owned(strs: Vec<&str>) -> Vec<String> {
     strs.into_iter().map(String::from).collect()
 }
@@ -124,6 +332,7 @@ struct Parameters {
     settings: GameSettings,
     plugins_count: u16,
     active_plugins_count: u16,
+    layout: Option<Layout>,
     _directory: Rc<TempDir>,
 }
 
@@ -143,10 +352,71 @@ impl Parameters {
             settings,
             plugins_count,
             active_plugins_count,
+            layout: None,
+            _directory: Rc::new(directory),
+        }
+    }
+
+    fn large(
+        game_id: GameId,
+        plugins_count: u16,
+        active_plugins_count: u16,
+        layout: Layout,
+    ) -> Parameters {
+        let directory = TempDir::new().unwrap();
+        let local_path = directory.path().join("local");
+
+        create_dir(&local_path).unwrap();
+
+        let mut settings =
+            GameSettings::with_local_path(game_id, directory.path(), &local_path).unwrap();
+
+        let additional_directories = if layout.overridden_percent > 0 {
+            vec![directory.path().join("My Games Data")]
+        } else {
+            Vec::new()
+        };
+        settings.set_additional_plugins_directories(additional_directories);
+
+        initialise_large_state(&settings, plugins_count, active_plugins_count, &layout);
+
+        Parameters {
+            settings,
+            plugins_count,
+            active_plugins_count,
+            layout: Some(layout),
+            _directory: Rc::new(directory),
+        }
+    }
+
+    fn openmw(plugins_count: u16, active_plugins_count: u16) -> Parameters {
+        let directory = TempDir::new().unwrap();
+        let local_path = directory.path().join("local");
+
+        create_dir(&local_path).unwrap();
+
+        let settings =
+            GameSettings::with_local_path(GameId::OpenMW, directory.path(), &local_path).unwrap();
+
+        initialise_openmw_state(&settings, plugins_count, active_plugins_count);
+
+        Parameters {
+            settings,
+            plugins_count,
+            active_plugins_count,
+            layout: None,
             _directory: Rc::new(directory),
         }
     }
 
+    fn with_header_cache(&self) -> Parameters {
+        let mut parameters = self.clone();
+        let path = parameters.settings.default_header_cache_path();
+        parameters.settings.set_header_cache_path(Some(path));
+
+        parameters
+    }
+
     fn load_order(&self) -> Box<dyn WritableLoadOrder> {
         self.settings.clone().into_load_order()
     }
@@ -163,11 +433,17 @@ impl fmt::Display for Parameters {
     fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
         write!(
             f,
-            "({:?}, {} plugins, {} active)",
+            "({:?}, {} plugins, {} active",
             self.settings.id(),
             self.plugins_count,
             self.active_plugins_count
-        )
+        )?;
+
+        if let Some(layout) = &self.layout {
+            write!(f, ", {}", layout)?;
+        }
+
+        write!(f, ")")
     }
 }
 
@@ -375,6 +651,193 @@ fn writable_load_order_benchmark(c: &mut Criterion) {
     );
 }
 
+/// Benchmarks for load orders with thousands of plugins. libloadorder's
+/// internal phases can't be called directly, so each is measured through the
+/// public entry point that it dominates:
+///
+/// - header parsing: `load()` with a new load order, so every plugin is parsed
+/// - the header cache: `load()` with a new load order and a populated cache
+/// - `find_plugins()` and `hoist_masters()`: `load()` on an already loaded
+///   load order, which reuses every plugin
+/// - `validate_load_order()`: `set_load_order()` with the current load order
+/// - `check_self_consistency()`: `is_self_consistent()` for Skyrim
+/// - `save_load_order_using_timestamps()`: `save()` for Oblivion after moving
+///   a plugin
+/// - OpenMW's `apply_load_order()`: `load()` on an already loaded OpenMW load
+///   order, which reuses every plugin
+fn large_load_order_benchmark(c: &mut Criterion) {
+    let load_orders: Vec<Parameters> = vec![
+        Parameters::large(
+            GameId::SkyrimSE,
+            2000,
+            250,
+            Layout {
+                light_percent: 30,
+                ghosted_percent: 10,
+                ..Default::default()
+            },
+        ),
+        Parameters::large(
+            GameId::SkyrimSE,
+            5000,
+            250,
+            Layout {
+                light_percent: 50,
+                ghosted_percent: 20,
+                hoisted_master: true,
+                ..Default::default()
+            },
+        ),
+        Parameters::large(
+            GameId::Starfield,
+            3000,
+            250,
+            Layout {
+                light_percent: 30,
+                medium_percent: 10,
+                ghosted_percent: 10,
+                overridden_percent: 25,
+                ..Default::default()
+            },
+        ),
+    ];
+
+    parameterised_benchmark!(
+        c,
+        "Header parsing: WritableLoadOrder.load() (new load order)",
+        load_orders,
+        |b, parameters| {
+            b.iter_batched(
+                || {
+                    drop_page_cache_if_requested();
+                    parameters.load_order()
+                },
+                |mut load_order| load_order.load().unwrap(),
+                BatchSize::PerIteration,
+            )
+        }
+    );
+
+    let cached_load_orders: Vec<Parameters> = load_orders
+        .iter()
+        .map(Parameters::with_header_cache)
+        .collect();
+
+    parameterised_benchmark!(
+        c,
+        "Header cache: WritableLoadOrder.load() (new load order)",
+        cached_load_orders,
+        |b, parameters| {
+            // Populate the header cache.
+            parameters.loaded_load_order();
+
+            b.iter_batched(
+                || {
+                    drop_page_cache_if_requested();
+                    parameters.load_order()
+                },
+                |mut load_order| load_order.load().unwrap(),
+                BatchSize::PerIteration,
+            )
+        }
+    );
+
+    parameterised_benchmark!(
+        c,
+        "find_plugins and hoist_masters: WritableLoadOrder.load() (reused plugins)",
+        load_orders,
+        |b, parameters| {
+            let mut load_order = parameters.loaded_load_order();
+
+            b.iter_batched(
+                drop_page_cache_if_requested,
+                |()| load_order.load().unwrap(),
+                BatchSize::PerIteration,
+            )
+        }
+    );
+
+    parameterised_benchmark!(
+        c,
+        "validate_load_order: WritableLoadOrder.set_load_order()",
+        load_orders,
+        |b, parameters| {
+            let mut load_order = parameters.loaded_load_order();
+
+            let plugins = to_owned(load_order.plugin_names());
+            let plugin_refs: Vec<&str> = plugins.iter().map(AsRef::as_ref).collect();
+
+            b.iter(|| load_order.set_load_order(&plugin_refs).unwrap())
+        }
+    );
+
+    let layout = Layout {
+        ghosted_percent: 10,
+        ..Default::default()
+    };
+    let skyrim_load_orders: Vec<Parameters> = vec![
+        Parameters::large(GameId::Skyrim, 2000, 250, layout),
+        Parameters::large(GameId::Skyrim, 5000, 250, layout),
+    ];
+
+    parameterised_benchmark!(
+        c,
+        "check_self_consistency: WritableLoadOrder.is_self_consistent()",
+        skyrim_load_orders,
+        |b, parameters| {
+            let load_order = parameters.loaded_load_order();
+
+            b.iter_batched(
+                drop_page_cache_if_requested,
+                |()| load_order.is_self_consistent().unwrap(),
+                BatchSize::PerIteration,
+            )
+        }
+    );
+
+    let oblivion_load_orders: Vec<Parameters> = vec![
+        Parameters::large(GameId::Oblivion, 2000, 250, layout),
+        Parameters::large(GameId::Oblivion, 5000, 250, layout),
+    ];
+
+    parameterised_benchmark!(
+        c,
+        "save_load_order_using_timestamps: WritableLoadOrder.save() (moved plugin)",
+        oblivion_load_orders,
+        |b, parameters| {
+            let mut load_order = parameters.loaded_load_order();
+
+            let last_index = usize::from(parameters.plugins_count) - 1;
+            let plugin_name = load_order.plugin_at(last_index).unwrap().to_string();
+            let mut moved = false;
+
+            b.iter(|| {
+                let index = if moved { last_index } else { last_index - 1 };
+                moved = !moved;
+
+                load_order.set_plugin_index(&plugin_name, index).unwrap();
+                load_order.save().unwrap()
+            })
+        }
+    );
+
+    let openmw_load_orders: Vec<Parameters> = vec![
+        Parameters::openmw(2000, 1000),
+        Parameters::openmw(5000, 2500),
+    ];
+
+    parameterised_benchmark!(
+        c,
+        "OpenMW apply_load_order: WritableLoadOrder.load() (reused plugins)",
+        openmw_load_orders,
+        |b, parameters| {
+            let mut load_order = parameters.loaded_load_order();
+
+            b.iter(|| load_order.load().unwrap())
+        }
+    );
+}
+
 criterion::criterion_group! {
     name = benches;
     config = Criterion::default()
@@ -389,4 +852,11 @@ criterion::criterion_group! {
         .sample_size(25);
     targets = benchmarks_writable_load_order_slow
 }
-criterion::criterion_main!(benches, slow_benches);
+criterion::criterion_group! {
+    name = large_benches;
+    config = Criterion::default()
+        .warm_up_time(Duration::from_secs(2))
+        .sample_size(10);
+    targets = large_load_order_benchmark
+}
+criterion::criterion_main!(benches, slow_benches, large_benches);
@@ -0,0 +1,447 @@
+// Measures the C API under concurrent use of a single game handle: reader
+// threads repeatedly query the load order while a writer thread periodically
+// reloads it, sets it or restores a snapshot of it.
+//
+// Usage: ffi_cpp_benchmarks [--testing-plugins <path>] [--plugins <count>]...
+//                           [--readers <count>] [--seconds <count>]
+//                           [--writer-interval-ms <count>]
+//
+// Each reader operation is first timed without any other threads running.
+// The difference between its mean latency under contention and that
+// uncontended mean is reported as an estimate of the time spent waiting for
+// the handle's lock, as the C API doesn't expose lock wait times directly.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "libloadorder.h"
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+// Skyrim SE allows at most 254 active full plugins besides Skyrim.esm.
+constexpr size_t MAX_ACTIVE_PLUGINS = 200;
+
+constexpr size_t BASELINE_ITERATIONS = 1000;
+
+// Setting the load order swaps two adjacent non-master plugins, and at most
+// 10% of the plugins are masters, so there must be at least two plugins.
+constexpr size_t MIN_PLUGIN_COUNT = 2;
+
+struct Options {
+  fs::path testing_plugins_path = "../../testing-plugins";
+  std::vector<size_t> plugin_counts;
+  unsigned int reader_threads = std::max(2u, std::thread::hardware_concurrency());
+  std::chrono::seconds duration{2};
+  std::chrono::milliseconds writer_interval{50};
+};
+
+enum class ReaderOperation {
+  GetLoadOrder,
+  GetLoadOrderPacked,
+  GetLoadOrderEntries,
+  GetPluginActive,
+  GetPluginPosition,
+};
+
+constexpr ReaderOperation READER_OPERATIONS[] = {
+  ReaderOperation::GetLoadOrder,
+  ReaderOperation::GetLoadOrderPacked,
+  ReaderOperation::GetLoadOrderEntries,
+  ReaderOperation::GetPluginActive,
+  ReaderOperation::GetPluginPosition,
+};
+
+constexpr size_t READER_OPERATION_COUNT = std::size(READER_OPERATIONS);
+
+const char * READER_OPERATION_NAMES[] = {
+  "lo_get_load_order",
+  "lo_get_load_order_packed",
+  "lo_get_load_order_entries",
+  "lo_get_plugin_active",
+  "lo_get_plugin_position",
+};
+
+enum class WriterOperation {
+  LoadCurrentState,
+  SetLoadOrder,
+  RestoreSnapshot,
+};
+
+constexpr WriterOperation WRITER_OPERATIONS[] = {
+  WriterOperation::LoadCurrentState,
+  WriterOperation::SetLoadOrder,
+  WriterOperation::RestoreSnapshot,
+};
+
+constexpr size_t WRITER_OPERATION_COUNT = std::size(WRITER_OPERATIONS);
+
+const char * WRITER_OPERATION_NAMES[] = {
+  "lo_load_current_state",
+  "lo_set_load_order",
+  "lo_restore_snapshot",
+};
+
+using Latencies = std::vector<Clock::duration>;
+
+// A small, fast generator so that picking plugins doesn't add contention.
+struct XorShift {
+  uint64_t state;
+
+  uint64_t next() {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+  }
+
+  size_t below(size_t bound) {
+    return static_cast<size_t>(next() % bound);
+  }
+};
+
+void check(unsigned int return_code, const char * function) {
+  if (return_code == LIBLO_OK || return_code == LIBLO_WARN_LO_MISMATCH) {
+    return;
+  }
+
+  const char * message = nullptr;
+  lo_get_error_message(&message);
+  fprintf(stderr, "%s failed with code %u: %s\n", function, return_code,
+    message == nullptr ? "" : message);
+  std::exit(1);
+}
+
+double to_micros(Clock::duration duration) {
+  return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+// Returns the load order, which starts with Skyrim.esm.
+std::vector<std::string> create_game(const fs::path & game_path,
+  const fs::path & testing_plugins_path,
+  size_t plugin_count) {
+  const auto source_path = testing_plugins_path / "SkyrimSE" / "Data";
+  const auto data_path = game_path / "Data";
+
+  fs::remove_all(game_path);
+  fs::create_directories(data_path);
+  fs::copy_file(source_path / "Blank.esm", data_path / "Skyrim.esm");
+
+  // Make 10% of the load order master files.
+  const size_t master_count = plugin_count / 10;
+
+  std::vector<std::string> load_order = { "Skyrim.esm" };
+  for (size_t i = 0; i < plugin_count; ++i) {
+    const bool is_master = i < master_count;
+    auto name = "Blank" + std::to_string(i) + (is_master ? ".esm" : ".esp");
+    fs::copy_file(source_path / (is_master ? "Blank - Different.esm" : "Blank.esp"),
+      data_path / name);
+    load_order.push_back(std::move(name));
+  }
+
+  std::ofstream plugins_file(game_path / "Plugins.txt");
+  for (size_t i = 1; i < load_order.size(); ++i) {
+    if (i <= MAX_ACTIVE_PLUGINS) {
+      plugins_file << '*';
+    }
+    plugins_file << load_order[i] << "\r\n";
+  }
+
+  return load_order;
+}
+
+void run_reader_operation(lo_game_handle handle,
+  ReaderOperation operation,
+  const char * plugin) {
+  switch (operation) {
+    case ReaderOperation::GetLoadOrder: {
+      char ** plugins = nullptr;
+      size_t num_plugins = 0;
+      check(lo_get_load_order(handle, &plugins, &num_plugins), "lo_get_load_order");
+      lo_free_string_array(plugins, num_plugins);
+      break;
+    }
+    case ReaderOperation::GetLoadOrderPacked: {
+      lo_string_buffer buffer = { nullptr, 0, nullptr, 0 };
+      check(lo_get_load_order_packed(handle, &buffer), "lo_get_load_order_packed");
+      lo_free_string_buffer(&buffer);
+      break;
+    }
+    case ReaderOperation::GetLoadOrderEntries: {
+      lo_load_order_entry * entries = nullptr;
+      size_t num_entries = 0;
+      check(lo_get_load_order_entries(handle, &entries, &num_entries),
+        "lo_get_load_order_entries");
+      lo_free_load_order_entries(entries, num_entries);
+      break;
+    }
+    case ReaderOperation::GetPluginActive: {
+      bool is_active = false;
+      check(lo_get_plugin_active(handle, plugin, &is_active), "lo_get_plugin_active");
+      break;
+    }
+    case ReaderOperation::GetPluginPosition: {
+      size_t index = 0;
+      check(lo_get_plugin_position(handle, plugin, &index), "lo_get_plugin_position");
+      break;
+    }
+  }
+}
+
+void run_writer_operation(lo_game_handle handle,
+  WriterOperation operation,
+  std::vector<const char *> & load_order,
+  size_t first_non_master,
+  lo_snapshot_handle snapshot,
+  XorShift & rng) {
+  switch (operation) {
+    case WriterOperation::LoadCurrentState:
+      check(lo_load_current_state(handle), "lo_load_current_state");
+      break;
+    case WriterOperation::SetLoadOrder: {
+      // Swap two adjacent non-master plugins so that the order stays valid.
+      const size_t i = first_non_master + rng.below(load_order.size() - first_non_master - 1);
+      std::swap(load_order[i], load_order[i + 1]);
+      check(lo_set_load_order(handle, load_order.data(), load_order.size()),
+        "lo_set_load_order");
+      break;
+    }
+    case WriterOperation::RestoreSnapshot:
+      check(lo_restore_snapshot(handle, snapshot), "lo_restore_snapshot");
+      break;
+  }
+}
+
+void sort_latencies(Latencies & latencies) {
+  std::sort(latencies.begin(), latencies.end());
+}
+
+Clock::duration percentile(const Latencies & sorted_latencies, size_t percent) {
+  if (sorted_latencies.empty()) {
+    return Clock::duration::zero();
+  }
+
+  return sorted_latencies[(sorted_latencies.size() - 1) * percent / 100];
+}
+
+Clock::duration mean(const Latencies & latencies) {
+  if (latencies.empty()) {
+    return Clock::duration::zero();
+  }
+
+  Clock::duration total = Clock::duration::zero();
+  for (const auto & latency : latencies) {
+    total += latency;
+  }
+
+  return total / static_cast<Clock::rep>(latencies.size());
+}
+
+void print_header() {
+  printf("  %-28s %10s %12s %10s %10s %10s %12s\n",
+    "operation", "calls", "calls/s", "p50 (us)", "p99 (us)", "mean (us)", "wait (us)");
+}
+
+void print_row(const char * name,
+  Latencies & latencies,
+  std::chrono::duration<double> elapsed,
+  const Clock::duration * uncontended_mean) {
+  sort_latencies(latencies);
+  const auto mean_latency = mean(latencies);
+
+  printf("  %-28s %10zu %12.0f %10.2f %10.2f %10.2f ",
+    name,
+    latencies.size(),
+    static_cast<double>(latencies.size()) / elapsed.count(),
+    to_micros(percentile(latencies, 50)),
+    to_micros(percentile(latencies, 99)),
+    to_micros(mean_latency));
+
+  if (uncontended_mean == nullptr) {
+    printf("%12s\n", "-");
+  } else {
+    printf("%12.2f\n", std::max(0.0, to_micros(mean_latency - *uncontended_mean)));
+  }
+}
+
+void run_benchmark(const Options & options, size_t plugin_count) {
+  const auto game_path = fs::temp_directory_path() /
+    ("libloadorder-ffi-benchmark-" + std::to_string(plugin_count));
+  const auto plugin_names = create_game(game_path, options.testing_plugins_path, plugin_count);
+  const size_t first_non_master = 1 + plugin_count / 10;
+
+  const auto game_path_string = game_path.string();
+  lo_game_handle handle = nullptr;
+  check(lo_create_handle(&handle,
+    LIBLO_GAME_TES5SE,
+    game_path_string.c_str(),
+    game_path_string.c_str()), "lo_create_handle");
+  check(lo_load_current_state(handle), "lo_load_current_state");
+
+  lo_snapshot_handle snapshot = nullptr;
+  check(lo_create_snapshot(handle, &snapshot), "lo_create_snapshot");
+
+  printf("%zu plugins, %u reader threads, 1 writer thread every %lld ms for %lld s\n",
+    plugin_count,
+    options.reader_threads,
+    static_cast<long long>(options.writer_interval.count()),
+    static_cast<long long>(options.duration.count()));
+
+  // Time each reader operation without contention first.
+  Clock::duration uncontended_means[READER_OPERATION_COUNT];
+  XorShift baseline_rng{ 0x9E3779B97F4A7C15ULL };
+  for (size_t op = 0; op < READER_OPERATION_COUNT; ++op) {
+    Latencies latencies;
+    latencies.reserve(BASELINE_ITERATIONS);
+    for (size_t i = 0; i < BASELINE_ITERATIONS; ++i) {
+      const auto plugin = plugin_names[baseline_rng.below(plugin_names.size())].c_str();
+      const auto start = Clock::now();
+      run_reader_operation(handle, READER_OPERATIONS[op], plugin);
+      latencies.push_back(Clock::now() - start);
+    }
+    uncontended_means[op] = mean(latencies);
+  }
+
+  std::atomic<bool> stop = false;
+  std::vector<std::vector<Latencies>> reader_latencies(options.reader_threads,
+    std::vector<Latencies>(READER_OPERATION_COUNT));
+  std::vector<Latencies> writer_latencies(WRITER_OPERATION_COUNT);
+
+  std::vector<std::thread> threads;
+  for (unsigned int t = 0; t < options.reader_threads; ++t) {
+    threads.emplace_back([&, t]() {
+      auto & latencies = reader_latencies[t];
+      XorShift rng{ 0x2545F4914F6CDD1DULL + t };
+      for (size_t i = 0; !stop.load(std::memory_order_relaxed); ++i) {
+        const size_t op = i % READER_OPERATION_COUNT;
+        const auto plugin = plugin_names[rng.below(plugin_names.size())].c_str();
+        const auto start = Clock::now();
+        run_reader_operation(handle, READER_OPERATIONS[op], plugin);
+        latencies[op].push_back(Clock::now() - start);
+      }
+    });
+  }
+
+  threads.emplace_back([&]() {
+    std::vector<const char *> load_order;
+    for (const auto & name : plugin_names) {
+      load_order.push_back(name.c_str());
+    }
+
+    XorShift rng{ 0x853C49E6748FEA9BULL };
+    for (size_t i = 0; !stop.load(std::memory_order_relaxed); ++i) {
+      std::this_thread::sleep_for(options.writer_interval);
+      const size_t op = i % WRITER_OPERATION_COUNT;
+      const auto start = Clock::now();
+      run_writer_operation(handle,
+        WRITER_OPERATIONS[op],
+        load_order,
+        first_non_master,
+        snapshot,
+        rng);
+      writer_latencies[op].push_back(Clock::now() - start);
+    }
+  });
+
+  const auto start = Clock::now();
+  std::this_thread::sleep_for(options.duration);
+  stop = true;
+  for (auto & thread : threads) {
+    thread.join();
+  }
+  const std::chrono::duration<double> elapsed = Clock::now() - start;
+
+  print_header();
+  for (size_t op = 0; op < READER_OPERATION_COUNT; ++op) {
+    Latencies latencies;
+    for (auto & thread_latencies : reader_latencies) {
+      latencies.insert(latencies.end(),
+        thread_latencies[op].begin(),
+        thread_latencies[op].end());
+    }
+    print_row(READER_OPERATION_NAMES[op], latencies, elapsed, &uncontended_means[op]);
+  }
+  for (size_t op = 0; op < WRITER_OPERATION_COUNT; ++op) {
+    print_row(WRITER_OPERATION_NAMES[op], writer_latencies[op], elapsed, nullptr);
+  }
+  printf("\n");
+
+  lo_destroy_snapshot(snapshot);
+  lo_destroy_handle(handle);
+  fs::remove_all(game_path);
+}
+
+bool parse_count(const char * value, unsigned long long & count) {
+  char * end = nullptr;
+  count = std::strtoull(value, &end, 10);
+  return end != value && *end == '\0' && count > 0;
+}
+
+bool parse_options(int argc, char ** argv, Options & options) {
+  for (int i = 1; i < argc; ++i) {
+    if (i + 1 >= argc) {
+      return false;
+    }
+
+    const char * option = argv[i];
+    const char * value = argv[++i];
+
+    if (strcmp(option, "--testing-plugins") == 0) {
+      options.testing_plugins_path = value;
+      continue;
+    }
+
+    unsigned long long count = 0;
+    if (!parse_count(value, count)) {
+      return false;
+    }
+
+    if (strcmp(option, "--plugins") == 0) {
+      if (count < MIN_PLUGIN_COUNT) {
+        return false;
+      }
+      options.plugin_counts.push_back(static_cast<size_t>(count));
+    } else if (strcmp(option, "--readers") == 0) {
+      options.reader_threads = static_cast<unsigned int>(count);
+    } else if (strcmp(option, "--seconds") == 0) {
+      options.duration = std::chrono::seconds(count);
+    } else if (strcmp(option, "--writer-interval-ms") == 0) {
+      options.writer_interval = std::chrono::milliseconds(count);
+    } else {
+      return false;
+    }
+  }
+
+  if (options.plugin_counts.empty()) {
+    options.plugin_counts = { 1000, 5000 };
+  }
+
+  return true;
+}
+
+int main(int argc, char ** argv) {
+  Options options;
+  if (!parse_options(argc, argv, options)) {
+    fprintf(stderr,
+      "Usage: %s [--testing-plugins <path>] [--plugins <count>]... [--readers <count>] "
+      "[--seconds <count>] [--writer-interval-ms <count>]\n",
+      argv[0]);
+    return 1;
+  }
+
+  for (const auto plugin_count : options.plugin_counts) {
+    run_benchmark(options, plugin_count);
+  }
+
+  return 0;
+}
@@ -23,11 +23,14 @@ use std::ptr;
 
 use libc::size_t;
 
-use super::lo_game_handle;
+use super::{lo_game_handle, lo_string_buffer};
 use crate::constants::{
     LIBLO_ERROR_INVALID_ARGS, LIBLO_ERROR_PANICKED, LIBLO_ERROR_POISONED_THREAD_LOCK, LIBLO_OK,
 };
-use crate::helpers::{error, handle_error, to_c_string_array, to_str, to_str_vec};
+use crate::helpers::{
+    empty_string_buffer, error, handle_error, to_c_string_array, to_str, to_str_vec,
+    to_string_buffer,
+};
 
 /// Gets the list of currently active plugins.
 ///
@@ -80,6 +83,47 @@ pub unsafe extern "C" fn lo_get_active_plugins(
     .unwrap_or(LIBLO_ERROR_PANICKED)
 }
 
+/// Gets the list of currently active plugins, packed into a single string buffer.
+///
+/// This outputs the same strings in the same order as `lo_get_active_plugins()`, but with all of them in one
+/// buffer, which is cheaper to allocate and free than a string array.
+///
+/// The output must be freed using `lo_free_string_buffer()`.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+///
+/// # Safety
+///
+/// - `handle` must be a value that was previously set by `lo_create_handle()` and that has not been
+///   destroyed using `lo_destroy_handle()`.
+/// - `plugins` must be a dereferenceable pointer.
+#[no_mangle]
+pub unsafe extern "C" fn lo_get_active_plugins_packed(
+    handle: lo_game_handle,
+    plugins: *mut lo_string_buffer,
+) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() || plugins.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+
+        let handle = match (*handle).read() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, &e.to_string()),
+            Ok(h) => h,
+        };
+
+        *plugins = empty_string_buffer();
+
+        match to_string_buffer(&handle.active_plugin_names()) {
+            Ok(buffer) => *plugins = buffer,
+            Err(x) => return error(x, "A filename contained a null byte"),
+        }
+
+        LIBLO_OK
+    })
+    .unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
 /// Sets the list of currently active plugins.
 ///
 /// Replaces the current active plugins list with the plugins in the given array. The replacement
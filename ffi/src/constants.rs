@@ -92,12 +92,20 @@ pub static LIBLO_ERROR_SYSTEM_ERROR: c_uint = 22;
 #[no_mangle]
 pub static LIBLO_ERROR_NO_PATH: c_uint = 23;
 
+/// The operation was cancelled before it completed.
+#[no_mangle]
+pub static LIBLO_ERROR_CANCELLED: c_uint = 24;
+
+/// The game's paths have changed since the given resolved game settings were exported.
+#[no_mangle]
+pub static LIBLO_ERROR_OUTDATED_SETTINGS: c_uint = 25;
+
 /// Matches the value of the highest-numbered return code.
 ///
 /// Provided in case clients wish to incorporate additional return codes in their implementation
 /// and desire some method of avoiding value conflicts.
 #[no_mangle]
-pub static LIBLO_RETURN_MAX: c_uint = 23;
+pub static LIBLO_RETURN_MAX: c_uint = 25;
 
 /// The game handle is using the timestamp-based load order system. Morrowind, Oblivion, Fallout 3
 /// and Fallout: New Vegas all use this system.
@@ -116,6 +124,38 @@ pub static LIBLO_METHOD_ASTERISK: c_uint = 2;
 #[no_mangle]
 pub static LIBLO_METHOD_OPENMW: c_uint = 3;
 
+/// A batch operation that sets a plugin's load order position.
+#[no_mangle]
+pub static LIBLO_BATCH_SET_POSITION: c_uint = 0;
+
+/// A batch operation that activates a plugin.
+#[no_mangle]
+pub static LIBLO_BATCH_ACTIVATE: c_uint = 1;
+
+/// A batch operation that deactivates a plugin.
+#[no_mangle]
+pub static LIBLO_BATCH_DEACTIVATE: c_uint = 2;
+
+/// A load order change that removes a plugin from the load order.
+#[no_mangle]
+pub static LIBLO_CHANGE_REMOVE: c_uint = 0;
+
+/// A load order change that adds a plugin to the load order.
+#[no_mangle]
+pub static LIBLO_CHANGE_ADD: c_uint = 1;
+
+/// A load order change that moves a plugin to a new load order position.
+#[no_mangle]
+pub static LIBLO_CHANGE_MOVE: c_uint = 2;
+
+/// A load order change that activates a plugin.
+#[no_mangle]
+pub static LIBLO_CHANGE_ACTIVATE: c_uint = 3;
+
+/// A load order change that deactivates a plugin.
+#[no_mangle]
+pub static LIBLO_CHANGE_DEACTIVATE: c_uint = 4;
+
 /// Game code for The Elder Scrolls III: Morrowind.
 #[no_mangle]
 pub static LIBLO_GAME_TES3: c_uint = 1;
@@ -19,13 +19,20 @@
 
 use std::ffi::{c_char, c_uint};
 use std::panic::catch_unwind;
-use std::path::Path;
+use std::path::{Path, PathBuf};
 use std::ptr;
-use std::sync::RwLock;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{LockResult, RwLock, RwLockReadGuard, RwLockWriteGuard};
+use std::time::Duration;
 
 use libc::size_t;
+use loadorder::Error;
 use loadorder::GameId;
 use loadorder::GameSettings;
+use loadorder::LoadProgress;
+use loadorder::Metrics;
+use loadorder::Parallelism;
+use loadorder::SharedHeaderCache;
 use loadorder::WritableLoadOrder;
 
 use crate::constants::{
@@ -36,8 +43,10 @@ use crate::constants::{
     LIBLO_OK, LIBLO_WARN_LO_MISMATCH,
 };
 use crate::helpers::{
-    error, handle_error, to_c_string, to_c_string_array, to_path_buf_vec, to_str,
+    empty_string_buffer, error, handle_error, to_c_string, to_c_string_array, to_path_buf_vec,
+    to_str, to_string_buffer,
 };
+use crate::lo_string_buffer;
 
 /// A structure that holds all game-specific data used by libloadorder.
 ///
@@ -48,7 +57,56 @@ pub type lo_game_handle = *mut GameHandle;
 
 // This type alias is necessary to make cbindgen treat lo_game_handle as a
 // pointer to an undefined type, rather than an undefined type itself.
-type GameHandle = RwLock<Box<dyn WritableLoadOrder>>;
+pub(crate) type GameHandle = LockedLoadOrder;
+
+type BoxedLoadOrder = Box<dyn WritableLoadOrder + Send + Sync>;
+
+/// A load order that can be shared between threads, which counts the number
+/// of times it has been locked for writing, so that state loaded into a copy
+/// of it isn't swapped in over changes that were made while it was loading.
+#[derive(Debug)]
+pub struct LockedLoadOrder {
+    load_order: RwLock<BoxedLoadOrder>,
+    generation: AtomicU64,
+}
+
+impl LockedLoadOrder {
+    fn new(load_order: BoxedLoadOrder) -> Self {
+        LockedLoadOrder {
+            load_order: RwLock::new(load_order),
+            generation: AtomicU64::new(0),
+        }
+    }
+
+    pub(crate) fn read(&self) -> LockResult<RwLockReadGuard<'_, BoxedLoadOrder>> {
+        self.load_order.read()
+    }
+
+    /// Every write lock is treated as a change to the load order.
+    pub(crate) fn write(&self) -> LockResult<RwLockWriteGuard<'_, BoxedLoadOrder>> {
+        let guard = self.load_order.write();
+        // The generation only changes while the write lock is held.
+        self.generation.fetch_add(1, Ordering::Relaxed);
+        guard
+    }
+
+    /// Lock the load order for reading, and get its current generation.
+    fn read_with_generation(&self) -> Result<(RwLockReadGuard<'_, BoxedLoadOrder>, u64), String> {
+        let guard = self.load_order.read().map_err(|e| e.to_string())?;
+        Ok((guard, self.generation.load(Ordering::Relaxed)))
+    }
+
+    /// Lock the load order for writing, and check if it is still at the
+    /// given generation.
+    fn write_if_unchanged_since(
+        &self,
+        generation: u64,
+    ) -> Result<(RwLockWriteGuard<'_, BoxedLoadOrder>, bool), String> {
+        let guard = self.load_order.write().map_err(|e| e.to_string())?;
+        let is_unchanged = self.generation.fetch_add(1, Ordering::Relaxed) == generation;
+        Ok((guard, is_unchanged))
+    }
+}
 
 fn map_game_id(game_id: u32) -> Result<GameId, u32> {
     match game_id {
@@ -125,7 +183,7 @@ pub unsafe extern "C" fn lo_create_handle(
             );
         }
 
-        let load_order: Box<dyn WritableLoadOrder>;
+        let load_order: Box<dyn WritableLoadOrder + Send + Sync>;
         if local_path.is_null() {
             match GameSettings::new(game_id, game_path) {
                 Ok(x) => load_order = x.into_load_order(),
@@ -155,7 +213,58 @@ pub unsafe extern "C" fn lo_create_handle(
 
         let is_self_consistent = load_order.is_self_consistent();
 
-        *handle = Box::into_raw(Box::new(RwLock::new(load_order)));
+        *handle = Box::into_raw(Box::new(LockedLoadOrder::new(load_order)));
+
+        match is_self_consistent {
+            Ok(true) => LIBLO_OK,
+            Ok(false) => LIBLO_WARN_LO_MISMATCH,
+            Err(x) => handle_error(&x),
+        }
+    })
+    .unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
+/// Initialise a new game handle from resolved game settings.
+///
+/// Creates a handle for a game using game settings that were previously output by
+/// `lo_get_resolved_settings()`, possibly in another process. This skips looking up the game's
+/// paths, which involves reading several files, and only checks that none of the files that they
+/// were looked up from have changed since. Like `lo_create_handle()`, this function also checks
+/// if the two load order files are in sync, provided they both exist.
+///
+/// The thread count, metrics and shared header cache setting of the handle that the settings were
+/// taken from are not included, so they are reset to their defaults.
+///
+/// Returns `LIBLO_OK` if successful, or `LIBLO_ERROR_OUTDATED_SETTINGS` if the game's paths may
+/// have changed since the settings were output, in which case `lo_create_handle()` should be used
+/// instead. Otherwise a `LIBLO_ERROR_*` code is returned.
+///
+/// # Safety
+///
+/// - `handle` must be a dereferenceable pointer.
+/// - `data` must be a non-null aligned pointer to a sequence of `size` bytes within a single
+///   allocated object.
+#[no_mangle]
+pub unsafe extern "C" fn lo_create_handle_from_resolved_settings(
+    handle: *mut lo_game_handle,
+    data: *const u8,
+    size: size_t,
+) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() || data.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer(s) passed");
+        }
+
+        let bytes = std::slice::from_raw_parts(data, size);
+
+        let load_order = match GameSettings::from_resolved_bytes(bytes) {
+            Ok(x) => x.into_load_order(),
+            Err(x) => return handle_error(&x),
+        };
+
+        let is_self_consistent = load_order.is_self_consistent();
+
+        *handle = Box::into_raw(Box::new(LockedLoadOrder::new(load_order)));
 
         match is_self_consistent {
             Ok(true) => LIBLO_OK,
@@ -188,6 +297,13 @@ pub unsafe extern "C" fn lo_destroy_handle(handle: lo_game_handle) {
 /// This function should be called whenever the load order or active state of plugins "on disk"
 /// changes, so that cached state is updated to reflect the changes.
 ///
+/// The state is loaded into a copy of the handle's load order, which then replaces it. Other
+/// threads can continue to read from the handle while the state is being loaded, and see either
+/// the previously held state or the newly loaded state, never a partially loaded state. If another
+/// thread changes the handle's state or game settings while the state is being loaded, the copy
+/// is discarded and the state is loaded again into the handle itself, so that those changes
+/// aren't lost.
+///
 /// # Safety
 ///
 /// - `handle` must be a value that was previously set by `lo_create_handle()` and that has not been
@@ -199,25 +315,52 @@ pub unsafe extern "C" fn lo_load_current_state(handle: lo_game_handle) -> c_uint
             return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
         }
 
-        let mut handle = match (*handle).write() {
-            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, &e.to_string()),
-            Ok(h) => h,
-        };
+        load_current_state(&*handle, &LoadProgress::new())
+    })
+    .unwrap_or(LIBLO_ERROR_PANICKED)
+}
 
-        if let Err(x) = handle
-            .game_settings_mut()
-            .refresh_implicitly_active_plugins()
-        {
-            return handle_error(&x);
-        }
+pub(crate) fn load_current_state(handle: &GameHandle, progress: &LoadProgress) -> c_uint {
+    // Only hold the read lock while copying the load order, so that loading
+    // doesn't block anything else from using the handle.
+    let (mut load_order, generation) = match handle.read_with_generation() {
+        Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, &e),
+        Ok((h, generation)) => (h.boxed_clone(), generation),
+    };
 
-        if let Err(x) = handle.load() {
+    if let Err(x) = refresh_and_load(&mut *load_order, progress) {
+        return handle_error(&x);
+    }
+
+    let (mut handle, is_unchanged) = match handle.write_if_unchanged_since(generation) {
+        Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, &e),
+        Ok(h) => h,
+    };
+
+    if is_unchanged {
+        *handle = load_order;
+    } else {
+        // The handle was changed while the state was being loaded, possibly
+        // including its game settings or the files that were loaded, so the
+        // state needs to be loaded again. This load can't be cancelled, as
+        // that would leave the handle's load order incomplete.
+        if let Err(x) = refresh_and_load(&mut **handle, &LoadProgress::new()) {
             return handle_error(&x);
         }
+    }
 
-        LIBLO_OK
-    })
-    .unwrap_or(LIBLO_ERROR_PANICKED)
+    LIBLO_OK
+}
+
+fn refresh_and_load(
+    load_order: &mut dyn WritableLoadOrder,
+    progress: &LoadProgress,
+) -> Result<(), Error> {
+    load_order
+        .game_settings_mut()
+        .refresh_implicitly_active_plugins()?;
+
+    load_order.load_with_progress(progress)
 }
 
 /// Check if the load order is ambiguous, by checking that all plugins in the current load order
@@ -256,6 +399,97 @@ pub unsafe extern "C" fn lo_is_ambiguous(handle: lo_game_handle, result: *mut bo
     .unwrap_or(LIBLO_ERROR_PANICKED)
 }
 
+/// Check if any of the files that the load order state was loaded from have changed since the
+/// state was last loaded.
+///
+/// This only reads the metadata of the active plugins file, load order file, CCC and ini files,
+/// plugins directories and loaded plugins, so is much cheaper than calling
+/// `lo_load_current_state()`. Changes made to the plugin lists by libloadorder itself are not
+/// counted, but unghosting plugins to activate them changes their plugins directory, so is
+/// counted. If no state has been loaded, the state is counted as changed.
+///
+/// Outputs `true` if the state has changed and should be loaded again, and `false` otherwise.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+///
+/// # Safety
+///
+/// - `handle` must be a value that was previously set by `lo_create_handle()` and that has not been
+///   destroyed using `lo_destroy_handle()`.
+/// - `result` must be a dereferenceable pointer.
+#[no_mangle]
+pub unsafe extern "C" fn lo_has_state_changed(handle: lo_game_handle, result: *mut bool) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() || result.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+
+        let handle = match (*handle).read() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, &e.to_string()),
+            Ok(h) => h,
+        };
+
+        *result = !handle.changes_since_load().is_empty();
+
+        LIBLO_OK
+    })
+    .unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
+/// Get the loaded plugins with files that have changed or been removed since the load order state
+/// was last loaded.
+///
+/// Plugins are listed in their load order. Plugins that have been installed since the state was
+/// last loaded are not listed, but are detected by `lo_has_state_changed()`.
+///
+/// If the list is empty, the `plugins` pointer will be null and `num_plugins` will be `0`.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+///
+/// # Safety
+///
+/// - `handle` must be a value that was previously set by `lo_create_handle()` and that has not been
+///   destroyed using `lo_destroy_handle()`.
+/// - `plugins` must be a dereferenceable pointer.
+/// - `num_plugins` must be a dereferenceable pointer.
+#[no_mangle]
+pub unsafe extern "C" fn lo_get_changed_plugins(
+    handle: lo_game_handle,
+    plugins: *mut *mut *mut c_char,
+    num_plugins: *mut size_t,
+) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() || plugins.is_null() || num_plugins.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+
+        let handle = match (*handle).read() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, &e.to_string()),
+            Ok(h) => h,
+        };
+
+        *plugins = ptr::null_mut();
+        *num_plugins = 0;
+
+        let plugin_names = handle.changes_since_load().changed_plugins;
+
+        if plugin_names.is_empty() {
+            return LIBLO_OK;
+        }
+
+        match to_c_string_array(&plugin_names) {
+            Ok((pointer, size)) => {
+                *plugins = pointer;
+                *num_plugins = size;
+            }
+            Err(x) => return error(x, "A filename contained a null byte"),
+        }
+
+        LIBLO_OK
+    })
+    .unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
 /// Fix up the text file(s) used by the load order and active plugins systems.
 ///
 /// This checks that the load order and active plugin lists conform to libloadorder's validity
@@ -281,22 +515,40 @@ pub unsafe extern "C" fn lo_fix_plugin_lists(handle: lo_game_handle) -> c_uint {
             return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
         }
 
-        let mut handle = match (*handle).write() {
-            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, &e.to_string()),
-            Ok(h) => h,
-        };
+        fix_plugin_lists(&*handle, &LoadProgress::new())
+    })
+    .unwrap_or(LIBLO_ERROR_PANICKED)
+}
 
-        if let Err(x) = handle.load() {
-            return handle_error(&x);
-        }
+pub(crate) fn fix_plugin_lists(handle: &GameHandle, progress: &LoadProgress) -> c_uint {
+    // Load into a copy of the load order in the same way as
+    // load_current_state(), so that the handle is only locked for writing
+    // while the fixed lists are saved.
+    let (mut load_order, generation) = match handle.read_with_generation() {
+        Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, &e),
+        Ok((h, generation)) => (h.boxed_clone(), generation),
+    };
+
+    if let Err(x) = load_order.load_with_progress(progress) {
+        return handle_error(&x);
+    }
 
-        if let Err(x) = handle.save() {
-            return handle_error(&x);
-        }
+    let (mut handle, is_unchanged) = match handle.write_if_unchanged_since(generation) {
+        Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, &e),
+        Ok(h) => h,
+    };
 
-        LIBLO_OK
-    })
-    .unwrap_or(LIBLO_ERROR_PANICKED)
+    if is_unchanged {
+        *handle = load_order;
+    } else if let Err(x) = handle.load() {
+        return handle_error(&x);
+    }
+
+    if let Err(x) = handle.save() {
+        return handle_error(&x);
+    }
+
+    LIBLO_OK
 }
 
 /// Get the list of implicitly active plugins for the given handle's game.
@@ -352,6 +604,47 @@ pub unsafe extern "C" fn lo_get_implicitly_active_plugins(
     .unwrap_or(LIBLO_ERROR_PANICKED)
 }
 
+/// Get the list of implicitly active plugins for the given handle's game, packed into a single string buffer.
+///
+/// This outputs the same strings in the same order as `lo_get_implicitly_active_plugins()`, but with all of them in one
+/// buffer, which is cheaper to allocate and free than a string array.
+///
+/// The output must be freed using `lo_free_string_buffer()`.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+///
+/// # Safety
+///
+/// - `handle` must be a value that was previously set by `lo_create_handle()` and that has not been
+///   destroyed using `lo_destroy_handle()`.
+/// - `plugins` must be a dereferenceable pointer.
+#[no_mangle]
+pub unsafe extern "C" fn lo_get_implicitly_active_plugins_packed(
+    handle: lo_game_handle,
+    plugins: *mut lo_string_buffer,
+) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() || plugins.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+
+        let handle = match (*handle).read() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, &e.to_string()),
+            Ok(h) => h,
+        };
+
+        *plugins = empty_string_buffer();
+
+        match to_string_buffer(handle.game_settings().implicitly_active_plugins()) {
+            Ok(buffer) => *plugins = buffer,
+            Err(x) => return error(x, "A filename contained a null byte"),
+        }
+
+        LIBLO_OK
+    })
+    .unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
 /// Get the list of plugins that load before all others for the given handle's game.
 ///
 /// The list may be empty if the game has no early loading plugins. The list may include plugins
@@ -412,6 +705,47 @@ pub unsafe extern "C" fn lo_get_early_loading_plugins(
     .unwrap_or(LIBLO_ERROR_PANICKED)
 }
 
+/// Get the list of plugins that load before all others for the given handle's game, packed into a single string buffer.
+///
+/// This outputs the same strings in the same order as `lo_get_early_loading_plugins()`, but with all of them in one
+/// buffer, which is cheaper to allocate and free than a string array.
+///
+/// The output must be freed using `lo_free_string_buffer()`.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+///
+/// # Safety
+///
+/// - `handle` must be a value that was previously set by `lo_create_handle()` and that has not been
+///   destroyed using `lo_destroy_handle()`.
+/// - `plugins` must be a dereferenceable pointer.
+#[no_mangle]
+pub unsafe extern "C" fn lo_get_early_loading_plugins_packed(
+    handle: lo_game_handle,
+    plugins: *mut lo_string_buffer,
+) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() || plugins.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+
+        let handle = match (*handle).read() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, &e.to_string()),
+            Ok(h) => h,
+        };
+
+        *plugins = empty_string_buffer();
+
+        match to_string_buffer(handle.game_settings().early_loading_plugins()) {
+            Ok(buffer) => *plugins = buffer,
+            Err(x) => return error(x, "A filename contained a null byte"),
+        }
+
+        LIBLO_OK
+    })
+    .unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
 /// Get the active plugins file path for the given game handle.
 ///
 /// The active plugins file path is often within the game's local path, but its name and location
@@ -458,6 +792,59 @@ pub unsafe extern "C" fn lo_get_active_plugins_file_path(
     .unwrap_or(LIBLO_ERROR_PANICKED)
 }
 
+/// Get the handle's resolved game settings.
+///
+/// Outputs the game's paths and early-loading and implicitly active plugins, along with
+/// fingerprints of the files that they were read from, as an opaque sequence of bytes. The bytes
+/// can be passed to `lo_create_handle_from_resolved_settings()` to cheaply create a handle for the
+/// same game, e.g. in a short-lived worker process. They are only compatible with the same version
+/// of libloadorder.
+///
+/// The output must be freed using `lo_free_resolved_settings()`.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+///
+/// # Safety
+///
+/// - `handle` must be a value that was previously set by `lo_create_handle()` and that has not been
+///   destroyed using `lo_destroy_handle()`.
+/// - `data` must be a dereferenceable pointer.
+/// - `size` must be a dereferenceable pointer.
+#[no_mangle]
+pub unsafe extern "C" fn lo_get_resolved_settings(
+    handle: lo_game_handle,
+    data: *mut *mut u8,
+    size: *mut size_t,
+) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() || data.is_null() || size.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+
+        let handle = match (*handle).read() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, &e.to_string()),
+            Ok(h) => h,
+        };
+
+        let bytes = match handle.game_settings().to_resolved_bytes() {
+            Ok(x) => x,
+            Err(Error::InvalidPath(_)) => {
+                return error(
+                    LIBLO_ERROR_PATH_ENCODE_FAIL,
+                    "A game settings path could not be encoded in UTF-8",
+                )
+            }
+            Err(x) => return handle_error(&x),
+        };
+
+        *size = bytes.len();
+        *data = Box::into_raw(bytes.into_boxed_slice()).cast();
+
+        LIBLO_OK
+    })
+    .unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
 /// Gets the additional plugins directories that are used when looking up plugin filenames.
 ///
 /// Some games (Fallout 4, Starfield and OpenMW) support loading plugins from outside of the game's
@@ -565,12 +952,503 @@ pub unsafe extern "C" fn lo_set_additional_plugins_directories(
     .unwrap_or(LIBLO_ERROR_PANICKED)
 }
 
-#[cfg(test)]
-mod tests {
-    use std::ffi::CString;
-    use std::path::PathBuf;
+/// Enables caching plugin header data in a file between loads.
+///
+/// When header caching is enabled, the first call to `lo_load_current_state()` reads the cache
+/// file, and only parses the plugins that have changed since they were cached. The cache file is
+/// updated whenever any plugins are parsed. Header caching is disabled by default.
+///
+/// If `cache_path` is null, the cache file is stored next to the game's active plugins file.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+///
+/// # Safety
+///
+/// - `handle` must be a value that was previously set by `lo_create_handle()` and that has not been
+///   destroyed using `lo_destroy_handle()`.
+/// - If not null, `cache_path` must be a null-terminated string contained within a single
+///   allocation.
+#[no_mangle]
+pub unsafe extern "C" fn lo_enable_header_cache(
+    handle: lo_game_handle,
+    cache_path: *const c_char,
+) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+
+        let mut handle = match (*handle).write() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, &e.to_string()),
+            Ok(h) => h,
+        };
+
+        let cache_path = if cache_path.is_null() {
+            handle.game_settings().default_header_cache_path()
+        } else {
+            match to_str(cache_path) {
+                Ok(x) => PathBuf::from(x),
+                Err(x) => return x,
+            }
+        };
+
+        handle
+            .game_settings_mut()
+            .set_header_cache_path(Some(cache_path));
+
+        LIBLO_OK
+    })
+    .unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
+/// Disables caching plugin header data in a file between loads.
+///
+/// Any existing cache file is left in place.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+///
+/// # Safety
+///
+/// - `handle` must be a value that was previously set by `lo_create_handle()` and that has not been
+///   destroyed using `lo_destroy_handle()`.
+#[no_mangle]
+pub unsafe extern "C" fn lo_disable_header_cache(handle: lo_game_handle) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+
+        let mut handle = match (*handle).write() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, &e.to_string()),
+            Ok(h) => h,
+        };
+
+        handle.game_settings_mut().set_header_cache_path(None);
+
+        LIBLO_OK
+    })
+    .unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
+/// Enables sharing parsed plugin header data with other handles.
+///
+/// All handles with header sharing enabled use the same process-wide cache, so a plugin's header
+/// is only parsed once, and only stored once, however many handles load it. This includes handles
+/// for different games that share a plugins directory. Cached headers are reused while their
+/// plugins' files have the same modification time and size. Header sharing is disabled by default.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+///
+/// # Safety
+///
+/// - `handle` must be a value that was previously set by `lo_create_handle()` and that has not been
+///   destroyed using `lo_destroy_handle()`.
+#[no_mangle]
+pub unsafe extern "C" fn lo_enable_shared_header_cache(handle: lo_game_handle) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+
+        let mut handle = match (*handle).write() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, &e.to_string()),
+            Ok(h) => h,
+        };
+
+        handle
+            .game_settings_mut()
+            .set_shared_header_cache(Some(SharedHeaderCache::global()));
+
+        LIBLO_OK
+    })
+    .unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
+/// Disables sharing parsed plugin header data with other handles.
+///
+/// Headers that the handle has already loaded stay in the shared cache until they are evicted.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+///
+/// # Safety
+///
+/// - `handle` must be a value that was previously set by `lo_create_handle()` and that has not been
+///   destroyed using `lo_destroy_handle()`.
+#[no_mangle]
+pub unsafe extern "C" fn lo_disable_shared_header_cache(handle: lo_game_handle) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+
+        let mut handle = match (*handle).write() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, &e.to_string()),
+            Ok(h) => h,
+        };
+
+        handle.game_settings_mut().set_shared_header_cache(None);
+
+        LIBLO_OK
+    })
+    .unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
+/// Sets the maximum amount of memory in bytes that the process-wide shared header cache uses.
+///
+/// When the cache is full, the headers that were least recently used are evicted. The capacity is
+/// 32 MiB by default, which is enough for several thousand plugins. Setting it to `0` empties the
+/// cache and stops headers from being shared.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+#[no_mangle]
+pub extern "C" fn lo_set_shared_header_cache_capacity(capacity: size_t) -> c_uint {
+    catch_unwind(|| {
+        SharedHeaderCache::global().set_capacity(capacity);
+
+        LIBLO_OK
+    })
+    .unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
+/// Sets how many threads the given handle uses for its work.
+///
+/// By default, libloadorder uses rayon's global thread pool, which is shared with anything else in
+/// the process that uses it. If `thread_count` is `1`, all work is done on the calling thread, and
+/// background jobs run on a new thread. If it is larger, the handle gets a dedicated thread pool with
+/// that many threads. If it is `0`, the handle goes back to using the global thread pool.
+///
+/// Whatever the thread count, work is only split across threads if there is enough of it to
+/// outweigh the cost of doing so.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+///
+/// # Safety
+///
+/// - `handle` must be a value that was previously set by `lo_create_handle()` and that has not been
+///   destroyed using `lo_destroy_handle()`.
+#[no_mangle]
+pub unsafe extern "C" fn lo_set_thread_count(
+    handle: lo_game_handle,
+    thread_count: size_t,
+) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+
+        let parallelism = match thread_count {
+            0 => Parallelism::Global,
+            1 => Parallelism::Serial,
+            threads => match Parallelism::with_threads(threads) {
+                Ok(x) => x,
+                Err(x) => return handle_error(&x),
+            },
+        };
+
+        let mut handle = match (*handle).write() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, &e.to_string()),
+            Ok(h) => h,
+        };
+
+        handle.game_settings_mut().set_parallelism(parallelism);
+
+        LIBLO_OK
+    })
+    .unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
+/// Load and save metrics for a game handle, as output by `lo_get_metrics()`.
+///
+/// Counts and times are totals since the handle was created or its metrics were last reset. Phase
+/// times are summed across threads, so phases that are run in parallel, like parsing plugin
+/// headers, can add up to more than the time spent loading.
+#[repr(C)]
+#[derive(Clone, Copy, Debug, Default)]
+pub struct lo_metrics {
+    /// The number of plugin files that had their metadata read while scanning the plugins
+    /// directories.
+    pub files_stated: u64,
+    /// The number of plugin headers that were parsed.
+    pub headers_parsed: u64,
+    /// The number of bytes read from plugins and plugin lists.
+    pub bytes_read: u64,
+    /// The number of files that were written, renamed to unghost them or had their timestamps
+    /// changed.
+    pub files_written: u64,
+    pub load_time_ns: u64,
+    pub save_time_ns: u64,
+    pub find_plugins_time_ns: u64,
+    pub parse_headers_time_ns: u64,
+    pub unghost_time_ns: u64,
+    pub hoist_masters_time_ns: u64,
+    pub validate_time_ns: u64,
+    pub save_timestamps_time_ns: u64,
+}
+
+impl From<Metrics> for lo_metrics {
+    fn from(metrics: Metrics) -> Self {
+        let nanos = |duration: Duration| u64::try_from(duration.as_nanos()).unwrap_or(u64::MAX);
+
+        lo_metrics {
+            files_stated: metrics.files_stated,
+            headers_parsed: metrics.headers_parsed,
+            bytes_read: metrics.bytes_read,
+            files_written: metrics.files_written,
+            load_time_ns: nanos(metrics.load_time),
+            save_time_ns: nanos(metrics.save_time),
+            find_plugins_time_ns: nanos(metrics.find_plugins_time),
+            parse_headers_time_ns: nanos(metrics.parse_headers_time),
+            unghost_time_ns: nanos(metrics.unghost_time),
+            hoist_masters_time_ns: nanos(metrics.hoist_masters_time),
+            validate_time_ns: nanos(metrics.validate_time),
+            save_timestamps_time_ns: nanos(metrics.save_timestamps_time),
+        }
+    }
+}
+
+/// Gets the load and save metrics recorded for the given handle.
+///
+/// This includes work done by asynchronous jobs for the handle.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+///
+/// # Safety
+///
+/// - `handle` must be a value that was previously set by `lo_create_handle()` and that has not been
+///   destroyed using `lo_destroy_handle()`.
+/// - `metrics` must be a dereferenceable pointer.
+#[no_mangle]
+pub unsafe extern "C" fn lo_get_metrics(
+    handle: lo_game_handle,
+    metrics: *mut lo_metrics,
+) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() || metrics.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+
+        let handle = match (*handle).read() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, &e.to_string()),
+            Ok(h) => h,
+        };
+
+        *metrics = handle.game_settings().metrics().into();
+
+        LIBLO_OK
+    })
+    .unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
+/// Resets the load and save metrics recorded for the given handle to zero.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+///
+/// # Safety
+///
+/// - `handle` must be a value that was previously set by `lo_create_handle()` and that has not been
+///   destroyed using `lo_destroy_handle()`.
+#[no_mangle]
+pub unsafe extern "C" fn lo_reset_metrics(handle: lo_game_handle) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+
+        let handle = match (*handle).read() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, &e.to_string()),
+            Ok(h) => h,
+        };
+
+        handle.game_settings().reset_metrics();
+
+        LIBLO_OK
+    })
+    .unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
+#[cfg(test)]
+mod tests {
+    use std::ffi::CString;
 
     use super::*;
+    use crate::{lo_free_resolved_settings, LIBLO_ERROR_OUTDATED_SETTINGS};
+
+    #[test]
+    fn lo_set_thread_count_should_set_the_handle_parallelism() {
+        let mut handle: lo_game_handle = std::ptr::null_mut();
+        let game_path = CString::new(".").unwrap();
+
+        unsafe {
+            let result = lo_create_handle(
+                &mut handle,
+                LIBLO_GAME_TES5,
+                game_path.as_ptr(),
+                game_path.as_ptr(),
+            );
+            assert_eq!(LIBLO_OK, result);
+
+            assert_eq!(LIBLO_OK, lo_set_thread_count(handle, 1));
+            assert_eq!(
+                Parallelism::Serial,
+                *(*handle).read().unwrap().game_settings().parallelism()
+            );
+
+            assert_eq!(LIBLO_OK, lo_set_thread_count(handle, 2));
+            assert!(matches!(
+                (*handle).read().unwrap().game_settings().parallelism(),
+                Parallelism::Pool(_)
+            ));
+
+            assert_eq!(LIBLO_OK, lo_set_thread_count(handle, 0));
+            assert_eq!(
+                Parallelism::Global,
+                *(*handle).read().unwrap().game_settings().parallelism()
+            );
+
+            lo_destroy_handle(handle);
+        }
+    }
+
+    #[test]
+    fn locked_load_order_should_be_changed_since_a_generation_if_it_was_locked_for_writing() {
+        let mut handle: lo_game_handle = std::ptr::null_mut();
+        let game_path = CString::new(".").unwrap();
+
+        unsafe {
+            let result = lo_create_handle(
+                &mut handle,
+                LIBLO_GAME_TES5,
+                game_path.as_ptr(),
+                game_path.as_ptr(),
+            );
+            assert_eq!(LIBLO_OK, result);
+
+            let generation = (*handle).read_with_generation().unwrap().1;
+
+            let is_unchanged = (*handle).write_if_unchanged_since(generation).unwrap().1;
+            assert!(is_unchanged);
+
+            let generation = (*handle).read_with_generation().unwrap().1;
+
+            drop((*handle).write().unwrap());
+
+            let is_unchanged = (*handle).write_if_unchanged_since(generation).unwrap().1;
+            assert!(!is_unchanged);
+
+            lo_destroy_handle(handle);
+        }
+    }
+
+    #[test]
+    fn lo_create_handle_from_resolved_settings_should_error_if_the_settings_are_outdated() {
+        let tmp_dir = tempfile::tempdir().unwrap();
+        let game_path = CString::new(tmp_dir.path().to_str().unwrap()).unwrap();
+
+        let mut handle: lo_game_handle = std::ptr::null_mut();
+        let mut other_handle: lo_game_handle = std::ptr::null_mut();
+        let mut data: *mut u8 = std::ptr::null_mut();
+        let mut size: size_t = 0;
+
+        unsafe {
+            let result = lo_create_handle(
+                &mut handle,
+                LIBLO_GAME_TES5,
+                game_path.as_ptr(),
+                game_path.as_ptr(),
+            );
+            assert_eq!(LIBLO_OK, result);
+
+            assert_eq!(
+                LIBLO_OK,
+                lo_get_resolved_settings(handle, &mut data, &mut size)
+            );
+
+            // The launcher's presence means the game is Enderal, which has
+            // different paths.
+            std::fs::write(tmp_dir.path().join("Enderal Launcher.exe"), "").unwrap();
+
+            assert_eq!(
+                LIBLO_ERROR_OUTDATED_SETTINGS,
+                lo_create_handle_from_resolved_settings(&mut other_handle, data, size)
+            );
+            assert!(other_handle.is_null());
+
+            lo_free_resolved_settings(data, size);
+            lo_destroy_handle(handle);
+        }
+    }
+
+    #[test]
+    fn lo_get_metrics_should_count_plugins_loaded_and_reset_should_zero_them() {
+        let tmp_dir = tempfile::tempdir().unwrap();
+        let game_path = tmp_dir.path().join("game");
+        let data_path = game_path.join("Data");
+        std::fs::create_dir_all(&data_path).unwrap();
+        std::fs::write(data_path.join("Blank.esp"), b"TES4").unwrap();
+        let game_path = CString::new(game_path.to_str().unwrap()).unwrap();
+        let local_path = CString::new(tmp_dir.path().to_str().unwrap()).unwrap();
+
+        let mut handle: lo_game_handle = std::ptr::null_mut();
+        let mut metrics = lo_metrics::default();
+
+        unsafe {
+            let result = lo_create_handle(
+                &mut handle,
+                LIBLO_GAME_TES5,
+                game_path.as_ptr(),
+                local_path.as_ptr(),
+            );
+            assert_eq!(LIBLO_OK, result);
+
+            assert_eq!(LIBLO_OK, lo_load_current_state(handle));
+            assert_eq!(LIBLO_OK, lo_get_metrics(handle, &mut metrics));
+            assert_eq!(1, metrics.files_stated);
+            assert!(metrics.load_time_ns > 0);
+
+            assert_eq!(LIBLO_OK, lo_reset_metrics(handle));
+            assert_eq!(LIBLO_OK, lo_get_metrics(handle, &mut metrics));
+            assert_eq!(0, metrics.files_stated);
+            assert_eq!(0, metrics.load_time_ns);
+
+            lo_destroy_handle(handle);
+        }
+    }
+
+    #[test]
+    fn lo_enable_shared_header_cache_should_set_the_global_cache() {
+        let mut handle: lo_game_handle = std::ptr::null_mut();
+        let game_path = CString::new(".").unwrap();
+
+        unsafe {
+            let result = lo_create_handle(
+                &mut handle,
+                LIBLO_GAME_TES5,
+                game_path.as_ptr(),
+                game_path.as_ptr(),
+            );
+            assert_eq!(LIBLO_OK, result);
+
+            assert_eq!(LIBLO_OK, lo_enable_shared_header_cache(handle));
+            assert_eq!(
+                Some(&SharedHeaderCache::global()),
+                (*handle)
+                    .read()
+                    .unwrap()
+                    .game_settings()
+                    .shared_header_cache()
+            );
+
+            assert_eq!(LIBLO_OK, lo_disable_shared_header_cache(handle));
+            assert!((*handle)
+                .read()
+                .unwrap()
+                .game_settings()
+                .shared_header_cache()
+                .is_none());
+
+            lo_destroy_handle(handle);
+        }
+    }
 
     #[test]
     fn lo_create_handle_should_allow_a_non_existent_local_path() {
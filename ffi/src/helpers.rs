@@ -19,17 +19,19 @@
 use std::ffi::{c_char, c_uint, CStr, CString};
 use std::io;
 use std::path::PathBuf;
+use std::ptr;
 use std::slice;
 
 use libc::size_t;
 use loadorder::Error;
 
-use super::ERROR_MESSAGE;
+use super::{lo_string_buffer, ERROR_MESSAGE};
 use crate::constants::{
-    LIBLO_ERROR_FILE_NOT_FOUND, LIBLO_ERROR_FILE_PARSE_FAIL, LIBLO_ERROR_FILE_RENAME_FAIL,
-    LIBLO_ERROR_INTERNAL_LOGIC_ERROR, LIBLO_ERROR_INVALID_ARGS, LIBLO_ERROR_IO_ERROR,
-    LIBLO_ERROR_IO_PERMISSION_DENIED, LIBLO_ERROR_NO_PATH, LIBLO_ERROR_SYSTEM_ERROR,
-    LIBLO_ERROR_TEXT_DECODE_FAIL, LIBLO_ERROR_TEXT_ENCODE_FAIL,
+    LIBLO_ERROR_CANCELLED, LIBLO_ERROR_FILE_NOT_FOUND, LIBLO_ERROR_FILE_PARSE_FAIL,
+    LIBLO_ERROR_FILE_RENAME_FAIL, LIBLO_ERROR_INTERNAL_LOGIC_ERROR, LIBLO_ERROR_INVALID_ARGS,
+    LIBLO_ERROR_IO_ERROR, LIBLO_ERROR_IO_PERMISSION_DENIED, LIBLO_ERROR_NO_PATH,
+    LIBLO_ERROR_OUTDATED_SETTINGS, LIBLO_ERROR_SYSTEM_ERROR, LIBLO_ERROR_TEXT_DECODE_FAIL,
+    LIBLO_ERROR_TEXT_ENCODE_FAIL,
 };
 
 pub(crate) fn error(code: c_uint, message: &str) -> c_uint {
@@ -76,11 +78,15 @@ fn map_error(err: &Error) -> c_uint {
         | Error::NoDocumentsPath
         | Error::UnrepresentedHoist { .. }
         | Error::InstalledPlugin(_)
-        | Error::InvalidBlueprintPluginPosition { .. } => LIBLO_ERROR_INVALID_ARGS,
+        | Error::InvalidBlueprintPluginPosition { .. }
+        | Error::IncompatibleSnapshot
+        | Error::InvalidResolvedSettings => LIBLO_ERROR_INVALID_ARGS,
         Error::NoUserConfigPath | Error::NoUserDataPath | Error::NoProgramFilesPath => {
             LIBLO_ERROR_NO_PATH
         }
-        Error::SystemError(_, _) => LIBLO_ERROR_SYSTEM_ERROR,
+        Error::SystemError(_, _) | Error::ThreadPoolError(_) => LIBLO_ERROR_SYSTEM_ERROR,
+        Error::LoadCancelled => LIBLO_ERROR_CANCELLED,
+        Error::OutdatedResolvedSettings => LIBLO_ERROR_OUTDATED_SETTINGS,
         _ => LIBLO_ERROR_INTERNAL_LOGIC_ERROR,
     }
 }
@@ -119,6 +125,50 @@ pub(crate) fn to_c_string_array<S: AsRef<str>>(
     Ok((pointer.cast(), size))
 }
 
+pub(crate) fn empty_string_buffer() -> lo_string_buffer {
+    lo_string_buffer {
+        data: ptr::null_mut(),
+        data_size: 0,
+        offsets: ptr::null_mut(),
+        num_strings: 0,
+    }
+}
+
+/// Pack the strings into one null-separated buffer, so that they can be
+/// output with two allocations instead of one per string.
+pub(crate) fn to_string_buffer<S: AsRef<str>>(strings: &[S]) -> Result<lo_string_buffer, u32> {
+    if strings.is_empty() {
+        return Ok(empty_string_buffer());
+    }
+
+    let data_size = strings.iter().map(|s| s.as_ref().len() + 1).sum();
+    let mut data = Vec::with_capacity(data_size);
+    let mut offsets = Vec::with_capacity(strings.len());
+
+    for string in strings {
+        let bytes = string.as_ref().as_bytes();
+        if bytes.contains(&0) {
+            return Err(LIBLO_ERROR_TEXT_ENCODE_FAIL);
+        }
+
+        offsets.push(data.len());
+        data.extend_from_slice(bytes);
+        data.push(0);
+    }
+
+    let data: Box<[u8]> = data.into_boxed_slice();
+    let offsets: Box<[size_t]> = offsets.into_boxed_slice();
+
+    // As with string arrays, the pointers to the boxes are also pointers to
+    // the start of their slices.
+    Ok(lo_string_buffer {
+        data_size: data.len(),
+        data: Box::into_raw(data).cast(),
+        num_strings: offsets.len(),
+        offsets: Box::into_raw(offsets).cast(),
+    })
+}
+
 pub(crate) unsafe fn to_str_vec<'a>(
     array: *const *const c_char,
     array_size: usize,
@@ -0,0 +1,453 @@
+/*
+ * This file is part of libloadorder
+ *
+ * Copyright (C) 2017 Oliver Hamlet
+ *
+ * libloadorder is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libloadorder is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
+ */
+use std::ffi::c_uint;
+use std::panic::catch_unwind;
+use std::sync::{Arc, Condvar, Mutex, MutexGuard, PoisonError};
+
+use libc::size_t;
+use loadorder::LoadProgress;
+
+use crate::constants::{
+    LIBLO_ERROR_INVALID_ARGS, LIBLO_ERROR_PANICKED, LIBLO_ERROR_POISONED_THREAD_LOCK, LIBLO_OK,
+};
+use crate::handle::{fix_plugin_lists, load_current_state, GameHandle};
+use crate::helpers::error;
+use crate::{lo_game_handle, ERROR_MESSAGE};
+
+/// A structure that holds the state of an operation running in the background.
+///
+/// Used to monitor, cancel and wait for the operation. It is the result of calling
+/// `lo_load_current_state_async()` or `lo_fix_plugin_lists_async()`.
+#[expect(
+    non_camel_case_types,
+    reason = "Non-camel-case types are used for consistency with the rest of the API"
+)]
+pub type lo_job_handle = *mut JobHandle;
+
+type JobHandle = Arc<Job>;
+
+#[derive(Debug, Default)]
+pub struct Job {
+    progress: LoadProgress,
+    result: Mutex<Option<JobResult>>,
+    finished: Condvar,
+}
+
+#[derive(Debug)]
+struct JobResult {
+    code: c_uint,
+    message: String,
+}
+
+impl Job {
+    fn lock_result(&self) -> MutexGuard<'_, Option<JobResult>> {
+        // The result is only ever replaced whole, so it's still valid if
+        // another thread panicked while holding the lock.
+        self.result.lock().unwrap_or_else(PoisonError::into_inner)
+    }
+
+    fn finish(&self, code: c_uint) {
+        // The operation sets the error message of the thread that it runs
+        // on, so copy it so that it can be passed on to the waiting thread.
+        let message = if code == LIBLO_OK {
+            String::new()
+        } else {
+            ERROR_MESSAGE.with(|f| f.borrow().to_string_lossy().into_owned())
+        };
+
+        *self.lock_result() = Some(JobResult { code, message });
+        self.finished.notify_all();
+    }
+
+    fn is_finished(&self) -> bool {
+        self.lock_result().is_some()
+    }
+
+    fn wait(&self) -> c_uint {
+        let result = self
+            .finished
+            .wait_while(self.lock_result(), |result| result.is_none())
+            .unwrap_or_else(PoisonError::into_inner);
+
+        match &*result {
+            Some(result) if result.code != LIBLO_OK => error(result.code, &result.message),
+            _ => LIBLO_OK,
+        }
+    }
+}
+
+/// A game handle that can be moved into the thread that runs a job.
+struct JobGameHandle(lo_game_handle);
+
+// SAFETY: The handle's load order is Send and Sync and is protected by a
+// lock, and callers of the async functions must keep the game handle alive
+// until the job has finished.
+unsafe impl Send for JobGameHandle {}
+
+impl JobGameHandle {
+    fn get(&self) -> lo_game_handle {
+        self.0
+    }
+}
+
+unsafe fn spawn_job(
+    handle: lo_game_handle,
+    job: *mut lo_job_handle,
+    operation: fn(&GameHandle, &LoadProgress) -> c_uint,
+) -> c_uint {
+    if handle.is_null() || job.is_null() {
+        return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+    }
+
+    let parallelism = match (*handle).read() {
+        Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, &e.to_string()),
+        Ok(h) => h.game_settings().parallelism().clone(),
+    };
+
+    let state = Arc::new(Job::default());
+    let worker_state = Arc::clone(&state);
+    let handle = JobGameHandle(handle);
+
+    parallelism.spawn(move || {
+        let code = catch_unwind(|| {
+            // SAFETY: The handle is not null, and the caller must keep it
+            // alive until the job has finished.
+            let handle = unsafe { &*handle.get() };
+            operation(handle, &worker_state.progress)
+        })
+        .unwrap_or(LIBLO_ERROR_PANICKED);
+
+        worker_state.finish(code);
+    });
+
+    *job = Box::into_raw(Box::new(state));
+
+    LIBLO_OK
+}
+
+/// Start loading the current load order state in the background.
+///
+/// This does the same as `lo_load_current_state()`, but returns without waiting for the state to
+/// be loaded. Instead, a job handle is output that can be used to monitor the load's progress,
+/// cancel it and wait for it to finish. If the load is cancelled, the handle's previously held
+/// state is kept.
+///
+/// Returns `LIBLO_OK` if the load was started, otherwise a `LIBLO_ERROR_*` code is returned. The
+/// result of the load itself is returned by `lo_wait_for_job()`.
+///
+/// # Safety
+///
+/// - `handle` must be a value that was previously set by `lo_create_handle()` and that has not been
+///   destroyed using `lo_destroy_handle()`, and it must not be destroyed until the job has
+///   finished.
+/// - `job` must be a dereferenceable pointer. The job handle it is set to must be destroyed using
+///   `lo_destroy_job()`.
+#[no_mangle]
+pub unsafe extern "C" fn lo_load_current_state_async(
+    handle: lo_game_handle,
+    job: *mut lo_job_handle,
+) -> c_uint {
+    catch_unwind(|| spawn_job(handle, job, load_current_state)).unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
+/// Start fixing the text file(s) used by the load order and active plugins systems in the
+/// background.
+///
+/// This does the same as `lo_fix_plugin_lists()`, but returns without waiting for the lists to be
+/// fixed. Instead, a job handle is output that can be used to monitor the progress of loading the
+/// current state, cancel it and wait for the job to finish. The fixed lists are only saved if the
+/// load finishes without being cancelled, so cancelling the job leaves the lists unchanged.
+///
+/// Returns `LIBLO_OK` if the job was started, otherwise a `LIBLO_ERROR_*` code is returned. The
+/// result of the job itself is returned by `lo_wait_for_job()`.
+///
+/// # Safety
+///
+/// - `handle` must be a value that was previously set by `lo_create_handle()` and that has not been
+///   destroyed using `lo_destroy_handle()`, and it must not be destroyed until the job has
+///   finished.
+/// - `job` must be a dereferenceable pointer. The job handle it is set to must be destroyed using
+///   `lo_destroy_job()`.
+#[no_mangle]
+pub unsafe extern "C" fn lo_fix_plugin_lists_async(
+    handle: lo_game_handle,
+    job: *mut lo_job_handle,
+) -> c_uint {
+    catch_unwind(|| spawn_job(handle, job, fix_plugin_lists)).unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
+/// Get the progress of a job's load.
+///
+/// Outputs the number of plugins that have been loaded so far and the total number of plugins to
+/// load. The total is zero until the job has found the plugins to load.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+///
+/// # Safety
+///
+/// - `job` must be a value that was previously set by `lo_load_current_state_async()` or
+///   `lo_fix_plugin_lists_async()` and that has not been destroyed using `lo_destroy_job()`.
+/// - `plugins_loaded` and `plugins_total` must be dereferenceable pointers.
+#[no_mangle]
+pub unsafe extern "C" fn lo_get_job_progress(
+    job: lo_job_handle,
+    plugins_loaded: *mut size_t,
+    plugins_total: *mut size_t,
+) -> c_uint {
+    catch_unwind(|| {
+        if job.is_null() || plugins_loaded.is_null() || plugins_total.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+
+        let progress = &(&*job).progress;
+
+        *plugins_loaded = progress.plugins_loaded();
+        *plugins_total = progress.plugins_total();
+
+        LIBLO_OK
+    })
+    .unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
+/// Check if a job has finished.
+///
+/// Outputs `true` if the job has finished, whether or not it was successful, and `false`
+/// otherwise. Once this outputs `true`, `lo_wait_for_job()` returns without blocking.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+///
+/// # Safety
+///
+/// - `job` must be a value that was previously set by `lo_load_current_state_async()` or
+///   `lo_fix_plugin_lists_async()` and that has not been destroyed using `lo_destroy_job()`.
+/// - `result` must be a dereferenceable pointer.
+#[no_mangle]
+pub unsafe extern "C" fn lo_is_job_finished(job: lo_job_handle, result: *mut bool) -> c_uint {
+    catch_unwind(|| {
+        if job.is_null() || result.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+
+        *result = (*job).is_finished();
+
+        LIBLO_OK
+    })
+    .unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
+/// Cancel a job.
+///
+/// The job stops at the next point where its load checks for cancellation, which happens before
+/// and after scanning for plugins, before loading each plugin and before sorting them, and then
+/// finishes with `LIBLO_ERROR_CANCELLED`. A job that has already finished is unaffected.
+///
+/// This returns without waiting for the job to stop.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+///
+/// # Safety
+///
+/// - `job` must be a value that was previously set by `lo_load_current_state_async()` or
+///   `lo_fix_plugin_lists_async()` and that has not been destroyed using `lo_destroy_job()`.
+#[no_mangle]
+pub unsafe extern "C" fn lo_cancel_job(job: lo_job_handle) -> c_uint {
+    catch_unwind(|| {
+        if job.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+
+        (&*job).progress.cancel();
+
+        LIBLO_OK
+    })
+    .unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
+/// Wait for a job to finish.
+///
+/// Blocks until the job has finished, then returns the result of its operation: `LIBLO_OK` if it
+/// was successful, `LIBLO_ERROR_CANCELLED` if it was cancelled, and otherwise the `LIBLO_ERROR_*`
+/// code that its operation failed with. If the job failed, its error message can be retrieved
+/// using `lo_get_error_message()` on the thread that called this function.
+///
+/// This can be called more than once for the same job.
+///
+/// # Safety
+///
+/// - `job` must be a value that was previously set by `lo_load_current_state_async()` or
+///   `lo_fix_plugin_lists_async()` and that has not been destroyed using `lo_destroy_job()`.
+#[no_mangle]
+pub unsafe extern "C" fn lo_wait_for_job(job: lo_job_handle) -> c_uint {
+    catch_unwind(|| {
+        if job.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+
+        (*job).wait()
+    })
+    .unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
+/// Destroy a job handle.
+///
+/// If the job has not finished, it is cancelled and this blocks until it has stopped, so that the
+/// game handle can be destroyed safely once this returns.
+///
+/// # Safety
+///
+/// - `job` must be a value that was previously set by `lo_load_current_state_async()` or
+///   `lo_fix_plugin_lists_async()`.
+///
+/// This function must not be called more than once with the same input value.
+#[no_mangle]
+pub unsafe extern "C" fn lo_destroy_job(job: lo_job_handle) {
+    if !job.is_null() {
+        let job = Box::from_raw(job);
+
+        if !job.is_finished() {
+            job.progress.cancel();
+            // The job's result isn't needed, so don't overwrite this
+            // thread's error message with it.
+            drop(
+                job.finished
+                    .wait_while(job.lock_result(), |result| result.is_none())
+                    .unwrap_or_else(PoisonError::into_inner),
+            );
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use std::ffi::{CStr, CString};
+
+    use super::*;
+    use crate::{
+        lo_create_handle, lo_destroy_handle, lo_get_error_message, LIBLO_ERROR_CANCELLED,
+        LIBLO_GAME_TES5,
+    };
+
+    fn create_handle(game_dir: &std::path::Path) -> lo_game_handle {
+        let mut handle: lo_game_handle = std::ptr::null_mut();
+        let game_path = CString::new(game_dir.to_str().unwrap()).unwrap();
+
+        unsafe {
+            let result = lo_create_handle(
+                &mut handle,
+                LIBLO_GAME_TES5,
+                game_path.as_ptr(),
+                game_path.as_ptr(),
+            );
+            assert_eq!(LIBLO_OK, result);
+        }
+
+        handle
+    }
+
+    #[test]
+    fn lo_load_current_state_async_should_output_a_job_that_can_be_waited_for() {
+        let tmp_dir = tempfile::tempdir().unwrap();
+        let handle = create_handle(tmp_dir.path());
+        let mut job: lo_job_handle = std::ptr::null_mut();
+
+        unsafe {
+            assert_eq!(LIBLO_OK, lo_load_current_state_async(handle, &mut job));
+            assert_eq!(LIBLO_OK, lo_wait_for_job(job));
+            assert_eq!(LIBLO_OK, lo_wait_for_job(job));
+
+            let mut is_finished = false;
+            assert_eq!(LIBLO_OK, lo_is_job_finished(job, &mut is_finished));
+            assert!(is_finished);
+
+            let mut plugins_loaded = 1;
+            let mut plugins_total = 1;
+            assert_eq!(
+                LIBLO_OK,
+                lo_get_job_progress(job, &mut plugins_loaded, &mut plugins_total)
+            );
+            assert_eq!(0, plugins_loaded);
+            assert_eq!(0, plugins_total);
+
+            lo_destroy_job(job);
+            lo_destroy_handle(handle);
+        }
+    }
+
+    #[test]
+    fn lo_fix_plugin_lists_async_should_output_a_job_that_can_be_destroyed_while_running() {
+        let tmp_dir = tempfile::tempdir().unwrap();
+        let handle = create_handle(tmp_dir.path());
+        let mut job: lo_job_handle = std::ptr::null_mut();
+
+        unsafe {
+            assert_eq!(LIBLO_OK, lo_fix_plugin_lists_async(handle, &mut job));
+            assert_eq!(LIBLO_OK, lo_cancel_job(job));
+
+            lo_destroy_job(job);
+            lo_destroy_handle(handle);
+        }
+    }
+
+    #[test]
+    fn async_functions_should_error_if_given_null_pointers() {
+        let tmp_dir = tempfile::tempdir().unwrap();
+        let handle = create_handle(tmp_dir.path());
+        let mut job: lo_job_handle = std::ptr::null_mut();
+
+        unsafe {
+            assert_eq!(
+                LIBLO_ERROR_INVALID_ARGS,
+                lo_load_current_state_async(std::ptr::null_mut(), &mut job)
+            );
+            assert_eq!(
+                LIBLO_ERROR_INVALID_ARGS,
+                lo_fix_plugin_lists_async(handle, std::ptr::null_mut())
+            );
+            assert_eq!(LIBLO_ERROR_INVALID_ARGS, lo_cancel_job(job));
+            assert_eq!(LIBLO_ERROR_INVALID_ARGS, lo_wait_for_job(job));
+            assert!(job.is_null());
+
+            lo_destroy_handle(handle);
+        }
+    }
+
+    #[test]
+    fn wait_should_set_the_error_message_of_the_waiting_thread() {
+        let job = Arc::new(Job::default());
+        let worker_job = Arc::clone(&job);
+
+        std::thread::spawn(move || {
+            error(LIBLO_ERROR_CANCELLED, "The load was cancelled");
+            worker_job.finish(LIBLO_ERROR_CANCELLED);
+        })
+        .join()
+        .unwrap();
+
+        assert_eq!(LIBLO_ERROR_CANCELLED, job.wait());
+
+        unsafe {
+            let mut message: *const std::ffi::c_char = std::ptr::null();
+            assert_eq!(LIBLO_OK, lo_get_error_message(&mut message));
+            assert_eq!(
+                "The load was cancelled",
+                CStr::from_ptr(message).to_str().unwrap()
+            );
+        }
+    }
+}
@@ -156,6 +156,10 @@
 //! multiple threads is not advised, as filesystem changes made when writing data are not atomic
 //! and data races may occur under such usage.
 //!
+//! `lo_load_current_state_async()` and `lo_fix_plugin_lists_async()` run their operation on a
+//! background thread and return a job handle that can be used to monitor, cancel and wait for it.
+//! The game handle must not be destroyed until the job has finished.
+//!
 //! ## Data Caching
 //!
 //! libloadorder caches plugin data to improve performance. Each game handle has its own unique
@@ -231,13 +235,17 @@ mod active_plugins;
 mod constants;
 mod handle;
 mod helpers;
+mod job;
 mod load_order;
+mod snapshot;
 
 pub use crate::active_plugins::*;
 pub use crate::constants::*;
 pub use crate::handle::*;
-use crate::helpers::error;
+use crate::helpers::{empty_string_buffer, error};
+pub use crate::job::*;
 pub use crate::load_order::*;
+pub use crate::snapshot::*;
 
 thread_local!(static ERROR_MESSAGE: RefCell<CString> = RefCell::new(CString::default()));
 
@@ -372,3 +380,145 @@ pub unsafe extern "C" fn lo_free_string_array(array: *mut *mut c_char, size: siz
 
     drop(strings);
 }
+
+/// Free memory allocated to resolved game settings output.
+///
+/// This function should be called to free memory allocated by `lo_get_resolved_settings()`.
+///
+/// # Safety
+///
+/// - `data` and `size` must be the values that were output by `lo_get_resolved_settings()`.
+///
+/// This function must not be called more than once with the same `data` value.
+#[no_mangle]
+pub unsafe extern "C" fn lo_free_resolved_settings(data: *mut u8, size: size_t) {
+    if data.is_null() || size == 0 {
+        return;
+    }
+
+    drop(Box::from_raw(std::slice::from_raw_parts_mut(data, size)));
+}
+
+/// An array of strings packed into a single buffer.
+///
+/// This is output by the `lo_get_*_packed()` functions as an alternative to a string array, so
+/// that all the strings are held in one allocation that can be freed using one call to
+/// `lo_free_string_buffer()`.
+///
+/// Each string in `data` is null-terminated, and the string at index `i` starts at
+/// `data + offsets[i]`. If there are no strings, `data` and `offsets` are null and `data_size` and
+/// `num_strings` are zero.
+#[repr(C)]
+#[derive(Clone, Copy, Debug)]
+pub struct lo_string_buffer {
+    /// The strings, stored one after another.
+    pub data: *mut c_char,
+    /// The size of `data` in bytes, including the strings' null terminators.
+    pub data_size: size_t,
+    /// The offset in bytes of each string from the start of `data`.
+    pub offsets: *mut size_t,
+    /// The number of strings, which is also the number of offsets.
+    pub num_strings: size_t,
+}
+
+/// Free memory allocated to string buffer output.
+///
+/// This function should be called to free memory allocated by any API function that outputs a
+/// `lo_string_buffer`. Once freed, the buffer's fields are set to null and zero.
+///
+/// # Safety
+///
+/// - `buffer` must be null or a dereferenceable pointer to a `lo_string_buffer` that was output by
+///   this library and whose fields have not been changed since.
+#[no_mangle]
+pub unsafe extern "C" fn lo_free_string_buffer(buffer: *mut lo_string_buffer) {
+    if buffer.is_null() {
+        return;
+    }
+
+    let lo_string_buffer {
+        data,
+        data_size,
+        offsets,
+        num_strings,
+    } = *buffer;
+
+    if !data.is_null() && data_size != 0 {
+        drop(Box::from_raw(std::slice::from_raw_parts_mut(
+            data.cast::<u8>(),
+            data_size,
+        )));
+    }
+
+    if !offsets.is_null() && num_strings != 0 {
+        drop(Box::from_raw(std::slice::from_raw_parts_mut(
+            offsets,
+            num_strings,
+        )));
+    }
+
+    *buffer = empty_string_buffer();
+}
+
+/// Free memory allocated to load order entry array output.
+///
+/// This function should be called to free memory allocated by `lo_get_load_order_entries()`.
+///
+/// # Safety
+///
+/// - `entries` must be a non-null aligned pointer to a sequence of `num_entries` initialised
+///   `lo_load_order_entry` values within a single allocated object.
+/// - `num_entries * std::mem::size_of::<lo_load_order_entry>()` must be no larger than
+///   `isize::MAX`.
+/// - `entries` and `num_entries` must represent a single complete array of entries that was
+///   allocated by this library.
+///
+/// This function must not be called more than once with the same `entries` value.
+#[no_mangle]
+pub unsafe extern "C" fn lo_free_load_order_entries(
+    entries: *mut lo_load_order_entry,
+    num_entries: size_t,
+) {
+    if entries.is_null() || num_entries == 0 {
+        return;
+    }
+
+    let entries = Box::from_raw(std::slice::from_raw_parts_mut(entries, num_entries));
+    for entry in &entries {
+        lo_free_string(entry.name);
+    }
+
+    drop(entries);
+}
+
+/// Free memory allocated to load order change array output.
+///
+/// This function should be called to free memory allocated by
+/// `lo_set_load_order_incremental()`.
+///
+/// # Safety
+///
+/// - `changes` must be a non-null aligned pointer to a sequence of `num_changes` initialised
+///   `lo_load_order_change` values within a single allocated object.
+/// - `num_changes * std::mem::size_of::<lo_load_order_change>()` must be no larger than
+///   `isize::MAX`.
+/// - `changes` and `num_changes` must represent a single complete array of changes that was
+///   allocated by this library.
+///
+/// This function must not be called more than once with the same `changes` value.
+#[no_mangle]
+pub unsafe extern "C" fn lo_free_load_order_changes(
+    changes: *mut lo_load_order_change,
+    num_changes: size_t,
+) {
+    if changes.is_null() || num_changes == 0 {
+        return;
+    }
+
+    let changes = Box::from_raw(std::slice::from_raw_parts_mut(changes, num_changes));
+    for change in &changes {
+        lo_free_string(change.plugin);
+    }
+
+    drop(changes);
+}
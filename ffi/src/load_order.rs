@@ -17,20 +17,27 @@
  * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
  */
 
-use std::ffi::{c_char, c_uint};
+use std::ffi::{c_char, c_uint, CString};
 use std::panic::catch_unwind;
 use std::ptr;
+use std::slice;
 
 use libc::size_t;
-use loadorder::LoadOrderMethod;
+use loadorder::{BatchOperation, LoadOrderMethod};
 
-use super::lo_game_handle;
+use super::{lo_game_handle, lo_string_buffer};
 use crate::constants::{
+    LIBLO_BATCH_ACTIVATE, LIBLO_BATCH_DEACTIVATE, LIBLO_BATCH_SET_POSITION, LIBLO_CHANGE_ACTIVATE,
+    LIBLO_CHANGE_ADD, LIBLO_CHANGE_DEACTIVATE, LIBLO_CHANGE_MOVE, LIBLO_CHANGE_REMOVE,
     LIBLO_ERROR_FILE_NOT_FOUND, LIBLO_ERROR_INTERNAL_LOGIC_ERROR, LIBLO_ERROR_INVALID_ARGS,
-    LIBLO_ERROR_PANICKED, LIBLO_ERROR_POISONED_THREAD_LOCK, LIBLO_METHOD_ASTERISK,
-    LIBLO_METHOD_OPENMW, LIBLO_METHOD_TEXTFILE, LIBLO_METHOD_TIMESTAMP, LIBLO_OK,
+    LIBLO_ERROR_PANICKED, LIBLO_ERROR_POISONED_THREAD_LOCK, LIBLO_ERROR_TEXT_ENCODE_FAIL,
+    LIBLO_METHOD_ASTERISK, LIBLO_METHOD_OPENMW, LIBLO_METHOD_TEXTFILE, LIBLO_METHOD_TIMESTAMP,
+    LIBLO_OK,
+};
+use crate::helpers::{
+    empty_string_buffer, error, handle_error, to_c_string, to_c_string_array, to_str, to_str_vec,
+    to_string_buffer,
 };
-use crate::helpers::{error, handle_error, to_c_string, to_c_string_array, to_str, to_str_vec};
 
 /// Get which method is used for the load order.
 ///
@@ -127,6 +134,143 @@ pub unsafe extern "C" fn lo_get_load_order(
     .unwrap_or(LIBLO_ERROR_PANICKED)
 }
 
+/// Get the current load order, packed into a single string buffer.
+///
+/// This outputs the same strings in the same order as `lo_get_load_order()`, but with all of them in one
+/// buffer, which is cheaper to allocate and free than a string array.
+///
+/// The output must be freed using `lo_free_string_buffer()`.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+///
+/// # Safety
+///
+/// - `handle` must be a value that was previously set by `lo_create_handle()` and that has not been
+///   destroyed using `lo_destroy_handle()`.
+/// - `plugins` must be a dereferenceable pointer.
+#[no_mangle]
+pub unsafe extern "C" fn lo_get_load_order_packed(
+    handle: lo_game_handle,
+    plugins: *mut lo_string_buffer,
+) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() || plugins.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+
+        let handle = match (*handle).read() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, &e.to_string()),
+            Ok(h) => h,
+        };
+
+        *plugins = empty_string_buffer();
+
+        match to_string_buffer(&handle.plugin_names()) {
+            Ok(buffer) => *plugins = buffer,
+            Err(x) => return error(x, "A filename contained a null byte"),
+        }
+
+        LIBLO_OK
+    })
+    .unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
+/// A plugin in the load order, as output by `lo_get_load_order_entries()`.
+#[repr(C)]
+#[derive(Clone, Copy, Debug)]
+pub struct lo_load_order_entry {
+    /// The plugin's filename, without any ghost file extension.
+    pub name: *mut c_char,
+    /// The plugin's position in the load order.
+    pub position: size_t,
+    pub is_active: bool,
+    pub is_master: bool,
+    pub is_light: bool,
+    pub is_medium: bool,
+    pub is_blueprint: bool,
+    pub is_ghosted: bool,
+    pub is_early_loading: bool,
+}
+
+/// Get the current load order, with each plugin's active state and header flags.
+///
+/// This gets the same plugins in the same order as `lo_get_load_order()`, along with their data,
+/// so that the load order and plugin states can be read together with one call.
+///
+/// If no plugins are in the current order, the value pointed to by `entries` will be null and
+/// `num_entries` will point to zero. Otherwise, the output must be freed using
+/// `lo_free_load_order_entries()`.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+///
+/// # Safety
+///
+/// - `handle` must be a value that was previously set by `lo_create_handle()` and that has not been
+///   destroyed using `lo_destroy_handle()`.
+/// - `entries` must be a dereferenceable pointer.
+/// - `num_entries` must be a dereferenceable pointer.
+#[no_mangle]
+pub unsafe extern "C" fn lo_get_load_order_entries(
+    handle: lo_game_handle,
+    entries: *mut *mut lo_load_order_entry,
+    num_entries: *mut size_t,
+) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() || entries.is_null() || num_entries.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+
+        let handle = match (*handle).read() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, &e.to_string()),
+            Ok(h) => h,
+        };
+
+        *entries = ptr::null_mut();
+        *num_entries = 0;
+
+        let load_order_entries = handle.entries();
+
+        if load_order_entries.is_empty() {
+            return LIBLO_OK;
+        }
+
+        // Convert all the names before allocating any output so that nothing
+        // leaks if a name can't be converted.
+        let Ok(names) = load_order_entries
+            .iter()
+            .map(|e| CString::new(e.name))
+            .collect::<Result<Vec<_>, _>>()
+        else {
+            return error(
+                LIBLO_ERROR_TEXT_ENCODE_FAIL,
+                "A filename contained a null byte",
+            );
+        };
+
+        let c_entries: Box<[lo_load_order_entry]> = load_order_entries
+            .iter()
+            .zip(names)
+            .map(|(entry, name)| lo_load_order_entry {
+                name: name.into_raw(),
+                position: entry.position,
+                is_active: entry.is_active,
+                is_master: entry.is_master,
+                is_light: entry.is_light,
+                is_medium: entry.is_medium,
+                is_blueprint: entry.is_blueprint,
+                is_ghosted: entry.is_ghosted,
+                is_early_loading: entry.is_early_loading,
+            })
+            .collect();
+
+        *num_entries = c_entries.len();
+        *entries = Box::into_raw(c_entries).cast();
+
+        LIBLO_OK
+    })
+    .unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
 /// Set the load order.
 ///
 /// Sets the load order to the passed plugin array, then scans the plugins directory and inserts
@@ -279,6 +423,250 @@ pub unsafe extern "C" fn lo_set_plugin_position(
     .unwrap_or(LIBLO_ERROR_PANICKED)
 }
 
+/// A change to make to a load order, as input to `lo_apply_batch()`.
+#[repr(C)]
+#[derive(Clone, Copy, Debug)]
+pub struct lo_batch_operation {
+    /// One of the `LIBLO_BATCH_*` operation codes.
+    pub operation: c_uint,
+    /// The filename of the plugin to change.
+    pub plugin: *const c_char,
+    /// The load order position to move the plugin to. This is only used by
+    /// `LIBLO_BATCH_SET_POSITION` operations.
+    pub position: size_t,
+}
+
+/// Apply a batch of position changes, activations and deactivations.
+///
+/// This is equivalent to calling `lo_set_plugin_position()` and `lo_set_plugin_active()` for each
+/// operation, except that the resulting load order is only validated and saved once, after all
+/// the operations have been applied. The position changes are made first, in the order they are
+/// given, and then the activations and deactivations: if a plugin is activated or deactivated more
+/// than once, the last such operation takes precedence.
+///
+/// If any operation is invalid or the resulting load order is invalid, none of the operations are
+/// applied.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+///
+/// # Safety
+///
+/// - `handle` must be a value that was previously set by `lo_create_handle()` and that has not been
+///   destroyed using `lo_destroy_handle()`.
+/// - `operations` must be a non-null aligned pointer to a sequence of `num_operations` initialised
+///   `lo_batch_operation` values within a single allocated object.
+/// - `num_operations * std::mem::size_of::<lo_batch_operation>()` must be no larger than
+///   `isize::MAX`.
+/// - Each operation's `plugin` must be a null-terminated string contained within a single
+///   allocation.
+#[no_mangle]
+pub unsafe extern "C" fn lo_apply_batch(
+    handle: lo_game_handle,
+    operations: *const lo_batch_operation,
+    num_operations: size_t,
+) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() || operations.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+
+        let mut handle = match (*handle).write() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, &e.to_string()),
+            Ok(h) => h,
+        };
+
+        let operations: Vec<BatchOperation> =
+            match slice::from_raw_parts(operations, num_operations)
+                .iter()
+                .map(|o| to_batch_operation(o))
+                .collect()
+            {
+                Ok(x) => x,
+                Err(x) => return x,
+            };
+
+        if let Err(x) = handle.apply_batch(&operations) {
+            return handle_error(&x);
+        }
+
+        if let Err(x) = handle.save() {
+            return handle_error(&x);
+        }
+
+        LIBLO_OK
+    })
+    .unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
+unsafe fn to_batch_operation(operation: &lo_batch_operation) -> Result<BatchOperation<'_>, c_uint> {
+    let plugin = match to_str(operation.plugin) {
+        Ok(x) => x,
+        Err(x) => return Err(error(x, "The filename contained a null byte")),
+    };
+
+    match operation.operation {
+        x if x == LIBLO_BATCH_SET_POSITION => {
+            Ok(BatchOperation::SetPosition(plugin, operation.position))
+        }
+        x if x == LIBLO_BATCH_ACTIVATE => Ok(BatchOperation::Activate(plugin)),
+        x if x == LIBLO_BATCH_DEACTIVATE => Ok(BatchOperation::Deactivate(plugin)),
+        _ => Err(error(
+            LIBLO_ERROR_INVALID_ARGS,
+            "Invalid batch operation code passed",
+        )),
+    }
+}
+
+/// A change made to a load order, as output by `lo_set_load_order_incremental()`.
+#[repr(C)]
+#[derive(Clone, Copy, Debug)]
+pub struct lo_load_order_change {
+    /// One of the `LIBLO_CHANGE_*` change codes.
+    pub change: c_uint,
+    /// The filename of the plugin that was changed.
+    pub plugin: *mut c_char,
+    /// The plugin's new load order position. This is only used by `LIBLO_CHANGE_ADD` and
+    /// `LIBLO_CHANGE_MOVE` changes, and is zero otherwise.
+    pub position: size_t,
+}
+
+/// Set the load order and active plugins, making only the changes that are needed.
+///
+/// The result is the same as calling `lo_set_load_order()` and then `lo_set_active_plugins()`,
+/// except that the load order is only validated and saved once, and if the new load order or
+/// active plugins are invalid then nothing is changed. Plugins that keep their relative order are
+/// not moved, so the fewest plugins possible are moved.
+///
+/// The changes that were made are output so that a caller can update its own copy of the load
+/// order instead of getting it again. Removals are output first, then additions and moves in
+/// order of their new positions, then activations and deactivations. Applying the removals, then
+/// inserting each added or moved plugin at its new position in turn, gives the new load order.
+///
+/// If nothing needed to change, the value pointed to by `changes` will be null and `num_changes`
+/// will point to zero. Otherwise, the output must be freed using `lo_free_load_order_changes()`.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+///
+/// # Safety
+///
+/// - `handle` must be a value that was previously set by `lo_create_handle()` and that has not been
+///   destroyed using `lo_destroy_handle()`.
+/// - `plugins` must be a non-null aligned pointer to a sequence of `num_plugins` initialised C
+///   strings within a single allocated object.
+/// - `num_plugins * std::mem::size_of::<*const c_char>()` must be no larger than `isize::MAX`.
+/// - `active_plugins` must be a non-null aligned pointer to a sequence of `num_active_plugins`
+///   initialised C strings within a single allocated object.
+/// - `num_active_plugins * std::mem::size_of::<*const c_char>()` must be no larger than
+///   `isize::MAX`.
+/// - `changes` must be a dereferenceable pointer.
+/// - `num_changes` must be a dereferenceable pointer.
+#[no_mangle]
+pub unsafe extern "C" fn lo_set_load_order_incremental(
+    handle: lo_game_handle,
+    plugins: *const *const c_char,
+    num_plugins: size_t,
+    active_plugins: *const *const c_char,
+    num_active_plugins: size_t,
+    changes: *mut *mut lo_load_order_change,
+    num_changes: *mut size_t,
+) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null()
+            || plugins.is_null()
+            || active_plugins.is_null()
+            || changes.is_null()
+            || num_changes.is_null()
+        {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+
+        if num_plugins == 0 {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Zero-length plugin array passed.");
+        }
+
+        let mut handle = match (*handle).write() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, &e.to_string()),
+            Ok(h) => h,
+        };
+
+        *changes = ptr::null_mut();
+        *num_changes = 0;
+
+        let plugins: Vec<&str> = match to_str_vec(plugins, num_plugins) {
+            Ok(x) => x,
+            Err(x) => return error(x, "A filename contained a null byte"),
+        };
+
+        let active_plugins: Vec<&str> = match to_str_vec(active_plugins, num_active_plugins) {
+            Ok(x) => x,
+            Err(x) => return error(x, "A filename contained a null byte"),
+        };
+
+        let diff = match handle.set_load_order_incremental(&plugins, &active_plugins) {
+            Ok(x) => x,
+            Err(x) => return handle_error(&x),
+        };
+
+        if let Err(x) = handle.save() {
+            return handle_error(&x);
+        }
+
+        if diff.is_empty() {
+            return LIBLO_OK;
+        }
+
+        let mut positioned: Vec<_> = diff
+            .added
+            .iter()
+            .map(|(n, p)| (LIBLO_CHANGE_ADD, n, *p))
+            .chain(diff.moved.iter().map(|(n, p)| (LIBLO_CHANGE_MOVE, n, *p)))
+            .collect();
+        positioned.sort_by_key(|(_, _, position)| *position);
+
+        let all_changes: Vec<_> = diff
+            .removed
+            .iter()
+            .map(|n| (LIBLO_CHANGE_REMOVE, n, 0))
+            .chain(positioned)
+            .chain(diff.activated.iter().map(|n| (LIBLO_CHANGE_ACTIVATE, n, 0)))
+            .chain(
+                diff.deactivated
+                    .iter()
+                    .map(|n| (LIBLO_CHANGE_DEACTIVATE, n, 0)),
+            )
+            .collect();
+
+        // Convert all the names before allocating any output so that nothing
+        // leaks if a name can't be converted.
+        let Ok(names) = all_changes
+            .iter()
+            .map(|(_, n, _)| CString::new(n.as_str()))
+            .collect::<Result<Vec<_>, _>>()
+        else {
+            return error(
+                LIBLO_ERROR_TEXT_ENCODE_FAIL,
+                "A filename contained a null byte",
+            );
+        };
+
+        let c_changes: Box<[lo_load_order_change]> = all_changes
+            .into_iter()
+            .zip(names)
+            .map(|((change, _, position), name)| lo_load_order_change {
+                change,
+                plugin: name.into_raw(),
+                position,
+            })
+            .collect();
+
+        *num_changes = c_changes.len();
+        *changes = Box::into_raw(c_changes).cast();
+
+        LIBLO_OK
+    })
+    .unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
 /// Get filename of the plugin at a specific load order position.
 ///
 /// Load order positions are zero-based, so the first plugin in the load order has a position of
@@ -0,0 +1,200 @@
+/*
+ * This file is part of libloadorder
+ *
+ * Copyright (C) 2017 Oliver Hamlet
+ *
+ * libloadorder is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libloadorder is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
+ */
+use std::ffi::c_uint;
+use std::panic::catch_unwind;
+
+use loadorder::LoadOrderSnapshot;
+
+use crate::constants::{
+    LIBLO_ERROR_INVALID_ARGS, LIBLO_ERROR_PANICKED, LIBLO_ERROR_POISONED_THREAD_LOCK, LIBLO_OK,
+};
+use crate::helpers::{error, handle_error};
+use crate::lo_game_handle;
+
+/// A structure that holds a copy of a game handle's load order and active plugins.
+///
+/// It is the result of calling `lo_create_snapshot()`, and can be restored using
+/// `lo_restore_snapshot()`.
+#[expect(
+    non_camel_case_types,
+    reason = "Non-camel-case types are used for consistency with the rest of the API"
+)]
+pub type lo_snapshot_handle = *mut SnapshotHandle;
+
+// This type alias is necessary to make cbindgen treat lo_snapshot_handle as a
+// pointer to an undefined type, rather than an undefined type itself.
+type SnapshotHandle = LoadOrderSnapshot;
+
+/// Take a snapshot of the current load order and active plugins.
+///
+/// The snapshot shares the plugin data that the game handle has already read, so taking one is
+/// cheap. This can be used to switch between profiles without reloading: take a snapshot of each
+/// profile's load order once, then use `lo_restore_snapshot()` to switch to it.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+///
+/// # Safety
+///
+/// - `handle` must be a value that was previously set by `lo_create_handle()` and that has not been
+///   destroyed using `lo_destroy_handle()`.
+/// - `snapshot` must be a dereferenceable pointer. The snapshot handle it is set to must be
+///   destroyed using `lo_destroy_snapshot()`.
+#[no_mangle]
+pub unsafe extern "C" fn lo_create_snapshot(
+    handle: lo_game_handle,
+    snapshot: *mut lo_snapshot_handle,
+) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() || snapshot.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+
+        let handle = match (*handle).read() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, &e.to_string()),
+            Ok(h) => h,
+        };
+
+        *snapshot = Box::into_raw(Box::new(handle.snapshot()));
+
+        LIBLO_OK
+    })
+    .unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
+/// Replace the current load order and active plugins with those in a snapshot.
+///
+/// The snapshot is validated in the same way as the arguments to `lo_set_load_order()` and
+/// `lo_set_active_plugins()`, and then the restored state is saved. No plugins are read, and only
+/// the files that the restored state changes are written. The snapshot's order and active states
+/// are applied to the plugins currently in the load order: plugins added since the snapshot was
+/// taken are left out, plugins removed since are not restored, and ghosted plugins that the
+/// snapshot activates are unghosted. If the snapshot is invalid, the current state is kept.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+///
+/// # Safety
+///
+/// - `handle` must be a value that was previously set by `lo_create_handle()` and that has not been
+///   destroyed using `lo_destroy_handle()`.
+/// - `snapshot` must be a value that was previously set by `lo_create_snapshot()` for a handle for
+///   the same game and that has not been destroyed using `lo_destroy_snapshot()`.
+#[no_mangle]
+pub unsafe extern "C" fn lo_restore_snapshot(
+    handle: lo_game_handle,
+    snapshot: lo_snapshot_handle,
+) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() || snapshot.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+
+        let mut handle = match (*handle).write() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, &e.to_string()),
+            Ok(h) => h,
+        };
+
+        if let Err(x) = handle.restore_snapshot(&*snapshot) {
+            return handle_error(&x);
+        }
+
+        if let Err(x) = handle.save() {
+            return handle_error(&x);
+        }
+
+        LIBLO_OK
+    })
+    .unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
+/// Destroy a snapshot handle.
+///
+/// # Safety
+///
+/// - `snapshot` must be a value that was previously set by `lo_create_snapshot()`.
+///
+/// This function must not be called more than once with the same input value.
+#[no_mangle]
+pub unsafe extern "C" fn lo_destroy_snapshot(snapshot: lo_snapshot_handle) {
+    if !snapshot.is_null() {
+        drop(Box::from_raw(snapshot));
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use std::ffi::CString;
+
+    use super::*;
+    use crate::{
+        lo_create_handle, lo_destroy_handle, lo_free_string_array, lo_get_active_plugins,
+        LIBLO_GAME_TES5,
+    };
+
+    #[test]
+    fn lo_restore_snapshot_should_restore_a_snapshot_created_by_the_same_handle() {
+        let tmp_dir = tempfile::tempdir().unwrap();
+        let game_path = CString::new(tmp_dir.path().to_str().unwrap()).unwrap();
+        let mut handle: lo_game_handle = std::ptr::null_mut();
+        let mut snapshot: lo_snapshot_handle = std::ptr::null_mut();
+
+        unsafe {
+            let result = lo_create_handle(
+                &mut handle,
+                LIBLO_GAME_TES5,
+                game_path.as_ptr(),
+                game_path.as_ptr(),
+            );
+            assert_eq!(LIBLO_OK, result);
+
+            assert_eq!(LIBLO_OK, lo_create_snapshot(handle, &mut snapshot));
+            assert!(!snapshot.is_null());
+            assert_eq!(LIBLO_OK, lo_restore_snapshot(handle, snapshot));
+
+            let mut plugins = std::ptr::null_mut();
+            let mut num_plugins = 1;
+            assert_eq!(
+                LIBLO_OK,
+                lo_get_active_plugins(handle, &mut plugins, &mut num_plugins)
+            );
+            assert_eq!(0, num_plugins);
+            lo_free_string_array(plugins, num_plugins);
+
+            lo_destroy_snapshot(snapshot);
+            lo_destroy_handle(handle);
+        }
+    }
+
+    #[test]
+    fn snapshot_functions_should_error_if_given_null_pointers() {
+        unsafe {
+            let mut snapshot: lo_snapshot_handle = std::ptr::null_mut();
+
+            assert_eq!(
+                LIBLO_ERROR_INVALID_ARGS,
+                lo_create_snapshot(std::ptr::null_mut(), &mut snapshot)
+            );
+            assert_eq!(
+                LIBLO_ERROR_INVALID_ARGS,
+                lo_restore_snapshot(std::ptr::null_mut(), snapshot)
+            );
+
+            lo_destroy_snapshot(snapshot);
+        }
+    }
+}
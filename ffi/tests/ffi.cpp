@@ -69,6 +69,14 @@ void test_lo_free_string_array() {
   lo_free_string_array(plugins, 0);
 }
 
+void test_lo_free_string_buffer() {
+  printf("testing lo_free_string_buffer()...\n");
+  lo_free_string_buffer(nullptr);
+
+  lo_string_buffer buffer = { nullptr, 0, nullptr, 0 };
+  lo_free_string_buffer(&buffer);
+}
+
 lo_game_handle create_handle() {
   lo_game_handle handle = nullptr;
   unsigned int return_code = lo_create_handle(&handle,
@@ -108,6 +116,44 @@ void test_lo_create_handle() {
   lo_destroy_handle(handle);
 }
 
+void test_lo_get_resolved_settings() {
+  printf("testing lo_get_resolved_settings()...\n");
+  lo_game_handle handle = create_handle();
+
+  uint8_t * data = nullptr;
+  size_t size = 0;
+  unsigned int return_code = lo_get_resolved_settings(handle, &data, &size);
+
+  assert(return_code == 0);
+  assert(data != nullptr);
+  assert(size != 0);
+
+  lo_game_handle other_handle = nullptr;
+  return_code = lo_create_handle_from_resolved_settings(&other_handle, data, size);
+
+  assert(return_code == 0);
+  assert(other_handle != nullptr);
+
+  char * path = nullptr;
+  char * other_path = nullptr;
+  return_code = lo_get_active_plugins_file_path(handle, &path);
+  assert(return_code == 0);
+  return_code = lo_get_active_plugins_file_path(other_handle, &other_path);
+  assert(return_code == 0);
+  assert(strcmp(path, other_path) == 0);
+
+  lo_game_handle invalid_handle = nullptr;
+  return_code = lo_create_handle_from_resolved_settings(&invalid_handle, data, size - 1);
+  assert(return_code == LIBLO_ERROR_INVALID_ARGS);
+  assert(invalid_handle == nullptr);
+
+  lo_free_string(path);
+  lo_free_string(other_path);
+  lo_free_resolved_settings(data, size);
+  lo_destroy_handle(other_handle);
+  lo_destroy_handle(handle);
+}
+
 void test_lo_is_ambiguous() {
   printf("testing lo_is_ambiguous()...\n");
   lo_game_handle handle = create_handle();
@@ -119,6 +165,32 @@ void test_lo_is_ambiguous() {
   lo_destroy_handle(handle);
 }
 
+void test_lo_has_state_changed() {
+  printf("testing lo_has_state_changed()...\n");
+  lo_game_handle handle = create_handle();
+
+  bool has_changed = true;
+  unsigned int return_code = lo_has_state_changed(handle, &has_changed);
+
+  assert(return_code == 0);
+  assert(!has_changed);
+  lo_destroy_handle(handle);
+}
+
+void test_lo_get_changed_plugins() {
+  printf("testing lo_get_changed_plugins()...\n");
+  lo_game_handle handle = create_handle();
+
+  char ** plugins = nullptr;
+  size_t num_plugins = 1;
+  unsigned int return_code = lo_get_changed_plugins(handle, &plugins, &num_plugins);
+
+  assert(return_code == 0);
+  assert(plugins == nullptr);
+  assert(num_plugins == 0);
+  lo_destroy_handle(handle);
+}
+
 void test_lo_fix_plugin_lists() {
   printf("testing lo_fix_plugin_list()...\n");
   lo_game_handle handle = create_handle();
@@ -144,6 +216,21 @@ void test_lo_get_implicitly_active_plugins() {
   lo_destroy_handle(handle);
 }
 
+void test_lo_get_implicitly_active_plugins_packed() {
+  printf("testing lo_get_implicitly_active_plugins_packed()...\n");
+  lo_game_handle handle = create_handle(LIBLO_GAME_FO4);
+
+  lo_string_buffer plugins;
+  unsigned int return_code = lo_get_implicitly_active_plugins_packed(handle, &plugins);
+
+  assert(return_code == 0);
+  assert(plugins.num_strings == 8);
+  assert(strcmp(plugins.data + plugins.offsets[0], "Fallout4.esm") == 0);
+  assert(strcmp(plugins.data + plugins.offsets[4], "DLCworkshop02.esm") == 0);
+  lo_free_string_buffer(&plugins);
+  lo_destroy_handle(handle);
+}
+
 void test_lo_get_early_loading_plugins() {
   printf("testing lo_get_load_order()...\n");
   lo_game_handle handle = create_handle(LIBLO_GAME_FO4);
@@ -212,6 +299,109 @@ printf("testing lo_set_additional_plugins_directories()...\n");
   lo_destroy_handle(handle);
 }
 
+void test_lo_enable_header_cache() {
+  printf("testing lo_enable_header_cache()...\n");
+  lo_game_handle handle = create_handle();
+
+  unsigned int return_code = lo_enable_header_cache(handle, nullptr);
+  assert(return_code == 0);
+
+  return_code = lo_load_current_state(handle);
+  assert(return_code == 0);
+
+  return_code = lo_disable_header_cache(handle);
+  assert(return_code == 0);
+
+  return_code = lo_load_current_state(handle);
+  assert(return_code == 0);
+
+  lo_destroy_handle(handle);
+}
+
+void test_lo_enable_shared_header_cache() {
+  printf("testing lo_enable_shared_header_cache()...\n");
+  unsigned int return_code = lo_set_shared_header_cache_capacity(1024 * 1024);
+  assert(return_code == 0);
+
+  lo_game_handle handles[2] = { nullptr, nullptr };
+  for (lo_game_handle& handle : handles) {
+    return_code = lo_create_handle(&handle,
+      LIBLO_GAME_TES4,
+      "../../testing-plugins/Oblivion",
+      "../../testing-plugins/Oblivion");
+    assert(return_code == 0);
+
+    return_code = lo_enable_shared_header_cache(handle);
+    assert(return_code == 0);
+
+    return_code = lo_reset_metrics(handle);
+    assert(return_code == 0);
+
+    return_code = lo_load_current_state(handle);
+    assert(return_code == 0);
+  }
+
+  // The second handle should have reused the headers parsed by the first.
+  lo_metrics metrics;
+  return_code = lo_get_metrics(handles[1], &metrics);
+  assert(return_code == 0);
+  assert(metrics.headers_parsed == 0);
+
+  for (lo_game_handle handle : handles) {
+    return_code = lo_disable_shared_header_cache(handle);
+    assert(return_code == 0);
+
+    lo_destroy_handle(handle);
+  }
+}
+
+void test_lo_set_thread_count() {
+  printf("testing lo_set_thread_count()...\n");
+  lo_game_handle handle = create_handle();
+
+  for (size_t thread_count : { 1, 4, 0 }) {
+    unsigned int return_code = lo_set_thread_count(handle, thread_count);
+    assert(return_code == 0);
+
+    return_code = lo_load_current_state(handle);
+    assert(return_code == 0);
+
+    char ** plugins = nullptr;
+    size_t num_plugins = 0;
+    return_code = lo_get_load_order(handle, &plugins, &num_plugins);
+    assert(return_code == 0);
+    assert(num_plugins == 10);
+    lo_free_string_array(plugins, num_plugins);
+  }
+
+  lo_destroy_handle(handle);
+}
+
+void test_lo_get_metrics() {
+  printf("testing lo_get_metrics()...\n");
+  lo_game_handle handle = create_handle();
+
+  unsigned int return_code = lo_load_current_state(handle);
+  assert(return_code == 0);
+
+  lo_metrics metrics;
+  return_code = lo_get_metrics(handle, &metrics);
+  assert(return_code == 0);
+  assert(metrics.files_stated > 0);
+  assert(metrics.headers_parsed > 0);
+  assert(metrics.bytes_read > 0);
+
+  return_code = lo_reset_metrics(handle);
+  assert(return_code == 0);
+
+  return_code = lo_get_metrics(handle, &metrics);
+  assert(return_code == 0);
+  assert(metrics.files_stated == 0);
+  assert(metrics.load_time_ns == 0);
+
+  lo_destroy_handle(handle);
+}
+
 void test_lo_set_active_plugins() {
   printf("testing lo_set_active_plugins()...\n");
   lo_game_handle handle = create_handle();
@@ -238,6 +428,26 @@ void test_lo_get_active_plugins() {
   lo_destroy_handle(handle);
 }
 
+void test_lo_get_active_plugins_packed() {
+  printf("testing lo_get_active_plugins_packed()...\n");
+  lo_game_handle handle = create_handle();
+
+  lo_string_buffer plugins;
+  unsigned int return_code = lo_get_active_plugins_packed(handle, &plugins);
+
+  assert(return_code == 0);
+  assert(plugins.num_strings == 1);
+  assert(plugins.data_size == strlen("Blank.esm") + 1);
+  assert(plugins.offsets[0] == 0);
+  assert(strcmp(plugins.data, "Blank.esm") == 0);
+
+  lo_free_string_buffer(&plugins);
+  assert(plugins.data == nullptr);
+  assert(plugins.offsets == nullptr);
+  assert(plugins.num_strings == 0);
+  lo_destroy_handle(handle);
+}
+
 void test_lo_set_plugin_active() {
   printf("testing lo_set_plugin_active()...\n");
   lo_game_handle handle = create_handle();
@@ -311,6 +521,63 @@ void test_lo_get_load_order() {
   lo_destroy_handle(handle);
 }
 
+void test_lo_get_load_order_entries() {
+  printf("testing lo_get_load_order_entries()...\n");
+  lo_game_handle handle = create_handle();
+
+  char ** plugins = nullptr;
+  size_t num_plugins = 0;
+  unsigned int return_code = lo_get_load_order(handle, &plugins, &num_plugins);
+  assert(return_code == 0);
+
+  lo_load_order_entry * entries = nullptr;
+  size_t num_entries = 0;
+  return_code = lo_get_load_order_entries(handle, &entries, &num_entries);
+
+  assert(return_code == 0);
+  assert(num_entries == num_plugins);
+  for (size_t i = 0; i < num_entries; ++i) {
+    assert(strcmp(entries[i].name, plugins[i]) == 0);
+    assert(entries[i].position == i);
+
+    bool is_active = false;
+    return_code = lo_get_plugin_active(handle, plugins[i], &is_active);
+    assert(return_code == 0);
+    assert(entries[i].is_active == is_active);
+  }
+
+  assert(strcmp(entries[0].name, "Blank.esm") == 0);
+  assert(entries[0].is_master);
+
+  lo_free_load_order_entries(entries, num_entries);
+  lo_free_string_array(plugins, num_plugins);
+  lo_destroy_handle(handle);
+}
+
+void test_lo_get_load_order_packed() {
+  printf("testing lo_get_load_order_packed()...\n");
+  lo_game_handle handle = create_handle();
+
+  char ** plugins = nullptr;
+  size_t num_plugins = 0;
+  unsigned int return_code = lo_get_load_order(handle, &plugins, &num_plugins);
+  assert(return_code == 0);
+
+  lo_string_buffer buffer;
+  return_code = lo_get_load_order_packed(handle, &buffer);
+
+  assert(return_code == 0);
+  assert(buffer.num_strings == num_plugins);
+  for (size_t i = 0; i < buffer.num_strings; ++i) {
+    assert(buffer.offsets[i] < buffer.data_size);
+    assert(strcmp(buffer.data + buffer.offsets[i], plugins[i]) == 0);
+  }
+
+  lo_free_string_buffer(&buffer);
+  lo_free_string_array(plugins, num_plugins);
+  lo_destroy_handle(handle);
+}
+
 void test_lo_set_plugin_position() {
   printf("testing lo_set_plugin_position()...\n");
   lo_game_handle handle = create_handle();
@@ -333,6 +600,128 @@ void test_lo_get_plugin_position() {
   lo_destroy_handle(handle);
 }
 
+void test_lo_apply_batch() {
+  printf("testing lo_apply_batch()...\n");
+  lo_game_handle handle = create_handle();
+
+  lo_batch_operation operations[] = {
+    { LIBLO_BATCH_SET_POSITION, "Blank.esp", 4 },
+    { LIBLO_BATCH_ACTIVATE, "Blank.esp", 0 },
+  };
+  unsigned int return_code = lo_apply_batch(handle, operations, 2);
+  assert(return_code == 0);
+
+  size_t position = 0;
+  return_code = lo_get_plugin_position(handle, "Blank.esp", &position);
+  assert(return_code == 0);
+  assert(position == 4);
+
+  bool is_active = false;
+  return_code = lo_get_plugin_active(handle, "Blank.esp", &is_active);
+  assert(return_code == 0);
+  assert(is_active);
+
+  lo_batch_operation invalid_operations[] = {
+    { LIBLO_BATCH_DEACTIVATE, "Blank.esp", 0 },
+    { LIBLO_BATCH_SET_POSITION, "Blank.esm", 100 },
+  };
+  return_code = lo_apply_batch(handle, invalid_operations, 2);
+  assert(return_code == LIBLO_ERROR_INVALID_ARGS);
+
+  return_code = lo_get_plugin_active(handle, "Blank.esp", &is_active);
+  assert(return_code == 0);
+  assert(is_active);
+
+  lo_destroy_handle(handle);
+}
+
+void test_lo_set_load_order_incremental() {
+  printf("testing lo_set_load_order_incremental()...\n");
+  lo_game_handle handle = create_handle();
+
+  char ** plugins = nullptr;
+  size_t num_plugins = 0;
+  unsigned int return_code = lo_get_load_order(handle, &plugins, &num_plugins);
+  assert(return_code == 0);
+
+  const char * active_plugins[] = { "Blank.esm" };
+  return_code = lo_set_active_plugins(handle, active_plugins, 1);
+  assert(return_code == 0);
+
+  lo_load_order_change * changes = nullptr;
+  size_t num_changes = 0;
+  return_code = lo_set_load_order_incremental(handle,
+    plugins,
+    num_plugins,
+    active_plugins,
+    1,
+    &changes,
+    &num_changes);
+  assert(return_code == 0);
+  assert(changes == nullptr);
+  assert(num_changes == 0);
+
+  const char * new_active_plugins[] = { "Blank.esm", "Blank.esp" };
+  return_code = lo_set_load_order_incremental(handle,
+    plugins,
+    num_plugins,
+    new_active_plugins,
+    2,
+    &changes,
+    &num_changes);
+  assert(return_code == 0);
+  assert(num_changes == 1);
+  assert(changes[0].change == LIBLO_CHANGE_ACTIVATE);
+  assert(strcmp(changes[0].plugin, "Blank.esp") == 0);
+  lo_free_load_order_changes(changes, num_changes);
+
+  const char * invalid_active_plugins[] = { "missing.esp" };
+  return_code = lo_set_load_order_incremental(handle,
+    plugins,
+    num_plugins,
+    invalid_active_plugins,
+    1,
+    &changes,
+    &num_changes);
+  assert(return_code == LIBLO_ERROR_INVALID_ARGS);
+
+  bool is_active = false;
+  return_code = lo_get_plugin_active(handle, "Blank.esp", &is_active);
+  assert(return_code == 0);
+  assert(is_active);
+
+  lo_free_string_array(plugins, num_plugins);
+  lo_destroy_handle(handle);
+}
+
+void test_lo_create_snapshot() {
+  printf("testing lo_create_snapshot()...\n");
+  lo_game_handle handle = create_handle();
+
+  bool was_active = false;
+  unsigned int return_code = lo_get_plugin_active(handle, "Blank.esp", &was_active);
+  assert(return_code == 0);
+
+  lo_snapshot_handle snapshot = nullptr;
+  return_code = lo_create_snapshot(handle, &snapshot);
+  assert(return_code == 0);
+  assert(snapshot != nullptr);
+
+  return_code = lo_set_plugin_active(handle, "Blank.esp", !was_active);
+  assert(return_code == 0);
+
+  return_code = lo_restore_snapshot(handle, snapshot);
+  assert(return_code == 0);
+
+  bool is_active = !was_active;
+  return_code = lo_get_plugin_active(handle, "Blank.esp", &is_active);
+  assert(return_code == 0);
+  assert(is_active == was_active);
+
+  lo_destroy_snapshot(snapshot);
+  lo_destroy_handle(handle);
+}
+
 void test_lo_get_indexed_plugin() {
   printf("testing lo_get_indexed_plugin()...\n");
   lo_game_handle handle = create_handle();
@@ -368,35 +757,133 @@ void test_thread_safety() {
   lo_destroy_handle(handle);
 }
 
+void test_reads_during_load() {
+  printf("testing reads during lo_load_current_state()...\n");
+  lo_game_handle handle = create_handle();
+
+  std::thread loader([&](){
+    for (int i = 0; i < 10; ++i) {
+      unsigned int return_code = lo_load_current_state(handle);
+      assert(return_code == 0);
+    }
+  });
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 10; ++i) {
+    readers.push_back(std::thread([&](){
+      for (int j = 0; j < 10; ++j) {
+        char ** plugins = nullptr;
+        size_t num_plugins = 0;
+        unsigned int return_code = lo_get_load_order(handle, &plugins, &num_plugins);
+
+        assert(return_code == 0);
+        assert(num_plugins == 10);
+        assert(strcmp(plugins[0], "Blank.esm") == 0);
+        lo_free_string_array(plugins, num_plugins);
+      }
+    }));
+  }
+
+  loader.join();
+  for (auto& reader : readers) {
+    reader.join();
+  }
+
+  lo_destroy_handle(handle);
+}
+
+void test_lo_load_current_state_async() {
+  printf("testing lo_load_current_state_async()...\n");
+  lo_game_handle handle = create_handle();
+
+  lo_job_handle job = nullptr;
+  unsigned int return_code = lo_load_current_state_async(handle, &job);
+  assert(return_code == 0);
+
+  return_code = lo_wait_for_job(job);
+  assert(return_code == 0);
+
+  bool is_finished = false;
+  return_code = lo_is_job_finished(job, &is_finished);
+  assert(return_code == 0);
+  assert(is_finished);
+
+  size_t plugins_loaded = 0;
+  size_t plugins_total = 0;
+  return_code = lo_get_job_progress(job, &plugins_loaded, &plugins_total);
+  assert(return_code == 0);
+  assert(plugins_total == 10);
+  assert(plugins_loaded == plugins_total);
+
+  lo_destroy_job(job);
+
+  return_code = lo_load_current_state_async(handle, &job);
+  assert(return_code == 0);
+
+  return_code = lo_cancel_job(job);
+  assert(return_code == 0);
+
+  return_code = lo_wait_for_job(job);
+  assert(return_code == 0 || return_code == LIBLO_ERROR_CANCELLED);
+
+  lo_destroy_job(job);
+
+  char ** plugins = nullptr;
+  size_t num_plugins = 0;
+  return_code = lo_get_load_order(handle, &plugins, &num_plugins);
+  assert(return_code == 0);
+  assert(num_plugins == 10);
+  lo_free_string_array(plugins, num_plugins);
+
+  lo_destroy_handle(handle);
+}
+
 int main(void) {
   test_game_id_values();
 
   test_lo_get_error_message();
   test_lo_free_string();
   test_lo_free_string_array();
+  test_lo_free_string_buffer();
 
   test_lo_create_handle();
+  test_lo_get_resolved_settings();
   test_lo_is_ambiguous();
+  test_lo_has_state_changed();
+  test_lo_get_changed_plugins();
   test_lo_fix_plugin_lists();
   test_lo_get_implicitly_active_plugins();
+  test_lo_get_implicitly_active_plugins_packed();
   test_lo_get_early_loading_plugins();
   test_lo_get_active_plugins_file_path();
   test_lo_get_additional_plugins_directories();
   test_lo_set_additional_plugins_directories();
+  test_lo_enable_header_cache();
+  test_lo_enable_shared_header_cache();
+  test_lo_set_thread_count();
+  test_lo_get_metrics();
 
   test_lo_set_active_plugins();
   test_lo_get_active_plugins();
+  test_lo_get_active_plugins_packed();
   test_lo_set_plugin_active();
   test_lo_get_plugin_active();
 
   test_lo_get_load_order_method();
   test_lo_set_load_order();
   test_lo_get_load_order();
+  test_lo_get_load_order_entries();
+  test_lo_get_load_order_packed();
   test_lo_set_plugin_position();
   test_lo_get_plugin_position();
+  test_lo_apply_batch();
+  test_lo_set_load_order_incremental();
+  test_lo_create_snapshot();
   test_lo_get_indexed_plugin();
 
   test_thread_safety();
+  test_reads_during_load();
+  test_lo_load_current_state_async();
 
   remove("testing-plugins/Oblivion/Plugins.txt");
   printf("SUCCESS\n");
@@ -0,0 +1,68 @@
+/*
+ * This file is part of libloadorder
+ *
+ * Copyright (C) 2017 Oliver Hamlet
+ *
+ * libloadorder is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libloadorder is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! Helpers for libloadorder's binary file formats. All integers are
+//! little-endian, and strings are prefixed by their length in bytes as a u32.
+
+use std::io::Write;
+
+pub(crate) fn write_len<W: Write>(writer: &mut W, len: usize) -> std::io::Result<()> {
+    let len = u32::try_from(len).map_err(std::io::Error::other)?;
+    writer.write_all(&len.to_le_bytes())
+}
+
+pub(crate) fn write_str<W: Write>(writer: &mut W, string: &str) -> std::io::Result<()> {
+    write_len(writer, string.len())?;
+    writer.write_all(string.as_bytes())
+}
+
+pub(crate) struct Reader<'a>(pub(crate) &'a [u8]);
+
+impl<'a> Reader<'a> {
+    pub(crate) fn take(&mut self, count: usize) -> Option<&'a [u8]> {
+        let (taken, rest) = self.0.split_at_checked(count)?;
+        self.0 = rest;
+        Some(taken)
+    }
+
+    fn array<const N: usize>(&mut self) -> Option<[u8; N]> {
+        self.take(N)?.try_into().ok()
+    }
+
+    pub(crate) fn u8(&mut self) -> Option<u8> {
+        self.array().map(u8::from_le_bytes)
+    }
+
+    pub(crate) fn u32(&mut self) -> Option<u32> {
+        self.array().map(u32::from_le_bytes)
+    }
+
+    pub(crate) fn u64(&mut self) -> Option<u64> {
+        self.array().map(u64::from_le_bytes)
+    }
+
+    pub(crate) fn len(&mut self) -> Option<usize> {
+        self.u32().and_then(|len| usize::try_from(len).ok())
+    }
+
+    pub(crate) fn str(&mut self) -> Option<&'a str> {
+        let len = self.len()?;
+        std::str::from_utf8(self.take(len)?).ok()
+    }
+}
@@ -135,6 +135,11 @@ pub enum Error {
         pos: usize,
         expected_pos: usize,
     },
+    LoadCancelled,
+    ThreadPoolError(String),
+    IncompatibleSnapshot,
+    InvalidResolvedSettings,
+    OutdatedResolvedSettings,
 }
 
 #[cfg(windows)]
@@ -193,6 +198,11 @@ impl fmt::Display for Error {
                 write!(f, "Error returned by the operating system, code {code}: \"{}\"", message.as_encoded_bytes().escape_ascii()),
             Error::InvalidBlueprintPluginPosition{ name, pos, expected_pos } =>
                 write!(f, "Attempted to load the blueprint plugin \"{name}\" at position {pos}, its expected position is {expected_pos}"),
+            Error::LoadCancelled => write!(f, "The load was cancelled"),
+            Error::ThreadPoolError(message) => write!(f, "The thread pool could not be created: {message}"),
+            Error::IncompatibleSnapshot => write!(f, "The snapshot was taken of a load order for a different game or plugins directory"),
+            Error::InvalidResolvedSettings => write!(f, "The resolved game settings data is invalid or was written by an incompatible version of libloadorder"),
+            Error::OutdatedResolvedSettings => write!(f, "The files that the resolved game settings were read from have changed"),
         }
     }
 }
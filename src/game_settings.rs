@@ -19,20 +19,29 @@
 
 use std::cmp::Ordering;
 use std::fs::{read_dir, DirEntry, File};
+use std::hash::{Hash, Hasher};
 use std::io::{BufRead, BufReader};
 use std::iter::once;
 use std::path::Path;
 use std::path::PathBuf;
+use std::sync::Arc;
+use std::time::{Duration, SystemTime, UNIX_EPOCH};
 
+use crate::binary_format::{write_len, write_str, Reader};
 use crate::enums::{Error, GameId, LoadOrderMethod};
-use crate::ini::{test_files, use_my_games_directory};
-use crate::is_enderal;
+use crate::ini::{
+    starfield_app_manifest_path, test_files, test_files_ini_paths, use_my_games_directory,
+};
 use crate::load_order::{
-    AsteriskBasedLoadOrder, OpenMWLoadOrder, TextfileBasedLoadOrder, TimestampBasedLoadOrder,
-    WritableLoadOrder,
+    fingerprint, AsteriskBasedLoadOrder, Fingerprint, OpenMWLoadOrder, TextfileBasedLoadOrder,
+    TimestampBasedLoadOrder, WritableLoadOrder,
 };
+use crate::metrics::{Metrics, MetricsRecorder, Phase};
 use crate::openmw_config;
+use crate::parallelism::{Parallelism, MIN_PARALLEL_FILE_READS};
 use crate::plugin::{has_plugin_extension, Plugin};
+use crate::shared_header_cache::SharedHeaderCache;
+use crate::{enderal_launcher_path, is_enderal};
 
 #[derive(Clone, Debug, Eq, PartialEq, Ord, PartialOrd, Hash)]
 pub struct GameSettings {
@@ -44,7 +53,13 @@ pub struct GameSettings {
     load_order_path: Option<PathBuf>,
     implicitly_active_plugins: Vec<String>,
     early_loading_plugins: Vec<String>,
+    implicitly_active_sources: TrackedSources,
+    resolution_sources: TrackedSources,
     additional_plugins_directories: Vec<PathBuf>,
+    header_cache_path: Option<PathBuf>,
+    shared_header_cache: Option<Arc<SharedHeaderCache>>,
+    parallelism: Parallelism,
+    metrics: MetricsRecorder,
 }
 
 const SKYRIM_HARDCODED_PLUGINS: &[&str] = &["Skyrim.esm"];
@@ -107,8 +122,51 @@ const MS_FO4_VAULT_TEC_PATH: &str = "../../Fallout 4- Vault-Tec Workshop (PC)/Co
 
 const PLUGINS_TXT: &str = "Plugins.txt";
 
+const HEADER_CACHE_FILENAME: &str = "libloadorder.cache";
+
 const OBLIVION_REMASTERED_RELATIVE_DATA_PATH: &str = "OblivionRemastered/Content/Dev/ObvData/Data";
 
+const APPX_MANIFEST: &str = "appxmanifest.xml";
+
+// Resolved settings are serialised as follows:
+//
+// - the magic bytes "LOGS" and a u32 format version
+// - a u8 index into RESOLVED_GAME_IDS
+// - the game path, plugins directory, plugins file path and My Games path
+// - an optional load order path
+// - a list of additional plugins directories
+// - an optional header cache path
+// - lists of the early-loading and implicitly active plugins
+// - the resolution sources and the implicitly active plugins' sources
+//
+// Optional values and source lists are prefixed by a u8 that is 1 if they're
+// present and 0 otherwise, and other lists are prefixed by their length as a
+// u32. Sources are pairs of a path and a fingerprint, and fingerprints are an
+// optional value of the modification time as a u64 of seconds and a u32 of
+// nanoseconds since the Unix epoch, followed by the file size as a u64.
+//
+// The format version must be incremented whenever the format or the meaning
+// of any of its content changes.
+const RESOLVED_MAGIC: &[u8; 4] = b"LOGS";
+const RESOLVED_FORMAT_VERSION: u32 = 1;
+
+// The order of this array must not change without incrementing the format
+// version.
+const RESOLVED_GAME_IDS: [GameId; 12] = [
+    GameId::Morrowind,
+    GameId::Oblivion,
+    GameId::Skyrim,
+    GameId::Fallout3,
+    GameId::FalloutNV,
+    GameId::Fallout4,
+    GameId::SkyrimSE,
+    GameId::Fallout4VR,
+    GameId::SkyrimVR,
+    GameId::Starfield,
+    GameId::OpenMW,
+    GameId::OblivionRemastered,
+];
+
 impl GameSettings {
     pub fn new(game_id: GameId, game_path: &Path) -> Result<GameSettings, Error> {
         let local_path = local_path(game_id, game_path)?.unwrap_or_default();
@@ -131,32 +189,115 @@ impl GameSettings {
         local_path: &Path,
         my_games_path: PathBuf,
     ) -> Result<GameSettings, Error> {
+        // Fingerprint the sources before reading them, like when refreshing
+        // the implicitly active plugins. OpenMW's config files are only
+        // known once they've been read.
+        let mut resolution_sources =
+            TrackedSources::new(resolution_source_paths(game_id, game_path));
+
         let plugins_file_path = plugins_file_path(game_id, game_path, local_path)?;
         let load_order_path = load_order_path(game_id, local_path, &plugins_file_path);
-        let plugins_directory = plugins_directory(game_id, game_path, local_path)?;
-        let additional_plugins_directories =
-            additional_plugins_directories(game_id, game_path, &my_games_path)?;
-
-        let (early_loading_plugins, implicitly_active_plugins) =
-            GameSettings::load_implicitly_active_plugins(
-                game_id,
-                game_path,
-                &my_games_path,
-                &plugins_directory,
-                &additional_plugins_directories,
-            )?;
-
-        Ok(GameSettings {
+        let (plugins_directory, additional_plugins_directories) = if game_id == GameId::OpenMW {
+            // Read OpenMW's config files once for both sets of directories.
+            let data_paths = openmw_config::data_paths(game_path, local_path)?;
+            for path in data_paths.source_paths {
+                let fingerprint = fingerprint(&path);
+                resolution_sources.push(path, fingerprint);
+            }
+            (data_paths.resources_vfs_path, data_paths.additional_paths)
+        } else {
+            (
+                plugins_directory(game_id, game_path, local_path)?,
+                additional_plugins_directories(game_id, game_path, &my_games_path)?,
+            )
+        };
+
+        let mut settings = GameSettings {
             id: game_id,
             game_path: game_path.to_path_buf(),
             plugins_directory,
             plugins_file_path,
             load_order_path,
             my_games_path,
-            implicitly_active_plugins,
-            early_loading_plugins,
+            implicitly_active_plugins: Vec::new(),
+            early_loading_plugins: Vec::new(),
+            implicitly_active_sources: TrackedSources::default(),
+            resolution_sources,
             additional_plugins_directories,
-        })
+            header_cache_path: None,
+            shared_header_cache: None,
+            parallelism: Parallelism::default(),
+            metrics: MetricsRecorder::default(),
+        };
+
+        settings.refresh_implicitly_active_plugins()?;
+
+        Ok(settings)
+    }
+
+    /// Recreate game settings from the output of
+    /// [GameSettings::to_resolved_bytes], without looking up the game's paths
+    /// again.
+    ///
+    /// Fails with [Error::OutdatedResolvedSettings] if any of the files that
+    /// the paths were resolved from have changed since, in which case the
+    /// settings should be created normally. The early-loading and implicitly
+    /// active plugins are only read again if their sources have changed.
+    pub fn from_resolved_bytes(bytes: &[u8]) -> Result<GameSettings, Error> {
+        let mut settings = parse_resolved_settings(bytes).ok_or(Error::InvalidResolvedSettings)?;
+
+        if !settings.resolution_sources.is_unchanged() {
+            return Err(Error::OutdatedResolvedSettings);
+        }
+
+        settings.refresh_implicitly_active_plugins()?;
+
+        Ok(settings)
+    }
+
+    /// Serialise the game's resolved paths and plugin lists, with
+    /// fingerprints of the files that they were resolved from, so that
+    /// [GameSettings::from_resolved_bytes] can cheaply recreate these
+    /// settings, e.g. in a short-lived worker process.
+    ///
+    /// The parallelism, metrics and shared header cache aren't included.
+    /// Fails with [Error::InvalidPath] if a path isn't valid UTF-8.
+    pub fn to_resolved_bytes(&self) -> Result<Vec<u8>, Error> {
+        let mut bytes = Vec::new();
+
+        bytes.extend_from_slice(RESOLVED_MAGIC);
+        bytes.extend_from_slice(&RESOLVED_FORMAT_VERSION.to_le_bytes());
+
+        let id_index = RESOLVED_GAME_IDS
+            .iter()
+            .position(|id| *id == self.id)
+            .and_then(|i| u8::try_from(i).ok())
+            .ok_or(Error::InvalidResolvedSettings)?;
+        bytes.push(id_index);
+
+        for path in [
+            &self.game_path,
+            &self.plugins_directory,
+            &self.plugins_file_path,
+            &self.my_games_path,
+        ] {
+            write_path(&mut bytes, path)?;
+        }
+        write_optional_path(&mut bytes, self.load_order_path.as_deref())?;
+        write_list(&mut bytes, &self.additional_plugins_directories, |b, p| {
+            write_path(b, p)
+        })?;
+        write_optional_path(&mut bytes, self.header_cache_path.as_deref())?;
+        write_list(&mut bytes, &self.early_loading_plugins, |b, p| {
+            write_str(b, p).map_err(serialisation_error)
+        })?;
+        write_list(&mut bytes, &self.implicitly_active_plugins, |b, p| {
+            write_str(b, p).map_err(serialisation_error)
+        })?;
+        self.resolution_sources.write(&mut bytes)?;
+        self.implicitly_active_sources.write(&mut bytes)?;
+
+        Ok(bytes)
     }
 
     pub fn id(&self) -> GameId {
@@ -240,13 +381,83 @@ impl GameSettings {
 
     pub fn set_additional_plugins_directories(&mut self, paths: Vec<PathBuf>) {
         self.additional_plugins_directories = paths;
+        // Test files may now be found in different directories.
+        self.implicitly_active_sources = TrackedSources::default();
+    }
+
+    /// The path to the file in which plugin header data is cached between
+    /// load order loads, if header caching is enabled.
+    pub fn header_cache_path(&self) -> Option<&Path> {
+        self.header_cache_path.as_deref()
+    }
+
+    /// Enable caching plugin header data in a file at the given path, or
+    /// disable it if no path is given. Header caching is disabled by default.
+    ///
+    /// The cache is read when a load order is first loaded, and plugins with
+    /// files that have the same modification time and size as when they were
+    /// cached are not parsed again. The cache is updated whenever any plugins
+    /// are parsed.
+    pub fn set_header_cache_path(&mut self, path: Option<PathBuf>) {
+        self.header_cache_path = path;
+    }
+
+    /// The default path for the header cache file, which is next to the
+    /// active plugins file.
+    pub fn default_header_cache_path(&self) -> PathBuf {
+        self.plugins_file_path.with_file_name(HEADER_CACHE_FILENAME)
+    }
+
+    /// The cache of plugin headers shared with other load orders, if one is
+    /// used.
+    pub fn shared_header_cache(&self) -> Option<&Arc<SharedHeaderCache>> {
+        self.shared_header_cache.as_ref()
+    }
+
+    /// Share parsed plugin headers with other load orders that use the given
+    /// cache, or stop sharing them if no cache is given. No cache is used by
+    /// default.
+    ///
+    /// Plugins found while scanning the plugins directories take their
+    /// headers from the cache if they're in it and their files are unchanged,
+    /// and otherwise have them parsed and added to it. Use
+    /// `SharedHeaderCache::global()` to share headers across the process.
+    pub fn set_shared_header_cache(&mut self, cache: Option<Arc<SharedHeaderCache>>) {
+        self.shared_header_cache = cache;
+    }
+
+    /// How work like loading plugins is spread across threads.
+    pub fn parallelism(&self) -> &Parallelism {
+        &self.parallelism
+    }
+
+    /// Set how work like loading plugins is spread across threads. By
+    /// default, rayon's global thread pool is used.
+    pub fn set_parallelism(&mut self, parallelism: Parallelism) {
+        self.parallelism = parallelism;
+    }
+
+    /// Get the metrics recorded for load orders using these settings and their
+    /// clones since they were created or their metrics were last reset.
+    pub fn metrics(&self) -> Metrics {
+        self.metrics.snapshot()
+    }
+
+    /// Reset the recorded metrics to zero.
+    pub fn reset_metrics(&self) {
+        self.metrics.reset();
+    }
+
+    pub(crate) fn metrics_recorder(&self) -> &MetricsRecorder {
+        &self.metrics
     }
 
     /// Find installed plugins and return them in their "inactive load order",
     /// which is generally the order in which the game launcher would display
     /// them if they were all inactive, ignoring rules like master files
     /// loading before others and about early-loading plugins.
-    pub(crate) fn find_plugins(&self) -> Vec<PathBuf> {
+    pub(crate) fn find_plugins(&self) -> Vec<PluginFile> {
+        let _timer = self.metrics.time(Phase::FindPlugins);
         let main_dir_iter = once(&self.plugins_directory);
         let other_directories_iter = self.additional_plugins_directories.iter();
 
@@ -254,11 +465,45 @@ impl GameSettings {
         // the same names that appear in the main plugins directory, so check
         // for the additional paths first. For OpenMW the main directory is
         // listed first.
-        if self.id == GameId::OpenMW {
-            find_plugins_in_directories(main_dir_iter.chain(other_directories_iter), self.id)
+        let plugin_files = if self.id == GameId::OpenMW {
+            find_plugins_in_directories(
+                main_dir_iter.chain(other_directories_iter),
+                self.id,
+                &self.parallelism,
+            )
         } else {
-            find_plugins_in_directories(other_directories_iter.chain(main_dir_iter), self.id)
-        }
+            find_plugins_in_directories(
+                other_directories_iter.chain(main_dir_iter),
+                self.id,
+                &self.parallelism,
+            )
+        };
+
+        // Each plugin file's metadata is read to record its modification time
+        // and size.
+        self.metrics.add_files_stated(plugin_files.len());
+
+        plugin_files
+    }
+
+    /// The paths of the files other than plugins that are read to get the
+    /// load order state: the active plugins and load order files, and the CCC
+    /// and ini files that can make plugins implicitly active.
+    pub(crate) fn state_file_paths(&self) -> Vec<PathBuf> {
+        let mut paths = vec![self.plugins_file_path.clone()];
+        paths.extend(self.load_order_path.clone());
+        paths.extend(ccc_file_paths(
+            self.id,
+            &self.game_path,
+            &self.my_games_path,
+        ));
+        paths.extend(test_files_ini_paths(
+            self.id,
+            &self.game_path,
+            &self.my_games_path,
+        ));
+
+        paths
     }
 
     pub(crate) fn game_path(&self) -> &Path {
@@ -274,58 +519,309 @@ impl GameSettings {
         )
     }
 
+    /// Read the early-loading and implicitly active plugins again, unless
+    /// none of the files and directories that they were last read from have
+    /// changed since.
     pub fn refresh_implicitly_active_plugins(&mut self) -> Result<(), Error> {
-        let (early_loading_plugins, implicitly_active_plugins) =
-            GameSettings::load_implicitly_active_plugins(
-                self.id,
-                &self.game_path,
-                &self.my_games_path,
-                &self.plugins_directory,
-                &self.additional_plugins_directories,
-            )?;
-
-        self.early_loading_plugins = early_loading_plugins;
-        self.implicitly_active_plugins = implicitly_active_plugins;
+        if self.implicitly_active_sources.is_unchanged() {
+            return Ok(());
+        }
 
-        Ok(())
-    }
+        // Fingerprint the sources before reading them, so that if they change
+        // while they're being read the next refresh reads them again.
+        // OpenMW's sources aren't tracked, as its non-user config files can
+        // include other config files.
+        let mut sources = if self.id == GameId::OpenMW {
+            TrackedSources::default()
+        } else {
+            TrackedSources::new(self.implicitly_active_source_paths())
+        };
+        self.implicitly_active_sources = TrackedSources::default();
 
-    fn load_implicitly_active_plugins(
-        game_id: GameId,
-        game_path: &Path,
-        my_games_path: &Path,
-        plugins_directory: &Path,
-        additional_plugins_directories: &[PathBuf],
-    ) -> Result<(Vec<String>, Vec<String>), Error> {
-        let mut test_files = test_files(game_id, game_path, my_games_path)?;
+        let mut test_files = test_files(self.id, &self.game_path, &self.my_games_path)?;
 
         if matches!(
-            game_id,
+            self.id,
             GameId::Fallout4 | GameId::Fallout4VR | GameId::Starfield
         ) {
             // Fallout 4 and Starfield ignore plugins.txt and Fallout4.ccc if there are valid
-            // plugins listed as test files, so filter out invalid values.
+            // plugins listed as test files, so filter out invalid values. Their headers are
+            // taken from the shared header cache if there is one.
             test_files.retain(|f| {
-                let path = plugin_path(
-                    game_id,
-                    f,
-                    plugins_directory,
-                    additional_plugins_directories,
-                );
-                Plugin::with_path(&path, game_id, false).is_ok()
+                let path = self.plugin_path(f);
+                let fingerprint = fingerprint(&path);
+                sources.push(path.clone(), fingerprint);
+
+                fingerprint.is_some_and(|(modification_time, file_size)| {
+                    Plugin::with_metadata(&path, self, false, modification_time, file_size).is_ok()
+                })
             });
         }
 
-        let early_loading_plugins =
-            early_loading_plugins(game_id, game_path, my_games_path, !test_files.is_empty())?;
+        let early_loading_plugins = early_loading_plugins(
+            self.id,
+            &self.game_path,
+            &self.my_games_path,
+            !test_files.is_empty(),
+        )?;
+
+        let implicitly_active_plugins = implicitly_active_plugins(
+            self.id,
+            &self.game_path,
+            &early_loading_plugins,
+            &test_files,
+        )?;
+
+        self.early_loading_plugins = early_loading_plugins;
+        self.implicitly_active_plugins = implicitly_active_plugins;
+        self.implicitly_active_sources = sources;
+
+        Ok(())
+    }
+
+    /// The paths of the files and directories that the early-loading and
+    /// implicitly active plugins are read from, other than the test files.
+    fn implicitly_active_source_paths(&self) -> Vec<PathBuf> {
+        let mut paths = ccc_file_paths(self.id, &self.game_path, &self.my_games_path);
+        paths.extend(test_files_ini_paths(
+            self.id,
+            &self.game_path,
+            &self.my_games_path,
+        ));
+
+        match self.id {
+            // Enderal reads its test files from a different ini file.
+            GameId::Skyrim | GameId::SkyrimSE => {
+                paths.push(enderal_launcher_path(&self.game_path));
+            }
+            // The .nam files are found by listing the Data directory.
+            GameId::FalloutNV => paths.push(self.game_path.join("Data")),
+            // Test files are found by checking the plugins directories, and
+            // Starfield's language affects which ini files are read.
+            GameId::Fallout4 | GameId::Fallout4VR | GameId::Starfield => {
+                paths.push(self.plugins_directory.clone());
+                paths.extend(self.additional_plugins_directories.iter().cloned());
+                if self.id == GameId::Starfield {
+                    paths.push(starfield_app_manifest_path(&self.game_path));
+                }
+            }
+            _ => {}
+        }
+
+        paths
+    }
+}
+
+/// Files and directories that game settings were read from, with the
+/// fingerprints that they had before they were read, or None if the settings
+/// must always be read again.
+///
+/// Starfield's language is only tracked through its Steam app manifest, so a
+/// change of Windows display language for a Microsoft Store install isn't
+/// noticed until another source changes.
+///
+/// The sources are only a cache, so they don't affect comparisons between
+/// game settings.
+#[derive(Clone, Debug, Default)]
+struct TrackedSources(Option<Vec<(PathBuf, Fingerprint)>>);
+
+impl TrackedSources {
+    fn new(paths: Vec<PathBuf>) -> Self {
+        TrackedSources(Some(
+            paths
+                .into_iter()
+                .map(|p| {
+                    let fingerprint = fingerprint(&p);
+                    (p, fingerprint)
+                })
+                .collect(),
+        ))
+    }
+
+    fn push(&mut self, path: PathBuf, fingerprint: Fingerprint) {
+        if let Some(sources) = &mut self.0 {
+            sources.push((path, fingerprint));
+        }
+    }
+
+    fn is_unchanged(&self) -> bool {
+        self.0
+            .as_ref()
+            .is_some_and(|s| s.iter().all(|(path, f)| fingerprint(path) == *f))
+    }
+
+    fn write(&self, bytes: &mut Vec<u8>) -> Result<(), Error> {
+        let Some(sources) = &self.0 else {
+            bytes.push(0);
+            return Ok(());
+        };
+
+        bytes.push(1);
+        write_list(bytes, sources, |b, (path, fingerprint)| {
+            write_path(b, path)?;
+            // A modification time before the Unix epoch is written as a
+            // missing fingerprint, so that the source is always treated as
+            // changed.
+            match fingerprint
+                .and_then(|(time, size)| time.duration_since(UNIX_EPOCH).ok().map(|d| (d, size)))
+            {
+                Some((since_epoch, size)) => {
+                    b.push(1);
+                    b.extend_from_slice(&since_epoch.as_secs().to_le_bytes());
+                    b.extend_from_slice(&since_epoch.subsec_nanos().to_le_bytes());
+                    b.extend_from_slice(&size.to_le_bytes());
+                }
+                None => b.push(0),
+            }
+            Ok(())
+        })
+    }
+
+    fn read(reader: &mut Reader) -> Option<Self> {
+        read_optional(reader, |r| {
+            read_list(r, |r| {
+                let path = read_path(r)?;
+                let fingerprint = read_optional(r, |r| {
+                    let since_epoch = Duration::new(r.u64()?, r.u32()?);
+                    Some((UNIX_EPOCH.checked_add(since_epoch)?, r.u64()?))
+                })?;
+                Some((path, fingerprint))
+            })
+        })
+        .map(TrackedSources)
+    }
+}
+
+impl PartialEq for TrackedSources {
+    fn eq(&self, _other: &Self) -> bool {
+        true
+    }
+}
+
+impl Eq for TrackedSources {}
 
-        let implicitly_active_plugins =
-            implicitly_active_plugins(game_id, game_path, &early_loading_plugins, &test_files)?;
+impl PartialOrd for TrackedSources {
+    fn partial_cmp(&self, other: &Self) -> Option<Ordering> {
+        Some(self.cmp(other))
+    }
+}
 
-        Ok((early_loading_plugins, implicitly_active_plugins))
+impl Ord for TrackedSources {
+    fn cmp(&self, _other: &Self) -> Ordering {
+        Ordering::Equal
     }
 }
 
+impl Hash for TrackedSources {
+    fn hash<H: Hasher>(&self, _state: &mut H) {}
+}
+
+fn parse_resolved_settings(bytes: &[u8]) -> Option<GameSettings> {
+    let mut reader = Reader(bytes);
+
+    if reader.take(RESOLVED_MAGIC.len())? != RESOLVED_MAGIC
+        || reader.u32()? != RESOLVED_FORMAT_VERSION
+    {
+        return None;
+    }
+
+    let id = *RESOLVED_GAME_IDS.get(usize::from(reader.u8()?))?;
+    let game_path = read_path(&mut reader)?;
+    let plugins_directory = read_path(&mut reader)?;
+    let plugins_file_path = read_path(&mut reader)?;
+    let my_games_path = read_path(&mut reader)?;
+    let load_order_path = read_optional(&mut reader, read_path)?;
+    let additional_plugins_directories = read_list(&mut reader, read_path)?;
+    let header_cache_path = read_optional(&mut reader, read_path)?;
+    let early_loading_plugins = read_list(&mut reader, |r| r.str().map(str::to_owned))?;
+    let implicitly_active_plugins = read_list(&mut reader, |r| r.str().map(str::to_owned))?;
+    let resolution_sources = TrackedSources::read(&mut reader)?;
+    let implicitly_active_sources = TrackedSources::read(&mut reader)?;
+
+    reader.0.is_empty().then_some(GameSettings {
+        id,
+        game_path,
+        plugins_directory,
+        plugins_file_path,
+        my_games_path,
+        load_order_path,
+        implicitly_active_plugins,
+        early_loading_plugins,
+        implicitly_active_sources,
+        resolution_sources,
+        additional_plugins_directories,
+        header_cache_path,
+        shared_header_cache: None,
+        parallelism: Parallelism::default(),
+        metrics: MetricsRecorder::default(),
+    })
+}
+
+fn serialisation_error(error: std::io::Error) -> Error {
+    Error::IoError(PathBuf::new(), error)
+}
+
+fn write_path(bytes: &mut Vec<u8>, path: &Path) -> Result<(), Error> {
+    let string = path
+        .to_str()
+        .ok_or_else(|| Error::InvalidPath(path.to_path_buf()))?;
+    write_str(bytes, string).map_err(serialisation_error)
+}
+
+fn write_optional_path(bytes: &mut Vec<u8>, path: Option<&Path>) -> Result<(), Error> {
+    if let Some(path) = path {
+        bytes.push(1);
+        write_path(bytes, path)
+    } else {
+        bytes.push(0);
+        Ok(())
+    }
+}
+
+fn write_list<T>(
+    bytes: &mut Vec<u8>,
+    items: &[T],
+    mut write_item: impl FnMut(&mut Vec<u8>, &T) -> Result<(), Error>,
+) -> Result<(), Error> {
+    write_len(bytes, items.len()).map_err(serialisation_error)?;
+    for item in items {
+        write_item(bytes, item)?;
+    }
+    Ok(())
+}
+
+fn read_path(reader: &mut Reader) -> Option<PathBuf> {
+    reader.str().map(PathBuf::from)
+}
+
+#[expect(
+    clippy::option_option,
+    reason = "The outer option is None if the value could not be read"
+)]
+fn read_optional<T>(
+    reader: &mut Reader,
+    read_value: impl FnOnce(&mut Reader) -> Option<T>,
+) -> Option<Option<T>> {
+    match reader.u8()? {
+        0 => Some(None),
+        1 => read_value(reader).map(Some),
+        _ => None,
+    }
+}
+
+fn read_list<T>(
+    reader: &mut Reader,
+    mut read_item: impl FnMut(&mut Reader) -> Option<T>,
+) -> Option<Vec<T>> {
+    let count = reader.len()?;
+    // Don't trust the count when allocating, each item is at least a byte.
+    let mut items = Vec::with_capacity(count.min(reader.0.len()));
+    for _ in 0..count {
+        items.push(read_item(reader)?);
+    }
+    Some(items)
+}
+
 #[cfg(windows)]
 fn local_path(game_id: GameId, game_path: &Path) -> Result<Option<PathBuf>, Error> {
     if game_id == GameId::OpenMW {
@@ -462,8 +958,6 @@ fn skyrim_my_games_folder_name(game_path: &Path) -> &'static str {
 }
 
 fn is_microsoft_store_install(game_id: GameId, game_path: &Path) -> bool {
-    const APPX_MANIFEST: &str = "appxmanifest.xml";
-
     match game_id {
         GameId::Morrowind | GameId::Oblivion | GameId::Fallout3 | GameId::FalloutNV => game_path
             .parent()
@@ -475,6 +969,31 @@ fn is_microsoft_store_install(game_id: GameId, game_path: &Path) -> bool {
     }
 }
 
+/// The paths of the files whose presence or content decide the game's
+/// paths, other than OpenMW's config files. The Documents path on Windows
+/// isn't read from a file, so isn't tracked.
+fn resolution_source_paths(game_id: GameId, game_path: &Path) -> Vec<PathBuf> {
+    // These files identify the store that the game was installed from, and
+    // whether it's actually Enderal.
+    let mut paths = vec![
+        game_path.join(APPX_MANIFEST),
+        game_path.join("Galaxy64.dll"),
+        game_path.join("EOSSDK-Win32-Shipping.dll"),
+        game_path.join("EOSSDK-Win64-Shipping.dll"),
+        enderal_launcher_path(game_path),
+    ];
+
+    if let Some(parent) = game_path.parent() {
+        paths.push(parent.join(APPX_MANIFEST));
+    }
+
+    if game_id == GameId::Oblivion {
+        paths.push(game_path.join("Oblivion.ini"));
+    }
+
+    paths
+}
+
 #[cfg(windows)]
 fn documents_path(_local_path: &Path) -> Option<PathBuf> {
     dirs::document_dir()
@@ -783,47 +1302,62 @@ fn plugin_path(
     }
 }
 
-fn sort_plugins_dir_entries(a: &DirEntry, b: &DirEntry) -> Ordering {
+/// A plugin file found while scanning the plugins directories, along with
+/// the metadata that was read for it during the scan, so that the file doesn't
+/// need to be queried again when sorting or loading it.
+#[derive(Clone, Debug, Eq, PartialEq)]
+pub(crate) struct PluginFile {
+    pub(crate) path: PathBuf,
+    pub(crate) modification_time: Option<SystemTime>,
+    pub(crate) file_size: u64,
+}
+
+impl PluginFile {
+    fn from_dir_entry(entry: &DirEntry) -> Self {
+        let metadata = entry.metadata().ok();
+
+        PluginFile {
+            path: entry.path(),
+            modification_time: metadata.as_ref().and_then(|m| m.modified().ok()),
+            file_size: metadata.map_or(0, |m| m.len()),
+        }
+    }
+}
+
+fn sort_plugin_files(a: &PluginFile, b: &PluginFile) -> Ordering {
     // Sort by file modification timestamps, in ascending order. If two
     // timestamps are equal, sort by filenames in descending order.
-    let m_a = a.metadata().and_then(|m| m.modified()).ok();
-    let m_b = b.metadata().and_then(|m| m.modified()).ok();
-
-    match m_a.cmp(&m_b) {
-        Ordering::Equal => a.file_name().cmp(&b.file_name()).reverse(),
+    match a.modification_time.cmp(&b.modification_time) {
+        Ordering::Equal => a.path.file_name().cmp(&b.path.file_name()).reverse(),
         x => x,
     }
 }
 
-fn sort_plugins_dir_entries_starfield(a: &DirEntry, b: &DirEntry) -> Ordering {
+fn sort_plugin_files_starfield(a: &PluginFile, b: &PluginFile) -> Ordering {
     // Sort by file modification timestamps, in ascending order. If two
     // timestamps are equal, sort by filenames in ascending order.
-    let m_a = a.metadata().and_then(|m| m.modified()).ok();
-    let m_b = b.metadata().and_then(|m| m.modified()).ok();
-
-    match m_a.cmp(&m_b) {
-        Ordering::Equal => a.file_name().cmp(&b.file_name()),
+    match a.modification_time.cmp(&b.modification_time) {
+        Ordering::Equal => a.path.file_name().cmp(&b.path.file_name()),
         x => x,
     }
 }
 
-fn sort_plugins_dir_entries_openmw(a: &DirEntry, b: &DirEntry) -> Ordering {
+fn sort_plugin_files_openmw(a: &PluginFile, b: &PluginFile) -> Ordering {
     // Preserve the directory ordering, but sort case-sensitive
     // lexicographically within directories.
-    if a.path().parent() == b.path().parent() {
-        a.file_name().cmp(&b.file_name())
+    if a.path.parent() == b.path.parent() {
+        a.path.file_name().cmp(&b.path.file_name())
     } else {
         Ordering::Equal
     }
 }
 
-fn find_plugins_in_directories<'a>(
-    directories_iter: impl Iterator<Item = &'a PathBuf>,
-    game_id: GameId,
-) -> Vec<PathBuf> {
-    let mut dir_entries: Vec<_> = directories_iter
-        .flat_map(read_dir)
-        .flatten()
+fn find_plugins_in_directory(directory: &Path, game_id: GameId) -> Vec<PluginFile> {
+    let Ok(dir_entries) = read_dir(directory) else {
+        return Vec::new();
+    };
+
+    dir_entries
         .filter_map(Result::ok)
         .filter(|e| e.file_type().map(|f| f.is_file()).unwrap_or(false))
         .filter(|e| {
@@ -831,17 +1365,36 @@ fn find_plugins_in_directories<'a>(
                 .to_str()
                 .is_some_and(|f| has_plugin_extension(f, game_id))
         })
+        .map(|e| PluginFile::from_dir_entry(&e))
+        .collect()
+}
+
+fn find_plugins_in_directories<'a>(
+    directories_iter: impl Iterator<Item = &'a PathBuf>,
+    game_id: GameId,
+    parallelism: &Parallelism,
+) -> Vec<PluginFile> {
+    let directories: Vec<_> = directories_iter.collect();
+
+    // Directories are read in parallel, but their files are kept in directory
+    // order, which matters for OpenMW.
+    let mut plugin_files: Vec<_> = parallelism
+        .map::<_, _, Vec<_>, _>(&directories, MIN_PARALLEL_FILE_READS, |d| {
+            find_plugins_in_directory(d, game_id)
+        })
+        .into_iter()
+        .flatten()
         .collect();
 
     let compare = match game_id {
-        GameId::OpenMW => sort_plugins_dir_entries_openmw,
-        GameId::Starfield => sort_plugins_dir_entries_starfield,
-        _ => sort_plugins_dir_entries,
+        GameId::OpenMW => sort_plugin_files_openmw,
+        GameId::Starfield => sort_plugin_files_starfield,
+        _ => sort_plugin_files,
     };
 
-    dir_entries.sort_by(compare);
+    plugin_files.sort_by(compare);
 
-    dir_entries.into_iter().map(|e| e.path()).collect()
+    plugin_files
 }
 
 #[cfg(test)]
@@ -2260,6 +2813,286 @@ mod tests {
         assert_eq!(expected_plugins, settings.implicitly_active_plugins());
     }
 
+    #[test]
+    fn refresh_implicitly_active_plugins_should_only_read_sources_again_if_they_have_changed() {
+        let tmp_dir = tempdir().unwrap();
+        let game_path = tmp_dir.path();
+
+        let ini_path = game_path.join("Fallout4.ini");
+        std::fs::write(&ini_path, "[General]\nsTestFile1=Blank.esp\n").unwrap();
+
+        copy_to_dir(
+            "Blank.esp",
+            &game_path.join("Data"),
+            "Blank.esp",
+            GameId::Fallout4,
+        );
+
+        let mut settings = GameSettings::with_local_and_my_games_paths(
+            GameId::Fallout4,
+            game_path,
+            &PathBuf::default(),
+            game_path.to_path_buf(),
+        )
+        .unwrap();
+
+        settings.reset_metrics();
+        settings.refresh_implicitly_active_plugins().unwrap();
+
+        assert_eq!(0, settings.metrics().headers_parsed);
+
+        std::fs::write(
+            &ini_path,
+            "[General]\nsTestFile1=Blank.esp\nsTestFile2=a.esp\n",
+        )
+        .unwrap();
+        settings.refresh_implicitly_active_plugins().unwrap();
+
+        assert_eq!(1, settings.metrics().headers_parsed);
+
+        let mut expected_plugins = FALLOUT4_HARDCODED_PLUGINS.to_vec();
+        expected_plugins.push("Blank.esp");
+        assert_eq!(expected_plugins, settings.implicitly_active_plugins());
+    }
+
+    #[test]
+    fn refresh_implicitly_active_plugins_should_reuse_headers_from_a_shared_header_cache() {
+        let tmp_dir = tempdir().unwrap();
+        let game_path = tmp_dir.path();
+
+        let ini_path = game_path.join("Fallout4.ini");
+        std::fs::write(&ini_path, "[General]\nsTestFile1=Blank.esp\n").unwrap();
+
+        copy_to_dir(
+            "Blank.esp",
+            &game_path.join("Data"),
+            "Blank.esp",
+            GameId::Fallout4,
+        );
+
+        let mut settings = GameSettings::with_local_and_my_games_paths(
+            GameId::Fallout4,
+            game_path,
+            &PathBuf::default(),
+            game_path.to_path_buf(),
+        )
+        .unwrap();
+        settings.set_shared_header_cache(Some(Arc::new(SharedHeaderCache::default())));
+
+        std::fs::write(
+            &ini_path,
+            "[General]\nsTestFile1=Blank.esp\nsTestFile2=a.esp\n",
+        )
+        .unwrap();
+        settings.refresh_implicitly_active_plugins().unwrap();
+        settings.reset_metrics();
+
+        std::fs::write(&ini_path, "[General]\nsTestFile1=Blank.esp\n").unwrap();
+        settings.refresh_implicitly_active_plugins().unwrap();
+
+        assert_eq!(0, settings.metrics().headers_parsed);
+    }
+
+    #[test]
+    fn from_resolved_bytes_should_recreate_the_settings_without_reading_their_sources() {
+        let tmp_dir = tempdir().unwrap();
+        let game_path = tmp_dir.path();
+
+        std::fs::write(
+            game_path.join("Fallout4.ini"),
+            "[General]\nsTestFile1=Blank.esp\n",
+        )
+        .unwrap();
+
+        copy_to_dir(
+            "Blank.esp",
+            &game_path.join("Data"),
+            "Blank.esp",
+            GameId::Fallout4,
+        );
+
+        let mut settings = GameSettings::with_local_and_my_games_paths(
+            GameId::Fallout4,
+            game_path,
+            &PathBuf::default(),
+            game_path.to_path_buf(),
+        )
+        .unwrap();
+        settings.set_header_cache_path(Some(game_path.join(HEADER_CACHE_FILENAME)));
+
+        let bytes = settings.to_resolved_bytes().unwrap();
+        let resolved = GameSettings::from_resolved_bytes(&bytes).unwrap();
+
+        assert_eq!(settings, resolved);
+        assert_eq!(
+            settings.early_loading_plugins(),
+            resolved.early_loading_plugins()
+        );
+        assert_eq!(settings.header_cache_path(), resolved.header_cache_path());
+        assert_eq!(0, resolved.metrics().headers_parsed);
+    }
+
+    #[test]
+    fn from_resolved_bytes_should_read_implicitly_active_plugins_again_if_their_sources_changed() {
+        let tmp_dir = tempdir().unwrap();
+        let game_path = tmp_dir.path();
+        let ini_path = game_path.join("Fallout4.ini");
+
+        copy_to_dir(
+            "Blank.esp",
+            &game_path.join("Data"),
+            "Blank.esp",
+            GameId::Fallout4,
+        );
+
+        let settings = GameSettings::with_local_and_my_games_paths(
+            GameId::Fallout4,
+            game_path,
+            &PathBuf::default(),
+            game_path.to_path_buf(),
+        )
+        .unwrap();
+
+        let bytes = settings.to_resolved_bytes().unwrap();
+
+        std::fs::write(&ini_path, "[General]\nsTestFile1=Blank.esp\n").unwrap();
+
+        let resolved = GameSettings::from_resolved_bytes(&bytes).unwrap();
+
+        let mut expected_plugins = FALLOUT4_HARDCODED_PLUGINS.to_vec();
+        expected_plugins.push("Blank.esp");
+        assert_eq!(expected_plugins, resolved.implicitly_active_plugins());
+    }
+
+    #[test]
+    fn from_resolved_bytes_should_error_if_a_resolution_source_has_changed() {
+        let tmp_dir = tempdir().unwrap();
+        let game_path = tmp_dir.path();
+
+        let settings = game_with_game_path(GameId::Oblivion, game_path);
+        let bytes = settings.to_resolved_bytes().unwrap();
+
+        std::fs::write(
+            game_path.join("Oblivion.ini"),
+            "[General]\nbUseMyGamesDirectory=0\n",
+        )
+        .unwrap();
+
+        assert!(matches!(
+            GameSettings::from_resolved_bytes(&bytes),
+            Err(Error::OutdatedResolvedSettings)
+        ));
+    }
+
+    #[test]
+    fn from_resolved_bytes_should_error_if_an_openmw_config_file_has_changed() {
+        let tmp_dir = tempdir().unwrap();
+        let game_path = tmp_dir.path().join("game");
+        let my_games_path = tmp_dir.path().join("my games");
+        let global_cfg_path = game_path.join("openmw.cfg");
+        let cfg_path = my_games_path.join("openmw.cfg");
+
+        create_dir_all(&game_path).unwrap();
+        std::fs::write(&global_cfg_path, "config=\"../my games\"\n").unwrap();
+
+        let settings =
+            GameSettings::with_local_path(GameId::OpenMW, &game_path, &my_games_path).unwrap();
+        let bytes = settings.to_resolved_bytes().unwrap();
+
+        assert!(GameSettings::from_resolved_bytes(&bytes).is_ok());
+
+        create_dir_all(&my_games_path).unwrap();
+        std::fs::write(&cfg_path, "data=\"foo/bar\"\n").unwrap();
+
+        assert!(matches!(
+            GameSettings::from_resolved_bytes(&bytes),
+            Err(Error::OutdatedResolvedSettings)
+        ));
+    }
+
+    #[test]
+    fn from_resolved_bytes_should_error_if_the_bytes_are_invalid() {
+        let settings = game_with_generic_paths(GameId::Skyrim);
+        let mut bytes = settings.to_resolved_bytes().unwrap();
+
+        assert!(matches!(
+            GameSettings::from_resolved_bytes(&bytes[..bytes.len() - 1]),
+            Err(Error::InvalidResolvedSettings)
+        ));
+
+        bytes[RESOLVED_MAGIC.len()] += 1;
+
+        assert!(matches!(
+            GameSettings::from_resolved_bytes(&bytes),
+            Err(Error::InvalidResolvedSettings)
+        ));
+    }
+
+    fn find_plugin_paths(directory: &Path, game_id: GameId) -> Vec<PathBuf> {
+        find_plugins_in_directories(
+            once(&directory.to_path_buf()),
+            game_id,
+            &Parallelism::default(),
+        )
+        .into_iter()
+        .map(|f| f.path)
+        .collect()
+    }
+
+    #[test]
+    fn find_plugins_in_directories_should_record_file_modification_times_and_sizes() {
+        let tmp_dir = tempdir().unwrap();
+        let game_path = tmp_dir.path();
+
+        copy_to_dir("Blank.esp", game_path, "Blank.esp", GameId::Oblivion);
+        let path = game_path.join("Blank.esp");
+        set_file_timestamps(&path, 10);
+        let metadata = path.metadata().unwrap();
+
+        let result = find_plugins_in_directories(
+            once(&game_path.to_path_buf()),
+            GameId::Oblivion,
+            &Parallelism::default(),
+        );
+
+        assert_eq!(
+            vec![PluginFile {
+                path,
+                modification_time: Some(metadata.modified().unwrap()),
+                file_size: metadata.len(),
+            }],
+            result
+        );
+    }
+
+    #[test]
+    fn find_plugins_in_directories_should_keep_directory_order_for_openmw() {
+        let tmp_dir = tempdir().unwrap();
+        let directories = [tmp_dir.path().join("b"), tmp_dir.path().join("a")];
+
+        copy_to_dir("Blank.esp", &directories[0], "Blank.esp", GameId::OpenMW);
+        copy_to_dir("Blank.esm", &directories[1], "Blank.esm", GameId::OpenMW);
+        copy_to_dir("Blank.esp", &directories[1], "A.esp", GameId::OpenMW);
+
+        let result: Vec<_> = find_plugins_in_directories(
+            directories.iter(),
+            GameId::OpenMW,
+            &Parallelism::default(),
+        )
+        .into_iter()
+        .map(|f| f.path)
+        .collect();
+
+        assert_eq!(
+            vec![
+                directories[0].join("Blank.esp"),
+                directories[1].join("A.esp"),
+                directories[1].join("Blank.esm"),
+            ],
+            result
+        );
+    }
+
     #[test]
     fn find_plugins_in_directories_should_sort_files_by_modification_timestamp() {
         let tmp_dir = tempdir().unwrap();
@@ -2282,7 +3115,7 @@ mod tests {
             set_file_timestamps(&path, i.try_into().unwrap());
         }
 
-        let result = find_plugins_in_directories(once(&game_path.to_path_buf()), GameId::Oblivion);
+        let result = find_plugin_paths(game_path, GameId::Oblivion);
 
         let expected: Vec<_> = plugin_names.iter().map(|n| game_path.join(n)).collect();
 
@@ -2318,7 +3151,7 @@ mod tests {
         set_file_timestamps(&game_path.join("Blank - Different.esp"), timestamp);
         set_file_timestamps(&game_path.join("Blank - Master Dependent.esp"), timestamp);
 
-        let result = find_plugins_in_directories(once(&game_path.to_path_buf()), GameId::Oblivion);
+        let result = find_plugin_paths(game_path, GameId::Oblivion);
 
         let plugin_paths = vec![
             game_path.join("Blank.esm"),
@@ -2355,7 +3188,7 @@ mod tests {
             set_file_timestamps(&path, timestamp);
         }
 
-        let result = find_plugins_in_directories(once(&game_path.to_path_buf()), GameId::Starfield);
+        let result = find_plugin_paths(game_path, GameId::Starfield);
 
         let plugin_paths = vec![
             game_path.join("Blank - Override.esp"),
@@ -0,0 +1,319 @@
+/*
+ * This file is part of libloadorder
+ *
+ * Copyright (C) 2017 Oliver Hamlet
+ *
+ * libloadorder is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libloadorder is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
+ */
+use std::fs::{create_dir_all, read, remove_file, rename, File};
+use std::io::{BufWriter, Write};
+use std::path::Path;
+use std::time::{Duration, UNIX_EPOCH};
+
+use crate::binary_format::{write_len, write_str, Reader};
+use crate::enums::GameId;
+use crate::load_order::temp_file_path;
+use crate::plugin::{Plugin, PluginHeader};
+
+// The cache file format is:
+//
+// - the magic bytes, then the format version as a u32
+// - the number of entries as a u32
+// - for each entry:
+//   - the UTF-8 plugin path
+//   - the modification time as u64 seconds and u32 nanoseconds since the Unix
+//     epoch
+//   - the file size as a u64
+//   - the header flags as a u8
+//   - the number of masters as a u32, then each UTF-8 master name
+//
+// The format version must be incremented whenever the format or the meaning
+// of any of its content changes.
+const MAGIC: &[u8; 4] = b"LOHC";
+const FORMAT_VERSION: u32 = 1;
+
+const MASTER_FLAG: u8 = 0b0001;
+const LIGHT_FLAG: u8 = 0b0010;
+const MEDIUM_FLAG: u8 = 0b0100;
+const BLUEPRINT_FLAG: u8 = 0b1000;
+
+/// Read the plugins stored in the header cache file at the given path. If the
+/// file doesn't exist, is unreadable or is not in the current format, no
+/// plugins are returned. The plugins are not checked against their files,
+/// and are all inactive.
+pub(crate) fn read_header_cache(cache_path: &Path, game_id: GameId) -> Vec<Plugin> {
+    read(cache_path)
+        .ok()
+        .and_then(|bytes| parse_header_cache(&bytes, game_id))
+        .unwrap_or_default()
+}
+
+/// Write the given plugins to a header cache file at the given path, replacing
+/// any existing file.
+pub(crate) fn write_header_cache(cache_path: &Path, plugins: &[Plugin]) -> std::io::Result<()> {
+    if let Some(parent) = cache_path.parent() {
+        if !parent.exists() {
+            create_dir_all(parent)?;
+        }
+    }
+
+    // Write to a temporary file first so that the cache is never left
+    // partially written.
+    let temp_path = temp_file_path(cache_path).map_err(std::io::Error::other)?;
+
+    let result =
+        write_cache_file(&temp_path, plugins).and_then(|()| rename(&temp_path, cache_path));
+    if result.is_err() {
+        remove_file(&temp_path).unwrap_or_default();
+    }
+
+    result
+}
+
+fn write_cache_file(path: &Path, plugins: &[Plugin]) -> std::io::Result<()> {
+    let mut writer = BufWriter::new(File::create(path)?);
+
+    let entries: Vec<_> = plugins.iter().filter_map(Entry::new).collect();
+
+    writer.write_all(MAGIC)?;
+    writer.write_all(&FORMAT_VERSION.to_le_bytes())?;
+    write_len(&mut writer, entries.len())?;
+    for entry in entries {
+        entry.write(&mut writer)?;
+    }
+
+    writer
+        .into_inner()
+        .map_err(std::io::IntoInnerError::into_error)?
+        .sync_all()
+}
+
+struct Entry<'a> {
+    path: &'a str,
+    since_epoch: Duration,
+    file_size: u64,
+    header: &'a PluginHeader,
+}
+
+impl<'a> Entry<'a> {
+    /// Plugins with paths that aren't valid UTF-8 or timestamps before the
+    /// Unix epoch are skipped.
+    fn new(plugin: &'a Plugin) -> Option<Self> {
+        Some(Entry {
+            path: plugin.path().to_str()?,
+            since_epoch: plugin.modification_time().duration_since(UNIX_EPOCH).ok()?,
+            file_size: plugin.file_size(),
+            header: plugin.header(),
+        })
+    }
+
+    fn write<W: Write>(&self, writer: &mut W) -> std::io::Result<()> {
+        let header = self.header;
+        let flags = [
+            (header.is_master_file, MASTER_FLAG),
+            (header.is_light_plugin, LIGHT_FLAG),
+            (header.is_medium_plugin, MEDIUM_FLAG),
+            (header.is_blueprint_plugin, BLUEPRINT_FLAG),
+        ]
+        .into_iter()
+        .filter(|(is_set, _)| *is_set)
+        .fold(0, |flags, (_, flag)| flags | flag);
+
+        write_str(writer, self.path)?;
+        writer.write_all(&self.since_epoch.as_secs().to_le_bytes())?;
+        writer.write_all(&self.since_epoch.subsec_nanos().to_le_bytes())?;
+        writer.write_all(&self.file_size.to_le_bytes())?;
+        writer.write_all(&[flags])?;
+        write_len(writer, header.masters.len())?;
+        for master in &header.masters {
+            write_str(writer, master)?;
+        }
+
+        Ok(())
+    }
+}
+
+fn parse_header_cache(bytes: &[u8], game_id: GameId) -> Option<Vec<Plugin>> {
+    let mut reader = Reader(bytes);
+
+    if reader.take(MAGIC.len())? != MAGIC || reader.u32()? != FORMAT_VERSION {
+        return None;
+    }
+
+    let count = reader.len()?;
+    // Don't trust the counts when allocating, each item is at least a byte.
+    let mut plugins = Vec::with_capacity(count.min(reader.0.len()));
+    for _ in 0..count {
+        let path = Path::new(reader.str()?);
+        let since_epoch = Duration::new(reader.u64()?, reader.u32()?);
+        let modification_time = UNIX_EPOCH.checked_add(since_epoch)?;
+        let file_size = reader.u64()?;
+        let flags = reader.u8()?;
+
+        let master_count = reader.len()?;
+        let mut masters = Vec::with_capacity(master_count.min(reader.0.len()));
+        for _ in 0..master_count {
+            masters.push(reader.str()?.to_owned());
+        }
+
+        let header = PluginHeader {
+            is_master_file: flags & MASTER_FLAG != 0,
+            is_light_plugin: flags & LIGHT_FLAG != 0,
+            is_medium_plugin: flags & MEDIUM_FLAG != 0,
+            is_blueprint_plugin: flags & BLUEPRINT_FLAG != 0,
+            masters,
+        };
+
+        // Skip any entries that aren't valid plugin paths for this game.
+        if let Ok(plugin) = Plugin::with_header(path, game_id, modification_time, file_size, header)
+        {
+            plugins.push(plugin);
+        }
+    }
+
+    reader.0.is_empty().then_some(plugins)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    use std::path::PathBuf;
+
+    use tempfile::tempdir;
+
+    use crate::game_settings::GameSettings;
+    use crate::tests::copy_to_test_dir;
+
+    fn prepare(game_dir: &Path) -> Vec<Plugin> {
+        let game_settings = GameSettings::with_local_and_my_games_paths(
+            GameId::SkyrimSE,
+            game_dir,
+            &PathBuf::default(),
+            PathBuf::default(),
+        )
+        .unwrap();
+
+        ["Blank.esm", "Blank.esp", "Blank - Master Dependent.esp"]
+            .into_iter()
+            .map(|name| {
+                copy_to_test_dir(name, name, &game_settings);
+                Plugin::new(name, &game_settings).unwrap()
+            })
+            .collect()
+    }
+
+    #[test]
+    fn read_header_cache_should_return_the_plugins_that_were_written() {
+        let tmp_dir = tempdir().unwrap();
+        let plugins = prepare(tmp_dir.path());
+        let cache_path = tmp_dir.path().join("local").join("cache.bin");
+
+        write_header_cache(&cache_path, &plugins).unwrap();
+
+        assert_eq!(plugins, read_header_cache(&cache_path, GameId::SkyrimSE));
+    }
+
+    #[test]
+    fn read_header_cache_should_return_no_plugins_if_the_file_does_not_exist() {
+        let tmp_dir = tempdir().unwrap();
+
+        assert!(read_header_cache(&tmp_dir.path().join("cache.bin"), GameId::SkyrimSE).is_empty());
+    }
+
+    #[test]
+    fn read_header_cache_should_return_no_plugins_if_the_format_version_is_different() {
+        let tmp_dir = tempdir().unwrap();
+        let plugins = prepare(tmp_dir.path());
+        let cache_path = tmp_dir.path().join("cache.bin");
+
+        write_header_cache(&cache_path, &plugins).unwrap();
+
+        let mut bytes = read(&cache_path).unwrap();
+        bytes[MAGIC.len()] += 1;
+        std::fs::write(&cache_path, bytes).unwrap();
+
+        assert!(read_header_cache(&cache_path, GameId::SkyrimSE).is_empty());
+    }
+
+    #[test]
+    fn read_header_cache_should_return_no_plugins_if_the_entry_count_is_too_large() {
+        let tmp_dir = tempdir().unwrap();
+        let plugins = prepare(tmp_dir.path());
+        let cache_path = tmp_dir.path().join("cache.bin");
+
+        write_header_cache(&cache_path, &plugins).unwrap();
+
+        let mut bytes = read(&cache_path).unwrap();
+        let count_start = MAGIC.len() + size_of::<u32>();
+        bytes.splice(
+            count_start..count_start + size_of::<u32>(),
+            u32::MAX.to_le_bytes(),
+        );
+        std::fs::write(&cache_path, bytes).unwrap();
+
+        assert!(read_header_cache(&cache_path, GameId::SkyrimSE).is_empty());
+    }
+
+    #[test]
+    fn write_header_cache_should_not_leave_a_temporary_file_behind() {
+        let tmp_dir = tempdir().unwrap();
+        let plugins = prepare(tmp_dir.path());
+        let cache_dir = tmp_dir.path().join("local");
+        let cache_path = cache_dir.join("cache.bin");
+
+        write_header_cache(&cache_path, &plugins).unwrap();
+        write_header_cache(&cache_path, &plugins).unwrap();
+
+        let filenames: Vec<_> = std::fs::read_dir(&cache_dir)
+            .unwrap()
+            .map(|entry| entry.unwrap().file_name())
+            .collect();
+        assert_eq!(vec![std::ffi::OsString::from("cache.bin")], filenames);
+    }
+
+    #[test]
+    fn write_header_cache_should_remove_the_temporary_file_if_it_fails() {
+        let tmp_dir = tempdir().unwrap();
+        let plugins = prepare(tmp_dir.path());
+        let cache_dir = tmp_dir.path().join("local");
+        let cache_path = cache_dir.join("cache.bin");
+
+        // A non-empty directory can't be replaced by a file.
+        create_dir_all(cache_path.join("subdirectory")).unwrap();
+
+        assert!(write_header_cache(&cache_path, &plugins).is_err());
+
+        let filenames: Vec<_> = std::fs::read_dir(&cache_dir)
+            .unwrap()
+            .map(|entry| entry.unwrap().file_name())
+            .collect();
+        assert_eq!(vec![std::ffi::OsString::from("cache.bin")], filenames);
+    }
+
+    #[test]
+    fn read_header_cache_should_return_no_plugins_if_the_file_is_truncated() {
+        let tmp_dir = tempdir().unwrap();
+        let plugins = prepare(tmp_dir.path());
+        let cache_path = tmp_dir.path().join("cache.bin");
+
+        write_header_cache(&cache_path, &plugins).unwrap();
+
+        let mut bytes = read(&cache_path).unwrap();
+        bytes.pop();
+        std::fs::write(&cache_path, bytes).unwrap();
+
+        assert!(read_header_cache(&cache_path, GameId::SkyrimSE).is_empty());
+    }
+}
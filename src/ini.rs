@@ -17,7 +17,7 @@
  * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
  */
 
-use std::path::Path;
+use std::path::{Path, PathBuf};
 
 use encoding_rs::WINDOWS_1252;
 
@@ -187,8 +187,62 @@ pub(crate) fn test_files(
     }
 }
 
+/// Get the paths of the ini files that `test_files()` may read test files
+/// from, whether or not they exist.
+pub(crate) fn test_files_ini_paths(
+    game_id: GameId,
+    game_path: &Path,
+    my_games_path: &Path,
+) -> Vec<PathBuf> {
+    match game_id {
+        GameId::Morrowind | GameId::OpenMW | GameId::OblivionRemastered => Vec::new(),
+        GameId::Oblivion => vec![
+            game_path.join("Oblivion.ini"),
+            my_games_path.join("Oblivion.ini"),
+        ],
+        GameId::Skyrim | GameId::SkyrimSE => {
+            let filename = if crate::is_enderal(game_path) {
+                "Enderal.ini"
+            } else {
+                "Skyrim.ini"
+            };
+
+            vec![my_games_path.join(filename)]
+        }
+        GameId::SkyrimVR => vec![my_games_path.join("SkyrimVR.ini")],
+        GameId::Fallout3 => vec![my_games_path.join("FALLOUT.INI")],
+        GameId::FalloutNV => vec![my_games_path.join("Fallout.ini")],
+        GameId::Fallout4 => vec![
+            my_games_path.join("Fallout4.ini"),
+            my_games_path.join("Fallout4Custom.ini"),
+        ],
+        GameId::Fallout4VR => vec![
+            my_games_path.join("Fallout4VR.ini"),
+            my_games_path.join("Fallout4VRCustom.ini"),
+        ],
+        GameId::Starfield => {
+            let mut paths = vec![
+                game_path.join("Starfield.ini"),
+                my_games_path.join("StarfieldCustom.ini"),
+            ];
+
+            if let Ok(language) = starfield_language(game_path) {
+                paths.push(my_games_path.join(format!("Starfield_{language}.INI")));
+            }
+
+            paths
+        }
+    }
+}
+
+/// Get the path of the Steam app manifest that Starfield's language is read
+/// from, whether or not it exists.
+pub(crate) fn starfield_app_manifest_path(game_path: &Path) -> PathBuf {
+    game_path.join("../../appmanifest_1716740.acf")
+}
+
 fn starfield_language(game_path: &Path) -> Result<&'static str, Error> {
-    let steam_acf_path = game_path.join("../../appmanifest_1716740.acf");
+    let steam_acf_path = starfield_app_manifest_path(game_path);
 
     let language = if steam_acf_path.exists() {
         // Steam install: Get language from app manifest's AppState.UserConfig.language.
@@ -300,8 +354,6 @@ fn map_windows_system_language<T: AsRef<str>>(system_language: T) -> &'static st
 
 #[cfg(test)]
 mod tests {
-    use std::path::PathBuf;
-
     use tempfile::tempdir;
 
     use super::*;
@@ -123,20 +123,35 @@
     )
 )]
 
+mod binary_format;
 mod enums;
 mod game_settings;
 mod ghostable_path;
+mod header_cache;
 mod ini;
 mod load_order;
+mod metrics;
 mod openmw_config;
+mod parallelism;
 mod plugin;
+mod shared_header_cache;
 #[cfg(test)]
 mod tests;
 
 pub use crate::enums::{Error, GameId, LoadOrderMethod};
 pub use crate::game_settings::GameSettings;
-pub use crate::load_order::{ReadableLoadOrder, WritableLoadOrder};
+pub use crate::load_order::{
+    BatchOperation, LoadOrderChanges, LoadOrderDiff, LoadOrderEntry, LoadOrderSnapshot,
+    LoadProgress, LoadStats, ReadableLoadOrder, SaveStats, WritableLoadOrder,
+};
+pub use crate::metrics::Metrics;
+pub use crate::parallelism::Parallelism;
+pub use crate::shared_header_cache::SharedHeaderCache;
+
+fn enderal_launcher_path(game_path: &std::path::Path) -> std::path::PathBuf {
+    game_path.join("Enderal Launcher.exe")
+}
 
 fn is_enderal(game_path: &std::path::Path) -> bool {
-    game_path.join("Enderal Launcher.exe").exists()
+    enderal_launcher_path(game_path).exists()
 }
@@ -17,26 +17,37 @@
  * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
  */
 use std::collections::HashSet;
-use std::fs::File;
-use std::io::{BufWriter, Write};
+use std::mem;
 
 use unicase::UniCase;
 
+use super::diff::LoadOrderDiff;
+use super::load_progress::LoadProgress;
 use super::mutable::{hoist_masters, read_plugin_names, MutableLoadOrder};
+use super::plugin_cache::{LoadStats, PluginCache};
+use super::plugin_index::PluginIndex;
 use super::readable::{ReadableLoadOrder, ReadableLoadOrderBase};
+use super::source_fingerprints::{LoadOrderChanges, SourceFingerprints};
 use super::strict_encode;
 use super::timestamp_based::save_load_order_using_timestamps;
 use super::writable::{
-    activate, add, create_parent_dirs, deactivate, remove, set_active_plugins, WritableLoadOrder,
+    activate, add, apply_batch, apply_diff, deactivate, remove, restore_snapshot,
+    set_active_plugins, snapshot, write_file_if_changed, BatchOperation, LoadOrderSnapshot,
+    SaveStats, WritableLoadOrder,
 };
 use crate::enums::{Error, GameId};
 use crate::game_settings::GameSettings;
+use crate::metrics::Phase;
 use crate::plugin::{trim_dot_ghost, Plugin};
 
 #[derive(Clone, Debug, Eq, PartialEq, Hash)]
 pub(crate) struct AsteriskBasedLoadOrder {
     game_settings: GameSettings,
     plugins: Vec<Plugin>,
+    plugin_index: PluginIndex,
+    load_stats: LoadStats,
+    save_stats: SaveStats,
+    source_fingerprints: SourceFingerprints,
 }
 
 impl AsteriskBasedLoadOrder {
@@ -44,6 +55,10 @@ impl AsteriskBasedLoadOrder {
         Self {
             game_settings,
             plugins: Vec::new(),
+            plugin_index: PluginIndex::default(),
+            load_stats: LoadStats::default(),
+            save_stats: SaveStats::default(),
+            source_fingerprints: SourceFingerprints::default(),
         }
     }
 
@@ -53,6 +68,7 @@ impl AsteriskBasedLoadOrder {
         } else {
             read_plugin_names(
                 self.game_settings().active_plugins_file(),
+                self.game_settings().metrics_recorder(),
                 owning_plugin_line_mapper,
             )
         }
@@ -74,12 +90,21 @@ impl ReadableLoadOrderBase for AsteriskBasedLoadOrder {
     fn plugins(&self) -> &[Plugin] {
         &self.plugins
     }
+
+    fn plugin_index(&self) -> Option<&PluginIndex> {
+        Some(&self.plugin_index)
+    }
 }
 
 impl MutableLoadOrder for AsteriskBasedLoadOrder {
     fn plugins_mut(&mut self) -> &mut Vec<Plugin> {
+        self.plugin_index.invalidate();
         &mut self.plugins
     }
+
+    fn plugins_and_index_mut(&mut self) -> (&mut Vec<Plugin>, Option<&mut PluginIndex>) {
+        (&mut self.plugins, Some(&mut self.plugin_index))
+    }
 }
 
 impl WritableLoadOrder for AsteriskBasedLoadOrder {
@@ -87,27 +112,56 @@ impl WritableLoadOrder for AsteriskBasedLoadOrder {
         &mut self.game_settings
     }
 
-    fn load(&mut self) -> Result<(), Error> {
-        self.plugins_mut().clear();
+    fn load_with_progress(&mut self, progress: &LoadProgress) -> Result<(), Error> {
+        let _timer = self.game_settings.metrics_recorder().time(Phase::Load);
+        let source_fingerprints = SourceFingerprints::new(&self.game_settings);
+        let cache = PluginCache::new(mem::take(self.plugins_mut()), &self.game_settings);
 
         let plugin_tuples = self.read_from_active_plugins_file()?;
+        progress.check_cancelled()?;
         let paths = self.game_settings.find_plugins();
+        progress.check_cancelled()?;
 
-        self.load_unique_plugins(&plugin_tuples, &paths);
+        self.load_stats = self.load_unique_plugins(&plugin_tuples, &paths, &cache, progress);
+        progress.check_cancelled()?;
+        cache.persist(&self.game_settings, &self.plugins, self.load_stats);
 
         self.add_implicitly_active_plugins()?;
 
-        hoist_masters(&mut self.plugins)?;
+        let timer = self
+            .game_settings
+            .metrics_recorder()
+            .time(Phase::HoistMasters);
+        hoist_masters(self.plugins_mut());
+        drop(timer);
+
+        self.source_fingerprints = source_fingerprints;
 
         Ok(())
     }
 
+    fn boxed_clone(&self) -> Box<dyn WritableLoadOrder + Send + Sync + 'static> {
+        Box::new(self.clone())
+    }
+
+    fn last_load_stats(&self) -> LoadStats {
+        self.load_stats
+    }
+
+    fn last_save_stats(&self) -> SaveStats {
+        self.save_stats
+    }
+
+    fn changes_since_load(&self) -> LoadOrderChanges {
+        self.source_fingerprints
+            .changes(&self.game_settings, &self.plugins)
+    }
+
     fn save(&mut self) -> Result<(), Error> {
-        let path = self.game_settings().active_plugins_file();
-        create_parent_dirs(path)?;
+        let _timer = self.game_settings.metrics_recorder().time(Phase::Save);
+        self.save_stats = SaveStats::default();
 
-        let file = File::create(path).map_err(|e| Error::IoError(path.clone(), e))?;
-        let mut writer = BufWriter::new(file);
+        let mut content = Vec::new();
         for plugin in self.plugins() {
             if self.game_settings().loads_early(plugin.name()) {
                 // Skip early loading plugins, but not implicitly active plugins
@@ -116,22 +170,31 @@ impl WritableLoadOrder for AsteriskBasedLoadOrder {
             }
 
             if plugin.is_active() {
-                write!(writer, "*").map_err(|e| Error::IoError(path.clone(), e))?;
+                content.push(b'*');
             }
-            writer
-                .write_all(&strict_encode(plugin.name())?)
-                .map_err(|e| Error::IoError(path.clone(), e))?;
-            writeln!(writer).map_err(|e| Error::IoError(path.clone(), e))?;
+            content.extend_from_slice(&strict_encode(plugin.name())?);
+            content.push(b'\n');
         }
 
+        write_file_if_changed(
+            self.game_settings().active_plugins_file(),
+            &content,
+            self.game_settings().metrics_recorder(),
+        )?;
+
         if self.ignore_active_plugins_file() {
             // If the active plugins file is being ignored there's no harm in
             // writing to it, but it won't actually have any impact on the load
             // order used by the game. In that case, the only way to set the
             // load order is to modify plugin timestamps, so do that.
-            save_load_order_using_timestamps(self)?;
+            self.save_stats = SaveStats {
+                timestamps_written: save_load_order_using_timestamps(self)?,
+            };
         }
 
+        self.source_fingerprints
+            .refresh_plugin_lists(&self.game_settings);
+
         Ok(())
     }
 
@@ -164,14 +227,18 @@ impl WritableLoadOrder for AsteriskBasedLoadOrder {
         // more useful than the returned vec, so insert into the set during the
         // line mapping and then discard the line.
         if !self.ignore_active_plugins_file() {
-            read_plugin_names(self.game_settings().active_plugins_file(), |line| {
-                plugin_line_mapper(line).and_then::<(), _>(|(name, _)| {
-                    set.insert(UniCase::new(
-                        trim_dot_ghost(name, self.game_settings.id()).to_owned(),
-                    ));
-                    None
-                })
-            })?;
+            read_plugin_names(
+                self.game_settings().active_plugins_file(),
+                self.game_settings().metrics_recorder(),
+                |line| {
+                    plugin_line_mapper(line).and_then::<(), _>(|(name, _)| {
+                        set.insert(UniCase::new(
+                            trim_dot_ghost(name, self.game_settings.id()).to_owned(),
+                        ));
+                        None
+                    })
+                },
+            )?;
         }
 
         // All implicitly active plugins have a defined load order position,
@@ -199,6 +266,22 @@ impl WritableLoadOrder for AsteriskBasedLoadOrder {
     fn set_active_plugins(&mut self, active_plugin_names: &[&str]) -> Result<(), Error> {
         set_active_plugins(self, active_plugin_names)
     }
+
+    fn apply_batch(&mut self, operations: &[BatchOperation<'_>]) -> Result<(), Error> {
+        apply_batch(self, operations)
+    }
+
+    fn snapshot(&self) -> LoadOrderSnapshot {
+        snapshot(self)
+    }
+
+    fn restore_snapshot(&mut self, snapshot: &LoadOrderSnapshot) -> Result<(), Error> {
+        restore_snapshot(self, snapshot)
+    }
+
+    fn apply_diff(&mut self, diff: &LoadOrderDiff) -> Result<(), Error> {
+        apply_diff(self, diff)
+    }
 }
 
 fn plugin_line_mapper(line: &str) -> Option<(&str, bool)> {
@@ -235,8 +318,9 @@ mod tests {
     use super::*;
 
     use crate::load_order::tests::*;
+    use crate::load_order::writable::create_parent_dirs;
     use crate::tests::{copy_to_dir, copy_to_test_dir, set_file_timestamps, NON_ASCII};
-    use std::fs::{create_dir_all, remove_dir_all};
+    use std::fs::{create_dir_all, remove_dir_all, File};
     use std::path::Path;
     use std::time::Duration;
     use tempfile::tempdir;
@@ -254,6 +338,10 @@ mod tests {
         AsteriskBasedLoadOrder {
             game_settings,
             plugins,
+            plugin_index: PluginIndex::default(),
+            load_stats: LoadStats::default(),
+            save_stats: SaveStats::default(),
+            source_fingerprints: SourceFingerprints::default(),
         }
     }
 
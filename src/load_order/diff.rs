@@ -0,0 +1,335 @@
+/*
+ * This file is part of libloadorder
+ *
+ * Copyright (C) 2017 Oliver Hamlet
+ *
+ * libloadorder is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libloadorder is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
+ */
+use std::collections::{HashMap, HashSet};
+
+use unicase::UniCase;
+
+use crate::enums::{Error, GameId};
+use crate::plugin::{trim_dot_ghost, Plugin};
+
+/// The changes that turn a load order into a target load order, as found by
+/// `ReadableLoadOrder::diff_load_order()`.
+///
+/// Plugins that keep their relative order aren't moved, so the moves are as
+/// few as possible. The changes can be applied using
+/// `WritableLoadOrder::apply_diff()`: plugins are removed, then moved and
+/// added plugins are inserted at their positions, then plugins are activated
+/// and deactivated.
+#[derive(Clone, Debug, Default, Eq, PartialEq, Hash)]
+pub struct LoadOrderDiff {
+    /// The names of plugins that are not in the target load order, in their
+    /// current load order.
+    pub removed: Vec<String>,
+    /// The names of plugins that are not in the current load order, with their
+    /// positions in the target load order, in target load order.
+    pub added: Vec<(String, usize)>,
+    /// The names of plugins that need to move, with their positions in the
+    /// target load order, in target load order.
+    pub moved: Vec<(String, usize)>,
+    /// The names of plugins that are inactive or added and need to be active,
+    /// in target load order.
+    pub activated: Vec<String>,
+    /// The names of active plugins that need to be inactive, in target load
+    /// order. Removed plugins are not included.
+    pub deactivated: Vec<String>,
+}
+
+impl LoadOrderDiff {
+    /// Returns true if the load order already matches the target.
+    pub fn is_empty(&self) -> bool {
+        self.removed.is_empty()
+            && self.added.is_empty()
+            && self.moved.is_empty()
+            && self.activated.is_empty()
+            && self.deactivated.is_empty()
+    }
+
+    /// Returns true if the diff adds, removes or moves any plugins, rather
+    /// than only changing which plugins are active.
+    pub(super) fn changes_positions(&self) -> bool {
+        !self.removed.is_empty() || !self.added.is_empty() || !self.moved.is_empty()
+    }
+}
+
+pub(super) fn diff_load_order(
+    plugins: &[Plugin],
+    game_id: GameId,
+    plugin_names: &[&str],
+    active_plugin_names: &[&str],
+) -> Result<LoadOrderDiff, Error> {
+    let current: Vec<_> = plugins.iter().map(|p| (p.name(), p.is_active())).collect();
+
+    diff_plugin_states(&current, game_id, plugin_names, active_plugin_names)
+}
+
+/// Find the changes that turn the current plugin names and active states into
+/// the target ones. Names are compared case-insensitively, ignoring any ghost
+/// extension if the game allows plugin ghosting, as in `Plugin::name_matches()`.
+fn diff_plugin_states(
+    current: &[(&str, bool)],
+    game_id: GameId,
+    plugin_names: &[&str],
+    active_plugin_names: &[&str],
+) -> Result<LoadOrderDiff, Error> {
+    let key = |name| UniCase::new(trim_dot_ghost(name, game_id));
+
+    let mut target_indices = HashMap::with_capacity(plugin_names.len());
+    for (index, name) in plugin_names.iter().enumerate() {
+        if target_indices.insert(key(name), index).is_some() {
+            return Err(Error::DuplicatePlugin((*name).to_owned()));
+        }
+    }
+
+    let mut target_active = HashSet::with_capacity(active_plugin_names.len());
+    for name in active_plugin_names {
+        if !target_indices.contains_key(&key(name)) {
+            return Err(Error::PluginNotFound((*name).to_owned()));
+        }
+        target_active.insert(key(name));
+    }
+
+    let current_indices: HashMap<_, _> = current
+        .iter()
+        .enumerate()
+        .map(|(index, (name, _))| (key(name), index))
+        .collect();
+
+    let mut diff = LoadOrderDiff {
+        removed: current
+            .iter()
+            .filter(|(name, _)| !target_indices.contains_key(&key(name)))
+            .map(|(name, _)| (*name).to_owned())
+            .collect(),
+        ..LoadOrderDiff::default()
+    };
+
+    // The current indices of the plugins that are in both load orders, in
+    // target load order. The plugins with indices in the longest increasing
+    // subsequence are already in the right relative order, so only the others
+    // need to move.
+    let kept: Vec<_> = plugin_names
+        .iter()
+        .filter_map(|name| current_indices.get(&key(name)).copied())
+        .collect();
+    let mut is_unmoved = longest_increasing_subsequence(&kept).into_iter();
+
+    for (position, name) in plugin_names.iter().enumerate() {
+        let should_be_active = target_active.contains(&key(name));
+
+        let Some((current_name, is_active)) = current_indices
+            .get(&key(name))
+            .and_then(|i| current.get(*i))
+        else {
+            diff.added.push(((*name).to_owned(), position));
+            if should_be_active {
+                diff.activated.push((*name).to_owned());
+            }
+            continue;
+        };
+
+        if !is_unmoved.next().unwrap_or(false) {
+            diff.moved.push(((*current_name).to_owned(), position));
+        }
+
+        if should_be_active && !is_active {
+            diff.activated.push((*current_name).to_owned());
+        } else if !should_be_active && *is_active {
+            diff.deactivated.push((*current_name).to_owned());
+        }
+    }
+
+    Ok(diff)
+}
+
+/// Find a longest strictly increasing subsequence of the given values, in
+/// O(n log n) time. Returns whether each value is part of the subsequence.
+fn longest_increasing_subsequence(values: &[usize]) -> Vec<bool> {
+    // tails[k] is the index of the smallest value that ends an increasing
+    // subsequence of length k + 1, and predecessors[i] is the index of the
+    // value before values[i] in the subsequence that it ends.
+    let mut tails: Vec<usize> = Vec::new();
+    let mut predecessors = vec![None; values.len()];
+
+    for (index, value) in values.iter().enumerate() {
+        let length = tails.partition_point(|t| values.get(*t).is_some_and(|v| v < value));
+
+        if let Some(predecessor) = predecessors.get_mut(index) {
+            *predecessor = length.checked_sub(1).and_then(|l| tails.get(l)).copied();
+        }
+
+        if let Some(tail) = tails.get_mut(length) {
+            *tail = index;
+        } else {
+            tails.push(index);
+        }
+    }
+
+    let mut in_subsequence = vec![false; values.len()];
+    let mut next = tails.last().copied();
+    while let Some(index) = next {
+        if let Some(is_in) = in_subsequence.get_mut(index) {
+            *is_in = true;
+        }
+        next = predecessors.get(index).copied().flatten();
+    }
+
+    in_subsequence
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn unmoved(values: &[usize]) -> Vec<usize> {
+        values
+            .iter()
+            .zip(longest_increasing_subsequence(values))
+            .filter(|(_, is_in)| *is_in)
+            .map(|(v, _)| *v)
+            .collect()
+    }
+
+    #[test]
+    fn longest_increasing_subsequence_should_find_a_longest_strictly_increasing_subsequence() {
+        assert!(unmoved(&[]).is_empty());
+        assert_eq!(vec![0usize, 1, 2, 3], unmoved(&[0, 1, 2, 3]));
+        assert_eq!(1, unmoved(&[3, 2, 1, 0]).len());
+        assert_eq!(vec![1usize, 2, 3], unmoved(&[1, 2, 3, 0]));
+        assert_eq!(vec![0usize, 1, 2], unmoved(&[3, 0, 1, 2]));
+        assert_eq!(vec![0usize, 1, 3, 5], unmoved(&[4, 0, 2, 1, 3, 5]));
+    }
+
+    #[test]
+    fn diff_plugin_states_should_be_empty_if_the_target_matches_the_current_state() {
+        let current = [("A.esm", true), ("B.esp", false), ("C.esp", true)];
+
+        let diff = diff_plugin_states(
+            &current,
+            GameId::Oblivion,
+            &["a.esm", "B.esp", "C.esp"],
+            &["A.esm", "c.esp"],
+        )
+        .unwrap();
+
+        assert!(diff.is_empty());
+    }
+
+    #[test]
+    fn diff_plugin_states_should_only_move_plugins_outside_the_longest_kept_sequence() {
+        let current = [
+            ("A.esm", false),
+            ("B.esp", false),
+            ("C.esp", false),
+            ("D.esp", false),
+            ("E.esp", false),
+        ];
+
+        let diff = diff_plugin_states(
+            &current,
+            GameId::Oblivion,
+            &["A.esm", "E.esp", "B.esp", "C.esp", "D.esp"],
+            &[],
+        )
+        .unwrap();
+
+        assert_eq!(vec![("E.esp".to_owned(), 1usize)], diff.moved);
+        assert!(diff.added.is_empty());
+        assert!(diff.removed.is_empty());
+    }
+
+    #[test]
+    fn diff_plugin_states_should_record_added_and_removed_plugins_and_active_state_changes() {
+        let current = [("A.esm", true), ("B.esp", true), ("C.esp", false)];
+
+        let diff = diff_plugin_states(
+            &current,
+            GameId::Oblivion,
+            &["A.esm", "D.esp", "C.esp"],
+            &["A.esm", "C.esp"],
+        )
+        .unwrap();
+
+        assert_eq!(vec!["B.esp".to_owned()], diff.removed);
+        assert_eq!(vec![("D.esp".to_owned(), 1usize)], diff.added);
+        assert!(diff.moved.is_empty());
+        assert_eq!(vec!["C.esp".to_owned()], diff.activated);
+        assert!(diff.deactivated.is_empty());
+        assert!(diff.changes_positions());
+    }
+
+    #[test]
+    fn diff_plugin_states_should_use_the_current_names_of_existing_plugins() {
+        let current = [("A.esm", false), ("B.esp", true)];
+
+        let diff = diff_plugin_states(&current, GameId::Oblivion, &["b.esp", "a.esm"], &["a.esm"])
+            .unwrap();
+
+        assert_eq!(vec![("B.esp".to_owned(), 0usize)], diff.moved);
+        assert_eq!(vec!["A.esm".to_owned()], diff.activated);
+        assert_eq!(vec!["B.esp".to_owned()], diff.deactivated);
+    }
+
+    #[test]
+    fn diff_plugin_states_should_not_distinguish_between_ghosted_and_unghosted_names() {
+        let current = [("A.esm", false), ("B.esp", true)];
+
+        let diff = diff_plugin_states(
+            &current,
+            GameId::Oblivion,
+            &["a.esm.ghost", "B.esp.GHOST"],
+            &["A.esm.ghost", "b.esp"],
+        )
+        .unwrap();
+
+        assert!(diff.removed.is_empty());
+        assert!(diff.added.is_empty());
+        assert!(diff.moved.is_empty());
+        assert_eq!(vec!["A.esm".to_owned()], diff.activated);
+        assert!(diff.deactivated.is_empty());
+
+        assert!(matches!(
+            diff_plugin_states(&current, GameId::Oblivion, &["A.esm", "A.esm.ghost"], &[]),
+            Err(Error::DuplicatePlugin(n)) if n == "A.esm.ghost"
+        ));
+    }
+
+    #[test]
+    fn diff_plugin_states_should_distinguish_ghosted_names_if_the_game_does_not_ghost_plugins() {
+        let current = [("A.esm", false)];
+
+        let diff = diff_plugin_states(&current, GameId::OpenMW, &["A.esm.ghost"], &[]).unwrap();
+
+        assert_eq!(vec!["A.esm".to_owned()], diff.removed);
+        assert_eq!(vec![("A.esm.ghost".to_owned(), 0usize)], diff.added);
+    }
+
+    #[test]
+    fn diff_plugin_states_should_error_if_given_duplicate_or_unlisted_plugins() {
+        let current = [("A.esm", false)];
+
+        assert!(matches!(
+            diff_plugin_states(&current, GameId::Oblivion, &["A.esm", "a.esm"], &[]),
+            Err(Error::DuplicatePlugin(n)) if n == "a.esm"
+        ));
+        assert!(matches!(
+            diff_plugin_states(&current, GameId::Oblivion, &["A.esm"], &["B.esp"]),
+            Err(Error::PluginNotFound(n)) if n == "B.esp"
+        ));
+    }
+}
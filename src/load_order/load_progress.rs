@@ -0,0 +1,114 @@
+/*
+ * This file is part of libloadorder
+ *
+ * Copyright (C) 2017 Oliver Hamlet
+ *
+ * libloadorder is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libloadorder is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
+ */
+use std::sync::atomic::{AtomicBool, AtomicUsize, Ordering};
+
+use crate::enums::Error;
+
+/// Allows a call to `WritableLoadOrder::load_with_progress()` to be monitored
+/// and cancelled from other threads.
+#[derive(Debug, Default)]
+pub struct LoadProgress {
+    cancelled: AtomicBool,
+    plugins_loaded: AtomicUsize,
+    plugins_total: AtomicUsize,
+}
+
+impl LoadProgress {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Ask for the load to stop. The load stops at the next point where it
+    /// checks for cancellation, which happens between scanning for plugins,
+    /// loading them and sorting them, and before loading each plugin. It then
+    /// fails with `Error::LoadCancelled`.
+    pub fn cancel(&self) {
+        self.cancelled.store(true, Ordering::Relaxed);
+    }
+
+    pub fn is_cancelled(&self) -> bool {
+        self.cancelled.load(Ordering::Relaxed)
+    }
+
+    /// The number of plugins that have been loaded so far, counting any that
+    /// failed to load.
+    pub fn plugins_loaded(&self) -> usize {
+        self.plugins_loaded.load(Ordering::Relaxed)
+    }
+
+    /// The number of plugins that will be loaded, which is zero until the
+    /// plugins directories have been scanned.
+    pub fn plugins_total(&self) -> usize {
+        self.plugins_total.load(Ordering::Relaxed)
+    }
+
+    pub(super) fn check_cancelled(&self) -> Result<(), Error> {
+        if self.is_cancelled() {
+            Err(Error::LoadCancelled)
+        } else {
+            Ok(())
+        }
+    }
+
+    pub(super) fn start_loading_plugins(&self, total: usize) {
+        self.plugins_loaded.store(0, Ordering::Relaxed);
+        self.plugins_total.store(total, Ordering::Relaxed);
+    }
+
+    pub(super) fn plugin_loaded(&self) {
+        self.plugins_loaded.fetch_add(1, Ordering::Relaxed);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn check_cancelled_should_error_once_cancelled() {
+        let progress = LoadProgress::new();
+
+        assert!(progress.check_cancelled().is_ok());
+
+        progress.cancel();
+
+        assert!(progress.is_cancelled());
+        assert!(matches!(
+            progress.check_cancelled(),
+            Err(Error::LoadCancelled)
+        ));
+    }
+
+    #[test]
+    fn start_loading_plugins_should_reset_the_counts() {
+        let progress = LoadProgress::new();
+
+        progress.start_loading_plugins(3);
+        progress.plugin_loaded();
+        progress.plugin_loaded();
+
+        assert_eq!(2, progress.plugins_loaded());
+        assert_eq!(3, progress.plugins_total());
+
+        progress.start_loading_plugins(5);
+
+        assert_eq!(0, progress.plugins_loaded());
+        assert_eq!(5, progress.plugins_total());
+    }
+}
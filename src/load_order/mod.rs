@@ -18,9 +18,15 @@
  */
 
 mod asterisk_based;
+mod diff;
+mod load_progress;
 mod mutable;
 mod openmw;
+mod plugin_cache;
+mod plugin_index;
+mod plugin_list;
 mod readable;
+mod source_fingerprints;
 #[cfg(test)]
 mod tests;
 mod textfile_based;
@@ -34,11 +40,17 @@ use encoding_rs::WINDOWS_1252;
 use super::enums::Error;
 
 pub(crate) use self::asterisk_based::AsteriskBasedLoadOrder;
+pub use self::diff::LoadOrderDiff;
+pub use self::load_progress::LoadProgress;
 pub(crate) use self::openmw::OpenMWLoadOrder;
-pub use self::readable::ReadableLoadOrder;
+pub use self::plugin_cache::LoadStats;
+pub use self::readable::{LoadOrderEntry, ReadableLoadOrder};
+pub use self::source_fingerprints::LoadOrderChanges;
+pub(crate) use self::source_fingerprints::{fingerprint, Fingerprint};
 pub(crate) use self::textfile_based::TextfileBasedLoadOrder;
 pub(crate) use self::timestamp_based::TimestampBasedLoadOrder;
-pub use self::writable::WritableLoadOrder;
+pub(crate) use self::writable::temp_file_path;
+pub use self::writable::{BatchOperation, LoadOrderSnapshot, SaveStats, WritableLoadOrder};
 
 fn strict_encode(string: &str) -> Result<Cow<'_, [u8]>, Error> {
     let (output, _, had_unmappable_chars) = WINDOWS_1252.encode(string);
@@ -19,43 +19,132 @@
 
 use std::collections::{BTreeMap, HashMap, HashSet};
 use std::mem;
-use std::path::{Path, PathBuf};
+use std::path::Path;
 
-use encoding_rs::WINDOWS_1252;
-use rayon::prelude::*;
 use unicase::{eq, UniCase};
 
+use super::load_progress::LoadProgress;
+use super::plugin_cache::{InstalledFiles, LoadStats, PluginCache};
+use super::plugin_index::PluginIndex;
+use super::plugin_list::{PluginList, PluginListEncoding};
 use super::readable::{ReadableLoadOrder, ReadableLoadOrderBase};
 use crate::enums::Error;
-use crate::game_settings::GameSettings;
-use crate::plugin::{trim_dot_ghost, Plugin};
+use crate::game_settings::PluginFile;
+use crate::metrics::{MetricsRecorder, Phase};
+use crate::parallelism::{MIN_PARALLEL_FILE_READS, MIN_PARALLEL_METADATA_OPERATIONS};
+use crate::plugin::{trim_dot_ghost, trim_dot_ghost_unchecked, Plugin};
 use crate::GameId;
 
 pub(super) trait MutableLoadOrder: ReadableLoadOrder + ReadableLoadOrderBase + Sync {
+    /// Implementations that have a plugin index must discard it when this is
+    /// called, as the caller may reorder, add or remove plugins.
     fn plugins_mut(&mut self) -> &mut Vec<Plugin>;
 
-    fn find_plugin_mut(&mut self, plugin_name: &str) -> Option<&mut Plugin> {
-        self.plugins_mut()
+    /// Get the plugins and the plugin index without discarding the index. The
+    /// caller is responsible for keeping the index up to date with any changes
+    /// made to the plugins.
+    fn plugins_and_index_mut(&mut self) -> (&mut Vec<Plugin>, Option<&mut PluginIndex>) {
+        (self.plugins_mut(), None)
+    }
+
+    /// Activate the plugin at the given position, if there is one.
+    fn activate_plugin_at(&mut self, position: usize) -> Result<(), Error> {
+        let metrics = self.game_settings_base().metrics_recorder().clone();
+        let (plugins, index) = self.plugins_and_index_mut();
+
+        if let Some(plugin) = plugins.get_mut(position).filter(|p| !p.is_active()) {
+            plugin.activate(&metrics)?;
+            if let Some(index) = index {
+                index.record_activation(plugin);
+            }
+        }
+
+        Ok(())
+    }
+
+    /// Activate the plugins at the given positions. Any ghosted plugins are
+    /// unghosted in parallel.
+    fn activate_plugins_at(&mut self, positions: &[usize]) -> Result<(), Error> {
+        let metrics = self.game_settings_base().metrics_recorder().clone();
+        let parallelism = self.game_settings_base().parallelism().clone();
+        let (plugins, index) = self.plugins_and_index_mut();
+
+        let mut is_listed = vec![false; plugins.len()];
+        for position in positions {
+            if let Some(is_listed) = is_listed.get_mut(*position) {
+                *is_listed = true;
+            }
+        }
+
+        let mut to_activate: Vec<_> = plugins
             .iter_mut()
-            .find(|p| p.name_matches(plugin_name))
+            .zip(is_listed)
+            .filter(|(p, is_listed)| *is_listed && !p.is_active())
+            .map(|(p, _)| p)
+            .collect();
+
+        let result = parallelism.map_mut::<_, _, Result<Vec<_>, Error>, _>(
+            &mut to_activate,
+            MIN_PARALLEL_FILE_READS,
+            |p| p.activate(&metrics),
+        );
+
+        // Record all the plugins that were activated, even if some failed.
+        if let Some(index) = index {
+            for plugin in to_activate.iter().filter(|p| p.is_active()) {
+                index.record_activation(plugin);
+            }
+        }
+
+        result.map(|_| ())
+    }
+
+    /// Deactivate the plugin at the given position, if there is one.
+    fn deactivate_plugin_at(&mut self, position: usize) {
+        let (plugins, index) = self.plugins_and_index_mut();
+
+        if let Some(plugin) = plugins.get_mut(position).filter(|p| p.is_active()) {
+            plugin.deactivate();
+            if let Some(index) = index {
+                index.record_deactivation(plugin);
+            }
+        }
+    }
+
+    fn insert_plugin(&mut self, position: usize, plugin: Plugin) {
+        let (plugins, index) = self.plugins_and_index_mut();
+        if let Some(index) = index {
+            index.insert(position, &plugin);
+        }
+        plugins.insert(position, plugin);
+    }
+
+    fn remove_plugin(&mut self, position: usize) -> Plugin {
+        let (plugins, index) = self.plugins_and_index_mut();
+        let plugin = plugins.remove(position);
+        if let Some(index) = index {
+            index.remove(position, &plugin);
+        }
+        plugin
     }
 
     fn max_active_full_plugins(&self) -> usize {
-        let has_active_light_plugin = if self.game_settings().id().supports_light_plugins() {
-            self.plugins()
-                .iter()
-                .any(|p| p.is_active() && p.is_light_plugin())
-        } else {
-            false
-        };
+        let counts = self.active_plugin_counts();
 
-        let has_active_medium_plugin = if self.game_settings().id().supports_medium_plugins() {
-            self.plugins()
-                .iter()
-                .any(|p| p.is_active() && p.is_medium_plugin())
-        } else {
-            false
-        };
+        self.full_plugins_limit(counts.light > 0, counts.medium > 0)
+    }
+
+    /// The maximum number of full plugins that can be active, given whether
+    /// any light and medium plugins are also active.
+    fn full_plugins_limit(
+        &self,
+        has_active_light_plugin: bool,
+        has_active_medium_plugin: bool,
+    ) -> usize {
+        let game_id = self.game_settings().id();
+        let has_active_light_plugin = has_active_light_plugin && game_id.supports_light_plugins();
+        let has_active_medium_plugin =
+            has_active_medium_plugin && game_id.supports_medium_plugins();
 
         if has_active_light_plugin && has_active_medium_plugin {
             253
@@ -85,40 +174,38 @@ pub(super) trait MutableLoadOrder: ReadableLoadOrder + ReadableLoadOrderBase + S
                 return Some(loaded_plugin_count);
             }
 
-            if self.plugins().iter().any(|p| {
-                p.is_blueprint_master() == plugin.is_blueprint_master()
-                    && p.name_matches(plugin_name)
-            }) {
+            if self
+                .find_plugin(plugin_name)
+                .is_some_and(|p| p.is_blueprint_master() == plugin.is_blueprint_master())
+            {
                 loaded_plugin_count += 1;
             }
         }
 
-        generic_insert_position(self.plugins(), plugin)
+        generic_insert_position(self, plugin)
     }
 
     fn validate_index(&self, plugin: &Plugin, index: usize) -> Result<(), Error> {
         if plugin.is_blueprint_master() {
             // Blueprint plugins load after all non-blueprint plugins of the
             // same scale, even non-masters.
-            validate_blueprint_plugin_index(self.plugins(), plugin, index)
+            validate_blueprint_plugin_index(self, plugin, index)
         } else {
             self.validate_early_loading_plugin_indexes(plugin.name(), index)?;
 
             if plugin.is_master_file() {
-                validate_master_file_index(self.plugins(), plugin, index)
+                validate_master_file_index(self, plugin, index)
             } else {
-                validate_non_master_file_index(self.plugins(), plugin, index)
+                validate_non_master_file_index(self, plugin, index)
             }
         }
     }
 
     fn lookup_plugins(&mut self, active_plugin_names: &[&str]) -> Result<Vec<usize>, Error> {
         active_plugin_names
-            .par_iter()
+            .iter()
             .map(|n| {
-                self.plugins()
-                    .par_iter()
-                    .position_any(|p| p.name_matches(n))
+                self.index_of(n)
                     .ok_or_else(|| Error::PluginNotFound((*n).to_owned()))
             })
             .collect()
@@ -133,19 +220,20 @@ pub(super) trait MutableLoadOrder: ReadableLoadOrder + ReadableLoadOrderBase + S
 
         let plugin = get_plugin_to_insert_at(self, plugin_name, position)?;
 
-        if position >= self.plugins().len() {
-            self.plugins_mut().push(plugin);
-            Ok(self.plugins().len() - 1)
-        } else {
-            self.plugins_mut().insert(position, plugin);
-            Ok(position)
-        }
+        let position = position.min(self.plugins().len());
+        self.insert_plugin(position, plugin);
+        Ok(position)
     }
 
     fn deactivate_all(&mut self) {
-        for plugin in self.plugins_mut() {
+        let (plugins, index) = self.plugins_and_index_mut();
+        for plugin in plugins {
             plugin.deactivate();
         }
+
+        if let Some(index) = index {
+            index.record_all_deactivated();
+        }
     }
 
     fn replace_plugins(&mut self, plugin_names: &[&str]) -> Result<(), Error> {
@@ -161,7 +249,12 @@ pub(super) trait MutableLoadOrder: ReadableLoadOrder + ReadableLoadOrderBase + S
 
         let mut plugins = map_to_plugins(self, plugin_names)?;
 
+        let timer = self
+            .game_settings()
+            .metrics_recorder()
+            .time(Phase::Validate);
         validate_load_order(&plugins, self.game_settings().early_loading_plugins())?;
+        drop(timer);
 
         mem::swap(&mut plugins, self.plugins_mut());
 
@@ -171,27 +264,48 @@ pub(super) trait MutableLoadOrder: ReadableLoadOrder + ReadableLoadOrderBase + S
     fn load_unique_plugins(
         &mut self,
         defined_load_order: &[(String, bool)],
-        installed_files: &[PathBuf],
-    ) {
-        let plugins: Vec<_> = Self::total_insertion_order(
+        installed_files: &[PluginFile],
+        cache: &PluginCache,
+        progress: &LoadProgress,
+    ) -> LoadStats {
+        let installed_metadata = InstalledFiles::new(installed_files);
+
+        let insertion_order = Self::total_insertion_order(
             defined_load_order,
             installed_files,
             self.game_settings().id(),
-        )
-        .into_par_iter()
-        .filter_map(|(filename, active)| {
-            Plugin::with_active(&filename, self.game_settings(), active).ok()
-        })
-        .collect();
+        );
+        progress.start_loading_plugins(insertion_order.len());
+
+        let game_settings = self.game_settings();
+        let loaded: Vec<_> = game_settings.parallelism().filter_map(
+            &insertion_order,
+            MIN_PARALLEL_FILE_READS,
+            |(filename, active)| {
+                if progress.is_cancelled() {
+                    return None;
+                }
 
-        for plugin in plugins {
+                let loaded = cache
+                    .load(filename, game_settings, *active, &installed_metadata)
+                    .ok();
+                progress.plugin_loaded();
+                loaded
+            },
+        );
+
+        let stats = LoadStats::count(&loaded);
+
+        for (plugin, _) in loaded {
             insert(self, plugin);
         }
+
+        stats
     }
 
     fn total_insertion_order(
         defined_load_order: &[(String, bool)],
-        installed_files: &[PathBuf],
+        installed_files: &[PluginFile],
         game_id: GameId,
     ) -> Vec<(String, bool)> {
         fn get_key_from_filename(filename: &str, game_id: GameId) -> UniCase<&str> {
@@ -213,7 +327,7 @@ pub(super) trait MutableLoadOrder: ReadableLoadOrder + ReadableLoadOrderBase + S
         // If multiple file paths have the same filename, keep the first path.
         let unique_file_tuples_iter = installed_files
             .iter()
-            .filter_map(|p| filename_str(p))
+            .filter_map(|f| filename_str(&f.path))
             .filter(|filename| set.insert(get_key_from_filename(filename, game_id)))
             .map(|f| (f.to_owned(), false));
 
@@ -287,60 +401,61 @@ where
     T: MutableLoadOrder,
     F: Fn(&str) -> Option<String> + Send + Sync,
 {
-    load_order.deactivate_all();
-
     let plugin_names = read_plugin_names(
         load_order.game_settings().active_plugins_file(),
+        load_order.game_settings().metrics_recorder(),
         line_mapper,
     )?;
 
-    for plugin_name in plugin_names {
-        if let Some(plugin) = load_order.find_plugin_mut(&plugin_name) {
-            plugin.activate()?;
-        }
-    }
+    activate_listed_plugins(load_order, plugin_names.iter().map(String::as_str))
+}
 
-    Ok(())
+/// Deactivate all plugins, then activate the given plugins, skipping any that
+/// aren't in the load order.
+pub(super) fn activate_listed_plugins<'a, T: MutableLoadOrder>(
+    load_order: &mut T,
+    plugin_names: impl Iterator<Item = &'a str>,
+) -> Result<(), Error> {
+    load_order.deactivate_all();
+
+    let positions: Vec<_> = plugin_names
+        .filter_map(|n| load_order.index_of(n))
+        .collect();
+
+    load_order.activate_plugins_at(&positions)
 }
 
-pub(super) fn read_plugin_names<F, T>(file_path: &Path, line_mapper: F) -> Result<Vec<T>, Error>
+pub(super) fn read_plugin_names<F, T>(
+    file_path: &Path,
+    metrics: &MetricsRecorder,
+    line_mapper: F,
+) -> Result<Vec<T>, Error>
 where
     F: FnMut(&str) -> Option<T> + Send + Sync,
     T: Send,
 {
-    if !file_path.exists() {
-        return Ok(Vec::new());
-    }
-
-    let content =
-        std::fs::read(file_path).map_err(|e| Error::IoError(file_path.to_path_buf(), e))?;
-
-    // This should never fail, as although Windows-1252 has a few unused bytes
-    // they get mapped to C1 control characters.
-    let decoded_content = WINDOWS_1252
-        .decode_without_bom_handling_and_without_replacement(&content)
-        .ok_or_else(|| Error::DecodeError(content.clone()))?;
-
-    Ok(decoded_content.lines().filter_map(line_mapper).collect())
-}
-
-pub(super) fn plugin_line_mapper(line: &str) -> Option<String> {
-    if line.is_empty() || line.starts_with('#') {
-        None
-    } else {
-        Some(line.to_owned())
-    }
+    Ok(
+        PluginList::read(file_path, PluginListEncoding::Windows1252, metrics)?
+            .lines()
+            .filter_map(line_mapper)
+            .collect(),
+    )
 }
 
 /// If an ESM has a master that is lower down in the load order, the master will
 /// be loaded directly before the ESM instead of in its usual position. This
 /// function "hoists" such masters further up the load order to match that
 /// behaviour.
-pub(super) fn hoist_masters(plugins: &mut Vec<Plugin>) -> Result<(), Error> {
+pub(super) fn hoist_masters(plugins: &mut Vec<Plugin>) {
+    let positions: HashMap<_, _> = plugins
+        .iter()
+        .enumerate()
+        .map(|(i, p)| (UniCase::new(p.name()), i))
+        .collect();
+
     // Store plugins' current positions and where they need to move to.
     // Use a BTreeMap so that if a plugin needs to move for more than one ESM,
-    // it will move for the earlier one and so also satisfy the later one, and
-    // so that it's possible to iterate over content in order.
+    // it will move for the earlier one and so also satisfy the later one.
     let mut from_to_map: BTreeMap<usize, usize> = BTreeMap::new();
 
     for (index, plugin) in plugins.iter().enumerate() {
@@ -348,12 +463,15 @@ pub(super) fn hoist_masters(plugins: &mut Vec<Plugin>) -> Result<(), Error> {
             continue;
         }
 
-        for master in plugin.masters()? {
-            let pos = plugins
-                .iter()
-                .position(|p| {
-                    p.name_matches(&master)
-                        && (plugin.is_blueprint_master() || !p.is_blueprint_master())
+        for master in plugin.masters() {
+            let pos = positions
+                .get(&UniCase::new(trim_dot_ghost_unchecked(master)))
+                .copied()
+                .filter(|i| {
+                    plugins.get(*i).is_some_and(|p| {
+                        p.name_matches(master)
+                            && (plugin.is_blueprint_master() || !p.is_blueprint_master())
+                    })
                 })
                 .unwrap_or(0);
             if pos > index {
@@ -364,13 +482,12 @@ pub(super) fn hoist_masters(plugins: &mut Vec<Plugin>) -> Result<(), Error> {
         }
     }
 
-    move_elements(plugins, from_to_map);
-
-    Ok(())
+    move_elements(plugins, &from_to_map);
 }
 
 fn validate_early_loader_positions(
     plugins: &[Plugin],
+    positions: &LoadOrderPositions<'_>,
     early_loading_plugins: &[String],
 ) -> Result<(), Error> {
     // Check that all early loading plugins that are present load in
@@ -379,9 +496,9 @@ fn validate_early_loader_positions(
     for (i, plugin_name) in early_loading_plugins.iter().enumerate() {
         // Blueprint masters never actually load early, so it's as
         // if they're missing.
-        match plugins
-            .iter()
-            .position(|p| !p.is_blueprint_master() && eq(p.name(), plugin_name))
+        match positions
+            .position(plugin_name)
+            .filter(|p| plugins.get(*p).is_some_and(|p| !p.is_blueprint_master()))
         {
             Some(pos) => {
                 let expected_pos = i - missing_plugins_count;
@@ -400,25 +517,27 @@ fn validate_early_loader_positions(
     Ok(())
 }
 
-fn generic_insert_position(plugins: &[Plugin], plugin: &Plugin) -> Option<usize> {
-    let is_master_of = |p: &Plugin| {
-        p.masters()
-            .map(|masters| masters.iter().any(|m| plugin.name_matches(m)))
-            .unwrap_or(false)
+fn generic_insert_position<T: ReadableLoadOrderBase + ?Sized>(
+    load_order: &T,
+    plugin: &Plugin,
+) -> Option<usize> {
+    let plugins = load_order.plugins();
+    let dependents = load_order.dependent_positions(plugin);
+    let first_dependent_position = |predicate: fn(&Plugin) -> bool| {
+        dependents
+            .iter()
+            .copied()
+            .find(|i| plugins.get(*i).is_some_and(predicate))
     };
 
     if plugin.is_blueprint_master() {
         // Blueprint plugins load after all other plugins unless they are
         // hoisted by another blueprint plugin.
-        return plugins
-            .iter()
-            .position(|p| p.is_blueprint_master() && is_master_of(p));
+        return first_dependent_position(Plugin::is_blueprint_master);
     }
 
     // Check that there isn't a master that would hoist this plugin.
-    let hoisted_index = plugins
-        .iter()
-        .position(|p| p.is_master_file() && is_master_of(p));
+    let hoisted_index = first_dependent_position(Plugin::is_master_file);
 
     hoisted_index.or_else(|| {
         if plugin.is_master_file() {
@@ -429,22 +548,34 @@ fn generic_insert_position(plugins: &[Plugin], plugin: &Plugin) -> Option<usize>
     })
 }
 
-fn to_plugin(
+fn to_plugin<T: ReadableLoadOrderBase + ?Sized>(
     plugin_name: &str,
-    existing_plugins: &[Plugin],
-    game_settings: &GameSettings,
+    load_order: &T,
 ) -> Result<Plugin, Error> {
-    existing_plugins
-        .par_iter()
-        .find_any(|p| p.name_matches(plugin_name))
-        .map_or_else(
-            || Plugin::new(plugin_name, game_settings),
-            |p| Ok(p.clone()),
-        )
+    load_order.find_plugin(plugin_name).map_or_else(
+        || Plugin::new(plugin_name, load_order.game_settings_base()),
+        |p| Ok(p.clone()),
+    )
 }
 
-fn validate_blueprint_plugin_index(
-    plugins: &[Plugin],
+/// Get the first plugin that loads before the given index and has the given
+/// plugin as a master, and that satisfies the given predicate.
+fn find_preceding_dependent<'a, T: ReadableLoadOrderBase + ?Sized>(
+    load_order: &'a T,
+    plugin: &Plugin,
+    index: usize,
+    predicate: impl Fn(&Plugin) -> bool,
+) -> Option<&'a Plugin> {
+    load_order
+        .dependent_positions(plugin)
+        .into_iter()
+        .take_while(|i| *i < index)
+        .filter_map(|i| load_order.plugins().get(i))
+        .find(|p| predicate(p))
+}
+
+fn validate_blueprint_plugin_index<T: ReadableLoadOrderBase + ?Sized>(
+    load_order: &T,
     plugin: &Plugin,
     index: usize,
 ) -> Result<(), Error> {
@@ -452,25 +583,17 @@ fn validate_blueprint_plugin_index(
     // they get moved after all non-blueprint plugins before conflicts are
     // resolved and don't get hoisted by non-blueprint plugins. However, they
     // do get hoisted by other blueprint plugins.
-    let preceding_plugins = plugins.get(..index).unwrap_or(plugins);
+    let plugins = load_order.plugins();
 
     // Check that none of the preceding blueprint plugins have this plugin as a
     // master.
-    for preceding_plugin in preceding_plugins {
-        if !preceding_plugin.is_blueprint_master() {
-            continue;
-        }
-
-        let preceding_masters = preceding_plugin.masters()?;
-        if preceding_masters
-            .iter()
-            .any(|m| eq(m.as_str(), plugin.name()))
-        {
-            return Err(Error::UnrepresentedHoist {
-                plugin: plugin.name().to_owned(),
-                master: preceding_plugin.name().to_owned(),
-            });
-        }
+    if let Some(preceding_plugin) = find_preceding_dependent(load_order, plugin, index, |p| {
+        p.is_blueprint_master() && p.has_master(plugin.name())
+    }) {
+        return Err(Error::UnrepresentedHoist {
+            plugin: plugin.name().to_owned(),
+            master: preceding_plugin.name().to_owned(),
+        });
     }
 
     let following_plugins = plugins.get(index..).unwrap_or(&[]);
@@ -491,25 +614,22 @@ fn validate_blueprint_plugin_index(
     }
 }
 
-fn validate_master_file_index(
-    plugins: &[Plugin],
+fn validate_master_file_index<T: ReadableLoadOrderBase + ?Sized>(
+    load_order: &T,
     plugin: &Plugin,
     index: usize,
 ) -> Result<(), Error> {
+    let plugins = load_order.plugins();
     let preceding_plugins = plugins.get(..index).unwrap_or(plugins);
 
     // Check that none of the preceding plugins have this plugin as a master.
-    for preceding_plugin in preceding_plugins {
-        let preceding_masters = preceding_plugin.masters()?;
-        if preceding_masters
-            .iter()
-            .any(|m| eq(m.as_str(), plugin.name()))
-        {
-            return Err(Error::UnrepresentedHoist {
-                plugin: plugin.name().to_owned(),
-                master: preceding_plugin.name().to_owned(),
-            });
-        }
+    if let Some(preceding_plugin) =
+        find_preceding_dependent(load_order, plugin, index, |p| p.has_master(plugin.name()))
+    {
+        return Err(Error::UnrepresentedHoist {
+            plugin: plugin.name().to_owned(),
+            master: preceding_plugin.name().to_owned(),
+        });
     }
 
     let previous_master_pos = preceding_plugins
@@ -517,15 +637,12 @@ fn validate_master_file_index(
         .rposition(Plugin::is_master_file)
         .unwrap_or(0);
 
-    let masters = plugin.masters()?;
-    let master_names: HashSet<_> = masters.iter().map(|m| UniCase::new(m.as_str())).collect();
-
     // Check that all of the plugins that load between this index and
     // the previous plugin are masters of this plugin.
     if let Some(n) = preceding_plugins
         .iter()
         .skip(previous_master_pos + 1)
-        .find(|p| !master_names.contains(&UniCase::new(p.name())))
+        .find(|p| !plugin.has_master(p.name()))
     {
         return Err(Error::NonMasterBeforeMaster {
             master: plugin.name().to_owned(),
@@ -535,11 +652,14 @@ fn validate_master_file_index(
 
     // Check that none of the plugins that load after index are
     // masters of this plugin.
-    if let Some(p) = plugins
+    let first_later_master = plugin
+        .masters()
         .iter()
-        .skip(index)
-        .find(|p| master_names.contains(&UniCase::new(p.name())))
-    {
+        .filter_map(|m| load_order.find_plugin_and_index(m))
+        .filter(|(i, p)| *i >= index && plugin.has_master(p.name()))
+        .min_by_key(|(i, _)| *i);
+
+    if let Some((_, p)) = first_later_master {
         Err(Error::UnrepresentedHoist {
             plugin: p.name().to_owned(),
             master: plugin.name().to_owned(),
@@ -549,37 +669,33 @@ fn validate_master_file_index(
     }
 }
 
-fn validate_non_master_file_index(
-    plugins: &[Plugin],
+fn validate_non_master_file_index<T: ReadableLoadOrderBase + ?Sized>(
+    load_order: &T,
     plugin: &Plugin,
     index: usize,
 ) -> Result<(), Error> {
     // Check that there aren't any earlier master files that have this
     // plugin as a master.
-    for master_file in plugins.iter().take(index).filter(|p| p.is_master_file()) {
-        if master_file
-            .masters()?
-            .iter()
-            .any(|m| plugin.name_matches(m))
-        {
-            return Err(Error::UnrepresentedHoist {
-                plugin: plugin.name().to_owned(),
-                master: master_file.name().to_owned(),
-            });
-        }
+    if let Some(master_file) =
+        find_preceding_dependent(load_order, plugin, index, Plugin::is_master_file)
+    {
+        return Err(Error::UnrepresentedHoist {
+            plugin: plugin.name().to_owned(),
+            master: master_file.name().to_owned(),
+        });
     }
 
     // Check that the next master file has this plugin as a master.
-    let next_master = match plugins.iter().skip(index).find(|p| p.is_master_file()) {
-        None => return Ok(()),
-        Some(p) => p,
+    let Some(next_master) = load_order
+        .plugins()
+        .iter()
+        .skip(index)
+        .find(|p| p.is_master_file())
+    else {
+        return Ok(());
     };
 
-    if next_master
-        .masters()?
-        .iter()
-        .any(|m| plugin.name_matches(m))
-    {
+    if next_master.masters().iter().any(|m| plugin.name_matches(m)) {
         Ok(())
     } else {
         Err(Error::NonMasterBeforeMaster {
@@ -593,41 +709,85 @@ fn map_to_plugins<T: ReadableLoadOrderBase + Sync + ?Sized>(
     load_order: &T,
     plugin_names: &[&str],
 ) -> Result<Vec<Plugin>, Error> {
-    plugin_names
-        .par_iter()
-        .map(|n| to_plugin(n, load_order.plugins(), load_order.game_settings_base()))
-        .collect()
+    load_order.game_settings_base().parallelism().map(
+        plugin_names,
+        MIN_PARALLEL_METADATA_OPERATIONS,
+        |n| to_plugin(n, load_order),
+    )
 }
 
 fn insert<T: MutableLoadOrder + ?Sized>(load_order: &mut T, plugin: Plugin) -> usize {
-    if let Some(position) = load_order.insert_position(&plugin) {
-        load_order.plugins_mut().insert(position, plugin);
-        position
-    } else {
-        load_order.plugins_mut().push(plugin);
-        load_order.plugins().len() - 1
-    }
+    let position = load_order
+        .insert_position(&plugin)
+        .unwrap_or(load_order.plugins().len());
+
+    load_order.insert_plugin(position, plugin);
+
+    position
 }
 
-fn move_elements<T>(vec: &mut Vec<T>, mut from_to_indices: BTreeMap<usize, usize>) {
-    // Move elements around. Moving elements doesn't change from_index values,
-    // as we're iterating from earliest index to latest, but to_index values can
-    // become incorrect, e.g. (5, 2), (6, 3), (7, 1) will insert an element
-    // before index 3 so that should become 4, but 1 is still correct.
-    // Keeping track of what indices need offsets is probably not worth it as
-    // this function is likely to be called with empty or very small maps, so
-    // just loop through it after each move and increment any affected to_index
-    // values.
-    while let Some((from_index, to_index)) = from_to_indices.pop_first() {
-        let element = vec.remove(from_index);
-        vec.insert(to_index, element);
-
-        for value in from_to_indices.values_mut() {
-            if *value < from_index && *value > to_index {
-                *value += 1;
+/// Move each element at a key index to directly before the element at its
+/// value index, which must be lower. If more than one element is moved before
+/// the same element, the later ones end up first. An element can both move and
+/// have elements moved before it, in which case they move with it.
+fn move_elements<T>(vec: &mut Vec<T>, from_to_indices: &BTreeMap<usize, usize>) {
+    if from_to_indices.is_empty() {
+        return;
+    }
+
+    // For each element, the elements that need to load directly before it.
+    let mut moved_before: Vec<Vec<usize>> = Vec::new();
+    moved_before.resize_with(vec.len(), Vec::new);
+
+    let mut is_moved = vec![false; vec.len()];
+
+    for (from_index, to_index) in from_to_indices.iter().rev() {
+        if to_index < from_index && *from_index < vec.len() {
+            if let Some(before) = moved_before.get_mut(*to_index) {
+                before.push(*from_index);
+            }
+            if let Some(moved) = is_moved.get_mut(*from_index) {
+                *moved = true;
             }
         }
     }
+
+    // Every moved element has a lower target index, so following the moves
+    // always ends at an element that isn't moved, and each element is visited
+    // once.
+    let mut new_order = Vec::with_capacity(vec.len());
+    let mut stack = Vec::new();
+    for (index, moved) in is_moved.iter().enumerate() {
+        if *moved {
+            continue;
+        }
+
+        stack.push((index, false));
+        while let Some((index, is_expanded)) = stack.pop() {
+            if is_expanded {
+                new_order.push(index);
+                continue;
+            }
+
+            stack.push((index, true));
+            if let Some(before) = moved_before.get(index) {
+                stack.extend(before.iter().rev().map(|i| (*i, false)));
+            }
+        }
+    }
+
+    reorder(vec, &new_order);
+}
+
+/// Rearrange the elements so that the element at `new_order[i]` ends up at
+/// index `i`. Indices that are missing from `new_order` are dropped.
+pub(super) fn reorder<T>(vec: &mut Vec<T>, new_order: &[usize]) {
+    let mut elements: Vec<Option<T>> = mem::take(vec).into_iter().map(Some).collect();
+
+    *vec = new_order
+        .iter()
+        .filter_map(|i| elements.get_mut(*i).and_then(Option::take))
+        .collect();
 }
 
 fn get_plugin_to_insert_at<T: MutableLoadOrder + ?Sized>(
@@ -638,7 +798,7 @@ fn get_plugin_to_insert_at<T: MutableLoadOrder + ?Sized>(
     if let Some((index, plugin)) = load_order.find_plugin_and_index(plugin_name) {
         load_order.validate_index(plugin, insert_position)?;
 
-        Ok(load_order.plugins_mut().remove(index))
+        Ok(load_order.remove_plugin(index))
     } else {
         let plugin = Plugin::new(plugin_name, load_order.game_settings())?;
 
@@ -648,78 +808,155 @@ fn get_plugin_to_insert_at<T: MutableLoadOrder + ?Sized>(
     }
 }
 
-fn validate_load_order(plugins: &[Plugin], early_loading_plugins: &[String]) -> Result<(), Error> {
-    validate_early_loader_positions(plugins, early_loading_plugins)?;
+pub(super) fn validate_load_order(
+    plugins: &[Plugin],
+    early_loading_plugins: &[String],
+) -> Result<(), Error> {
+    let positions = LoadOrderPositions::new(plugins);
 
-    validate_no_unhoisted_non_masters_before_masters(plugins)?;
+    validate_early_loader_positions(plugins, &positions, early_loading_plugins)?;
 
-    validate_no_non_blueprint_plugins_after_blueprint_plugins(plugins)?;
+    let unrepresented_hoist = validate_master_positions(plugins, &positions)?;
 
-    validate_plugins_load_before_their_masters(plugins)?;
+    validate_no_non_blueprint_plugins_after_blueprint_plugins(plugins, &positions)?;
 
-    Ok(())
+    match unrepresented_hoist {
+        Some(e) => Err(e),
+        None => Ok(()),
+    }
 }
 
-fn validate_no_unhoisted_non_masters_before_masters(plugins: &[Plugin]) -> Result<(), Error> {
-    let first_non_master_pos = match find_first_non_master_position(plugins) {
-        None => plugins.len(),
-        Some(x) => x,
-    };
+/// The positions that validating a load order needs, gathered in one pass over
+/// its plugins.
+struct LoadOrderPositions<'a> {
+    by_name: HashMap<UniCase<&'a str>, usize>,
+    first_non_master: Option<usize>,
+    last_non_blueprint_master: Option<usize>,
+    first_blueprint_master: Option<usize>,
+    last_non_blueprint_plugin: Option<usize>,
+}
+
+impl<'a> LoadOrderPositions<'a> {
+    fn new(plugins: &'a [Plugin]) -> Self {
+        let mut positions = LoadOrderPositions {
+            by_name: HashMap::with_capacity(plugins.len()),
+            first_non_master: None,
+            last_non_blueprint_master: None,
+            first_blueprint_master: None,
+            last_non_blueprint_plugin: None,
+        };
+
+        for (index, plugin) in plugins.iter().enumerate() {
+            positions
+                .by_name
+                .entry(UniCase::new(plugin.name()))
+                .or_insert(index);
+
+            if plugin.is_blueprint_master() {
+                positions.first_blueprint_master.get_or_insert(index);
+            } else {
+                positions.last_non_blueprint_plugin = Some(index);
+
+                if plugin.is_master_file() {
+                    positions.last_non_blueprint_master = Some(index);
+                } else {
+                    positions.first_non_master.get_or_insert(index);
+                }
+            }
+        }
+
+        positions
+    }
+
+    fn position(&self, plugin_name: &str) -> Option<usize> {
+        self.by_name.get(&UniCase::new(plugin_name)).copied()
+    }
+}
 
+/// Check that no non-master loads before a master unless it's hoisted by a
+/// master that loads after it. This also finds the last master file that
+/// loads before one of its masters, as that needs the same pass over the
+/// plugins, but that error is returned instead of raised so that the blueprint
+/// plugin positions can be checked first.
+fn validate_master_positions(
+    plugins: &[Plugin],
+    positions: &LoadOrderPositions<'_>,
+) -> Result<Option<Error>, Error> {
     // Ignore blueprint plugins because they load after non-masters.
-    let last_master_pos = match plugins
-        .iter()
-        .rposition(|p| p.is_master_file() && !p.is_blueprint_master())
-    {
-        None => return Ok(()),
-        Some(x) => x,
+    let hoist_check_range = match (
+        positions.first_non_master,
+        positions.last_non_blueprint_master,
+    ) {
+        (Some(first), Some(last)) if first < last => Some(first..=last),
+        _ => None,
     };
 
-    let mut plugin_names: HashSet<UniCase<String>> = HashSet::new();
-
     // Add each plugin that isn't a master file to the hashset.
     // When a master file is encountered, remove its masters from the hashset.
     // If there are any plugins left in the hashset, they weren't hoisted there,
     // so fail the check.
-    if first_non_master_pos < last_master_pos {
-        for plugin in plugins
-            .iter()
-            .skip(first_non_master_pos)
-            .take(last_master_pos - first_non_master_pos + 1)
-        {
-            if plugin.is_master_file() {
-                for master in plugin.masters()? {
-                    plugin_names.remove(&UniCase::new(master.clone()));
-                }
+    let mut plugin_names: HashSet<UniCase<&str>> = HashSet::new();
+    let mut unrepresented_hoist = None;
 
-                if let Some(n) = plugin_names.iter().next() {
-                    return Err(Error::NonMasterBeforeMaster {
-                        master: plugin.name().to_owned(),
-                        non_master: n.to_string(),
-                    });
-                }
-            } else {
-                plugin_names.insert(UniCase::new(plugin.name().to_owned()));
+    for (index, plugin) in plugins.iter().enumerate() {
+        let check_hoisting = hoist_check_range
+            .as_ref()
+            .is_some_and(|r| r.contains(&index));
+
+        if !plugin.is_master_file() {
+            if check_hoisting {
+                plugin_names.insert(UniCase::new(plugin.name()));
+            }
+            continue;
+        }
+
+        if check_hoisting {
+            for master in plugin.masters() {
+                plugin_names.remove(&UniCase::new(master.as_str()));
+            }
+
+            if let Some(n) = plugin_names.iter().next() {
+                return Err(Error::NonMasterBeforeMaster {
+                    master: plugin.name().to_owned(),
+                    non_master: n.to_string(),
+                });
+            }
+        }
+
+        let later_master = plugin.masters().iter().find_map(|m| {
+            positions
+                .position(m)
+                .filter(|i| *i > index)
+                .and_then(|i| plugins.get(i))
+        });
+
+        if let Some(m) = later_master {
+            // Don't error if a non-blueprint plugin depends on a blueprint plugin.
+            if plugin.is_blueprint_master() || !m.is_blueprint_master() {
+                // Keep the last such plugin's error.
+                unrepresented_hoist = Some((m, plugin));
             }
         }
     }
 
-    Ok(())
+    Ok(
+        unrepresented_hoist.map(|(m, plugin)| Error::UnrepresentedHoist {
+            plugin: m.name().to_owned(),
+            master: plugin.name().to_owned(),
+        }),
+    )
 }
 
 fn validate_no_non_blueprint_plugins_after_blueprint_plugins(
     plugins: &[Plugin],
+    positions: &LoadOrderPositions<'_>,
 ) -> Result<(), Error> {
-    let first_blueprint_plugin = plugins
-        .iter()
-        .enumerate()
-        .find(|(_, p)| p.is_blueprint_master());
-
-    if let Some((first_blueprint_pos, first_blueprint_plugin)) = first_blueprint_plugin {
-        let last_non_blueprint_pos = plugins.iter().rposition(|p| !p.is_blueprint_master());
-
-        if let Some(last_non_blueprint_pos) = last_non_blueprint_pos {
-            if last_non_blueprint_pos > first_blueprint_pos {
+    if let (Some(first_blueprint_pos), Some(last_non_blueprint_pos)) = (
+        positions.first_blueprint_master,
+        positions.last_non_blueprint_plugin,
+    ) {
+        if last_non_blueprint_pos > first_blueprint_pos {
+            if let Some(first_blueprint_plugin) = plugins.get(first_blueprint_pos) {
                 return Err(Error::InvalidBlueprintPluginPosition {
                     name: first_blueprint_plugin.name().to_owned(),
                     pos: first_blueprint_pos,
@@ -732,38 +969,12 @@ fn validate_no_non_blueprint_plugins_after_blueprint_plugins(
     Ok(())
 }
 
-fn validate_plugins_load_before_their_masters(plugins: &[Plugin]) -> Result<(), Error> {
-    let mut plugins_map: HashMap<UniCase<String>, &Plugin> = HashMap::new();
-
-    for plugin in plugins.iter().rev() {
-        if plugin.is_master_file() {
-            if let Some(m) = plugin
-                .masters()?
-                .iter()
-                .find_map(|m| plugins_map.get(&UniCase::new(m.to_owned())))
-            {
-                // Don't error if a non-blueprint plugin depends on a blueprint plugin.
-                if plugin.is_blueprint_master() || !m.is_blueprint_master() {
-                    return Err(Error::UnrepresentedHoist {
-                        plugin: m.name().to_owned(),
-                        master: plugin.name().to_owned(),
-                    });
-                }
-            }
-        }
-
-        plugins_map.insert(UniCase::new(plugin.name().to_owned()), plugin);
-    }
-
-    Ok(())
-}
-
 fn activate_unvalidated<T: MutableLoadOrder + ?Sized>(
     load_order: &mut T,
     filename: &str,
 ) -> Result<(), Error> {
-    if let Some(plugin) = load_order.find_plugin_mut(filename) {
-        plugin.activate()
+    if let Some((index, _)) = load_order.find_plugin_and_index(filename) {
+        load_order.activate_plugin_at(index)
     } else {
         // Ignore any errors trying to load the plugin to save checking if it's
         // valid and then loading it if it is.
@@ -787,6 +998,7 @@ fn find_first_blueprint_master_position(plugins: &[Plugin]) -> Option<usize> {
 mod tests {
     use super::*;
 
+    use crate::game_settings::GameSettings;
     use crate::load_order::tests::*;
     use crate::load_order::writable::create_parent_dirs;
     use crate::tests::{copy_to_test_dir, NON_ASCII};
@@ -2015,7 +2227,7 @@ mod tests {
             .map(|n| Plugin::new(n, &game_settings).unwrap())
             .collect();
 
-        assert!(hoist_masters(&mut plugins).is_ok());
+        hoist_masters(&mut plugins);
 
         let expected_plugin_names = vec![
             "Blank.esm",
@@ -2056,7 +2268,7 @@ mod tests {
             .map(|n| Plugin::new(n, &game_settings).unwrap())
             .collect();
 
-        assert!(hoist_masters(&mut plugins).is_ok());
+        hoist_masters(&mut plugins);
 
         let expected_plugin_names = plugin_names;
 
@@ -2086,7 +2298,7 @@ mod tests {
             .map(|n| Plugin::new(n, &game_settings).unwrap())
             .collect();
 
-        assert!(hoist_masters(&mut plugins).is_ok());
+        hoist_masters(&mut plugins);
 
         let expected_plugin_names = vec!["Blank.esp", blueprint_plugin, dependent_plugin];
 
@@ -2102,11 +2314,35 @@ mod tests {
         from_to_indices.insert(5, 2);
         from_to_indices.insert(7, 1);
 
-        move_elements(&mut vec, from_to_indices);
+        move_elements(&mut vec, &from_to_indices);
 
         assert_eq!(vec![0u8, 7, 1, 5, 2, 6, 3, 4, 8], vec);
     }
 
+    #[test]
+    fn move_elements_should_move_elements_along_with_the_elements_moved_before_them() {
+        let mut vec = vec![0u8, 1, 2, 3];
+        let mut from_to_indices = BTreeMap::new();
+        from_to_indices.insert(2, 0);
+        from_to_indices.insert(3, 2);
+
+        move_elements(&mut vec, &from_to_indices);
+
+        assert_eq!(vec![3u8, 2, 0, 1], vec);
+    }
+
+    #[test]
+    fn move_elements_should_put_later_elements_first_if_moved_before_the_same_element() {
+        let mut vec = vec![0u8, 1, 2, 3];
+        let mut from_to_indices = BTreeMap::new();
+        from_to_indices.insert(2, 1);
+        from_to_indices.insert(3, 1);
+
+        move_elements(&mut vec, &from_to_indices);
+
+        assert_eq!(vec![0u8, 3, 2, 1], vec);
+    }
+
     #[test]
     fn validate_load_order_should_be_ok_if_there_are_only_master_files() {
         let tmp_dir = tempdir().unwrap();
@@ -2229,6 +2465,60 @@ mod tests {
         assert!(validate_load_order(&plugins, &[]).is_err());
     }
 
+    #[test]
+    fn validate_load_order_should_name_the_master_that_loads_before_its_master() {
+        let tmp_dir = tempdir().unwrap();
+        let settings = prepare(GameId::SkyrimSE, tmp_dir.path()).game_settings;
+
+        copy_to_test_dir(
+            "Blank - Master Dependent.esm",
+            "Blank - Master Dependent.esm",
+            &settings,
+        );
+
+        let plugins = vec![
+            Plugin::new("Blank - Master Dependent.esm", &settings).unwrap(),
+            Plugin::new("Blank.esm", &settings).unwrap(),
+        ];
+
+        match validate_load_order(&plugins, &[]).unwrap_err() {
+            Error::UnrepresentedHoist { plugin, master } => {
+                assert_eq!("Blank.esm", plugin);
+                assert_eq!("Blank - Master Dependent.esm", master);
+            }
+            e => panic!("Expected unrepresented hoist error, got {e:?}"),
+        }
+    }
+
+    #[test]
+    fn validate_load_order_should_check_early_loader_positions_before_master_positions() {
+        let tmp_dir = tempdir().unwrap();
+        let settings = prepare(GameId::SkyrimSE, tmp_dir.path()).game_settings;
+
+        let plugins = vec![
+            Plugin::new("Blank.esp", &settings).unwrap(),
+            Plugin::new("Blank.esm", &settings).unwrap(),
+        ];
+
+        match validate_load_order(&plugins, &["Blank.esm".into()]).unwrap_err() {
+            Error::InvalidEarlyLoadingPluginPosition {
+                name,
+                pos,
+                expected_pos,
+            } => {
+                assert_eq!("Blank.esm", name);
+                assert_eq!(1, pos);
+                assert_eq!(0, expected_pos);
+            }
+            e => panic!("Expected invalid early loading plugin position error, got {e:?}"),
+        }
+
+        assert!(matches!(
+            validate_load_order(&plugins, &[]).unwrap_err(),
+            Error::NonMasterBeforeMaster { .. }
+        ));
+    }
+
     #[test]
     fn validate_load_order_should_succeed_if_a_blueprint_plugin_loads_after_all_non_blueprint_plugins(
     ) {
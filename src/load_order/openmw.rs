@@ -1,18 +1,31 @@
-use std::{collections::HashSet, path::PathBuf};
+use std::{
+    collections::{HashMap, HashSet},
+    mem,
+};
 
 use unicase::UniCase;
 
 use crate::{
+    game_settings::PluginFile,
     load_order::mutable::filename_str,
+    metrics::Phase,
     openmw_config::{non_user_additional_data_paths, read_active_plugin_names, write_openmw_cfg},
     plugin::{iends_with_ascii, Plugin},
     Error, GameId, GameSettings,
 };
 
 use super::{
-    mutable::MutableLoadOrder,
+    diff::LoadOrderDiff,
+    load_progress::LoadProgress,
+    mutable::{reorder, MutableLoadOrder},
+    plugin_cache::{LoadStats, PluginCache},
+    plugin_index::PluginIndex,
     readable::{ReadableLoadOrder, ReadableLoadOrderBase},
-    writable::{activate, add, deactivate, remove, set_active_plugins},
+    source_fingerprints::{LoadOrderChanges, SourceFingerprints},
+    writable::{
+        activate, add, apply_batch, apply_diff, deactivate, remove, restore_snapshot,
+        set_active_plugins, snapshot, BatchOperation, LoadOrderSnapshot, SaveStats,
+    },
     WritableLoadOrder,
 };
 
@@ -20,6 +33,10 @@ use super::{
 pub(crate) struct OpenMWLoadOrder {
     game_settings: GameSettings,
     plugins: Vec<Plugin>,
+    plugin_index: PluginIndex,
+    load_stats: LoadStats,
+    save_stats: SaveStats,
+    source_fingerprints: SourceFingerprints,
 }
 
 impl OpenMWLoadOrder {
@@ -27,6 +44,10 @@ impl OpenMWLoadOrder {
         Self {
             game_settings,
             plugins: Vec::new(),
+            plugin_index: PluginIndex::default(),
+            load_stats: LoadStats::default(),
+            save_stats: SaveStats::default(),
+            source_fingerprints: SourceFingerprints::default(),
         }
     }
 
@@ -68,14 +89,10 @@ impl OpenMWLoadOrder {
         // you can't see where it actually loads in relation to the others).
         // A plugin is a game file if it has no masters and ends with .esm or
         // .omwgame.
-        let game_file_name = self
-            .plugins()
-            .iter()
-            .find(|p| {
-                (iends_with_ascii(p.name(), ".esm") || iends_with_ascii(p.name(), ".omwgame"))
-                    && p.masters().unwrap_or_default().is_empty()
-            })
-            .map(|p| p.name().to_owned());
+        let game_file_index = self.plugins.iter().position(|p| {
+            (iends_with_ascii(p.name(), ".esm") || iends_with_ascii(p.name(), ".omwgame"))
+                && p.masters().is_empty()
+        });
 
         let first_modifiable_index = self
             .plugins
@@ -83,76 +100,181 @@ impl OpenMWLoadOrder {
             .position(|p| !self.game_settings.loads_early(p.name()))
             .unwrap_or(self.plugins.len());
 
-        // This is adapted from OpenMW's logic at
-        // <https://gitlab.com/OpenMW/openmw/-/blob/openmw-49-rc3/components/contentselector/model/contentmodel.cpp?ref_type=tags#L638>
-        let mut moved = HashSet::new();
-
         if self.plugins.is_empty() {
             // Return early to prevent underflow panic if there are no plugins
             // loaded.
             return;
         }
 
+        // The plugins are reordered below, so discard the name index.
+        self.plugin_index.invalidate();
+
+        // This is adapted from OpenMW's logic at
+        // <https://gitlab.com/OpenMW/openmw/-/blob/openmw-49-rc3/components/contentselector/model/contentmodel.cpp?ref_type=tags#L638>
+        // but instead of scanning every earlier plugin's masters for each
+        // later plugin, it looks up the later plugin's dependents, and it
+        // moves plugin indices rather than the plugins themselves. Plugins are
+        // identified by their index in the initial order, and order maps each
+        // position to the plugin at that position, while positions maps each
+        // plugin to its current position.
+        let dependents = master_dependents(&self.plugins);
+        let mut order: Vec<usize> = (0..self.plugins.len()).collect();
+        let mut positions = order.clone();
+        let mut moved = vec![false; self.plugins.len()];
+        let mut moved_plugins = Vec::new();
+
         let mut i = self.plugins.len() - 1;
         while i > first_modifiable_index {
-            let Some(later_plugin) = self.plugins.get(i) else {
+            let Some(later_plugin) = order.get(i).copied() else {
                 // This should never happen.
                 break;
             };
 
-            let key = UniCase::new(later_plugin.name().to_owned());
-            if !moved.contains(&key) {
-                let index = self
-                    .plugins
-                    .iter()
-                    .skip(first_modifiable_index)
-                    .take(i - first_modifiable_index)
-                    .position(|earlier_plugin| {
-                        game_file_name
-                            .as_ref()
-                            .is_some_and(|n| n == later_plugin.name())
-                            || (later_plugin.name_matches("Tribunal.esm")
-                                && earlier_plugin.name_matches("Bloodmoon.esm"))
-                            || earlier_plugin.has_master(later_plugin.name())
-                    });
-
-                if let Some(index) = index {
-                    let plugin = self.plugins.remove(i);
-                    self.plugins.insert(first_modifiable_index + index, plugin);
-                    moved.insert(key);
+            if moved.get(later_plugin) == Some(&false) {
+                // The later plugin is moved to the earliest modifiable position
+                // of a plugin that must load after it.
+                let target = if game_file_index == Some(later_plugin) {
+                    Some(first_modifiable_index)
+                } else {
+                    dependents.get(later_plugin).and_then(|d| {
+                        d.iter()
+                            .filter_map(|p| positions.get(*p).copied())
+                            .filter(|p| (first_modifiable_index..i).contains(p))
+                            .min()
+                    })
+                };
+
+                if let Some(target) = target {
+                    // Move the later plugin to the earlier plugin's position,
+                    // shifting only the plugins in between.
+                    if let Some(range) = order.get_mut(target..=i) {
+                        range.rotate_right(1);
+                        for (position, plugin) in (target..).zip(range.iter()) {
+                            if let Some(p) = positions.get_mut(*plugin) {
+                                *p = position;
+                            }
+                        }
+                    }
+                    if let Some(m) = moved.get_mut(later_plugin) {
+                        *m = true;
+                    }
+                    moved_plugins.push(later_plugin);
                     continue;
                 }
             }
             i -= 1;
-            moved.clear();
+            for plugin in moved_plugins.drain(..) {
+                if let Some(m) = moved.get_mut(plugin) {
+                    *m = false;
+                }
+            }
         }
 
+        reorder(&mut self.plugins, &order);
+
         // Finally, sort the active plugins according to their defined load
         // order. This is equivalent to the approach that the OpenMW Launcher
         // takes:
         // <https://gitlab.com/OpenMW/openmw/-/blob/openmw-0.48.0/components/contentselector/model/contentmodel.cpp?ref_type=tags#L611>
-        let mut previous_index = 0;
-        for name_tuple in active_plugins {
-            if !name_tuple.1 {
-                // The name tuples should all be for active plugins, but check
-                // just in case.
-                continue;
-            }
+        let new_order = sort_active_plugins(&self.plugins, active_plugins);
+        reorder(&mut self.plugins, &new_order);
+    }
+}
 
-            if let Some(current_index) = self
-                .plugins
-                .iter()
-                .position(|p| p.name_matches(&name_tuple.0))
+/// Get the indices of the plugins that must load after each plugin because
+/// they have it as a master, or because it's Tribunal.esm and they're
+/// Bloodmoon.esm.
+fn master_dependents(plugins: &[Plugin]) -> Vec<Vec<usize>> {
+    let indices: HashMap<_, _> = plugins
+        .iter()
+        .enumerate()
+        .map(|(i, p)| (UniCase::new(p.name()), i))
+        .collect();
+
+    let mut dependents = vec![Vec::new(); plugins.len()];
+    for (index, plugin) in plugins.iter().enumerate() {
+        for master in plugin.masters() {
+            if let Some(d) = indices
+                .get(&UniCase::new(master.as_str()))
+                .and_then(|i| dependents.get_mut(*i))
             {
-                if current_index < previous_index {
-                    let plugin = self.plugins.remove(current_index);
-                    self.plugins.insert(previous_index, plugin);
-                } else {
-                    previous_index = current_index;
+                d.push(index);
+            }
+        }
+    }
+
+    let tribunal = indices.get(&UniCase::new("Tribunal.esm"));
+    let bloodmoon = indices.get(&UniCase::new("Bloodmoon.esm"));
+    if let (Some(tribunal), Some(bloodmoon)) = (tribunal, bloodmoon) {
+        if let Some(d) = dependents.get_mut(*tribunal) {
+            d.push(*bloodmoon);
+        }
+    }
+
+    dependents
+}
+
+/// Get the order that the plugins should be in if every active plugin that
+/// loads before the previous active plugin (in the given order) is moved to
+/// load directly after it.
+fn sort_active_plugins(plugins: &[Plugin], active_plugins: &[(String, bool)]) -> Vec<usize> {
+    let positions: HashMap<_, _> = plugins
+        .iter()
+        .enumerate()
+        .map(|(i, p)| (UniCase::new(p.name()), i))
+        .collect();
+
+    // Plugins only ever move from before the previous plugin to directly after
+    // it, so the plugins after the furthest position reached without moving a
+    // plugin keep their current order. Only the order of the plugins up to
+    // that position needs to be tracked, and when a plugin moves its earlier
+    // entry is cleared.
+    let mut new_order = vec![Some(0)];
+    let mut new_order_indices = vec![None; plugins.len()];
+    if let Some(i) = new_order_indices.first_mut() {
+        *i = Some(0);
+    }
+    let mut last_unmoved_index = 0;
+    let mut previous_index = 0;
+
+    for (name, is_active) in active_plugins {
+        if !is_active {
+            // The name tuples should all be for active plugins, but check
+            // just in case.
+            continue;
+        }
+
+        let Some(current_index) = positions.get(&UniCase::new(name.as_str())).copied() else {
+            continue;
+        };
+
+        if current_index > last_unmoved_index {
+            for i in last_unmoved_index + 1..=current_index {
+                if let Some(new_order_index) = new_order_indices.get_mut(i) {
+                    *new_order_index = Some(new_order.len());
                 }
+                new_order.push(Some(i));
             }
+            last_unmoved_index = current_index;
+        } else if current_index != previous_index {
+            // The plugin loads before the previous plugin, so move it.
+            if let Some(new_order_index) = new_order_indices.get_mut(current_index) {
+                if let Some(entry) = new_order_index.and_then(|i| new_order.get_mut(i)) {
+                    *entry = None;
+                }
+                *new_order_index = Some(new_order.len());
+            }
+            new_order.push(Some(current_index));
         }
+
+        previous_index = current_index;
     }
+
+    new_order
+        .into_iter()
+        .flatten()
+        .chain(last_unmoved_index + 1..plugins.len())
+        .collect()
 }
 
 impl ReadableLoadOrderBase for OpenMWLoadOrder {
@@ -160,6 +282,10 @@ impl ReadableLoadOrderBase for OpenMWLoadOrder {
         &self.plugins
     }
 
+    fn plugin_index(&self) -> Option<&PluginIndex> {
+        Some(&self.plugin_index)
+    }
+
     fn game_settings_base(&self) -> &GameSettings {
         &self.game_settings
     }
@@ -167,10 +293,19 @@ impl ReadableLoadOrderBase for OpenMWLoadOrder {
 
 impl MutableLoadOrder for OpenMWLoadOrder {
     fn plugins_mut(&mut self) -> &mut Vec<Plugin> {
+        self.plugin_index.invalidate();
         &mut self.plugins
     }
 
-    fn max_active_full_plugins(&self) -> usize {
+    fn plugins_and_index_mut(&mut self) -> (&mut Vec<Plugin>, Option<&mut PluginIndex>) {
+        (&mut self.plugins, Some(&mut self.plugin_index))
+    }
+
+    fn full_plugins_limit(
+        &self,
+        _has_active_light_plugin: bool,
+        _has_active_medium_plugin: bool,
+    ) -> usize {
         // Stated as the limit in the FAQs here:
         // <https://openmw.org/faq/>
         // The code shows that plugin indexes are stored as int32_t, with 0
@@ -182,7 +317,7 @@ impl MutableLoadOrder for OpenMWLoadOrder {
 
     fn total_insertion_order(
         defined_load_order: &[(String, bool)],
-        installed_files: &[PathBuf],
+        installed_files: &[PluginFile],
         _: GameId,
     ) -> Vec<(String, bool)> {
         // The OpenMW Launcher lists files by the order of their data
@@ -207,7 +342,7 @@ impl MutableLoadOrder for OpenMWLoadOrder {
         // but that's handled by GameSettings::plugin_path().
         let unique_tuples: Vec<_> = installed_files
             .iter()
-            .filter_map(|p| filename_str(p))
+            .filter_map(|f| filename_str(&f.path))
             .filter_map(|f| {
                 let key = get_key_from_filename(f);
                 set.insert(key)
@@ -230,22 +365,48 @@ impl WritableLoadOrder for OpenMWLoadOrder {
         &mut self.game_settings
     }
 
-    fn load(&mut self) -> Result<(), Error> {
-        self.plugins_mut().clear();
+    fn load_with_progress(&mut self, progress: &LoadProgress) -> Result<(), Error> {
+        let _timer = self.game_settings.metrics_recorder().time(Phase::Load);
+        let source_fingerprints = SourceFingerprints::new(&self.game_settings);
+        let cache = PluginCache::new(mem::take(self.plugins_mut()), &self.game_settings);
 
         let plugin_tuples = self.read_from_active_plugins_file()?;
+        progress.check_cancelled()?;
         let paths = self.game_settings.find_plugins();
+        progress.check_cancelled()?;
 
-        self.load_unique_plugins(&plugin_tuples, &paths);
+        self.load_stats = self.load_unique_plugins(&plugin_tuples, &paths, &cache, progress);
+        progress.check_cancelled()?;
+        cache.persist(&self.game_settings, &self.plugins, self.load_stats);
 
         self.add_implicitly_active_plugins()?;
 
         self.apply_load_order(&plugin_tuples);
 
+        self.source_fingerprints = source_fingerprints;
+
         Ok(())
     }
 
+    fn boxed_clone(&self) -> Box<dyn WritableLoadOrder + Send + Sync + 'static> {
+        Box::new(self.clone())
+    }
+
+    fn last_load_stats(&self) -> LoadStats {
+        self.load_stats
+    }
+
+    fn last_save_stats(&self) -> SaveStats {
+        self.save_stats
+    }
+
+    fn changes_since_load(&self) -> LoadOrderChanges {
+        self.source_fingerprints
+            .changes(&self.game_settings, &self.plugins)
+    }
+
     fn save(&mut self) -> Result<(), Error> {
+        let _timer = self.game_settings.metrics_recorder().time(Phase::Save);
         let read_only_data_paths: HashSet<_> =
             non_user_additional_data_paths(self.game_settings.game_path())?
                 .into_iter()
@@ -264,6 +425,9 @@ impl WritableLoadOrder for OpenMWLoadOrder {
         let cfg_path = self.game_settings.active_plugins_file();
         write_openmw_cfg(cfg_path, &data_paths, &self.active_plugin_names())?;
 
+        self.source_fingerprints
+            .refresh_plugin_lists(&self.game_settings);
+
         Ok(())
     }
 
@@ -302,13 +466,29 @@ impl WritableLoadOrder for OpenMWLoadOrder {
     fn set_active_plugins(&mut self, active_plugin_names: &[&str]) -> Result<(), Error> {
         set_active_plugins(self, active_plugin_names)
     }
+
+    fn apply_batch(&mut self, operations: &[BatchOperation<'_>]) -> Result<(), Error> {
+        apply_batch(self, operations)
+    }
+
+    fn snapshot(&self) -> LoadOrderSnapshot {
+        snapshot(self)
+    }
+
+    fn restore_snapshot(&mut self, snapshot: &LoadOrderSnapshot) -> Result<(), Error> {
+        restore_snapshot(self, snapshot)
+    }
+
+    fn apply_diff(&mut self, diff: &LoadOrderDiff) -> Result<(), Error> {
+        apply_diff(self, diff)
+    }
 }
 
 #[cfg(test)]
 mod tests {
     use std::{
         fs::{create_dir_all, write},
-        path::Path,
+        path::{Path, PathBuf},
     };
 
     use tempfile::tempdir;
@@ -328,10 +508,7 @@ mod tests {
         let mut game_settings = game_settings_for_test(GameId::OpenMW, tmp_path);
         mock_game_files(&mut game_settings);
 
-        OpenMWLoadOrder {
-            game_settings,
-            plugins: Vec::new(),
-        }
+        OpenMWLoadOrder::new(game_settings)
     }
 
     fn write_cfg(cfg_path: &Path, data_paths: &[&str], content: &[&str]) {
@@ -361,10 +538,8 @@ mod tests {
     #[test]
     fn load_should_not_panic_if_no_plugins_are_installed() {
         let tmp_dir = tempdir().unwrap();
-        let mut load_order = OpenMWLoadOrder {
-            game_settings: game_settings_for_test(GameId::OpenMW, tmp_dir.path()),
-            plugins: Vec::new(),
-        };
+        let mut load_order =
+            OpenMWLoadOrder::new(game_settings_for_test(GameId::OpenMW, tmp_dir.path()));
 
         load_order.load().unwrap();
 
@@ -474,6 +649,53 @@ mod tests {
         assert_eq!(plugin_names, load_order.plugin_names().as_slice());
     }
 
+    #[test]
+    fn load_should_move_a_master_in_a_later_data_path_to_before_its_first_dependent() {
+        let tmp_dir = tempdir().unwrap();
+
+        let other_dir_1 = tmp_dir.path().join("other1");
+        let other_dir_2 = tmp_dir.path().join("other2");
+        create_dir_all(&other_dir_1).unwrap();
+        create_dir_all(&other_dir_2).unwrap();
+
+        let cfg_path = cfg_path(tmp_dir.path());
+        write_cfg(
+            &cfg_path,
+            &[other_dir_1.to_str().unwrap(), other_dir_2.to_str().unwrap()],
+            &[],
+        );
+
+        let mut load_order = prepare(tmp_dir.path());
+
+        copy_to_dir(
+            "Blank - Different Master Dependent.esp",
+            &other_dir_1,
+            "Blank - Different Master Dependent.esp",
+            GameId::OpenMW,
+        );
+        copy_to_dir(
+            "Blank.esm",
+            &other_dir_2,
+            "Blank - Different.esm",
+            GameId::OpenMW,
+        );
+
+        load_order.load().unwrap();
+
+        // Blank.esm is moved up because it looks like a game file.
+        let plugin_names = &[
+            "Blank.esm",
+            "Blank - Different.esp",
+            "Blank - Master Dependent.esp",
+            "Blank.esp",
+            NON_ASCII,
+            "Blank - Different.esm",
+            "Blank - Different Master Dependent.esp",
+        ];
+
+        assert_eq!(plugin_names, load_order.plugin_names().as_slice());
+    }
+
     #[test]
     fn load_should_move_game_file_immediately_below_last_early_loader() {
         let tmp_dir = tempdir().unwrap();
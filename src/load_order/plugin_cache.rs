@@ -0,0 +1,494 @@
+/*
+ * This file is part of libloadorder
+ *
+ * Copyright (C) 2017 Oliver Hamlet
+ *
+ * libloadorder is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libloadorder is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
+ */
+use std::collections::HashMap;
+use std::path::{Path, PathBuf};
+use std::time::SystemTime;
+
+use crate::enums::Error;
+use crate::game_settings::{GameSettings, PluginFile};
+use crate::header_cache::{read_header_cache, write_header_cache};
+use crate::plugin::{resolve_plugin_path, Plugin};
+
+/// Counts of how the plugins in a load order were obtained during the last
+/// call to `WritableLoadOrder::load()`.
+#[derive(Clone, Copy, Debug, Default, Eq, PartialEq, Hash)]
+pub struct LoadStats {
+    /// The number of plugins that were reused from the previous load because
+    /// their files were unchanged.
+    pub reused: usize,
+    /// The number of plugins that had their headers parsed.
+    pub parsed: usize,
+}
+
+impl LoadStats {
+    pub(super) fn count(loaded: &[(Plugin, bool)]) -> Self {
+        let reused = loaded.iter().filter(|(_, reused)| *reused).count();
+
+        LoadStats {
+            reused,
+            parsed: loaded.len() - reused,
+        }
+    }
+}
+
+/// The modification times and sizes of the plugin files found by scanning the
+/// plugins directories, keyed by path.
+#[derive(Debug, Default)]
+pub(super) struct InstalledFiles<'a> {
+    metadata: HashMap<&'a Path, (SystemTime, u64)>,
+}
+
+impl<'a> InstalledFiles<'a> {
+    pub(super) fn new(plugin_files: &'a [PluginFile]) -> Self {
+        InstalledFiles {
+            metadata: plugin_files
+                .iter()
+                .filter_map(|f| Some((f.path.as_path(), (f.modification_time?, f.file_size))))
+                .collect(),
+        }
+    }
+
+    fn metadata(&self, path: &Path) -> Option<(SystemTime, u64)> {
+        self.metadata.get(path).copied()
+    }
+}
+
+/// Plugins from a previous load, keyed by the paths that they were read from,
+/// so that plugins with unchanged files don't need to be parsed again.
+#[derive(Debug, Default)]
+pub(super) struct PluginCache {
+    plugins: HashMap<PathBuf, Plugin>,
+}
+
+impl PluginCache {
+    /// Create a cache of the given plugins. If there are none and the game
+    /// settings enable header caching, the cache is populated from the header
+    /// cache file instead.
+    pub(super) fn new(plugins: Vec<Plugin>, game_settings: &GameSettings) -> Self {
+        let plugins = match game_settings.header_cache_path() {
+            Some(cache_path) if plugins.is_empty() => {
+                read_header_cache(cache_path, game_settings.id())
+            }
+            _ => plugins,
+        };
+
+        PluginCache {
+            plugins: plugins
+                .into_iter()
+                .map(|p| (p.path().to_path_buf(), p))
+                .collect(),
+        }
+    }
+
+    /// Write the given plugins to the header cache file if header caching is
+    /// enabled and the loaded plugins weren't all reused from this cache.
+    pub(super) fn persist(
+        &self,
+        game_settings: &GameSettings,
+        plugins: &[Plugin],
+        stats: LoadStats,
+    ) {
+        let Some(cache_path) = game_settings.header_cache_path() else {
+            return;
+        };
+
+        if stats.parsed == 0 && stats.reused == self.plugins.len() {
+            return;
+        }
+
+        // Failing to write the cache only means that the next cold start will
+        // need to parse plugins again, so it's not worth failing the load.
+        write_header_cache(cache_path, plugins).unwrap_or_default();
+    }
+
+    /// Load the named plugin, reusing the cached plugin with the same path if
+    /// that path's modification time and size haven't changed. The returned
+    /// bool is true if the cached plugin was reused.
+    ///
+    /// If the plugin's file is one of the given installed files, the metadata
+    /// read when it was found is used instead of querying the file again.
+    pub(super) fn load(
+        &self,
+        filename: &str,
+        game_settings: &GameSettings,
+        active: bool,
+        installed_files: &InstalledFiles<'_>,
+    ) -> Result<(Plugin, bool), Error> {
+        let path = resolve_plugin_path(filename, game_settings, active)?;
+        let metadata = installed_files.metadata(&path);
+
+        let is_unchanged = |cached: &Plugin| match metadata {
+            Some((modification_time, file_size)) => {
+                cached.modification_time() == modification_time && cached.file_size() == file_size
+            }
+            None => cached.is_unchanged_on_disk(),
+        };
+
+        match self.plugins.get(&path) {
+            Some(cached) if is_unchanged(cached) => {
+                let mut plugin = cached.clone();
+                if active {
+                    // The path has already been unghosted, so this just sets
+                    // the plugin as active.
+                    plugin.activate(game_settings.metrics_recorder())?;
+                } else {
+                    plugin.deactivate();
+                }
+                Ok((plugin, true))
+            }
+            _ => match metadata {
+                Some((modification_time, file_size)) => Plugin::with_metadata(
+                    &path,
+                    game_settings,
+                    active,
+                    modification_time,
+                    file_size,
+                ),
+                None => Plugin::with_path(
+                    &path,
+                    game_settings.id(),
+                    active,
+                    game_settings.metrics_recorder(),
+                ),
+            }
+            .map(|p| (p, false)),
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    use std::fs::{File, FileTimes, OpenOptions};
+    use std::io::Write;
+    use std::sync::Arc;
+    use std::time::Duration;
+
+    use tempfile::tempdir;
+
+    use crate::enums::GameId;
+    use crate::load_order::tests::{game_settings_for_test, mock_game_files};
+    use crate::shared_header_cache::SharedHeaderCache;
+
+    fn prepare(game_dir: &std::path::Path) -> (GameSettings, PluginCache) {
+        let mut game_settings = game_settings_for_test(GameId::Oblivion, game_dir);
+        mock_game_files(&mut game_settings);
+
+        let cache = PluginCache::new(
+            vec![
+                Plugin::new("Blank.esm", &game_settings).unwrap(),
+                Plugin::new("Blank.esp", &game_settings).unwrap(),
+            ],
+            &game_settings,
+        );
+
+        (game_settings, cache)
+    }
+
+    #[test]
+    fn load_should_reuse_a_cached_plugin_if_its_file_is_unchanged() {
+        let tmp_dir = tempdir().unwrap();
+        let (game_settings, cache) = prepare(tmp_dir.path());
+
+        let (plugin, reused) = cache
+            .load(
+                "Blank.esp",
+                &game_settings,
+                true,
+                &InstalledFiles::default(),
+            )
+            .unwrap();
+
+        assert!(reused);
+        assert_eq!("Blank.esp", plugin.name());
+        assert!(plugin.is_active());
+    }
+
+    #[test]
+    fn load_should_parse_a_plugin_that_is_not_cached() {
+        let tmp_dir = tempdir().unwrap();
+        let (game_settings, cache) = prepare(tmp_dir.path());
+
+        let (plugin, reused) = cache
+            .load(
+                "Blank - Different.esp",
+                &game_settings,
+                false,
+                &InstalledFiles::default(),
+            )
+            .unwrap();
+
+        assert!(!reused);
+        assert_eq!("Blank - Different.esp", plugin.name());
+    }
+
+    #[test]
+    fn load_should_parse_a_plugin_if_its_modification_time_has_changed() {
+        let tmp_dir = tempdir().unwrap();
+        let (game_settings, cache) = prepare(tmp_dir.path());
+
+        let path = game_settings.plugin_path("Blank.esp");
+        let mtime = std::fs::metadata(&path).unwrap().modified().unwrap();
+        File::options()
+            .write(true)
+            .open(&path)
+            .unwrap()
+            .set_times(FileTimes::new().set_modified(mtime + Duration::from_secs(10)))
+            .unwrap();
+
+        let (_, reused) = cache
+            .load(
+                "Blank.esp",
+                &game_settings,
+                false,
+                &InstalledFiles::default(),
+            )
+            .unwrap();
+
+        assert!(!reused);
+    }
+
+    #[test]
+    fn load_should_parse_a_plugin_if_its_size_has_changed() {
+        let tmp_dir = tempdir().unwrap();
+        let (game_settings, cache) = prepare(tmp_dir.path());
+
+        let path = game_settings.plugin_path("Blank.esp");
+        let mtime = std::fs::metadata(&path).unwrap().modified().unwrap();
+        let mut file = OpenOptions::new().append(true).open(&path).unwrap();
+        file.write_all(&[0]).unwrap();
+        file.set_times(FileTimes::new().set_modified(mtime))
+            .unwrap();
+
+        let (_, reused) = cache
+            .load(
+                "Blank.esp",
+                &game_settings,
+                false,
+                &InstalledFiles::default(),
+            )
+            .unwrap();
+
+        assert!(!reused);
+    }
+
+    #[test]
+    fn load_should_compare_a_cached_plugin_against_installed_file_metadata_if_given() {
+        let tmp_dir = tempdir().unwrap();
+        let (game_settings, cache) = prepare(tmp_dir.path());
+
+        let path = game_settings.plugin_path("Blank.esp");
+        let metadata = std::fs::metadata(&path).unwrap();
+        let mut plugin_file = PluginFile {
+            path,
+            modification_time: Some(metadata.modified().unwrap()),
+            file_size: metadata.len(),
+        };
+
+        let files = [plugin_file.clone()];
+        let (_, reused) = cache
+            .load(
+                "Blank.esp",
+                &game_settings,
+                false,
+                &InstalledFiles::new(&files),
+            )
+            .unwrap();
+        assert!(reused);
+
+        plugin_file.file_size += 1;
+        let files = [plugin_file];
+        let (_, reused) = cache
+            .load(
+                "Blank.esp",
+                &game_settings,
+                false,
+                &InstalledFiles::new(&files),
+            )
+            .unwrap();
+        assert!(!reused);
+    }
+
+    #[test]
+    fn load_should_share_parsed_headers_through_a_shared_header_cache() {
+        let tmp_dir = tempdir().unwrap();
+        let shared_cache = Arc::new(SharedHeaderCache::default());
+
+        let mut game_settings = game_settings_for_test(GameId::Oblivion, tmp_dir.path());
+        mock_game_files(&mut game_settings);
+        game_settings.set_shared_header_cache(Some(Arc::clone(&shared_cache)));
+        let mut other_game_settings = game_settings.clone();
+        other_game_settings.set_shared_header_cache(Some(Arc::clone(&shared_cache)));
+
+        let path = game_settings.plugin_path("Blank.esp");
+        let metadata = std::fs::metadata(&path).unwrap();
+        let files = [PluginFile {
+            path,
+            modification_time: Some(metadata.modified().unwrap()),
+            file_size: metadata.len(),
+        }];
+        let installed_files = InstalledFiles::new(&files);
+
+        let cache = PluginCache::default();
+        let (plugin, _) = cache
+            .load("Blank.esp", &game_settings, false, &installed_files)
+            .unwrap();
+        let headers_parsed = game_settings.metrics().headers_parsed;
+        let (other_plugin, reused) = cache
+            .load("Blank.esp", &other_game_settings, false, &installed_files)
+            .unwrap();
+
+        assert!(!reused);
+        assert!(std::ptr::eq(plugin.header(), other_plugin.header()));
+        assert_eq!(headers_parsed, game_settings.metrics().headers_parsed);
+        assert_eq!(1, shared_cache.len());
+    }
+
+    #[test]
+    fn load_should_give_a_parsed_plugin_the_installed_file_metadata_if_given() {
+        let tmp_dir = tempdir().unwrap();
+        let (game_settings, cache) = prepare(tmp_dir.path());
+
+        let modification_time = SystemTime::UNIX_EPOCH + Duration::from_secs(10);
+        let files = [PluginFile {
+            path: game_settings.plugin_path("Blank - Different.esp"),
+            modification_time: Some(modification_time),
+            file_size: 10,
+        }];
+
+        let (plugin, reused) = cache
+            .load(
+                "Blank - Different.esp",
+                &game_settings,
+                false,
+                &InstalledFiles::new(&files),
+            )
+            .unwrap();
+
+        assert!(!reused);
+        assert_eq!(modification_time, plugin.modification_time());
+        assert_eq!(10, plugin.file_size());
+    }
+
+    #[test]
+    fn new_should_read_the_header_cache_file_if_given_no_plugins_and_caching_is_enabled() {
+        let tmp_dir = tempdir().unwrap();
+        let (mut game_settings, cache) = prepare(tmp_dir.path());
+
+        let cache_path = tmp_dir.path().join("libloadorder.cache");
+        game_settings.set_header_cache_path(Some(cache_path.clone()));
+
+        let plugins: Vec<_> = cache.plugins.into_values().collect();
+        write_header_cache(&cache_path, &plugins).unwrap();
+
+        let cache = PluginCache::new(Vec::new(), &game_settings);
+        let (plugin, reused) = cache
+            .load(
+                "Blank.esp",
+                &game_settings,
+                false,
+                &InstalledFiles::default(),
+            )
+            .unwrap();
+
+        assert!(reused);
+        assert_eq!("Blank.esp", plugin.name());
+    }
+
+    #[test]
+    fn persist_should_write_the_header_cache_file_if_any_plugins_were_parsed() {
+        let tmp_dir = tempdir().unwrap();
+        let (mut game_settings, cache) = prepare(tmp_dir.path());
+
+        let cache_path = tmp_dir.path().join("libloadorder.cache");
+        game_settings.set_header_cache_path(Some(cache_path.clone()));
+
+        let loaded = vec![
+            cache
+                .load(
+                    "Blank.esm",
+                    &game_settings,
+                    false,
+                    &InstalledFiles::default(),
+                )
+                .unwrap(),
+            cache
+                .load(
+                    "Blank.esp",
+                    &game_settings,
+                    false,
+                    &InstalledFiles::default(),
+                )
+                .unwrap(),
+        ];
+        let plugins: Vec<_> = loaded.iter().map(|(p, _)| p.clone()).collect();
+
+        cache.persist(&game_settings, &plugins, LoadStats::count(&loaded));
+        assert!(!cache_path.exists());
+
+        let stats = LoadStats {
+            reused: 1,
+            parsed: 1,
+        };
+        cache.persist(&game_settings, &plugins, stats);
+        assert_eq!(plugins, read_header_cache(&cache_path, game_settings.id()));
+    }
+
+    #[test]
+    fn load_stats_count_should_count_reused_and_parsed_plugins() {
+        let tmp_dir = tempdir().unwrap();
+        let (game_settings, cache) = prepare(tmp_dir.path());
+
+        let loaded = vec![
+            cache
+                .load(
+                    "Blank.esm",
+                    &game_settings,
+                    false,
+                    &InstalledFiles::default(),
+                )
+                .unwrap(),
+            cache
+                .load(
+                    "Blank.esp",
+                    &game_settings,
+                    false,
+                    &InstalledFiles::default(),
+                )
+                .unwrap(),
+            cache
+                .load(
+                    "Blank - Different.esp",
+                    &game_settings,
+                    false,
+                    &InstalledFiles::default(),
+                )
+                .unwrap(),
+        ];
+
+        assert_eq!(
+            LoadStats {
+                reused: 2,
+                parsed: 1
+            },
+            LoadStats::count(&loaded)
+        );
+    }
+}
@@ -0,0 +1,571 @@
+/*
+ * This file is part of libloadorder
+ *
+ * Copyright (C) 2017 Oliver Hamlet
+ *
+ * libloadorder is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libloadorder is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
+ */
+use std::collections::hash_map::Entry;
+use std::collections::HashMap;
+use std::hash::{BuildHasher, Hash, Hasher, RandomState};
+use std::sync::OnceLock;
+
+use unicase::UniCase;
+
+use crate::enums::GameId;
+use crate::plugin::{trim_dot_ghost, trim_dot_ghost_unchecked, Plugin};
+
+/// A case-insensitive map from plugin names to their positions in a load
+/// order's plugins, along with a map from master names to the positions of the
+/// plugins that depend on them, and counts of the active plugins.
+///
+/// The maps are keyed on hashes of the plugin names so that lookups don't need
+/// to allocate, and any match is confirmed by the caller, so hash collisions
+/// cost time but not correctness. They're built on first use, kept up to date
+/// when individual plugins are inserted or removed, and discarded when the
+/// plugins are changed in any other way. The active plugin counts are also
+/// kept up to date when individual plugins are activated or deactivated.
+#[derive(Clone, Debug, Default)]
+pub struct PluginIndex {
+    hash_builder: RandomState,
+    maps: OnceLock<Maps>,
+    active_counts: OnceLock<PluginCounts>,
+}
+
+/// Counts of light, medium and full plugins, which have separate limits on
+/// how many can be active.
+#[derive(Clone, Copy, Debug, Default, Eq, PartialEq, Ord, PartialOrd, Hash)]
+pub struct PluginCounts {
+    pub(crate) light: usize,
+    pub(crate) medium: usize,
+    pub(crate) full: usize,
+}
+
+impl PluginCounts {
+    pub(crate) fn count_plugin(&mut self, plugin: &Plugin) {
+        *self.count_mut(plugin) += 1;
+    }
+
+    pub(crate) fn uncount_plugin(&mut self, plugin: &Plugin) {
+        let count = self.count_mut(plugin);
+        *count = count.saturating_sub(1);
+    }
+
+    fn count_mut(&mut self, plugin: &Plugin) -> &mut usize {
+        if plugin.is_light_plugin() {
+            &mut self.light
+        } else if plugin.is_medium_plugin() {
+            &mut self.medium
+        } else {
+            &mut self.full
+        }
+    }
+}
+
+pub(crate) fn count_active_plugins(plugins: &[Plugin]) -> PluginCounts {
+    let mut counts = PluginCounts::default();
+
+    for plugin in plugins.iter().filter(|p| p.is_active()) {
+        counts.count_plugin(plugin);
+    }
+
+    counts
+}
+
+#[derive(Clone, Debug, Default)]
+struct Maps {
+    positions: HashMap<u64, Positions>,
+    dependents: HashMap<u64, Positions>,
+}
+
+#[derive(Clone, Debug)]
+enum Positions {
+    One(usize),
+    /// Sorted in ascending order.
+    Many(Vec<usize>),
+}
+
+impl Positions {
+    fn add(&mut self, position: usize) {
+        match self {
+            Positions::One(existing) => {
+                *self = Positions::Many(if *existing < position {
+                    vec![*existing, position]
+                } else {
+                    vec![position, *existing]
+                });
+            }
+            Positions::Many(positions) => {
+                let index = positions.partition_point(|p| *p < position);
+                positions.insert(index, position);
+            }
+        }
+    }
+
+    /// Remove one of several positions, returning false if the position to
+    /// remove isn't present.
+    fn remove(&mut self, position: usize) -> bool {
+        let Positions::Many(positions) = self else {
+            return false;
+        };
+
+        let Ok(index) = positions.binary_search(&position) else {
+            return false;
+        };
+
+        positions.remove(index);
+        if let [remaining] = positions.as_slice() {
+            *self = Positions::One(*remaining);
+        }
+
+        true
+    }
+
+    fn as_slice(&self) -> &[usize] {
+        match self {
+            Positions::One(position) => std::slice::from_ref(position),
+            Positions::Many(positions) => positions,
+        }
+    }
+
+    fn shift_from(&mut self, position: usize, shift: impl Fn(usize) -> usize) {
+        match self {
+            Positions::One(p) => {
+                if *p >= position {
+                    *p = shift(*p);
+                }
+            }
+            Positions::Many(positions) => positions
+                .iter_mut()
+                .filter(|p| **p >= position)
+                .for_each(|p| *p = shift(*p)),
+        }
+    }
+}
+
+impl PluginIndex {
+    pub(crate) fn find<'a>(
+        &self,
+        plugins: &'a [Plugin],
+        plugin_name: &str,
+        game_id: GameId,
+    ) -> Option<(usize, &'a Plugin)> {
+        let hash = self.hash_name(trim_dot_ghost(plugin_name, game_id));
+
+        let matching_plugin = |index: usize| {
+            plugins
+                .get(index)
+                .filter(|p| p.name_matches(plugin_name))
+                .map(|p| (index, p))
+        };
+
+        self.maps(plugins)
+            .positions
+            .get(&hash)?
+            .as_slice()
+            .iter()
+            .find_map(|i| matching_plugin(*i))
+    }
+
+    /// Get the positions of plugins that may have the named plugin as a
+    /// master, in ascending order. The positions may include plugins that
+    /// don't have the named plugin as a master, so callers must check each
+    /// plugin's masters.
+    pub(crate) fn candidate_dependents(&self, plugins: &[Plugin], plugin_name: &str) -> &[usize] {
+        let hash = self.hash_master_name(plugin_name);
+
+        self.maps(plugins)
+            .dependents
+            .get(&hash)
+            .map(Positions::as_slice)
+            .unwrap_or_default()
+    }
+
+    /// Get the counts of the active plugins.
+    pub(crate) fn active_counts(&self, plugins: &[Plugin]) -> PluginCounts {
+        *self
+            .active_counts
+            .get_or_init(|| count_active_plugins(plugins))
+    }
+
+    /// Record that the given plugin has been activated.
+    pub(crate) fn record_activation(&mut self, plugin: &Plugin) {
+        if let Some(counts) = self.active_counts.get_mut() {
+            counts.count_plugin(plugin);
+        }
+    }
+
+    /// Record that the given plugin has been deactivated.
+    pub(crate) fn record_deactivation(&mut self, plugin: &Plugin) {
+        if let Some(counts) = self.active_counts.get_mut() {
+            counts.uncount_plugin(plugin);
+        }
+    }
+
+    /// Record that all plugins have been deactivated.
+    pub(crate) fn record_all_deactivated(&mut self) {
+        self.active_counts = OnceLock::from(PluginCounts::default());
+    }
+
+    /// Record that the given plugin has been inserted at the given position.
+    pub(crate) fn insert(&mut self, position: usize, plugin: &Plugin) {
+        if plugin.is_active() {
+            self.record_activation(plugin);
+        }
+
+        let hash = self.hash_name(plugin.name());
+        let master_hashes = self.master_hashes(plugin);
+
+        if let Some(maps) = self.maps.get_mut() {
+            shift_positions(&mut maps.positions, position, |i| i + 1);
+            shift_positions(&mut maps.dependents, position, |i| i + 1);
+
+            add_position(&mut maps.positions, hash, position);
+            for master_hash in master_hashes {
+                add_position(&mut maps.dependents, master_hash, position);
+            }
+        }
+    }
+
+    /// Record that the given plugin has been removed from the given position.
+    pub(crate) fn remove(&mut self, position: usize, plugin: &Plugin) {
+        if plugin.is_active() {
+            self.record_deactivation(plugin);
+        }
+
+        let hash = self.hash_name(plugin.name());
+        let master_hashes = self.master_hashes(plugin);
+
+        let Some(maps) = self.maps.get_mut() else {
+            return;
+        };
+
+        let mut removed = remove_position(&mut maps.positions, hash, position);
+        for master_hash in master_hashes {
+            removed &= remove_position(&mut maps.dependents, master_hash, position);
+        }
+
+        if removed {
+            shift_positions(&mut maps.positions, position, |i| i - 1);
+            shift_positions(&mut maps.dependents, position, |i| i - 1);
+        } else {
+            // The index has somehow got out of sync, so throw it away.
+            self.invalidate();
+        }
+    }
+
+    pub(crate) fn invalidate(&mut self) {
+        self.maps = OnceLock::new();
+        self.active_counts = OnceLock::new();
+    }
+
+    fn maps(&self, plugins: &[Plugin]) -> &Maps {
+        self.maps.get_or_init(|| {
+            let mut maps = Maps {
+                positions: HashMap::with_capacity(plugins.len()),
+                dependents: HashMap::new(),
+            };
+            for (index, plugin) in plugins.iter().enumerate() {
+                add_position(&mut maps.positions, self.hash_name(plugin.name()), index);
+                for master_hash in self.master_hashes(plugin) {
+                    add_position(&mut maps.dependents, master_hash, index);
+                }
+            }
+            maps
+        })
+    }
+
+    fn hash_name(&self, plugin_name: &str) -> u64 {
+        self.hash_builder.hash_one(UniCase::new(plugin_name))
+    }
+
+    /// Masters are matched against plugin names in a few different ways, so
+    /// always trim any ghost extension to ensure that they all have the same
+    /// hash.
+    fn hash_master_name(&self, master_name: &str) -> u64 {
+        self.hash_name(trim_dot_ghost_unchecked(master_name))
+    }
+
+    /// Get the deduplicated hashes of the given plugin's masters, so that each
+    /// plugin's position is recorded at most once per master.
+    fn master_hashes(&self, plugin: &Plugin) -> Vec<u64> {
+        let mut hashes: Vec<u64> = plugin
+            .masters()
+            .iter()
+            .map(|m| self.hash_master_name(m))
+            .collect();
+        hashes.sort_unstable();
+        hashes.dedup();
+        hashes
+    }
+}
+
+fn add_position(map: &mut HashMap<u64, Positions>, hash: u64, position: usize) {
+    map.entry(hash)
+        .and_modify(|p| p.add(position))
+        .or_insert(Positions::One(position));
+}
+
+/// Returns false if the position wasn't recorded for the given hash.
+fn remove_position(map: &mut HashMap<u64, Positions>, hash: u64, position: usize) -> bool {
+    match map.entry(hash) {
+        Entry::Occupied(mut entry) => {
+            if matches!(entry.get(), Positions::One(p) if *p == position) {
+                entry.remove();
+                true
+            } else {
+                entry.get_mut().remove(position)
+            }
+        }
+        Entry::Vacant(_) => false,
+    }
+}
+
+#[expect(
+    clippy::iter_over_hash_type,
+    reason = "The order in which positions are shifted doesn't matter"
+)]
+fn shift_positions(
+    positions: &mut HashMap<u64, Positions>,
+    from_position: usize,
+    shift: impl Fn(usize) -> usize,
+) {
+    for p in positions.values_mut() {
+        p.shift_from(from_position, &shift);
+    }
+}
+
+// The index is derived entirely from the plugins that it indexes, so it
+// doesn't contribute to the equality or hash of the load order that owns it.
+impl PartialEq for PluginIndex {
+    fn eq(&self, _: &Self) -> bool {
+        true
+    }
+}
+
+impl Eq for PluginIndex {}
+
+impl Hash for PluginIndex {
+    fn hash<H: Hasher>(&self, _: &mut H) {}
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    use tempfile::tempdir;
+
+    use crate::load_order::tests::{game_settings_for_test, mock_game_files};
+    use crate::tests::copy_to_test_dir;
+
+    fn prepare(game_dir: &std::path::Path) -> (GameId, Vec<Plugin>) {
+        let mut game_settings = game_settings_for_test(GameId::Oblivion, game_dir);
+        mock_game_files(&mut game_settings);
+        copy_to_test_dir("Blank.esp", "Blank - Ghosted.esp.ghost", &game_settings);
+
+        let plugins = vec![
+            Plugin::new("Blank.esm", &game_settings).unwrap(),
+            Plugin::new("Blank.esp", &game_settings).unwrap(),
+            Plugin::new("Blank - Ghosted.esp", &game_settings).unwrap(),
+        ];
+
+        (game_settings.id(), plugins)
+    }
+
+    #[test]
+    fn find_should_return_the_index_and_plugin_with_the_given_name() {
+        let tmp_dir = tempdir().unwrap();
+        let (game_id, plugins) = prepare(tmp_dir.path());
+        let index = PluginIndex::default();
+
+        let (i, plugin) = index.find(&plugins, "Blank.esp", game_id).unwrap();
+
+        assert_eq!(1, i);
+        assert_eq!("Blank.esp", plugin.name());
+    }
+
+    #[test]
+    fn find_should_be_case_insensitive() {
+        let tmp_dir = tempdir().unwrap();
+        let (game_id, plugins) = prepare(tmp_dir.path());
+        let index = PluginIndex::default();
+
+        assert_eq!(1, index.find(&plugins, "blank.ESP", game_id).unwrap().0);
+    }
+
+    #[test]
+    fn find_should_ignore_a_ghost_extension_if_the_game_allows_ghosting() {
+        let tmp_dir = tempdir().unwrap();
+        let (game_id, plugins) = prepare(tmp_dir.path());
+        let index = PluginIndex::default();
+
+        assert_eq!(
+            2,
+            index
+                .find(&plugins, "Blank - Ghosted.esp.ghost", game_id)
+                .unwrap()
+                .0
+        );
+        assert_eq!(
+            1,
+            index.find(&plugins, "Blank.esp.ghost", game_id).unwrap().0
+        );
+    }
+
+    #[test]
+    fn find_should_return_none_if_no_plugin_has_the_given_name() {
+        let tmp_dir = tempdir().unwrap();
+        let (game_id, plugins) = prepare(tmp_dir.path());
+        let index = PluginIndex::default();
+
+        assert!(index.find(&plugins, "missing.esp", game_id).is_none());
+    }
+
+    #[test]
+    fn find_should_return_the_first_of_several_plugins_with_the_same_name() {
+        let tmp_dir = tempdir().unwrap();
+        let (game_id, mut plugins) = prepare(tmp_dir.path());
+        plugins.push(plugins[1].clone());
+        let index = PluginIndex::default();
+
+        assert_eq!(1, index.find(&plugins, "Blank.esp", game_id).unwrap().0);
+    }
+
+    #[test]
+    fn insert_should_shift_the_positions_of_later_plugins() {
+        let tmp_dir = tempdir().unwrap();
+        let (game_id, mut plugins) = prepare(tmp_dir.path());
+        let mut index = PluginIndex::default();
+        assert_eq!(1, index.find(&plugins, "Blank.esp", game_id).unwrap().0);
+
+        let plugin = plugins.remove(0);
+        index.remove(0, &plugin);
+
+        assert_eq!(0, index.find(&plugins, "Blank.esp", game_id).unwrap().0);
+        assert!(index.find(&plugins, "Blank.esm", game_id).is_none());
+
+        index.insert(2, &plugin);
+        plugins.insert(2, plugin);
+
+        assert_eq!(0, index.find(&plugins, "Blank.esp", game_id).unwrap().0);
+        assert_eq!(
+            1,
+            index
+                .find(&plugins, "Blank - Ghosted.esp", game_id)
+                .unwrap()
+                .0
+        );
+        assert_eq!(2, index.find(&plugins, "Blank.esm", game_id).unwrap().0);
+    }
+
+    #[test]
+    fn insert_and_remove_should_track_plugins_with_the_same_name() {
+        let tmp_dir = tempdir().unwrap();
+        let (game_id, mut plugins) = prepare(tmp_dir.path());
+        let mut index = PluginIndex::default();
+        assert!(index.find(&plugins, "Blank.esp", game_id).is_some());
+
+        let plugin = plugins[1].clone();
+        index.insert(0, &plugin);
+        plugins.insert(0, plugin);
+
+        assert_eq!(0, index.find(&plugins, "Blank.esp", game_id).unwrap().0);
+
+        let plugin = plugins.remove(0);
+        index.remove(0, &plugin);
+
+        assert_eq!(1, index.find(&plugins, "Blank.esp", game_id).unwrap().0);
+    }
+
+    #[test]
+    fn remove_should_invalidate_the_index_if_the_plugin_is_not_at_the_given_position() {
+        let tmp_dir = tempdir().unwrap();
+        let (game_id, mut plugins) = prepare(tmp_dir.path());
+        let mut index = PluginIndex::default();
+        assert!(index.find(&plugins, "Blank.esp", game_id).is_some());
+
+        let plugin = plugins.remove(2);
+        index.remove(0, &plugin);
+
+        assert!(index.maps.get().is_none());
+        assert_eq!(1, index.find(&plugins, "Blank.esp", game_id).unwrap().0);
+    }
+
+    #[test]
+    fn invalidate_should_cause_the_index_to_be_rebuilt_on_next_use() {
+        let tmp_dir = tempdir().unwrap();
+        let (game_id, mut plugins) = prepare(tmp_dir.path());
+        let mut index = PluginIndex::default();
+        assert_eq!(1, index.find(&plugins, "Blank.esp", game_id).unwrap().0);
+
+        plugins.swap(0, 1);
+        index.invalidate();
+
+        assert_eq!(0, index.find(&plugins, "Blank.esp", game_id).unwrap().0);
+    }
+
+    #[test]
+    fn candidate_dependents_should_track_plugins_that_have_the_given_master() {
+        let tmp_dir = tempdir().unwrap();
+        let (game_id, mut plugins) = prepare(tmp_dir.path());
+        let game_settings = game_settings_for_test(game_id, tmp_dir.path());
+        let mut index = PluginIndex::default();
+
+        let dependent = Plugin::new("Blank - Master Dependent.esp", &game_settings).unwrap();
+        plugins.push(dependent.clone());
+
+        assert_eq!(&[3], index.candidate_dependents(&plugins, "Blank.esm"));
+        assert!(index.candidate_dependents(&plugins, "Blank.esp").is_empty());
+
+        index.insert(0, &dependent);
+        plugins.insert(0, dependent);
+
+        assert_eq!(&[0, 4], index.candidate_dependents(&plugins, "blank.esm"));
+
+        let plugin = plugins.remove(4);
+        index.remove(4, &plugin);
+
+        assert_eq!(
+            &[0],
+            index.candidate_dependents(&plugins, "Blank.esm.ghost")
+        );
+    }
+
+    #[test]
+    fn active_counts_should_track_activated_inserted_and_removed_plugins() {
+        let tmp_dir = tempdir().unwrap();
+        let (game_id, mut plugins) = prepare(tmp_dir.path());
+        let game_settings = game_settings_for_test(game_id, tmp_dir.path());
+        let mut index = PluginIndex::default();
+
+        assert_eq!(PluginCounts::default(), index.active_counts(&plugins));
+
+        let active = Plugin::with_active("Blank.esp", &game_settings, true).unwrap();
+        index.insert(0, &active);
+        plugins.insert(0, active);
+
+        assert_eq!(1, index.active_counts(&plugins).full);
+
+        index.record_deactivation(&plugins[0]);
+        assert_eq!(0, index.active_counts(&plugins).full);
+
+        index.record_activation(&plugins[0]);
+        assert_eq!(1, index.active_counts(&plugins).full);
+
+        let plugin = plugins.remove(0);
+        index.remove(0, &plugin);
+
+        assert_eq!(PluginCounts::default(), index.active_counts(&plugins));
+    }
+}
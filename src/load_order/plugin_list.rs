@@ -0,0 +1,341 @@
+/*
+ * This file is part of libloadorder
+ *
+ * Copyright (C) 2017 Oliver Hamlet
+ *
+ * libloadorder is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libloadorder is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
+ */
+use std::path::{Path, PathBuf};
+use std::sync::Arc;
+
+use encoding_rs::WINDOWS_1252;
+use memchr::memchr_iter;
+
+use super::source_fingerprints::{fingerprint, Fingerprint};
+use crate::enums::Error;
+use crate::metrics::MetricsRecorder;
+
+/// How the content of a plugin list file is encoded.
+#[derive(Clone, Copy, Debug, Eq, PartialEq, Hash)]
+pub(super) enum PluginListEncoding {
+    Windows1252,
+    /// UTF-8 is tried first, and if the content isn't valid UTF-8 it's
+    /// decoded as Windows-1252.
+    Utf8OrWindows1252,
+}
+
+/// The decoded content of a plugin list file, e.g. plugins.txt or
+/// loadorder.txt.
+#[derive(Clone, Debug, Default, Eq, PartialEq, Hash)]
+pub(super) struct PluginList {
+    content: String,
+}
+
+impl PluginList {
+    /// Read the plugin list at the given path. A file that doesn't exist is
+    /// treated as an empty list.
+    pub(super) fn read(
+        path: &Path,
+        encoding: PluginListEncoding,
+        metrics: &MetricsRecorder,
+    ) -> Result<Self, Error> {
+        if !path.exists() {
+            return Ok(PluginList::default());
+        }
+
+        let content = std::fs::read(path).map_err(|e| Error::IoError(path.to_path_buf(), e))?;
+        metrics.add_bytes_read(content.len());
+
+        Self::decode(content, encoding)
+    }
+
+    fn decode(content: Vec<u8>, encoding: PluginListEncoding) -> Result<Self, Error> {
+        // ASCII content is valid UTF-8 and decodes to the same text as
+        // Windows-1252, so it can be used without copying it.
+        let content = if encoding == PluginListEncoding::Utf8OrWindows1252 || content.is_ascii() {
+            match String::from_utf8(content) {
+                Ok(content) => return Ok(PluginList { content }),
+                Err(e) => e.into_bytes(),
+            }
+        } else {
+            content
+        };
+
+        // This should never fail, as although Windows-1252 has a few unused bytes
+        // they get mapped to C1 control characters.
+        let decoded_content = WINDOWS_1252
+            .decode_without_bom_handling_and_without_replacement(&content)
+            .ok_or_else(|| Error::DecodeError(content.clone()))?
+            .into_owned();
+
+        Ok(PluginList {
+            content: decoded_content,
+        })
+    }
+
+    /// Get the lines in the list, split in the same way as `str::lines()`.
+    pub(super) fn lines(&self) -> impl Iterator<Item = &str> {
+        let content = self.content.as_str();
+        let unterminated_end =
+            (!content.ends_with('\n') && !content.is_empty()).then_some(content.len());
+
+        let mut start = 0;
+        memchr_iter(b'\n', content.as_bytes())
+            .chain(unterminated_end)
+            .filter_map(move |end| {
+                let line = content.get(start..end)?;
+                start = end.saturating_add(1);
+
+                if end < content.len() {
+                    Some(line.strip_suffix('\r').unwrap_or(line))
+                } else {
+                    Some(line)
+                }
+            })
+    }
+
+    /// Get the plugin names in the list, skipping blank lines and comments.
+    pub(super) fn plugin_names(&self) -> impl Iterator<Item = &str> {
+        self.lines()
+            .filter(|line| !line.is_empty() && !line.starts_with('#'))
+    }
+}
+
+/// Plugin lists that have been read, along with the fingerprints their files
+/// had when they were read, so that they only need to be read again once their
+/// files have changed.
+#[derive(Clone, Debug, Default, Eq, PartialEq, Hash)]
+pub(super) struct PluginListCache {
+    entries: Vec<(PathBuf, Fingerprint, Arc<PluginList>)>,
+}
+
+impl PluginListCache {
+    /// Get the plugin list at the given path, reading it if it isn't cached or
+    /// its file has changed since it was cached.
+    pub(super) fn get(
+        &self,
+        path: &Path,
+        encoding: PluginListEncoding,
+        metrics: &MetricsRecorder,
+    ) -> Result<Arc<PluginList>, Error> {
+        let current_fingerprint = fingerprint(path);
+
+        match self.find(path, current_fingerprint) {
+            Some(list) => Ok(list),
+            None => PluginList::read(path, encoding, metrics).map(Arc::new),
+        }
+    }
+
+    /// Get the plugin list at the given path in the same way as `get()`, but
+    /// also cache it if it had to be read.
+    pub(super) fn get_or_read(
+        &mut self,
+        path: &Path,
+        encoding: PluginListEncoding,
+        metrics: &MetricsRecorder,
+    ) -> Result<Arc<PluginList>, Error> {
+        // Get the fingerprint first so that if the file changes while it's
+        // being read, the next call reads it again.
+        let current_fingerprint = fingerprint(path);
+
+        if let Some(list) = self.find(path, current_fingerprint) {
+            return Ok(list);
+        }
+
+        let list = Arc::new(PluginList::read(path, encoding, metrics)?);
+
+        self.remove(path);
+        if current_fingerprint.is_some() {
+            self.entries
+                .push((path.to_path_buf(), current_fingerprint, Arc::clone(&list)));
+        }
+
+        Ok(list)
+    }
+
+    fn remove(&mut self, path: &Path) {
+        self.entries.retain(|(p, _, _)| p != path);
+    }
+
+    fn find(&self, path: &Path, current_fingerprint: Fingerprint) -> Option<Arc<PluginList>> {
+        current_fingerprint?;
+
+        self.entries
+            .iter()
+            .find(|(p, f, _)| p == path && *f == current_fingerprint)
+            .map(|(_, _, list)| Arc::clone(list))
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    use std::fs::write;
+
+    use tempfile::tempdir;
+
+    fn lines(content: &str) -> Vec<String> {
+        PluginList {
+            content: content.to_owned(),
+        }
+        .lines()
+        .map(str::to_owned)
+        .collect()
+    }
+
+    #[test]
+    fn lines_should_split_content_in_the_same_way_as_str_lines() {
+        let inputs = [
+            "",
+            "\n",
+            "a",
+            "a\n",
+            "a\nb",
+            "a\r\nb\r\n",
+            "a\n\nb\n\n",
+            "a\rb\r",
+            "\r\n\r\n",
+        ];
+
+        for input in inputs {
+            let expected: Vec<_> = input.lines().map(str::to_owned).collect();
+            assert_eq!(expected, lines(input), "input {input:?}");
+        }
+    }
+
+    #[test]
+    fn plugin_names_should_skip_blank_lines_and_comments() {
+        let list = PluginList {
+            content: "# comment\nBlank.esm\n\nBlank.esp\r\n".to_owned(),
+        };
+
+        assert_eq!(
+            vec!["Blank.esm", "Blank.esp"],
+            list.plugin_names().collect::<Vec<_>>()
+        );
+    }
+
+    #[test]
+    fn read_should_return_an_empty_list_if_the_file_does_not_exist() {
+        let tmp_dir = tempdir().unwrap();
+        let path = tmp_dir.path().join("plugins.txt");
+
+        let list = PluginList::read(
+            &path,
+            PluginListEncoding::Windows1252,
+            &MetricsRecorder::default(),
+        )
+        .unwrap();
+
+        assert_eq!(0, list.lines().count());
+    }
+
+    #[test]
+    fn read_should_decode_windows_1252_content() {
+        let tmp_dir = tempdir().unwrap();
+        let path = tmp_dir.path().join("plugins.txt");
+        write(&path, b"Bl\xe0nk.esp\n").unwrap();
+
+        let list = PluginList::read(
+            &path,
+            PluginListEncoding::Windows1252,
+            &MetricsRecorder::default(),
+        )
+        .unwrap();
+
+        assert_eq!(vec!["Bl\u{e0}nk.esp"], list.lines().collect::<Vec<_>>());
+    }
+
+    #[test]
+    fn read_should_decode_windows_1252_content_that_is_also_valid_utf8_as_windows_1252() {
+        let tmp_dir = tempdir().unwrap();
+        let path = tmp_dir.path().join("plugins.txt");
+        write(&path, "Bl\u{e0}nk.esp\n").unwrap();
+
+        let list = PluginList::read(
+            &path,
+            PluginListEncoding::Windows1252,
+            &MetricsRecorder::default(),
+        )
+        .unwrap();
+
+        assert_eq!(
+            vec!["Bl\u{c3}\u{a0}nk.esp"],
+            list.lines().collect::<Vec<_>>()
+        );
+    }
+
+    #[test]
+    fn read_should_prefer_utf8_if_allowed() {
+        let tmp_dir = tempdir().unwrap();
+        let path = tmp_dir.path().join("loadorder.txt");
+        write(&path, "Bl\u{e0}nk.esp\n").unwrap();
+
+        let list = PluginList::read(
+            &path,
+            PluginListEncoding::Utf8OrWindows1252,
+            &MetricsRecorder::default(),
+        )
+        .unwrap();
+
+        assert_eq!(vec!["Bl\u{e0}nk.esp"], list.lines().collect::<Vec<_>>());
+    }
+
+    #[test]
+    fn read_should_fall_back_to_windows_1252_if_content_is_not_valid_utf8() {
+        let tmp_dir = tempdir().unwrap();
+        let path = tmp_dir.path().join("loadorder.txt");
+        write(&path, b"Bl\xe0nk.esp\n").unwrap();
+
+        let list = PluginList::read(
+            &path,
+            PluginListEncoding::Utf8OrWindows1252,
+            &MetricsRecorder::default(),
+        )
+        .unwrap();
+
+        assert_eq!(vec!["Bl\u{e0}nk.esp"], list.lines().collect::<Vec<_>>());
+    }
+
+    #[test]
+    fn cache_get_or_read_should_reuse_a_list_until_its_file_changes() {
+        let tmp_dir = tempdir().unwrap();
+        let path = tmp_dir.path().join("plugins.txt");
+        write(&path, "Blank.esp\n").unwrap();
+
+        let metrics = MetricsRecorder::default();
+        let mut cache = PluginListCache::default();
+        let first = cache
+            .get_or_read(&path, PluginListEncoding::Windows1252, &metrics)
+            .unwrap();
+        let second = cache
+            .get(&path, PluginListEncoding::Windows1252, &metrics)
+            .unwrap();
+
+        assert!(Arc::ptr_eq(&first, &second));
+        assert_eq!(10, metrics.snapshot().bytes_read);
+
+        write(&path, "Blank.esm\nBlank.esp\n").unwrap();
+
+        let third = cache
+            .get(&path, PluginListEncoding::Windows1252, &metrics)
+            .unwrap();
+
+        assert_eq!(
+            vec!["Blank.esm", "Blank.esp"],
+            third.lines().collect::<Vec<_>>()
+        );
+    }
+}
@@ -16,6 +16,9 @@
  * You should have received a copy of the GNU General Public License
  * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
  */
+use super::diff::{diff_load_order, LoadOrderDiff};
+use super::plugin_index::{count_active_plugins, PluginCounts, PluginIndex};
+use crate::enums::Error;
 use crate::game_settings::GameSettings;
 use crate::plugin::Plugin;
 
@@ -24,23 +27,85 @@ pub trait ReadableLoadOrderBase {
 
     fn game_settings_base(&self) -> &GameSettings;
 
+    /// The index used to look up plugins by name, if there is one. Without an
+    /// index, lookups scan through the plugins.
+    fn plugin_index(&self) -> Option<&PluginIndex> {
+        None
+    }
+
     fn find_plugin(&self, plugin_name: &str) -> Option<&Plugin> {
-        self.plugins().iter().find(|p| p.name_matches(plugin_name))
+        self.find_plugin_and_index(plugin_name).map(|(_, p)| p)
     }
 
     fn find_plugin_and_index(&self, plugin_name: &str) -> Option<(usize, &Plugin)> {
-        self.plugins()
-            .iter()
-            .enumerate()
-            .find(|(_, p)| p.name_matches(plugin_name))
+        match self.plugin_index() {
+            Some(index) => index.find(self.plugins(), plugin_name, self.game_settings_base().id()),
+            None => self
+                .plugins()
+                .iter()
+                .enumerate()
+                .find(|(_, p)| p.name_matches(plugin_name)),
+        }
+    }
+
+    /// Count the active light, medium and full plugins.
+    fn active_plugin_counts(&self) -> PluginCounts {
+        match self.plugin_index() {
+            Some(index) => index.active_counts(self.plugins()),
+            None => count_active_plugins(self.plugins()),
+        }
+    }
+
+    /// Get the positions of the plugins that have the given plugin as a
+    /// master, in ascending order.
+    fn dependent_positions(&self, plugin: &Plugin) -> Vec<usize> {
+        let is_dependent = |p: &Plugin| p.masters().iter().any(|m| plugin.name_matches(m));
+
+        match self.plugin_index() {
+            Some(index) => index
+                .candidate_dependents(self.plugins(), plugin.name())
+                .iter()
+                .copied()
+                .filter(|i| self.plugins().get(*i).is_some_and(is_dependent))
+                .collect(),
+            None => self
+                .plugins()
+                .iter()
+                .enumerate()
+                .filter(|(_, p)| is_dependent(p))
+                .map(|(i, _)| i)
+                .collect(),
+        }
     }
 }
 
+/// A plugin's position in a load order, along with its state and the header
+/// flags that affect where it can load.
+#[derive(Clone, Copy, Debug, Eq, PartialEq, Hash)]
+#[expect(
+    clippy::struct_excessive_bools,
+    reason = "The bools are independent properties of the plugin"
+)]
+pub struct LoadOrderEntry<'a> {
+    pub name: &'a str,
+    pub position: usize,
+    pub is_active: bool,
+    pub is_master: bool,
+    pub is_light: bool,
+    pub is_medium: bool,
+    pub is_blueprint: bool,
+    pub is_ghosted: bool,
+    pub is_early_loading: bool,
+}
+
 pub trait ReadableLoadOrder {
     fn game_settings(&self) -> &GameSettings;
 
     fn plugin_names(&self) -> Vec<&str>;
 
+    /// Get an entry for each plugin in the load order, in load order.
+    fn entries(&self) -> Vec<LoadOrderEntry<'_>>;
+
     fn index_of(&self, plugin_name: &str) -> Option<usize>;
 
     fn plugin_at(&self, index: usize) -> Option<&str>;
@@ -48,6 +113,16 @@ pub trait ReadableLoadOrder {
     fn active_plugin_names(&self) -> Vec<&str>;
 
     fn is_active(&self, plugin_name: &str) -> bool;
+
+    /// Find the changes that would turn the current load order and active
+    /// plugins into the given ones, without making them. The target load
+    /// order must not contain duplicates, and the active plugins must all be
+    /// in it.
+    fn diff_load_order(
+        &self,
+        plugin_names: &[&str],
+        active_plugin_names: &[&str],
+    ) -> Result<LoadOrderDiff, Error>;
 }
 
 impl<T: ReadableLoadOrderBase> ReadableLoadOrder for T {
@@ -59,10 +134,28 @@ impl<T: ReadableLoadOrderBase> ReadableLoadOrder for T {
         self.plugins().iter().map(Plugin::name).collect()
     }
 
-    fn index_of(&self, plugin_name: &str) -> Option<usize> {
+    fn entries(&self) -> Vec<LoadOrderEntry<'_>> {
+        let game_settings = self.game_settings_base();
+
         self.plugins()
             .iter()
-            .position(|p| p.name_matches(plugin_name))
+            .enumerate()
+            .map(|(position, plugin)| LoadOrderEntry {
+                name: plugin.name(),
+                position,
+                is_active: plugin.is_active(),
+                is_master: plugin.is_master_file(),
+                is_light: plugin.is_light_plugin(),
+                is_medium: plugin.is_medium_plugin(),
+                is_blueprint: plugin.is_blueprint_master(),
+                is_ghosted: plugin.is_ghosted(),
+                is_early_loading: game_settings.loads_early(plugin.name()),
+            })
+            .collect()
+    }
+
+    fn index_of(&self, plugin_name: &str) -> Option<usize> {
+        self.find_plugin_and_index(plugin_name).map(|(i, _)| i)
     }
 
     fn plugin_at(&self, index: usize) -> Option<&str> {
@@ -80,6 +173,19 @@ impl<T: ReadableLoadOrderBase> ReadableLoadOrder for T {
     fn is_active(&self, plugin_name: &str) -> bool {
         self.find_plugin(plugin_name).is_some_and(Plugin::is_active)
     }
+
+    fn diff_load_order(
+        &self,
+        plugin_names: &[&str],
+        active_plugin_names: &[&str],
+    ) -> Result<LoadOrderDiff, Error> {
+        diff_load_order(
+            self.plugins(),
+            self.game_settings_base().id(),
+            plugin_names,
+            active_plugin_names,
+        )
+    }
 }
 
 #[cfg(test)]
@@ -110,7 +216,11 @@ mod tests {
     }
 
     fn prepare(game_dir: &Path) -> TestLoadOrder {
-        let mut game_settings = game_settings_for_test(GameId::Oblivion, game_dir);
+        prepare_for_game(GameId::Oblivion, game_dir)
+    }
+
+    fn prepare_for_game(game_id: GameId, game_dir: &Path) -> TestLoadOrder {
+        let mut game_settings = game_settings_for_test(game_id, game_dir);
         mock_game_files(&mut game_settings);
 
         let plugins = vec![
@@ -186,6 +296,39 @@ mod tests {
         assert_eq!(0, load_order.index_of("blank.esp").unwrap());
     }
 
+    #[test]
+    fn entries_should_describe_each_plugin_in_load_order() {
+        let tmp_dir = tempdir().unwrap();
+        let load_order = prepare_with_ghosted_plugin(tmp_dir.path());
+
+        let entries = load_order.entries();
+
+        assert_eq!(
+            vec![
+                "Blank - Different.esm",
+                "Blank.esp",
+                "Blank - Different.esp"
+            ],
+            entries.iter().map(|e| e.name).collect::<Vec<_>>()
+        );
+        assert_eq!(
+            vec![0, 1, 2],
+            entries.iter().map(|e| e.position).collect::<Vec<_>>()
+        );
+
+        assert!(entries[0].is_master);
+        assert!(entries[0].is_ghosted);
+        assert!(!entries[0].is_active);
+
+        assert!(!entries[1].is_master);
+        assert!(!entries[1].is_ghosted);
+        assert!(entries[1].is_active);
+        assert!(!entries[1].is_light);
+        assert!(!entries[1].is_medium);
+        assert!(!entries[1].is_blueprint);
+        assert!(!entries[1].is_early_loading);
+    }
+
     #[test]
     fn plugin_at_should_return_none_if_given_an_out_of_bounds_index() {
         let tmp_dir = tempdir().unwrap();
@@ -250,4 +393,49 @@ mod tests {
 
         assert!(load_order.is_active("blank.esp"));
     }
+
+    #[test]
+    fn diff_load_order_should_ignore_ghost_extensions_if_the_game_ghosts_plugins() {
+        let tmp_dir = tempdir().unwrap();
+        let load_order = prepare_with_ghosted_plugin(tmp_dir.path());
+
+        let diff = load_order
+            .diff_load_order(
+                &[
+                    "Blank - Different.esm.ghost",
+                    "Blank.esp",
+                    "Blank - Different.esp",
+                ],
+                &["Blank.esp", "Blank - Different.esp.ghost"],
+            )
+            .unwrap();
+
+        assert!(diff.removed.is_empty());
+        assert!(diff.added.is_empty());
+        assert!(diff.moved.is_empty());
+        assert_eq!(vec!["Blank - Different.esp".to_owned()], diff.activated);
+        assert!(diff.deactivated.is_empty());
+    }
+
+    #[test]
+    fn diff_load_order_should_not_ignore_ghost_extensions_if_the_game_does_not_ghost_plugins() {
+        let tmp_dir = tempdir().unwrap();
+        let load_order = prepare_for_game(GameId::OpenMW, tmp_dir.path());
+
+        let diff = load_order
+            .diff_load_order(
+                &["Blank.esp", "Blank - Different.esp.ghost"],
+                &["Blank.esp"],
+            )
+            .unwrap();
+
+        assert_eq!(vec!["Blank - Different.esp".to_owned()], diff.removed);
+        assert_eq!(
+            vec![("Blank - Different.esp.ghost".to_owned(), 1usize)],
+            diff.added
+        );
+        assert!(diff.moved.is_empty());
+        assert!(diff.activated.is_empty());
+        assert!(diff.deactivated.is_empty());
+    }
 }
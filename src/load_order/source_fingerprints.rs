@@ -0,0 +1,255 @@
+/*
+ * This file is part of libloadorder
+ *
+ * Copyright (C) 2017 Oliver Hamlet
+ *
+ * libloadorder is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libloadorder is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
+ */
+use std::fs::metadata;
+use std::path::{Path, PathBuf};
+use std::time::SystemTime;
+
+use crate::game_settings::GameSettings;
+use crate::parallelism::MIN_PARALLEL_METADATA_OPERATIONS;
+use crate::plugin::Plugin;
+
+/// The changes to the files that a load order was read from since it was last
+/// loaded, as found by `WritableLoadOrder::changes_since_load()`.
+#[derive(Clone, Debug, Default, Eq, PartialEq, Hash)]
+pub struct LoadOrderChanges {
+    /// True if the active plugins file, load order file, or any of the CCC or
+    /// ini files that can make plugins implicitly active have changed.
+    pub plugin_lists_changed: bool,
+    /// True if any of the plugins directories have changed, which happens when
+    /// plugins are added to, removed from or renamed within them. This
+    /// includes ghosted plugins that the load order unghosted when activating
+    /// them.
+    pub plugins_directories_changed: bool,
+    /// The names of loaded plugins with files that have changed or no longer
+    /// exist, in load order.
+    pub changed_plugins: Vec<String>,
+}
+
+impl LoadOrderChanges {
+    /// Returns true if nothing has changed, so there's no need to load the
+    /// load order again.
+    pub fn is_empty(&self) -> bool {
+        !self.plugin_lists_changed
+            && !self.plugins_directories_changed
+            && self.changed_plugins.is_empty()
+    }
+}
+
+/// The modification time and size of a file or directory, or None if it
+/// doesn't exist or its metadata couldn't be read.
+pub(crate) type Fingerprint = Option<(SystemTime, u64)>;
+
+pub(crate) fn fingerprint(path: &Path) -> Fingerprint {
+    let metadata = metadata(path).ok()?;
+
+    Some((metadata.modified().ok()?, metadata.len()))
+}
+
+fn fingerprints<'a>(paths: impl Iterator<Item = &'a PathBuf>) -> Vec<(PathBuf, Fingerprint)> {
+    paths.map(|p| (p.clone(), fingerprint(p))).collect()
+}
+
+/// Fingerprints of the non-plugin files and directories that a load order was
+/// read from, so that checking if the load order may be out of date only needs
+/// their metadata to be read. Loaded plugins already record the metadata of
+/// their files.
+#[derive(Clone, Debug, Default, Eq, PartialEq, Hash)]
+pub(super) struct SourceFingerprints {
+    plugin_lists: Vec<(PathBuf, Fingerprint)>,
+    plugins_directories: Vec<(PathBuf, Fingerprint)>,
+}
+
+impl SourceFingerprints {
+    /// This should be called before reading the load order, so that changes
+    /// made while it's being read are picked up by the next check.
+    pub(super) fn new(game_settings: &GameSettings) -> Self {
+        SourceFingerprints {
+            plugin_lists: fingerprints(game_settings.state_file_paths().iter()),
+            plugins_directories: plugins_directories_fingerprints(game_settings),
+        }
+    }
+
+    /// Update the plugin list fingerprints after the load order has written
+    /// its plugin lists, so that its own changes aren't reported.
+    pub(super) fn refresh_plugin_lists(&mut self, game_settings: &GameSettings) {
+        self.plugin_lists = fingerprints(game_settings.state_file_paths().iter());
+    }
+
+    pub(super) fn changes(
+        &self,
+        game_settings: &GameSettings,
+        plugins: &[Plugin],
+    ) -> LoadOrderChanges {
+        let plugin_lists = fingerprints(game_settings.state_file_paths().iter());
+
+        LoadOrderChanges {
+            plugin_lists_changed: plugin_lists != self.plugin_lists,
+            plugins_directories_changed: plugins_directories_fingerprints(game_settings)
+                != self.plugins_directories,
+            changed_plugins: game_settings.parallelism().filter_map(
+                plugins,
+                MIN_PARALLEL_METADATA_OPERATIONS,
+                |p| (!p.is_unchanged_on_disk()).then(|| p.name().to_owned()),
+            ),
+        }
+    }
+}
+
+fn plugins_directories_fingerprints(game_settings: &GameSettings) -> Vec<(PathBuf, Fingerprint)> {
+    let plugins_directory = game_settings.plugins_directory();
+
+    fingerprints(
+        std::iter::once(&plugins_directory)
+            .chain(game_settings.additional_plugins_directories().iter()),
+    )
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    use std::fs::{remove_file, File, FileTimes};
+    use std::time::Duration;
+
+    use tempfile::tempdir;
+
+    use crate::enums::GameId;
+    use crate::load_order::tests::{game_settings_for_test, mock_game_files};
+    use crate::tests::copy_to_test_dir;
+
+    fn prepare(game_dir: &Path) -> (GameSettings, Vec<Plugin>) {
+        let mut game_settings = game_settings_for_test(GameId::SkyrimSE, game_dir);
+        mock_game_files(&mut game_settings);
+
+        let plugins = vec![
+            Plugin::new("Blank.esm", &game_settings).unwrap(),
+            Plugin::new("Blank.esp", &game_settings).unwrap(),
+        ];
+
+        (game_settings, plugins)
+    }
+
+    fn set_modification_time(path: &Path, seconds: u64) {
+        File::options()
+            .write(true)
+            .open(path)
+            .unwrap()
+            .set_times(
+                FileTimes::new()
+                    .set_modified(SystemTime::UNIX_EPOCH + Duration::from_secs(seconds)),
+            )
+            .unwrap();
+    }
+
+    #[test]
+    fn changes_should_be_empty_if_nothing_has_changed() {
+        let tmp_dir = tempdir().unwrap();
+        let (game_settings, plugins) = prepare(tmp_dir.path());
+
+        let fingerprints = SourceFingerprints::new(&game_settings);
+
+        assert!(fingerprints.changes(&game_settings, &plugins).is_empty());
+    }
+
+    #[test]
+    fn changes_should_not_be_empty_if_there_are_no_fingerprints() {
+        let tmp_dir = tempdir().unwrap();
+        let (game_settings, plugins) = prepare(tmp_dir.path());
+
+        let changes = SourceFingerprints::default().changes(&game_settings, &plugins);
+
+        assert!(changes.plugin_lists_changed);
+        assert!(changes.plugins_directories_changed);
+    }
+
+    #[test]
+    fn changes_should_include_plugins_with_changed_or_removed_files() {
+        let tmp_dir = tempdir().unwrap();
+        let (game_settings, plugins) = prepare(tmp_dir.path());
+
+        let fingerprints = SourceFingerprints::new(&game_settings);
+
+        set_modification_time(&game_settings.plugin_path("Blank.esp"), 10);
+        remove_file(game_settings.plugin_path("Blank.esm")).unwrap();
+
+        let changes = fingerprints.changes(&game_settings, &plugins);
+
+        assert_eq!(vec!["Blank.esm", "Blank.esp"], changes.changed_plugins);
+        assert!(!changes.plugin_lists_changed);
+    }
+
+    #[test]
+    fn changes_should_detect_a_changed_plugin_list() {
+        let tmp_dir = tempdir().unwrap();
+        let (game_settings, plugins) = prepare(tmp_dir.path());
+
+        File::create(game_settings.active_plugins_file()).unwrap();
+        set_modification_time(game_settings.active_plugins_file(), 10);
+        let fingerprints = SourceFingerprints::new(&game_settings);
+
+        set_modification_time(game_settings.active_plugins_file(), 20);
+
+        let changes = fingerprints.changes(&game_settings, &plugins);
+
+        assert!(changes.plugin_lists_changed);
+        assert!(!changes.plugins_directories_changed);
+        assert!(changes.changed_plugins.is_empty());
+    }
+
+    // Windows can't set the timestamps of a directory opened read-only, and
+    // without resetting the timestamp, adding a file may not change it if the
+    // filesystem's timestamps are too coarse.
+    #[cfg(unix)]
+    #[test]
+    fn changes_should_detect_a_plugin_being_added() {
+        let tmp_dir = tempdir().unwrap();
+        let (game_settings, plugins) = prepare(tmp_dir.path());
+
+        File::open(game_settings.plugins_directory())
+            .unwrap()
+            .set_times(FileTimes::new().set_modified(SystemTime::UNIX_EPOCH))
+            .unwrap();
+        let fingerprints = SourceFingerprints::new(&game_settings);
+
+        copy_to_test_dir("Blank.esp", "Blank - Copy.esp", &game_settings);
+
+        let changes = fingerprints.changes(&game_settings, &plugins);
+
+        assert!(changes.plugins_directories_changed);
+        assert!(!changes.plugin_lists_changed);
+    }
+
+    #[test]
+    fn refresh_plugin_lists_should_update_the_plugin_list_fingerprints() {
+        let tmp_dir = tempdir().unwrap();
+        let (game_settings, plugins) = prepare(tmp_dir.path());
+
+        let mut fingerprints = SourceFingerprints::new(&game_settings);
+        File::create(game_settings.active_plugins_file()).unwrap();
+        assert!(
+            fingerprints
+                .changes(&game_settings, &plugins)
+                .plugin_lists_changed
+        );
+
+        fingerprints.refresh_plugin_lists(&game_settings);
+
+        assert!(fingerprints.changes(&game_settings, &plugins).is_empty());
+    }
+}
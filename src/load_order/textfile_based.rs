@@ -17,29 +17,40 @@
  * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
  */
 use std::collections::HashSet;
-use std::fs::File;
-use std::io::{BufWriter, Write};
-use std::path::{Path, PathBuf};
+use std::mem;
+use std::sync::Arc;
 
-use unicase::{eq, UniCase};
+use unicase::UniCase;
 
-use super::mutable::{
-    hoist_masters, load_active_plugins, plugin_line_mapper, read_plugin_names, MutableLoadOrder,
-};
+use super::diff::LoadOrderDiff;
+use super::load_progress::LoadProgress;
+use super::mutable::{activate_listed_plugins, hoist_masters, MutableLoadOrder};
+use super::plugin_cache::{LoadStats, PluginCache};
+use super::plugin_index::PluginIndex;
+use super::plugin_list::{PluginList, PluginListCache, PluginListEncoding};
 use super::readable::{ReadableLoadOrder, ReadableLoadOrderBase};
+use super::source_fingerprints::{LoadOrderChanges, SourceFingerprints};
 use super::strict_encode;
 use super::writable::{
-    activate, add, create_parent_dirs, deactivate, remove, set_active_plugins, WritableLoadOrder,
+    activate, add, apply_batch, apply_diff, deactivate, remove, restore_snapshot,
+    set_active_plugins, snapshot, write_file_if_changed, BatchOperation, LoadOrderSnapshot,
+    SaveStats, WritableLoadOrder,
 };
 use crate::enums::Error;
 use crate::game_settings::GameSettings;
-use crate::plugin::{trim_dot_ghost, trim_dot_ghost_unchecked, Plugin};
+use crate::metrics::Phase;
+use crate::plugin::{trim_dot_ghost, Plugin};
 use crate::GameId;
 
 #[derive(Clone, Debug, Eq, PartialEq, Hash)]
 pub(crate) struct TextfileBasedLoadOrder {
     game_settings: GameSettings,
     plugins: Vec<Plugin>,
+    plugin_index: PluginIndex,
+    load_stats: LoadStats,
+    save_stats: SaveStats,
+    source_fingerprints: SourceFingerprints,
+    plugin_lists: PluginListCache,
 }
 
 impl TextfileBasedLoadOrder {
@@ -47,51 +58,59 @@ impl TextfileBasedLoadOrder {
         Self {
             game_settings,
             plugins: Vec::new(),
+            plugin_index: PluginIndex::default(),
+            load_stats: LoadStats::default(),
+            save_stats: SaveStats::default(),
+            source_fingerprints: SourceFingerprints::default(),
+            plugin_lists: PluginListCache::default(),
         }
     }
 
-    fn read_from_load_order_file(&self) -> Result<Vec<(String, bool)>, Error> {
-        match self.game_settings().load_order_file() {
-            Some(file_path) => read_utf8_plugin_names(file_path, load_order_line_mapper)
-                .or_else(|_| read_plugin_names(file_path, load_order_line_mapper)),
-            None => Ok(Vec::new()),
+    fn read_load_order_file(&mut self) -> Result<Arc<PluginList>, Error> {
+        match self.game_settings.load_order_file() {
+            Some(file_path) => self.plugin_lists.get_or_read(
+                file_path,
+                PluginListEncoding::Utf8OrWindows1252,
+                self.game_settings.metrics_recorder(),
+            ),
+            None => Ok(Arc::default()),
         }
     }
 
-    fn read_from_active_plugins_file(&self) -> Result<Vec<(String, bool)>, Error> {
-        read_plugin_names(
-            self.game_settings().active_plugins_file(),
-            active_plugin_line_mapper,
+    fn read_active_plugins_file(&mut self) -> Result<Arc<PluginList>, Error> {
+        self.plugin_lists.get_or_read(
+            self.game_settings.active_plugins_file(),
+            PluginListEncoding::Windows1252,
+            self.game_settings.metrics_recorder(),
         )
     }
 
     fn save_load_order(&self) -> Result<(), Error> {
         if let Some(file_path) = self.game_settings().load_order_file() {
-            create_parent_dirs(file_path)?;
-
-            let file = File::create(file_path).map_err(|e| Error::IoError(file_path.clone(), e))?;
-            let mut writer = BufWriter::new(file);
+            let mut content = Vec::new();
             for plugin_name in self.plugin_names() {
-                writeln!(writer, "{plugin_name}")
-                    .map_err(|e| Error::IoError(file_path.clone(), e))?;
+                content.extend_from_slice(plugin_name.as_bytes());
+                content.push(b'\n');
             }
+
+            write_file_if_changed(file_path, &content, self.game_settings().metrics_recorder())?;
         }
         Ok(())
     }
 
     fn save_active_plugins(&self) -> Result<(), Error> {
-        let path = self.game_settings().active_plugins_file();
-        create_parent_dirs(path)?;
-
-        let file = File::create(path).map_err(|e| Error::IoError(path.clone(), e))?;
-        let mut writer = BufWriter::new(file);
+        let mut content = Vec::new();
         for plugin_name in self.active_plugin_names() {
-            writer
-                .write_all(&strict_encode(plugin_name)?)
-                .map_err(|e| Error::IoError(path.clone(), e))?;
-            writeln!(writer).map_err(|e| Error::IoError(path.clone(), e))?;
+            content.extend_from_slice(&strict_encode(plugin_name)?);
+            content.push(b'\n');
         }
 
+        write_file_if_changed(
+            self.game_settings().active_plugins_file(),
+            &content,
+            self.game_settings().metrics_recorder(),
+        )?;
+
         Ok(())
     }
 }
@@ -104,12 +123,21 @@ impl ReadableLoadOrderBase for TextfileBasedLoadOrder {
     fn plugins(&self) -> &[Plugin] {
         &self.plugins
     }
+
+    fn plugin_index(&self) -> Option<&PluginIndex> {
+        Some(&self.plugin_index)
+    }
 }
 
 impl MutableLoadOrder for TextfileBasedLoadOrder {
     fn plugins_mut(&mut self) -> &mut Vec<Plugin> {
+        self.plugin_index.invalidate();
         &mut self.plugins
     }
+
+    fn plugins_and_index_mut(&mut self) -> (&mut Vec<Plugin>, Option<&mut PluginIndex>) {
+        (&mut self.plugins, Some(&mut self.plugin_index))
+    }
 }
 
 impl WritableLoadOrder for TextfileBasedLoadOrder {
@@ -117,39 +145,85 @@ impl WritableLoadOrder for TextfileBasedLoadOrder {
         &mut self.game_settings
     }
 
-    fn load(&mut self) -> Result<(), Error> {
-        self.plugins_mut().clear();
+    fn load_with_progress(&mut self, progress: &LoadProgress) -> Result<(), Error> {
+        let _timer = self.game_settings.metrics_recorder().time(Phase::Load);
+        let source_fingerprints = SourceFingerprints::new(&self.game_settings);
+        let cache = PluginCache::new(mem::take(self.plugins_mut()), &self.game_settings);
 
         let load_order_file_exists = self
             .game_settings()
             .load_order_file()
             .is_some_and(|p| p.exists());
 
-        let plugin_tuples = if load_order_file_exists {
-            self.read_from_load_order_file()?
+        let plugin_tuples: Vec<_> = if load_order_file_exists {
+            self.read_load_order_file()?
+                .plugin_names()
+                .map(|name| (name.to_owned(), false))
+                .collect()
         } else {
-            self.read_from_active_plugins_file()?
+            self.read_active_plugins_file()?
+                .plugin_names()
+                .map(|name| (name.to_owned(), true))
+                .collect()
         };
 
+        progress.check_cancelled()?;
         let paths = self.game_settings.find_plugins();
-        self.load_unique_plugins(&plugin_tuples, &paths);
+        progress.check_cancelled()?;
+
+        self.load_stats = self.load_unique_plugins(&plugin_tuples, &paths, &cache, progress);
+        progress.check_cancelled()?;
+        cache.persist(&self.game_settings, &self.plugins, self.load_stats);
 
         if load_order_file_exists {
-            load_active_plugins(self, plugin_line_mapper)?;
+            let active_plugins = self.read_active_plugins_file()?;
+            activate_listed_plugins(self, active_plugins.plugin_names())?;
         }
 
         self.add_implicitly_active_plugins()?;
 
         if self.game_settings.id().treats_master_files_differently() {
-            hoist_masters(&mut self.plugins)?;
+            let _timer = self
+                .game_settings
+                .metrics_recorder()
+                .time(Phase::HoistMasters);
+            hoist_masters(self.plugins_mut());
         }
 
+        self.source_fingerprints = source_fingerprints;
+
         Ok(())
     }
 
+    fn boxed_clone(&self) -> Box<dyn WritableLoadOrder + Send + Sync + 'static> {
+        Box::new(self.clone())
+    }
+
+    fn last_load_stats(&self) -> LoadStats {
+        self.load_stats
+    }
+
+    fn last_save_stats(&self) -> SaveStats {
+        self.save_stats
+    }
+
+    fn changes_since_load(&self) -> LoadOrderChanges {
+        self.source_fingerprints
+            .changes(&self.game_settings, &self.plugins)
+    }
+
     fn save(&mut self) -> Result<(), Error> {
+        let _timer = self.game_settings.metrics_recorder().time(Phase::Save);
+        // The plugin lists are about to be replaced.
+        self.plugin_lists = PluginListCache::default();
+
         self.save_load_order()?;
-        self.save_active_plugins()
+        self.save_active_plugins()?;
+
+        self.source_fingerprints
+            .refresh_plugin_lists(&self.game_settings);
+
+        Ok(())
     }
 
     fn add(&mut self, plugin_name: &str) -> Result<usize, Error> {
@@ -169,9 +243,14 @@ impl WritableLoadOrder for TextfileBasedLoadOrder {
     }
 
     fn is_self_consistent(&self) -> Result<bool, Error> {
-        match check_self_consistency(self.game_settings())? {
-            SelfConsistency::Inconsistent => Ok(false),
-            _ => Ok(true),
+        match read_plugin_lists_to_compare(&self.game_settings, &self.plugin_lists)? {
+            Some((load_order_plugins, active_plugins)) => Ok(listed_plugins_if_consistent(
+                self.game_settings.id(),
+                &load_order_plugins,
+                &active_plugins,
+            )
+            .is_some()),
+            None => Ok(true),
         }
     }
 
@@ -180,30 +259,39 @@ impl WritableLoadOrder for TextfileBasedLoadOrder {
     /// order to one that prefers plugins.txt) or when there are installed
     /// plugins that are not present in one or both of the text files.
     fn is_ambiguous(&self) -> Result<bool, Error> {
-        let plugin_names = match check_self_consistency(self.game_settings())? {
-            SelfConsistency::Inconsistent => {
-                return Ok(true);
-            }
-            SelfConsistency::ConsistentWithNames(plugin_names) => plugin_names,
-            SelfConsistency::ConsistentNoLoadOrderFile => read_plugin_names(
-                self.game_settings().active_plugins_file(),
-                plugin_line_mapper,
-            )?,
-            SelfConsistency::ConsistentOnlyLoadOrderFile(load_order_file) => {
-                read_utf8_plugin_names(&load_order_file, plugin_line_mapper)
-                    .or_else(|_| read_plugin_names(&load_order_file, plugin_line_mapper))?
+        let game_id = self.game_settings.id();
+        let plugin_lists = read_plugin_lists_to_compare(&self.game_settings, &self.plugin_lists)?;
+
+        let only_plugin_list;
+        let listed_plugins = if let Some((load_order_plugins, active_plugins)) = &plugin_lists {
+            match listed_plugins_if_consistent(game_id, load_order_plugins, active_plugins) {
+                Some(listed_plugins) => listed_plugins,
+                None => return Ok(true),
             }
+        } else {
+            only_plugin_list = match self.game_settings.load_order_file() {
+                Some(load_order_file) if load_order_file.exists() => self.plugin_lists.get(
+                    load_order_file,
+                    PluginListEncoding::Utf8OrWindows1252,
+                    self.game_settings.metrics_recorder(),
+                )?,
+                _ => self.plugin_lists.get(
+                    self.game_settings.active_plugins_file(),
+                    PluginListEncoding::Windows1252,
+                    self.game_settings.metrics_recorder(),
+                )?,
+            };
+
+            only_plugin_list
+                .plugin_names()
+                .map(|name| plugin_name_key(game_id, name))
+                .collect()
         };
 
-        let set: HashSet<_> = plugin_names
-            .iter()
-            .map(|name| UniCase::new(trim_dot_ghost(name, self.game_settings.id())))
-            .collect();
-
         let all_plugins_listed = self
             .plugins
             .iter()
-            .all(|plugin| set.contains(&UniCase::new(plugin.name())));
+            .all(|plugin| listed_plugins.contains(&UniCase::new(plugin.name())));
 
         Ok(!all_plugins_listed)
     }
@@ -219,103 +307,109 @@ impl WritableLoadOrder for TextfileBasedLoadOrder {
     fn set_active_plugins(&mut self, active_plugin_names: &[&str]) -> Result<(), Error> {
         set_active_plugins(self, active_plugin_names)
     }
-}
 
-pub(super) fn read_utf8_plugin_names<F, T>(
-    file_path: &Path,
-    line_mapper: F,
-) -> Result<Vec<T>, Error>
-where
-    F: Fn(&str) -> Option<T> + Send + Sync,
-    T: Send,
-{
-    if !file_path.exists() {
-        return Ok(Vec::new());
+    fn apply_batch(&mut self, operations: &[BatchOperation<'_>]) -> Result<(), Error> {
+        apply_batch(self, operations)
     }
 
-    let content = std::fs::read_to_string(file_path)
-        .map_err(|e| Error::IoError(file_path.to_path_buf(), e))?;
+    fn snapshot(&self) -> LoadOrderSnapshot {
+        snapshot(self)
+    }
 
-    Ok(content.lines().filter_map(line_mapper).collect())
-}
+    fn restore_snapshot(&mut self, snapshot: &LoadOrderSnapshot) -> Result<(), Error> {
+        restore_snapshot(self, snapshot)
+    }
 
-enum SelfConsistency {
-    ConsistentNoLoadOrderFile,
-    ConsistentOnlyLoadOrderFile(PathBuf),
-    ConsistentWithNames(Vec<String>),
-    Inconsistent,
+    fn apply_diff(&mut self, diff: &LoadOrderDiff) -> Result<(), Error> {
+        apply_diff(self, diff)
+    }
 }
 
-fn check_self_consistency(game_settings: &GameSettings) -> Result<SelfConsistency, Error> {
-    match game_settings.load_order_file() {
-        None => Ok(SelfConsistency::ConsistentNoLoadOrderFile),
-        Some(load_order_file) => {
-            if !load_order_file.exists() {
-                return Ok(SelfConsistency::ConsistentNoLoadOrderFile);
-            }
+/// The plugins listed in loadorder.txt and plugins.txt respectively.
+type PluginListsToCompare = (Arc<PluginList>, Arc<PluginList>);
+
+/// Read loadorder.txt and plugins.txt if they both exist. If either doesn't
+/// exist then there's nothing to compare and the load order is self-consistent.
+fn read_plugin_lists_to_compare(
+    game_settings: &GameSettings,
+    plugin_lists: &PluginListCache,
+) -> Result<Option<PluginListsToCompare>, Error> {
+    let Some(load_order_file) = game_settings.load_order_file() else {
+        return Ok(None);
+    };
+
+    if !load_order_file.exists() || !game_settings.active_plugins_file().exists() {
+        return Ok(None);
+    }
 
-            if !game_settings.active_plugins_file().exists() {
-                return Ok(SelfConsistency::ConsistentOnlyLoadOrderFile(
-                    load_order_file.clone(),
-                ));
-            }
+    let load_order_plugins = plugin_lists.get(
+        load_order_file,
+        PluginListEncoding::Utf8OrWindows1252,
+        game_settings.metrics_recorder(),
+    )?;
+    let active_plugins = plugin_lists.get(
+        game_settings.active_plugins_file(),
+        PluginListEncoding::Windows1252,
+        game_settings.metrics_recorder(),
+    )?;
+
+    Ok(Some((load_order_plugins, active_plugins)))
+}
 
-            // First get load order according to loadorder.txt.
-            let load_order_plugin_names =
-                read_utf8_plugin_names(load_order_file, plugin_line_mapper)
-                    .or_else(|_| read_plugin_names(load_order_file, plugin_line_mapper))?;
-
-            // Get load order from plugins.txt.
-            let active_plugin_names =
-                read_plugin_names(game_settings.active_plugins_file(), plugin_line_mapper)?;
-
-            let are_equal = load_order_plugin_names
-                .iter()
-                .filter(|l| {
-                    active_plugin_names
-                        .iter()
-                        .any(|a| plugin_names_match(game_settings.id(), a, l))
-                })
-                .zip(active_plugin_names.iter())
-                .all(|(l, a)| plugin_names_match(game_settings.id(), l, a));
-
-            if are_equal {
-                Ok(SelfConsistency::ConsistentWithNames(
-                    load_order_plugin_names,
-                ))
-            } else {
-                Ok(SelfConsistency::Inconsistent)
+/// The lists are consistent if the plugins that are listed in both are listed
+/// in the same order. If they are, returns the set of plugins listed in
+/// loadorder.txt.
+fn listed_plugins_if_consistent<'a>(
+    game_id: GameId,
+    load_order_plugins: &'a PluginList,
+    active_plugins: &PluginList,
+) -> Option<HashSet<UniCase<&'a str>>> {
+    let active_plugin_keys: Vec<_> = active_plugins
+        .plugin_names()
+        .map(|name| plugin_name_key(game_id, name))
+        .collect();
+    let active_plugin_keys_set: HashSet<_> = active_plugin_keys.iter().collect();
+
+    let mut next_active_plugin_keys = active_plugin_keys.iter();
+    let mut listed_plugins = HashSet::new();
+
+    for name in load_order_plugins.plugin_names() {
+        let key = plugin_name_key(game_id, name);
+
+        if active_plugin_keys_set.contains(&key) {
+            // Once all the active plugins have been matched, any remaining
+            // load order plugins have nothing to be compared with.
+            if let Some(active_plugin_key) = next_active_plugin_keys.next() {
+                if *active_plugin_key != key {
+                    return None;
+                }
             }
         }
-    }
-}
 
-fn load_order_line_mapper(line: &str) -> Option<(String, bool)> {
-    plugin_line_mapper(line).map(|s| (s, false))
-}
+        listed_plugins.insert(key);
+    }
 
-fn active_plugin_line_mapper(line: &str) -> Option<(String, bool)> {
-    plugin_line_mapper(line).map(|s| (s, true))
+    Some(listed_plugins)
 }
 
-fn plugin_names_match(game_id: GameId, name1: &str, name2: &str) -> bool {
-    if game_id.allow_plugin_ghosting() {
-        eq(
-            trim_dot_ghost_unchecked(name1),
-            trim_dot_ghost_unchecked(name2),
-        )
-    } else {
-        eq(name1, name2)
-    }
+/// Get the key used to compare plugin names from plugin lists: names are
+/// compared case-insensitively, and ignoring any .ghost extension if the game
+/// allows plugins to be ghosted.
+fn plugin_name_key(game_id: GameId, name: &str) -> UniCase<&str> {
+    UniCase::new(trim_dot_ghost(name, game_id))
 }
 
 #[cfg(test)]
 mod tests {
     use super::*;
 
+    use crate::load_order::plugin_index::count_active_plugins;
     use crate::load_order::tests::*;
     use crate::tests::{copy_to_test_dir, set_file_timestamps, NON_ASCII};
-    use std::fs::remove_dir_all;
+    use crate::Parallelism;
+    use std::fs::{remove_dir_all, File};
+    use std::io::Write;
+    use std::path::Path;
     use tempfile::tempdir;
 
     fn prepare(game_dir: &Path) -> TextfileBasedLoadOrder {
@@ -338,6 +432,11 @@ mod tests {
         TextfileBasedLoadOrder {
             game_settings,
             plugins,
+            plugin_index: PluginIndex::default(),
+            load_stats: LoadStats::default(),
+            save_stats: SaveStats::default(),
+            source_fingerprints: SourceFingerprints::default(),
+            plugin_lists: PluginListCache::default(),
         }
     }
 
@@ -364,6 +463,143 @@ mod tests {
         assert!(load_order.plugins()[1].is_master_file());
     }
 
+    #[test]
+    fn boxed_clone_should_return_a_copy_that_can_be_loaded_without_changing_the_original() {
+        let tmp_dir = tempdir().unwrap();
+        let load_order = prepare(tmp_dir.path());
+
+        let plugin_names = load_order.plugin_names().join(",");
+
+        copy_to_test_dir("Blank.esm", "Blank.esp", load_order.game_settings());
+        let plugin_path = load_order
+            .game_settings()
+            .plugins_directory()
+            .join("Blank.esp");
+        set_file_timestamps(&plugin_path, 0);
+
+        let mut copy = load_order.boxed_clone();
+        assert_eq!(plugin_names, copy.plugin_names().join(","));
+
+        copy.load().unwrap();
+
+        assert_eq!(plugin_names, load_order.plugin_names().join(","));
+        assert!(!load_order.plugins()[1].is_master_file());
+        assert_ne!(plugin_names, copy.plugin_names().join(","));
+    }
+
+    #[test]
+    fn load_with_progress_should_count_the_plugins_loaded() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(tmp_dir.path());
+
+        let progress = LoadProgress::new();
+        load_order.load_with_progress(&progress).unwrap();
+
+        assert_ne!(0, progress.plugins_total());
+        assert_eq!(progress.plugins_total(), progress.plugins_loaded());
+    }
+
+    #[test]
+    fn load_should_give_the_same_load_order_whatever_the_parallelism() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(tmp_dir.path());
+
+        load_order.load().unwrap();
+        let expected: Vec<_> = load_order
+            .plugin_names()
+            .into_iter()
+            .map(str::to_owned)
+            .collect();
+
+        for parallelism in [Parallelism::Serial, Parallelism::with_threads(2).unwrap()] {
+            load_order.game_settings_mut().set_parallelism(parallelism);
+            load_order.load().unwrap();
+
+            assert_eq!(expected, load_order.plugin_names());
+        }
+    }
+
+    #[test]
+    fn load_with_progress_should_error_if_cancelled() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(tmp_dir.path());
+
+        let progress = LoadProgress::new();
+        progress.cancel();
+
+        assert!(matches!(
+            load_order.load_with_progress(&progress),
+            Err(Error::LoadCancelled)
+        ));
+        assert_eq!(0, progress.plugins_loaded());
+    }
+
+    #[test]
+    fn changes_since_load_should_only_include_changes_not_made_by_the_load_order() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(tmp_dir.path());
+
+        assert!(!load_order.changes_since_load().is_empty());
+
+        load_order.load().unwrap();
+        assert!(load_order.changes_since_load().is_empty());
+
+        load_order.save().unwrap();
+        assert!(load_order.changes_since_load().is_empty());
+
+        copy_to_test_dir("Blank.esm", "Blank.esp", load_order.game_settings());
+
+        let changes = load_order.changes_since_load();
+        assert_eq!(vec!["Blank.esp"], changes.changed_plugins);
+        assert!(!changes.plugin_lists_changed);
+    }
+
+    #[test]
+    fn changes_since_load_should_include_the_plugins_directory_if_a_plugin_was_unghosted() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(tmp_dir.path());
+
+        copy_to_test_dir(
+            "Blank.esp",
+            "Blank - Ghosted.esp.ghost",
+            load_order.game_settings(),
+        );
+        load_order.load().unwrap();
+        assert!(load_order.changes_since_load().is_empty());
+
+        WritableLoadOrder::activate(&mut load_order, "Blank - Ghosted.esp").unwrap();
+        load_order.save().unwrap();
+
+        let changes = load_order.changes_since_load();
+        assert!(changes.plugins_directories_changed);
+        assert!(!changes.plugin_lists_changed);
+        assert!(changes.changed_plugins.is_empty());
+    }
+
+    #[test]
+    fn load_should_reuse_plugins_that_are_unchanged_since_the_last_load() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(tmp_dir.path());
+
+        load_order.load().unwrap();
+
+        let stats = load_order.last_load_stats();
+        assert_eq!(2, stats.reused);
+        assert_eq!(load_order.plugins().len() - 2, stats.parsed);
+
+        copy_to_test_dir("Blank.esm", "Blank.esp", load_order.game_settings());
+
+        load_order.load().unwrap();
+
+        let stats = load_order.last_load_stats();
+        assert_eq!(load_order.plugins().len() - 1, stats.reused);
+        assert_eq!(1, stats.parsed);
+        assert!(load_order
+            .find_plugin("Blank.esp")
+            .unwrap()
+            .is_master_file());
+    }
+
     #[test]
     fn load_should_remove_plugins_that_fail_to_load() {
         let tmp_dir = tempdir().unwrap();
@@ -691,11 +927,13 @@ mod tests {
         load_order.save().unwrap();
 
         let expected_filenames = vec!["Blank.esp", "Blank - Different.esp"];
-        let plugin_names = read_utf8_plugin_names(
+        let plugin_list = PluginList::read(
             load_order.game_settings().load_order_file().unwrap(),
-            plugin_line_mapper,
+            PluginListEncoding::Utf8OrWindows1252,
+            load_order.game_settings().metrics_recorder(),
         )
         .unwrap();
+        let plugin_names: Vec<_> = plugin_list.plugin_names().collect();
         assert_eq!(expected_filenames, plugin_names);
     }
 
@@ -746,7 +984,9 @@ mod tests {
             load_order.game_settings(),
         );
         let mut plugin = Plugin::new(filename, load_order.game_settings()).unwrap();
-        plugin.activate().unwrap();
+        plugin
+            .activate(load_order.game_settings().metrics_recorder())
+            .unwrap();
         load_order.plugins_mut().push(plugin);
 
         match load_order.save().unwrap_err() {
@@ -807,6 +1047,27 @@ mod tests {
         assert!(load_order.is_self_consistent().unwrap());
     }
 
+    #[test]
+    fn is_self_consistent_should_ignore_case_ghost_extensions_and_plugins_not_in_both_files() {
+        let tmp_dir = tempdir().unwrap();
+        let load_order = prepare(tmp_dir.path());
+
+        write_active_plugins_file(
+            load_order.game_settings(),
+            &["blank.esm", "Blank.esp.ghost", "missing.esp"],
+        );
+
+        let filenames = vec![
+            "Skyrim.esm",
+            "Blank.esm.ghost",
+            "Blank - Different.esp",
+            "BLANK.ESP",
+        ];
+        write_load_order_file(load_order.game_settings(), &filenames);
+
+        assert!(load_order.is_self_consistent().unwrap());
+    }
+
     #[test]
     fn is_self_consistent_should_read_load_order_file_as_windows_1252_if_not_utf8() {
         let tmp_dir = tempdir().unwrap();
@@ -988,4 +1249,105 @@ mod tests {
 
         assert!(!load_order.is_ambiguous().unwrap());
     }
+
+    #[test]
+    fn index_of_should_stay_correct_as_plugins_are_added_moved_and_removed() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(tmp_dir.path());
+
+        assert_eq!(Some(0), load_order.index_of("Blank.esp"));
+        assert_eq!(Some(1), load_order.index_of("Blank - Different.esp"));
+
+        assert_eq!(
+            0,
+            WritableLoadOrder::add(&mut load_order, "Blank.esm").unwrap()
+        );
+        assert_eq!(Some(0), load_order.index_of("blank.esm"));
+        assert_eq!(Some(1), load_order.index_of("blank.esp"));
+        assert_eq!(Some(2), load_order.index_of("blank - different.esp"));
+
+        WritableLoadOrder::set_plugin_index(&mut load_order, "Blank - Different.esp", 1).unwrap();
+        assert_eq!(Some(1), load_order.index_of("Blank - Different.esp"));
+        assert_eq!(Some(2), load_order.index_of("Blank.esp"));
+
+        std::fs::remove_file(
+            load_order
+                .game_settings()
+                .plugins_directory()
+                .join("Blank - Different.esp"),
+        )
+        .unwrap();
+        WritableLoadOrder::remove(&mut load_order, "Blank - Different.esp").unwrap();
+        assert_eq!(None, load_order.index_of("Blank - Different.esp"));
+        assert_eq!(Some(1), load_order.index_of("Blank.esp"));
+        assert!(load_order.is_active("Blank.esp"));
+    }
+
+    #[test]
+    fn active_plugin_counts_should_stay_correct_as_plugins_are_activated_and_deactivated() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(tmp_dir.path());
+
+        let assert_full_count = |load_order: &TextfileBasedLoadOrder, count: usize| {
+            assert_eq!(count, load_order.active_plugin_counts().full);
+            assert_eq!(
+                count_active_plugins(load_order.plugins()),
+                load_order.active_plugin_counts()
+            );
+        };
+
+        assert_full_count(&load_order, 1);
+
+        WritableLoadOrder::activate(&mut load_order, "Blank - Different.esp").unwrap();
+        assert_full_count(&load_order, 2);
+
+        WritableLoadOrder::deactivate(&mut load_order, "Blank.esp").unwrap();
+        assert_full_count(&load_order, 1);
+
+        WritableLoadOrder::add(&mut load_order, "Blank.esm").unwrap();
+        WritableLoadOrder::set_active_plugins(&mut load_order, &["Blank.esm", "Blank.esp"])
+            .unwrap();
+        assert_full_count(&load_order, 2);
+
+        std::fs::remove_file(
+            load_order
+                .game_settings()
+                .plugins_directory()
+                .join("Blank.esp"),
+        )
+        .unwrap();
+        WritableLoadOrder::remove(&mut load_order, "Blank.esp").unwrap();
+        assert_full_count(&load_order, 1);
+    }
+
+    #[test]
+    fn set_active_plugins_should_unghost_ghosted_plugins_whatever_the_parallelism() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(tmp_dir.path());
+        load_order
+            .game_settings_mut()
+            .set_parallelism(Parallelism::with_threads(2).unwrap());
+
+        let plugin_names: Vec<_> = (0..8).map(|i| format!("Blank - Ghosted {i}.esp")).collect();
+        for name in &plugin_names {
+            copy_to_test_dir(
+                "Blank.esp",
+                &format!("{name}.ghost"),
+                load_order.game_settings(),
+            );
+            let plugin = Plugin::new(name, load_order.game_settings()).unwrap();
+            load_order.plugins_mut().push(plugin);
+        }
+
+        let active_plugin_names: Vec<_> = plugin_names.iter().map(String::as_str).collect();
+        WritableLoadOrder::set_active_plugins(&mut load_order, &active_plugin_names).unwrap();
+
+        let plugins_dir = load_order.game_settings().plugins_directory();
+        for name in &plugin_names {
+            assert!(load_order.is_active(name));
+            assert!(plugins_dir.join(name).exists());
+            assert!(!plugins_dir.join(format!("{name}.ghost")).exists());
+        }
+        assert_eq!(8, load_order.active_plugin_counts().full);
+    }
 }
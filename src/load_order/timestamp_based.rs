@@ -19,23 +19,33 @@
 use std::cmp::Ordering;
 use std::collections::HashSet;
 use std::fs::File;
-use std::io::{BufRead, BufReader, BufWriter, Write};
-use std::path::PathBuf;
+use std::io::{BufRead, BufReader};
+use std::mem;
 use std::sync::LazyLock;
 use std::time::{Duration, SystemTime, UNIX_EPOCH};
 
-use rayon::prelude::*;
 use regex::Regex;
 use unicase::UniCase;
 
+use super::diff::LoadOrderDiff;
+use super::load_progress::LoadProgress;
 use super::mutable::{hoist_masters, load_active_plugins, MutableLoadOrder};
+use super::plugin_cache::{InstalledFiles, LoadStats, PluginCache};
+use super::plugin_index::PluginIndex;
 use super::readable::{ReadableLoadOrder, ReadableLoadOrderBase};
+use super::source_fingerprints::{LoadOrderChanges, SourceFingerprints};
 use super::strict_encode;
 use super::writable::{
-    activate, add, create_parent_dirs, deactivate, remove, set_active_plugins, WritableLoadOrder,
+    activate, add, apply_batch, apply_diff, deactivate, remove, restore_snapshot,
+    set_active_plugins, snapshot, write_file_if_changed, BatchOperation, LoadOrderSnapshot,
+    SaveStats, WritableLoadOrder,
 };
 use crate::enums::{Error, GameId};
-use crate::game_settings::GameSettings;
+use crate::game_settings::{GameSettings, PluginFile};
+use crate::metrics::Phase;
+use crate::parallelism::{
+    MIN_PARALLEL_FILE_READS, MIN_PARALLEL_METADATA_OPERATIONS, MIN_PARALLEL_SORT_LEN,
+};
 use crate::plugin::{trim_dot_ghost, Plugin};
 
 const GAME_FILES_HEADER: &[u8] = b"[Game Files]";
@@ -44,15 +54,19 @@ const GAME_FILES_HEADER: &[u8] = b"[Game Files]";
 pub(crate) struct TimestampBasedLoadOrder {
     game_settings: GameSettings,
     plugins: Vec<Plugin>,
+    plugin_index: PluginIndex,
+    load_stats: LoadStats,
+    save_stats: SaveStats,
+    source_fingerprints: SourceFingerprints,
 }
 
 /// Retains the first occurrence for each unique filename that is valid Unicode.
-fn get_unique_filenames(file_paths: &[PathBuf], game_id: GameId) -> Vec<String> {
+fn get_unique_filenames(plugin_files: &[PluginFile], game_id: GameId) -> Vec<String> {
     let mut set = HashSet::new();
 
-    file_paths
+    plugin_files
         .iter()
-        .filter_map(|p| p.file_name().and_then(|n| n.to_str()))
+        .filter_map(|f| f.path.file_name().and_then(|n| n.to_str()))
         .filter(|n| set.insert(UniCase::new(trim_dot_ghost(n, game_id))))
         .map(ToOwned::to_owned)
         .collect()
@@ -63,41 +77,65 @@ impl TimestampBasedLoadOrder {
         Self {
             game_settings,
             plugins: Vec::new(),
+            plugin_index: PluginIndex::default(),
+            load_stats: LoadStats::default(),
+            save_stats: SaveStats::default(),
+            source_fingerprints: SourceFingerprints::default(),
         }
     }
 
-    fn load_plugins_from_dir(&self) -> Vec<Plugin> {
+    fn load_plugins_from_dir(
+        &self,
+        cache: &PluginCache,
+        progress: &LoadProgress,
+    ) -> (Vec<Plugin>, LoadStats) {
         let paths = self.game_settings.find_plugins();
 
         let filenames = get_unique_filenames(&paths, self.game_settings.id());
+        let installed_files = InstalledFiles::new(&paths);
+
+        if progress.is_cancelled() {
+            return (Vec::new(), LoadStats::default());
+        }
+        progress.start_loading_plugins(filenames.len());
+
+        let loaded: Vec<_> =
+            self.game_settings
+                .parallelism()
+                .filter_map(&filenames, MIN_PARALLEL_FILE_READS, |f| {
+                    if progress.is_cancelled() {
+                        return None;
+                    }
+
+                    let loaded = cache
+                        .load(f, &self.game_settings, false, &installed_files)
+                        .ok();
+                    progress.plugin_loaded();
+                    loaded
+                });
 
-        filenames
-            .par_iter()
-            .filter_map(|f| Plugin::new(f, &self.game_settings).ok())
-            .collect()
+        let stats = LoadStats::count(&loaded);
+
+        (loaded.into_iter().map(|(p, _)| p).collect(), stats)
     }
 
     fn save_active_plugins(&mut self) -> Result<(), Error> {
-        let path = self.game_settings().active_plugins_file();
-        create_parent_dirs(path)?;
-
-        let prelude = get_file_prelude(self.game_settings())?;
+        let mut content = get_file_prelude(self.game_settings())?;
 
-        let file = File::create(path).map_err(|e| Error::IoError(path.clone(), e))?;
-        let mut writer = BufWriter::new(file);
-        writer
-            .write_all(&prelude)
-            .map_err(|e| Error::IoError(path.clone(), e))?;
         for (index, plugin_name) in self.active_plugin_names().iter().enumerate() {
             if self.game_settings().id() == GameId::Morrowind {
-                write!(writer, "GameFile{index}=").map_err(|e| Error::IoError(path.clone(), e))?;
+                content.extend_from_slice(format!("GameFile{index}=").as_bytes());
             }
-            writer
-                .write_all(&strict_encode(plugin_name)?)
-                .map_err(|e| Error::IoError(path.clone(), e))?;
-            writeln!(writer).map_err(|e| Error::IoError(path.clone(), e))?;
+            content.extend_from_slice(&strict_encode(plugin_name)?);
+            content.push(b'\n');
         }
 
+        write_file_if_changed(
+            self.game_settings().active_plugins_file(),
+            &content,
+            self.game_settings().metrics_recorder(),
+        )?;
+
         Ok(())
     }
 }
@@ -110,12 +148,21 @@ impl ReadableLoadOrderBase for TimestampBasedLoadOrder {
     fn plugins(&self) -> &[Plugin] {
         &self.plugins
     }
+
+    fn plugin_index(&self) -> Option<&PluginIndex> {
+        Some(&self.plugin_index)
+    }
 }
 
 impl MutableLoadOrder for TimestampBasedLoadOrder {
     fn plugins_mut(&mut self) -> &mut Vec<Plugin> {
+        self.plugin_index.invalidate();
         &mut self.plugins
     }
+
+    fn plugins_and_index_mut(&mut self) -> (&mut Vec<Plugin>, Option<&mut PluginIndex>) {
+        (&mut self.plugins, Some(&mut self.plugin_index))
+    }
 }
 
 impl WritableLoadOrder for TimestampBasedLoadOrder {
@@ -123,11 +170,17 @@ impl WritableLoadOrder for TimestampBasedLoadOrder {
         &mut self.game_settings
     }
 
-    fn load(&mut self) -> Result<(), Error> {
-        self.plugins_mut().clear();
-
-        self.plugins = self.load_plugins_from_dir();
-        self.plugins.par_sort_by(plugin_sorter);
+    fn load_with_progress(&mut self, progress: &LoadProgress) -> Result<(), Error> {
+        let _timer = self.game_settings.metrics_recorder().time(Phase::Load);
+        let source_fingerprints = SourceFingerprints::new(&self.game_settings);
+        let cache = PluginCache::new(mem::take(self.plugins_mut()), &self.game_settings);
+        let (plugins, stats) = self.load_plugins_from_dir(&cache, progress);
+        progress.check_cancelled()?;
+        *self.plugins_mut() = plugins;
+        self.load_stats = stats;
+        cache.persist(&self.game_settings, &self.plugins, self.load_stats);
+        let parallelism = self.game_settings.parallelism().clone();
+        parallelism.sort_by(self.plugins_mut(), MIN_PARALLEL_SORT_LEN, plugin_sorter);
 
         let game_id = self.game_settings().id();
         let line_mapper = |line: &str| plugin_line_mapper(line, game_id);
@@ -136,15 +189,47 @@ impl WritableLoadOrder for TimestampBasedLoadOrder {
 
         self.add_implicitly_active_plugins()?;
 
-        hoist_masters(&mut self.plugins)?;
+        let timer = self
+            .game_settings
+            .metrics_recorder()
+            .time(Phase::HoistMasters);
+        hoist_masters(self.plugins_mut());
+        drop(timer);
+
+        self.source_fingerprints = source_fingerprints;
 
         Ok(())
     }
 
+    fn boxed_clone(&self) -> Box<dyn WritableLoadOrder + Send + Sync + 'static> {
+        Box::new(self.clone())
+    }
+
+    fn last_load_stats(&self) -> LoadStats {
+        self.load_stats
+    }
+
+    fn last_save_stats(&self) -> SaveStats {
+        self.save_stats
+    }
+
+    fn changes_since_load(&self) -> LoadOrderChanges {
+        self.source_fingerprints
+            .changes(&self.game_settings, &self.plugins)
+    }
+
     fn save(&mut self) -> Result<(), Error> {
-        save_load_order_using_timestamps(self)?;
+        let _timer = self.game_settings.metrics_recorder().time(Phase::Save);
+        self.save_stats = SaveStats {
+            timestamps_written: save_load_order_using_timestamps(self)?,
+        };
+
+        self.save_active_plugins()?;
 
-        self.save_active_plugins()
+        self.source_fingerprints
+            .refresh_plugin_lists(&self.game_settings);
+
+        Ok(())
     }
 
     fn add(&mut self, plugin_name: &str) -> Result<usize, Error> {
@@ -184,20 +269,52 @@ impl WritableLoadOrder for TimestampBasedLoadOrder {
     fn set_active_plugins(&mut self, active_plugin_names: &[&str]) -> Result<(), Error> {
         set_active_plugins(self, active_plugin_names)
     }
+
+    fn apply_batch(&mut self, operations: &[BatchOperation<'_>]) -> Result<(), Error> {
+        apply_batch(self, operations)
+    }
+
+    fn snapshot(&self) -> LoadOrderSnapshot {
+        snapshot(self)
+    }
+
+    fn restore_snapshot(&mut self, snapshot: &LoadOrderSnapshot) -> Result<(), Error> {
+        restore_snapshot(self, snapshot)
+    }
+
+    fn apply_diff(&mut self, diff: &LoadOrderDiff) -> Result<(), Error> {
+        apply_diff(self, diff)
+    }
 }
 
+/// Set plugin timestamps so that sorting by timestamp gives the current load
+/// order, only writing to the files that don't already have the right
+/// timestamp. Returns the number of files that were written to.
 pub(super) fn save_load_order_using_timestamps<T: MutableLoadOrder>(
     load_order: &mut T,
-) -> Result<(), Error> {
+) -> Result<usize, Error> {
+    let _timer = load_order
+        .game_settings()
+        .metrics_recorder()
+        .time(Phase::SaveTimestamps);
     let timestamps = padded_unique_timestamps(load_order.plugins());
+    let parallelism = load_order.game_settings().parallelism().clone();
+
+    // Only the plugins' timestamps change, so the index remains valid.
+    let written = parallelism.zip_map_mut::<_, _, _, Result<Vec<_>, Error>, _>(
+        load_order.plugins_and_index_mut().0,
+        timestamps,
+        MIN_PARALLEL_METADATA_OPERATIONS,
+        Plugin::set_modification_time_if_changed,
+    )?;
 
+    let written = written.into_iter().filter(|w| *w).count();
     load_order
-        .plugins_mut()
-        .par_iter_mut()
-        .zip(timestamps.into_par_iter())
-        .map(|(ref mut plugin, timestamp)| plugin.set_modification_time(timestamp))
-        .collect::<Result<Vec<_>, Error>>()
-        .map(|_| ())
+        .game_settings()
+        .metrics_recorder()
+        .add_files_written(written);
+
+    Ok(written)
 }
 
 fn plugin_sorter(a: &Plugin, b: &Plugin) -> Ordering {
@@ -281,7 +398,7 @@ mod tests {
     use crate::load_order::tests::*;
     use crate::tests::{copy_to_test_dir, set_file_timestamps, set_timestamps, NON_ASCII};
     use std::fs::remove_dir_all;
-    use std::io::Read;
+    use std::io::{Read, Write};
     use std::path::Path;
     use tempfile::tempdir;
 
@@ -297,6 +414,10 @@ mod tests {
         TimestampBasedLoadOrder {
             game_settings,
             plugins,
+            plugin_index: PluginIndex::default(),
+            load_stats: LoadStats::default(),
+            save_stats: SaveStats::default(),
+            source_fingerprints: SourceFingerprints::default(),
         }
     }
 
@@ -305,6 +426,21 @@ mod tests {
         writeln!(file).unwrap();
     }
 
+    #[test]
+    fn load_with_progress_should_error_without_loading_plugins_if_cancelled() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Oblivion, tmp_dir.path());
+
+        let progress = LoadProgress::new();
+        progress.cancel();
+
+        assert!(matches!(
+            load_order.load_with_progress(&progress),
+            Err(Error::LoadCancelled)
+        ));
+        assert_eq!(0, progress.plugins_total());
+    }
+
     #[test]
     fn load_should_reload_existing_plugins() {
         let tmp_dir = tempdir().unwrap();
@@ -323,6 +459,30 @@ mod tests {
         assert!(load_order.plugins()[1].is_master_file());
     }
 
+    #[test]
+    fn load_should_reuse_plugins_that_are_unchanged_since_the_last_load() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Oblivion, tmp_dir.path());
+
+        load_order.load().unwrap();
+
+        let stats = load_order.last_load_stats();
+        assert_eq!(2, stats.reused);
+        assert_eq!(load_order.plugins().len() - 2, stats.parsed);
+
+        copy_to_test_dir("Blank.esm", "Blank.esp", load_order.game_settings());
+
+        load_order.load().unwrap();
+
+        let stats = load_order.last_load_stats();
+        assert_eq!(load_order.plugins().len() - 1, stats.reused);
+        assert_eq!(1, stats.parsed);
+        assert!(load_order
+            .find_plugin("Blank.esp")
+            .unwrap()
+            .is_master_file());
+    }
+
     #[test]
     fn load_should_remove_plugins_that_fail_to_load() {
         let tmp_dir = tempdir().unwrap();
@@ -518,6 +678,27 @@ mod tests {
         assert_eq!(expected_filenames, load_order.active_plugin_names());
     }
 
+    #[test]
+    fn save_should_only_write_timestamps_that_need_to_change() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Oblivion, tmp_dir.path());
+
+        load_order.load().unwrap();
+        load_order.save().unwrap();
+
+        load_order.save().unwrap();
+        assert_eq!(0, load_order.last_save_stats().timestamps_written);
+
+        let last_index = load_order.plugins().len() - 1;
+        let last_plugin = load_order.plugin_at(last_index).unwrap().to_owned();
+        WritableLoadOrder::set_plugin_index(&mut load_order, &last_plugin, last_index - 1).unwrap();
+        load_order.save().unwrap();
+        assert_eq!(2, load_order.last_save_stats().timestamps_written);
+
+        load_order.load().unwrap();
+        assert_eq!(last_index - 1, load_order.index_of(&last_plugin).unwrap());
+    }
+
     #[test]
     fn save_should_preserve_the_existing_set_of_timestamps() {
         let tmp_dir = tempdir().unwrap();
@@ -662,7 +843,9 @@ mod tests {
             load_order.game_settings(),
         );
         let mut plugin = Plugin::new(filename, load_order.game_settings()).unwrap();
-        plugin.activate().unwrap();
+        plugin
+            .activate(load_order.game_settings().metrics_recorder())
+            .unwrap();
         load_order.plugins_mut().push(plugin);
 
         match load_order.save().unwrap_err() {
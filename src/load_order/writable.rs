@@ -16,15 +16,23 @@
  * You should have received a copy of the GNU General Public License
  * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
  */
-use std::collections::HashSet;
-use std::fs::create_dir_all;
-use std::path::Path;
+use std::collections::{HashMap, HashSet};
+use std::ffi::OsString;
+use std::fs::{create_dir_all, read, remove_file, rename, write};
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicUsize, Ordering};
 
 use unicase::{eq, UniCase};
 
-use super::mutable::MutableLoadOrder;
+use super::diff::LoadOrderDiff;
+use super::load_progress::LoadProgress;
+use super::mutable::{validate_load_order, MutableLoadOrder};
+use super::plugin_cache::LoadStats;
+use super::plugin_index::PluginCounts;
 use super::readable::{ReadableLoadOrder, ReadableLoadOrderBase};
-use crate::enums::Error;
+use super::source_fingerprints::LoadOrderChanges;
+use crate::enums::{Error, GameId};
+use crate::metrics::{MetricsRecorder, Phase};
 use crate::plugin::Plugin;
 use crate::GameSettings;
 
@@ -34,10 +42,36 @@ const MAX_ACTIVE_MEDIUM_PLUGINS: usize = 256;
 pub trait WritableLoadOrder: ReadableLoadOrder + std::fmt::Debug {
     fn game_settings_mut(&mut self) -> &mut GameSettings;
 
-    fn load(&mut self) -> Result<(), Error>;
+    fn load(&mut self) -> Result<(), Error> {
+        self.load_with_progress(&LoadProgress::new())
+    }
+
+    /// Load in the same way as `load()`, while reporting progress to and
+    /// checking for cancellation through the given `LoadProgress`. If the load
+    /// is cancelled it fails with `Error::LoadCancelled` and leaves the load
+    /// order incomplete, so it must be loaded again before it's used.
+    fn load_with_progress(&mut self, progress: &LoadProgress) -> Result<(), Error>;
+
+    /// Get a copy of this load order. The copy can then be loaded while this
+    /// load order continues to be used, e.g. by other threads.
+    fn boxed_clone(&self) -> Box<dyn WritableLoadOrder + Send + Sync + 'static>;
+
+    /// Get counts of the plugins that were reused and parsed during the last
+    /// call to `load()`.
+    fn last_load_stats(&self) -> LoadStats;
+
+    /// Check which of the files that the load order was read from have changed
+    /// since it was last loaded, without reading the files. Changes to the
+    /// plugin lists that are made by calling `save()` are not included, but
+    /// unghosting plugins to activate them changes their plugins directory.
+    fn changes_since_load(&self) -> LoadOrderChanges;
 
     fn save(&mut self) -> Result<(), Error>;
 
+    /// Get counts of the changes that were written during the last call to
+    /// `save()`.
+    fn last_save_stats(&self) -> SaveStats;
+
     fn add(&mut self, plugin_name: &str) -> Result<usize, Error>;
 
     fn remove(&mut self, plugin_name: &str) -> Result<(), Error>;
@@ -55,6 +89,102 @@ pub trait WritableLoadOrder: ReadableLoadOrder + std::fmt::Debug {
     fn deactivate(&mut self, plugin_name: &str) -> Result<(), Error>;
 
     fn set_active_plugins(&mut self, active_plugin_names: &[&str]) -> Result<(), Error>;
+
+    /// Apply all the given operations, validating the result once at the
+    /// end. If any operation fails or the result is invalid, the load order
+    /// is left unchanged.
+    fn apply_batch(&mut self, operations: &[BatchOperation<'_>]) -> Result<(), Error>;
+
+    /// Get a snapshot of the current load order and active plugins, which can
+    /// later be restored without reading any files.
+    fn snapshot(&self) -> LoadOrderSnapshot;
+
+    /// Replace the current load order and active plugins with those in the
+    /// given snapshot, if they're valid, without reading or writing any files.
+    /// Call `save()` to write them.
+    ///
+    /// The snapshot must have been taken of a load order for the same game and
+    /// plugins directory. Its order and active states are applied to the
+    /// plugins that are currently in the load order: plugins that have been
+    /// added since are not kept, and plugins that have been removed since are
+    /// not restored. Any ghosted plugins that are restored as active are
+    /// unghosted.
+    fn restore_snapshot(&mut self, snapshot: &LoadOrderSnapshot) -> Result<(), Error>;
+
+    /// Apply the given changes, validating the result once at the end. If any
+    /// change fails or the result is invalid, the load order is left
+    /// unchanged. Only the plugins that are added are read.
+    fn apply_diff(&mut self, diff: &LoadOrderDiff) -> Result<(), Error>;
+
+    /// Set the load order and active plugins by applying only the changes
+    /// that are needed to get from the current state to the given one, and
+    /// return those changes. The result is the same as calling
+    /// `set_load_order()` and then `set_active_plugins()`, except that the
+    /// load order is only validated once and is left unchanged on error.
+    fn set_load_order_incremental(
+        &mut self,
+        plugin_names: &[&str],
+        active_plugin_names: &[&str],
+    ) -> Result<LoadOrderDiff, Error> {
+        let diff = self.diff_load_order(plugin_names, active_plugin_names)?;
+        self.apply_diff(&diff)?;
+        Ok(diff)
+    }
+}
+
+/// Counts of the changes that were written during the last call to
+/// `WritableLoadOrder::save()`.
+#[derive(Clone, Copy, Debug, Default, Eq, PartialEq, Hash)]
+pub struct SaveStats {
+    /// The number of plugin files that had their modification times written.
+    /// Plugins with files that already had the right modification time are
+    /// not written to.
+    pub timestamps_written: usize,
+}
+
+/// A copy of a load order's plugins and their active states, as returned by
+/// [`WritableLoadOrder::snapshot`].
+///
+/// Snapshots share their plugins' parsed data with the load order that they
+/// were taken of, so they're cheap to take and to restore.
+#[derive(Clone, Debug, Eq, PartialEq, Hash)]
+pub struct LoadOrderSnapshot {
+    game_id: GameId,
+    plugins_directory: PathBuf,
+    plugins: Vec<Plugin>,
+}
+
+impl LoadOrderSnapshot {
+    /// The names of the plugins in the snapshot, in load order.
+    pub fn plugin_names(&self) -> Vec<&str> {
+        self.plugins.iter().map(Plugin::name).collect()
+    }
+
+    /// The names of the active plugins in the snapshot, in load order.
+    pub fn active_plugin_names(&self) -> Vec<&str> {
+        self.plugins
+            .iter()
+            .filter(|p| p.is_active())
+            .map(Plugin::name)
+            .collect()
+    }
+}
+
+/// A change to make to a load order as part of a batch.
+///
+/// The plugin moves in a batch are made in the order they're given, then
+/// plugins are activated and deactivated: if the same plugin is activated or
+/// deactivated more than once, the last operation takes precedence.
+#[derive(Clone, Copy, Debug, Eq, PartialEq, Hash)]
+#[non_exhaustive]
+pub enum BatchOperation<'a> {
+    /// Move the named plugin to the given position, adding it to the load
+    /// order if it's not already present. As with
+    /// [`WritableLoadOrder::set_plugin_index`], a position past the end of
+    /// the load order appends the plugin.
+    SetPosition(&'a str, usize),
+    Activate(&'a str),
+    Deactivate(&'a str),
 }
 
 pub(super) fn add<T: MutableLoadOrder>(
@@ -66,15 +196,14 @@ pub(super) fn add<T: MutableLoadOrder>(
     } else {
         let plugin = Plugin::new(plugin_name, load_order.game_settings())?;
 
-        if let Some(position) = load_order.insert_position(&plugin) {
-            load_order.validate_index(&plugin, position)?;
-            load_order.plugins_mut().insert(position, plugin);
-            Ok(position)
-        } else {
-            load_order.validate_index(&plugin, load_order.plugins().len())?;
-            load_order.plugins_mut().push(plugin);
-            Ok(load_order.plugins().len() - 1)
-        }
+        let position = load_order
+            .insert_position(&plugin)
+            .unwrap_or(load_order.plugins().len());
+
+        load_order.validate_index(&plugin, position)?;
+        load_order.insert_plugin(position, plugin);
+
+        Ok(position)
     }
 }
 
@@ -101,23 +230,20 @@ pub(super) fn remove<T: MutableLoadOrder>(
                     .find(|p| p.is_master_file());
 
                 if let Some(next_master) = next_master {
-                    let next_master_masters = next_master.masters()?;
-                    let next_master_master_names: HashSet<_> =
-                        next_master_masters.iter().map(UniCase::new).collect();
-
-                    let mut masters = plugin.masters()?;
-
-                    // Remove any masters that are also masters of the next master plugin.
-                    masters.retain(|m| !next_master_master_names.contains(&UniCase::new(m)));
-
-                    // Finally, check if any remaining masters are non-master plugins.
-                    if let Some(n) = masters.iter().find(|n| {
-                        load_order
-                            .find_plugin(n)
-                            // If the master isn't installed, assume it's a master file and so
-                            // doesn't prevent removal of the target plugin.
-                            .is_some_and(|p| !p.is_master_file())
-                    }) {
+                    // Ignore any masters that are also masters of the next master plugin, then
+                    // check if any remaining masters are non-master plugins.
+                    if let Some(n) = plugin
+                        .masters()
+                        .iter()
+                        .filter(|m| !next_master.has_master(m))
+                        .find(|n| {
+                            load_order
+                                .find_plugin(n)
+                                // If the master isn't installed, assume it's a master file and so
+                                // doesn't prevent removal of the target plugin.
+                                .is_some_and(|p| !p.is_master_file())
+                        })
+                    {
                         return Err(Error::NonMasterBeforeMaster {
                             master: plugin_name.to_owned(),
                             non_master: n.to_owned(),
@@ -126,7 +252,7 @@ pub(super) fn remove<T: MutableLoadOrder>(
                 }
             }
 
-            load_order.plugins_mut().remove(index);
+            load_order.remove_plugin(index);
 
             Ok(())
         }
@@ -134,35 +260,6 @@ pub(super) fn remove<T: MutableLoadOrder>(
     }
 }
 
-#[derive(Clone, Copy, Debug, Default, Eq, PartialEq, Ord, PartialOrd, Hash)]
-struct PluginCounts {
-    light: usize,
-    medium: usize,
-    full: usize,
-}
-
-impl PluginCounts {
-    fn count_plugin(&mut self, plugin: &Plugin) {
-        if plugin.is_light_plugin() {
-            self.light += 1;
-        } else if plugin.is_medium_plugin() {
-            self.medium += 1;
-        } else {
-            self.full += 1;
-        }
-    }
-}
-
-fn count_active_plugins<T: ReadableLoadOrderBase>(load_order: &T) -> PluginCounts {
-    let mut counts = PluginCounts::default();
-
-    for plugin in load_order.plugins().iter().filter(|p| p.is_active()) {
-        counts.count_plugin(plugin);
-    }
-
-    counts
-}
-
 fn count_plugins(existing_plugins: &[Plugin], existing_plugin_indexes: &[usize]) -> PluginCounts {
     let mut counts = PluginCounts::default();
 
@@ -179,10 +276,11 @@ pub(super) fn activate<T: MutableLoadOrder>(
     load_order: &mut T,
     plugin_name: &str,
 ) -> Result<(), Error> {
-    let counts = count_active_plugins(load_order);
-    let max_active_full_plugins = load_order.max_active_full_plugins();
+    let counts = load_order.active_plugin_counts();
+    let max_active_full_plugins =
+        load_order.full_plugins_limit(counts.light > 0, counts.medium > 0);
 
-    let Some(plugin) = load_order.find_plugin_mut(plugin_name) else {
+    let Some((index, plugin)) = load_order.find_plugin_and_index(plugin_name) else {
         return Err(Error::PluginNotFound(plugin_name.to_owned()));
     };
 
@@ -202,7 +300,7 @@ pub(super) fn activate<T: MutableLoadOrder>(
             });
         }
 
-        plugin.activate()?;
+        load_order.activate_plugin_at(index)?;
     }
 
     Ok(())
@@ -216,10 +314,13 @@ pub(super) fn deactivate<T: MutableLoadOrder>(
         return Err(Error::ImplicitlyActivePlugin(plugin_name.to_owned()));
     }
 
-    load_order
-        .find_plugin_mut(plugin_name)
-        .ok_or_else(|| Error::PluginNotFound(plugin_name.to_owned()))
-        .map(Plugin::deactivate)
+    let Some((index, _)) = load_order.find_plugin_and_index(plugin_name) else {
+        return Err(Error::PluginNotFound(plugin_name.to_owned()));
+    };
+
+    load_order.deactivate_plugin_at(index);
+
+    Ok(())
 }
 
 pub(super) fn set_active_plugins<T: MutableLoadOrder>(
@@ -253,15 +354,339 @@ pub(super) fn set_active_plugins<T: MutableLoadOrder>(
 
     load_order.deactivate_all();
 
-    for index in existing_plugin_indices {
-        if let Some(plugin) = load_order.plugins_mut().get_mut(index) {
-            plugin.activate()?;
+    load_order.activate_plugins_at(&existing_plugin_indices)
+}
+
+pub(super) fn apply_batch<T: MutableLoadOrder>(
+    load_order: &mut T,
+    operations: &[BatchOperation<'_>],
+) -> Result<(), Error> {
+    let previous_plugins = load_order.plugins().to_vec();
+
+    let result = move_batch_plugins(load_order, operations)
+        .and_then(|()| set_batch_active_states(load_order, operations));
+
+    if result.is_err() {
+        roll_back(load_order, previous_plugins);
+    }
+
+    result
+}
+
+/// Put back the plugins that a failed change started from. Activating plugins
+/// may have unghosted some of their files before the change failed, and those
+/// renames aren't undone, so any previously ghosted plugins that are no longer
+/// ghosted keep their unghosted paths.
+fn roll_back<T: MutableLoadOrder>(load_order: &mut T, mut previous_plugins: Vec<Plugin>) {
+    let unghosted: HashMap<_, _> = load_order
+        .plugins()
+        .iter()
+        .filter(|p| !p.is_ghosted())
+        .map(|p| (UniCase::new(p.name()), p))
+        .collect();
+
+    for plugin in previous_plugins.iter_mut().filter(|p| p.is_ghosted()) {
+        if let Some(unghosted) = unghosted.get(&UniCase::new(plugin.name())) {
+            plugin.use_unghosted_path(unghosted);
         }
     }
 
+    *load_order.plugins_mut() = previous_plugins;
+}
+
+fn move_batch_plugins<T: MutableLoadOrder>(
+    load_order: &mut T,
+    operations: &[BatchOperation<'_>],
+) -> Result<(), Error> {
+    let mut moved_plugins = false;
+
+    for operation in operations {
+        let BatchOperation::SetPosition(plugin_name, position) = *operation else {
+            continue;
+        };
+
+        let plugin = match load_order.index_of(plugin_name) {
+            Some(index) => load_order.remove_plugin(index),
+            None => Plugin::new(plugin_name, load_order.game_settings())?,
+        };
+
+        let position = position.min(load_order.plugins().len());
+        load_order.insert_plugin(position, plugin);
+        moved_plugins = true;
+    }
+
+    if moved_plugins {
+        let _timer = load_order
+            .game_settings()
+            .metrics_recorder()
+            .time(Phase::Validate);
+        validate_load_order(
+            load_order.plugins(),
+            load_order.game_settings().early_loading_plugins(),
+        )?;
+    }
+
     Ok(())
 }
 
+fn set_batch_active_states<T: MutableLoadOrder>(
+    load_order: &mut T,
+    operations: &[BatchOperation<'_>],
+) -> Result<(), Error> {
+    // Go through the operations in reverse so that the last operation for
+    // each plugin is the one that's kept.
+    let mut seen_indices = HashSet::new();
+    let mut plugins_to_activate = Vec::new();
+    for operation in operations.iter().rev() {
+        let (plugin_name, active) = match *operation {
+            BatchOperation::Activate(plugin_name) => (plugin_name, true),
+            BatchOperation::Deactivate(plugin_name) => (plugin_name, false),
+            BatchOperation::SetPosition(..) => continue,
+        };
+
+        let Some(index) = load_order.index_of(plugin_name) else {
+            return Err(Error::PluginNotFound(plugin_name.to_owned()));
+        };
+
+        if seen_indices.insert(index) {
+            if active {
+                plugins_to_activate.push(index);
+            } else if load_order.game_settings().is_implicitly_active(plugin_name) {
+                return Err(Error::ImplicitlyActivePlugin(plugin_name.to_owned()));
+            } else {
+                load_order.deactivate_plugin_at(index);
+            }
+        }
+    }
+
+    // Deactivations have been applied, so count the active plugins as if the
+    // activations had been too, without touching any ghosted plugin files.
+    let mut counts = load_order.active_plugin_counts();
+    for index in &plugins_to_activate {
+        if let Some(plugin) = load_order.plugins().get(*index) {
+            if !plugin.is_active() {
+                counts.count_plugin(plugin);
+            }
+        }
+    }
+
+    let max_active_full_plugins =
+        load_order.full_plugins_limit(counts.light > 0, counts.medium > 0);
+
+    if counts.full > max_active_full_plugins
+        || counts.medium > MAX_ACTIVE_MEDIUM_PLUGINS
+        || counts.light > MAX_ACTIVE_LIGHT_PLUGINS
+    {
+        return Err(Error::TooManyActivePlugins {
+            light_count: counts.light,
+            medium_count: counts.medium,
+            full_count: counts.full,
+        });
+    }
+
+    load_order.activate_plugins_at(&plugins_to_activate)
+}
+
+pub(super) fn apply_diff<T: MutableLoadOrder>(
+    load_order: &mut T,
+    diff: &LoadOrderDiff,
+) -> Result<(), Error> {
+    validate_diff_implicitly_active_plugins(load_order, diff)?;
+
+    let previous_plugins = load_order.plugins().to_vec();
+
+    let result = if diff.changes_positions() {
+        move_diff_plugins(load_order, diff)
+    } else {
+        Ok(())
+    }
+    .and_then(|()| {
+        let operations: Vec<_> = diff
+            .activated
+            .iter()
+            .map(|n| BatchOperation::Activate(n))
+            .chain(
+                diff.deactivated
+                    .iter()
+                    .map(|n| BatchOperation::Deactivate(n)),
+            )
+            .collect();
+        set_batch_active_states(load_order, &operations)
+    });
+
+    if result.is_err() {
+        roll_back(load_order, previous_plugins);
+    }
+
+    result
+}
+
+/// Check that every implicitly active plugin that will be in the load order
+/// once the diff is applied will also be active, as `set_active_plugins()`
+/// does for its active plugins.
+fn validate_diff_implicitly_active_plugins<T: MutableLoadOrder>(
+    load_order: &T,
+    diff: &LoadOrderDiff,
+) -> Result<(), Error> {
+    let is_listed =
+        |names: &[String], plugin_name: &str| names.iter().any(|n| eq(n.as_str(), plugin_name));
+
+    for plugin_name in load_order.game_settings().implicitly_active_plugins() {
+        let is_added = diff.added.iter().any(|(n, _)| eq(n, plugin_name));
+        let is_kept =
+            load_order.index_of(plugin_name).is_some() && !is_listed(&diff.removed, plugin_name);
+
+        let will_be_active = is_listed(&diff.activated, plugin_name)
+            || (load_order.is_active(plugin_name) && !is_listed(&diff.deactivated, plugin_name));
+
+        if (is_added || is_kept) && !will_be_active {
+            return Err(Error::ImplicitlyActivePlugin(plugin_name.clone()));
+        }
+    }
+
+    Ok(())
+}
+
+/// Remove the removed and moved plugins, then insert the moved and added
+/// plugins in order of their target positions. Inserting in that order puts
+/// each plugin at its target position, as every plugin before it is already
+/// in place.
+fn move_diff_plugins<T: MutableLoadOrder>(
+    load_order: &mut T,
+    diff: &LoadOrderDiff,
+) -> Result<(), Error> {
+    let mut taken: HashMap<_, _> = diff
+        .removed
+        .iter()
+        .map(|n| (UniCase::new(n.as_str()), false))
+        .chain(
+            diff.moved
+                .iter()
+                .map(|(n, _)| (UniCase::new(n.as_str()), true)),
+        )
+        .collect();
+
+    let mut kept = Vec::with_capacity(load_order.plugins().len());
+    let mut moved = HashMap::with_capacity(diff.moved.len());
+    for plugin in load_order.plugins() {
+        match taken.remove(&UniCase::new(plugin.name())) {
+            Some(true) => {
+                moved.insert(UniCase::new(plugin.name()), plugin.clone());
+            }
+            Some(false) => {}
+            None => kept.push(plugin.clone()),
+        }
+    }
+
+    if let Some(name) = taken.keys().next() {
+        return Err(Error::PluginNotFound(name.to_string()));
+    }
+
+    let mut insertions = Vec::with_capacity(diff.moved.len() + diff.added.len());
+    for (name, position) in &diff.moved {
+        if let Some(plugin) = moved.remove(&UniCase::new(name.as_str())) {
+            insertions.push((*position, plugin));
+        }
+    }
+    for (name, position) in &diff.added {
+        if load_order.index_of(name).is_some() {
+            return Err(Error::DuplicatePlugin(name.clone()));
+        }
+        insertions.push((*position, Plugin::new(name, load_order.game_settings())?));
+    }
+    insertions.sort_by_key(|(position, _)| *position);
+
+    let mut kept = kept.into_iter();
+    let mut plugins = Vec::with_capacity(kept.len() + insertions.len());
+    for (position, plugin) in insertions {
+        plugins.extend(kept.by_ref().take(position.saturating_sub(plugins.len())));
+        plugins.push(plugin);
+    }
+    plugins.extend(kept);
+
+    {
+        let _timer = load_order
+            .game_settings()
+            .metrics_recorder()
+            .time(Phase::Validate);
+        validate_load_order(&plugins, load_order.game_settings().early_loading_plugins())?;
+    }
+
+    *load_order.plugins_mut() = plugins;
+
+    Ok(())
+}
+
+pub(super) fn snapshot<T: ReadableLoadOrderBase>(load_order: &T) -> LoadOrderSnapshot {
+    let game_settings = load_order.game_settings();
+
+    LoadOrderSnapshot {
+        game_id: game_settings.id(),
+        plugins_directory: game_settings.plugins_directory(),
+        plugins: load_order.plugins().to_vec(),
+    }
+}
+
+pub(super) fn restore_snapshot<T: MutableLoadOrder>(
+    load_order: &mut T,
+    snapshot: &LoadOrderSnapshot,
+) -> Result<(), Error> {
+    let game_settings = load_order.game_settings();
+    if snapshot.game_id != game_settings.id()
+        || snapshot.plugins_directory != game_settings.plugins_directory()
+    {
+        return Err(Error::IncompatibleSnapshot);
+    }
+
+    // The snapshot's plugins may have been unghosted or uninstalled since it
+    // was taken, so restore its order and active states using the current
+    // plugins, dropping any that are no longer present.
+    let mut plugins = Vec::with_capacity(snapshot.plugins.len());
+    let mut active_positions = Vec::new();
+    for snapshot_plugin in &snapshot.plugins {
+        let Some(plugin) = load_order.find_plugin(snapshot_plugin.name()) else {
+            continue;
+        };
+
+        if snapshot_plugin.is_active() {
+            active_positions.push(plugins.len());
+        } else if game_settings.is_implicitly_active(plugin.name()) {
+            return Err(Error::ImplicitlyActivePlugin(plugin.name().to_owned()));
+        }
+
+        let mut plugin = plugin.clone();
+        plugin.deactivate();
+        plugins.push(plugin);
+    }
+
+    let counts = count_plugins(&plugins, &active_positions);
+    if counts.full > load_order.full_plugins_limit(counts.light > 0, counts.medium > 0)
+        || counts.medium > MAX_ACTIVE_MEDIUM_PLUGINS
+        || counts.light > MAX_ACTIVE_LIGHT_PLUGINS
+    {
+        return Err(Error::TooManyActivePlugins {
+            light_count: counts.light,
+            medium_count: counts.medium,
+            full_count: counts.full,
+        });
+    }
+
+    {
+        let _timer = game_settings.metrics_recorder().time(Phase::Validate);
+        validate_load_order(&plugins, game_settings.early_loading_plugins())?;
+    }
+
+    let previous_plugins = std::mem::replace(load_order.plugins_mut(), plugins);
+
+    let result = load_order.activate_plugins_at(&active_positions);
+
+    if result.is_err() {
+        roll_back(load_order, previous_plugins);
+    }
+
+    result
+}
+
 pub(super) fn create_parent_dirs(path: &Path) -> Result<(), Error> {
     if let Some(x) = path.parent() {
         if !x.exists() {
@@ -271,21 +696,75 @@ pub(super) fn create_parent_dirs(path: &Path) -> Result<(), Error> {
     Ok(())
 }
 
+/// Write the given content to the file at the given path, unless the file
+/// already has exactly that content, so that tools watching the file aren't
+/// told about changes that didn't happen. The content is written to a
+/// temporary file that then replaces the file, so that readers never see a
+/// partially written file. Returns true if the file was written.
+pub(super) fn write_file_if_changed(
+    path: &Path,
+    content: &[u8],
+    metrics: &MetricsRecorder,
+) -> Result<bool, Error> {
+    if let Ok(existing) = read(path) {
+        metrics.add_bytes_read(existing.len());
+        if existing == content {
+            return Ok(false);
+        }
+    }
+
+    create_parent_dirs(path)?;
+
+    let temp_path = temp_file_path(path)?;
+    if let Err(e) = write(&temp_path, content) {
+        // A partial write can leave the temporary file behind.
+        remove_file(&temp_path).unwrap_or_default();
+        return Err(Error::IoError(temp_path, e));
+    }
+
+    if rename(&temp_path, path).is_err() {
+        // Replacing a file can fail on Windows if another process has it open
+        // without allowing it to be deleted, so fall back to overwriting it.
+        remove_file(&temp_path).unwrap_or_default();
+        write(path, content).map_err(|e| Error::IoError(path.to_path_buf(), e))?;
+    }
+    metrics.add_files_written(1);
+
+    Ok(true)
+}
+
+pub(crate) fn temp_file_path(path: &Path) -> Result<PathBuf, Error> {
+    // Give each temporary file a unique name so that concurrent saves don't
+    // write to the same temporary file.
+    static COUNTER: AtomicUsize = AtomicUsize::new(0);
+
+    let Some(filename) = path.file_name() else {
+        return Err(Error::NoFilename(path.to_path_buf()));
+    };
+
+    let mut temp_filename = OsString::from(".");
+    temp_filename.push(filename);
+    temp_filename.push(format!(
+        ".{}.{}.tmp",
+        std::process::id(),
+        COUNTER.fetch_add(1, Ordering::Relaxed)
+    ));
+
+    Ok(path.with_file_name(temp_filename))
+}
+
 #[cfg(test)]
 mod tests {
     use super::*;
 
-    use std::fs::remove_file;
-
     use tempfile::tempdir;
 
-    use crate::enums::GameId;
     use crate::load_order::tests::{
         game_settings_for_test, load_and_insert, mock_game_files, prepare_bulk_full_plugins,
         prepare_bulk_plugins, prepend_early_loader, prepend_master, set_blueprint_flag,
         set_master_flag,
     };
-    use crate::tests::{copy_to_test_dir, NON_ASCII};
+    use crate::tests::{copy_to_test_dir, set_file_timestamps, NON_ASCII};
 
     struct TestLoadOrder {
         game_settings: GameSettings,
@@ -1062,4 +1541,447 @@ mod tests {
         assert!(set_active_plugins(&mut load_order, &plugin_refs).is_err());
         assert_eq!(1, load_order.active_plugin_names().len());
     }
+
+    #[test]
+    fn apply_batch_should_move_add_and_activate_plugins() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Oblivion, tmp_dir.path());
+
+        let operations = [
+            BatchOperation::SetPosition("Blank - Different.esp", 0),
+            BatchOperation::SetPosition("Blank.esm", 0),
+            BatchOperation::Activate("Blank - Different.esp"),
+            BatchOperation::Deactivate("Blank.esp"),
+        ];
+        assert!(apply_batch(&mut load_order, &operations).is_ok());
+
+        assert_eq!(
+            vec!["Blank.esm", "Blank - Different.esp", "Blank.esp"],
+            load_order.plugin_names()
+        );
+        assert!(load_order.is_active("Blank - Different.esp"));
+        assert!(!load_order.is_active("Blank.esp"));
+    }
+
+    #[test]
+    fn apply_batch_should_leave_the_load_order_unchanged_if_the_result_is_invalid() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Oblivion, tmp_dir.path());
+
+        let operations = [
+            BatchOperation::Activate("Blank - Different.esp"),
+            BatchOperation::SetPosition("Blank - Different.esp", 0),
+            BatchOperation::SetPosition("Blank.esm", 2),
+        ];
+        assert!(apply_batch(&mut load_order, &operations).is_err());
+
+        assert_eq!(
+            vec!["Blank.esp", "Blank - Different.esp"],
+            load_order.plugin_names()
+        );
+        assert!(!load_order.is_active("Blank - Different.esp"));
+    }
+
+    #[test]
+    fn apply_batch_should_leave_the_load_order_unchanged_if_an_operation_fails() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Oblivion, tmp_dir.path());
+
+        let operations = [
+            BatchOperation::SetPosition("Blank - Different.esp", 0),
+            BatchOperation::Deactivate("Blank.esp"),
+            BatchOperation::Activate("missing.esp"),
+        ];
+        assert!(apply_batch(&mut load_order, &operations).is_err());
+
+        assert_eq!(
+            vec!["Blank.esp", "Blank - Different.esp"],
+            load_order.plugin_names()
+        );
+        assert!(load_order.is_active("Blank.esp"));
+    }
+
+    #[test]
+    fn apply_batch_should_use_the_last_activation_or_deactivation_of_a_plugin() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Oblivion, tmp_dir.path());
+
+        let operations = [
+            BatchOperation::Activate("Blank - Different.esp"),
+            BatchOperation::Deactivate("Blank - Different.esp"),
+            BatchOperation::Deactivate("Blank.esp"),
+            BatchOperation::Activate("Blank.esp"),
+        ];
+        assert!(apply_batch(&mut load_order, &operations).is_ok());
+
+        assert!(!load_order.is_active("Blank - Different.esp"));
+        assert!(load_order.is_active("Blank.esp"));
+    }
+
+    #[test]
+    fn apply_batch_should_check_the_active_plugins_limit_after_all_changes() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Oblivion, tmp_dir.path());
+
+        let plugins = prepare_bulk_full_plugins(&mut load_order);
+        for plugin in &plugins[..254] {
+            activate(&mut load_order, plugin).unwrap();
+        }
+
+        let operations = [BatchOperation::Activate("Blank - Different.esp")];
+        assert!(apply_batch(&mut load_order, &operations).is_err());
+        assert!(!load_order.is_active("Blank - Different.esp"));
+
+        let operations = [
+            BatchOperation::Activate("Blank - Different.esp"),
+            BatchOperation::Deactivate("Blank.esp"),
+        ];
+        assert!(apply_batch(&mut load_order, &operations).is_ok());
+        assert!(load_order.is_active("Blank - Different.esp"));
+        assert!(!load_order.is_active("Blank.esp"));
+    }
+
+    #[test]
+    fn apply_batch_should_error_if_given_an_implicitly_active_plugin_to_deactivate() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::SkyrimSE, tmp_dir.path());
+
+        prepend_early_loader(&mut load_order);
+
+        assert!(activate(&mut load_order, "Skyrim.esm").is_ok());
+
+        let operations = [BatchOperation::Deactivate("Skyrim.esm")];
+        assert!(apply_batch(&mut load_order, &operations).is_err());
+        assert!(load_order.is_active("Skyrim.esm"));
+    }
+
+    #[test]
+    fn apply_batch_should_allow_an_implicitly_active_plugin_to_be_deactivated_then_activated() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::SkyrimSE, tmp_dir.path());
+
+        prepend_early_loader(&mut load_order);
+
+        let operations = [
+            BatchOperation::Deactivate("Skyrim.esm"),
+            BatchOperation::Activate("Skyrim.esm"),
+        ];
+        assert!(apply_batch(&mut load_order, &operations).is_ok());
+        assert!(load_order.is_active("Skyrim.esm"));
+    }
+
+    #[test]
+    fn write_file_if_changed_should_create_the_file_and_its_parent_directories() {
+        let tmp_dir = tempdir().unwrap();
+        let path = tmp_dir.path().join("a").join("b").join("plugins.txt");
+
+        assert!(write_file_if_changed(&path, b"Blank.esp\n", &MetricsRecorder::default()).unwrap());
+
+        assert_eq!(b"Blank.esp\n".as_slice(), read(&path).unwrap());
+    }
+
+    #[test]
+    fn restore_snapshot_should_restore_the_load_order_and_active_plugins() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Oblivion, tmp_dir.path());
+
+        let snapshot = snapshot(&load_order);
+        let plugin_names = load_order.plugin_names().join(",");
+
+        load_and_insert(&mut load_order, "Blank.esm");
+        set_active_plugins(&mut load_order, &["Blank.esm", "Blank - Different.esp"]).unwrap();
+
+        restore_snapshot(&mut load_order, &snapshot).unwrap();
+
+        assert_eq!(plugin_names, load_order.plugin_names().join(","));
+        assert_eq!(vec!["Blank.esp"], load_order.active_plugin_names());
+        assert_eq!(snapshot.plugin_names(), load_order.plugin_names());
+    }
+
+    #[test]
+    fn restore_snapshot_should_use_the_current_paths_of_plugins_unghosted_since_it_was_taken() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Oblivion, tmp_dir.path());
+        let path = load_order.game_settings().plugin_path("Blank.esm");
+        std::fs::rename(&path, path.with_extension("esm.ghost")).unwrap();
+        load_and_insert(&mut load_order, "Blank.esm.ghost");
+
+        let snapshot = snapshot(&load_order);
+
+        activate(&mut load_order, "Blank.esm").unwrap();
+
+        restore_snapshot(&mut load_order, &snapshot).unwrap();
+
+        assert_eq!(path, load_order.plugins[0].path());
+        assert!(!load_order.plugins[0].is_active());
+        assert!(!load_order.plugins[0].is_ghosted());
+    }
+
+    #[test]
+    fn restore_snapshot_should_unghost_plugins_that_it_activates() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Oblivion, tmp_dir.path());
+        load_and_insert(&mut load_order, "Blank.esm");
+        activate(&mut load_order, "Blank.esm").unwrap();
+
+        let snapshot = snapshot(&load_order);
+
+        // Simulate the plugin being ghosted and the load order reloaded.
+        let path = load_order.plugins[0].path().to_path_buf();
+        std::fs::rename(&path, path.with_extension("esm.ghost")).unwrap();
+        load_order.plugins[0] = Plugin::new("Blank.esm.ghost", load_order.game_settings()).unwrap();
+
+        restore_snapshot(&mut load_order, &snapshot).unwrap();
+
+        assert!(load_order.plugins[0].is_active());
+        assert!(!load_order.plugins[0].is_ghosted());
+        assert_eq!(path, load_order.plugins[0].path());
+        assert!(path.exists());
+    }
+
+    #[test]
+    fn restore_snapshot_should_drop_plugins_that_have_been_removed_since_it_was_taken() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Oblivion, tmp_dir.path());
+
+        let snapshot = snapshot(&load_order);
+
+        load_order.plugins.pop();
+
+        restore_snapshot(&mut load_order, &snapshot).unwrap();
+
+        assert_eq!(vec!["Blank.esp"], load_order.plugin_names());
+    }
+
+    #[test]
+    fn restore_snapshot_should_error_if_the_snapshot_is_for_a_different_game() {
+        let tmp_dir = tempdir().unwrap();
+        let other_tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Oblivion, tmp_dir.path());
+        let other_load_order = prepare(GameId::Oblivion, other_tmp_dir.path());
+        let skyrim_load_order = prepare(GameId::Skyrim, tmp_dir.path());
+
+        assert!(matches!(
+            restore_snapshot(&mut load_order, &snapshot(&other_load_order)),
+            Err(Error::IncompatibleSnapshot)
+        ));
+        assert!(matches!(
+            restore_snapshot(&mut load_order, &snapshot(&skyrim_load_order)),
+            Err(Error::IncompatibleSnapshot)
+        ));
+    }
+
+    #[test]
+    fn restore_snapshot_should_error_if_an_implicitly_active_plugin_is_inactive() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::SkyrimSE, tmp_dir.path());
+        prepend_early_loader(&mut load_order);
+
+        let snapshot = snapshot(&load_order);
+        load_order.plugins[0]
+            .activate(&MetricsRecorder::default())
+            .unwrap();
+
+        assert!(matches!(
+            restore_snapshot(&mut load_order, &snapshot),
+            Err(Error::ImplicitlyActivePlugin(_))
+        ));
+        assert!(load_order.plugins[0].is_active());
+    }
+
+    #[test]
+    fn restore_snapshot_should_error_if_too_many_plugins_are_active() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Oblivion, tmp_dir.path());
+        prepare_bulk_full_plugins(&mut load_order);
+
+        let mut snapshot = snapshot(&load_order);
+        for plugin in &mut snapshot.plugins {
+            plugin.activate(&MetricsRecorder::default()).unwrap();
+        }
+
+        assert!(matches!(
+            restore_snapshot(&mut load_order, &snapshot),
+            Err(Error::TooManyActivePlugins { .. })
+        ));
+        assert_eq!(1, load_order.active_plugin_names().len());
+    }
+
+    #[test]
+    fn restore_snapshot_should_error_and_leave_the_load_order_unchanged_if_it_is_invalid() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Oblivion, tmp_dir.path());
+        load_and_insert(&mut load_order, "Blank.esm");
+        let plugin_names = load_order.plugin_names().join(",");
+
+        let mut snapshot = snapshot(&load_order);
+        snapshot.plugins.rotate_left(1);
+
+        assert!(restore_snapshot(&mut load_order, &snapshot).is_err());
+        assert_eq!(plugin_names, load_order.plugin_names().join(","));
+    }
+
+    #[test]
+    fn apply_batch_should_keep_the_paths_of_plugins_unghosted_before_an_error() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Oblivion, tmp_dir.path());
+        let plugins_dir = load_order.game_settings().plugins_directory();
+
+        std::fs::rename(
+            plugins_dir.join("Blank.esm"),
+            plugins_dir.join("Blank.esm.ghost"),
+        )
+        .unwrap();
+        load_and_insert(&mut load_order, "Blank.esm.ghost");
+
+        // Unghosting this plugin fails because a directory has its name.
+        copy_to_test_dir(
+            "Blank - Different.esm",
+            "Blank - Different.esm.ghost",
+            load_order.game_settings(),
+        );
+        load_and_insert(&mut load_order, "Blank - Different.esm.ghost");
+        create_dir_all(plugins_dir.join("Blank - Different.esm")).unwrap();
+
+        assert!(apply_batch(
+            &mut load_order,
+            &[
+                BatchOperation::Activate("Blank.esm"),
+                BatchOperation::Activate("Blank - Different.esm"),
+            ]
+        )
+        .is_err());
+
+        for plugin in &load_order.plugins {
+            assert!(plugin.path().exists());
+        }
+        assert_eq!(vec!["Blank.esp"], load_order.active_plugin_names());
+    }
+
+    #[test]
+    fn apply_diff_should_apply_the_changes_found_by_diff_load_order() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Oblivion, tmp_dir.path());
+
+        let plugin_names = ["Blank.esm", "Blank - Different.esp", "Blank.esp"];
+        let active_plugin_names = ["Blank.esm", "Blank - Different.esp"];
+        let diff = load_order
+            .diff_load_order(&plugin_names, &active_plugin_names)
+            .unwrap();
+
+        assert_eq!(vec![("Blank.esm".to_owned(), 0usize)], diff.added);
+        assert_eq!(
+            vec![("Blank - Different.esp".to_owned(), 1usize)],
+            diff.moved
+        );
+        assert_eq!(vec!["Blank.esp".to_owned()], diff.deactivated);
+
+        assert!(apply_diff(&mut load_order, &diff).is_ok());
+
+        assert_eq!(plugin_names.to_vec(), load_order.plugin_names());
+        assert_eq!(
+            active_plugin_names.to_vec(),
+            load_order.active_plugin_names()
+        );
+        assert!(load_order
+            .diff_load_order(&plugin_names, &active_plugin_names)
+            .unwrap()
+            .is_empty());
+    }
+
+    #[test]
+    fn apply_diff_should_leave_the_load_order_unchanged_if_the_result_is_invalid() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Oblivion, tmp_dir.path());
+
+        let diff = load_order
+            .diff_load_order(
+                &["Blank - Different.esp", "Blank.esm"],
+                &["Blank - Different.esp"],
+            )
+            .unwrap();
+        assert!(apply_diff(&mut load_order, &diff).is_err());
+
+        assert_eq!(
+            vec!["Blank.esp", "Blank - Different.esp"],
+            load_order.plugin_names()
+        );
+        assert_eq!(vec!["Blank.esp"], load_order.active_plugin_names());
+    }
+
+    #[test]
+    fn apply_diff_should_error_if_an_implicitly_active_plugin_would_be_inactive() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::SkyrimSE, tmp_dir.path());
+        prepend_early_loader(&mut load_order);
+
+        let plugin_names = ["Skyrim.esm", "Blank - Different.esp", "Blank.esp"];
+        let diff = load_order
+            .diff_load_order(&plugin_names, &["Blank.esp"])
+            .unwrap();
+        match apply_diff(&mut load_order, &diff).unwrap_err() {
+            Error::ImplicitlyActivePlugin(n) => assert_eq!("Skyrim.esm", n),
+            e => panic!("Expected implicitly active plugin error, got {e:?}"),
+        }
+
+        assert_eq!(
+            vec!["Skyrim.esm", "Blank.esp", "Blank - Different.esp"],
+            load_order.plugin_names()
+        );
+
+        let diff = load_order
+            .diff_load_order(&plugin_names, &["Skyrim.esm", "Blank.esp"])
+            .unwrap();
+        assert!(apply_diff(&mut load_order, &diff).is_ok());
+    }
+
+    #[test]
+    fn apply_diff_should_error_and_leave_the_load_order_unchanged_if_a_plugin_is_not_found() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Oblivion, tmp_dir.path());
+
+        let diff = LoadOrderDiff {
+            moved: vec![("Blank - Different.esp".to_owned(), 0)],
+            deactivated: vec!["missing.esp".to_owned()],
+            ..LoadOrderDiff::default()
+        };
+        match apply_diff(&mut load_order, &diff).unwrap_err() {
+            Error::PluginNotFound(n) => assert_eq!("missing.esp", n),
+            e => panic!("Expected plugin not found error, got {e:?}"),
+        }
+
+        assert_eq!(
+            vec!["Blank.esp", "Blank - Different.esp"],
+            load_order.plugin_names()
+        );
+    }
+
+    #[test]
+    fn write_file_if_changed_should_not_write_a_file_that_already_has_the_given_content() {
+        let tmp_dir = tempdir().unwrap();
+        let path = tmp_dir.path().join("plugins.txt");
+
+        write(&path, b"Blank.esp\n").unwrap();
+        set_file_timestamps(&path, 0);
+        let mtime = path.metadata().unwrap().modified().unwrap();
+
+        assert!(
+            !write_file_if_changed(&path, b"Blank.esp\n", &MetricsRecorder::default()).unwrap()
+        );
+
+        assert_eq!(mtime, path.metadata().unwrap().modified().unwrap());
+    }
+
+    #[test]
+    fn write_file_if_changed_should_replace_a_file_with_different_content() {
+        let tmp_dir = tempdir().unwrap();
+        let path = tmp_dir.path().join("plugins.txt");
+
+        write(&path, b"Blank.esp\n").unwrap();
+
+        assert!(write_file_if_changed(&path, b"Blank.esm\n", &MetricsRecorder::default()).unwrap());
+
+        assert_eq!(b"Blank.esm\n".as_slice(), read(&path).unwrap());
+        assert_eq!(1, std::fs::read_dir(tmp_dir.path()).unwrap().count());
+    }
 }
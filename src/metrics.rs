@@ -0,0 +1,296 @@
+/*
+ * This file is part of libloadorder
+ *
+ * Copyright (C) 2017 Oliver Hamlet
+ *
+ * libloadorder is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libloadorder is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
+ */
+use std::cmp::Ordering;
+use std::hash::{Hash, Hasher};
+use std::sync::atomic::{AtomicU64, Ordering as AtomicOrdering};
+use std::sync::Arc;
+use std::time::{Duration, Instant};
+
+/// Counts of the I/O that a load order has done and the time it has spent in
+/// each phase of its work, since its game settings were created or its
+/// metrics were last reset.
+///
+/// Phase times are summed across threads, so phases that are run in parallel,
+/// like parsing headers, can add up to more than the time spent loading.
+#[derive(Clone, Copy, Debug, Default, Eq, PartialEq, Hash)]
+pub struct Metrics {
+    /// The number of plugin files that had their metadata read while
+    /// scanning the plugins directories.
+    pub files_stated: u64,
+    /// The number of plugin headers that were parsed.
+    pub headers_parsed: u64,
+    /// The number of bytes read from plugins and plugin lists.
+    pub bytes_read: u64,
+    /// The number of files that were written, renamed to unghost them or had
+    /// their timestamps changed.
+    pub files_written: u64,
+    pub load_time: Duration,
+    pub save_time: Duration,
+    pub find_plugins_time: Duration,
+    pub parse_headers_time: Duration,
+    pub unghost_time: Duration,
+    pub hoist_masters_time: Duration,
+    pub validate_time: Duration,
+    pub save_timestamps_time: Duration,
+}
+
+#[derive(Clone, Copy, Debug, Eq, PartialEq)]
+pub(crate) enum Phase {
+    Load,
+    Save,
+    FindPlugins,
+    ParseHeaders,
+    Unghost,
+    HoistMasters,
+    Validate,
+    SaveTimestamps,
+}
+
+impl Phase {
+    #[cfg(feature = "tracing")]
+    fn name(self) -> &'static str {
+        match self {
+            Phase::Load => "load",
+            Phase::Save => "save",
+            Phase::FindPlugins => "find_plugins",
+            Phase::ParseHeaders => "parse_headers",
+            Phase::Unghost => "unghost",
+            Phase::HoistMasters => "hoist_masters",
+            Phase::Validate => "validate",
+            Phase::SaveTimestamps => "save_timestamps",
+        }
+    }
+}
+
+#[derive(Debug, Default)]
+struct Counters {
+    files_stated: AtomicU64,
+    headers_parsed: AtomicU64,
+    bytes_read: AtomicU64,
+    files_written: AtomicU64,
+    load_nanos: AtomicU64,
+    save_nanos: AtomicU64,
+    find_plugins_nanos: AtomicU64,
+    parse_headers_nanos: AtomicU64,
+    unghost_nanos: AtomicU64,
+    hoist_masters_nanos: AtomicU64,
+    validate_nanos: AtomicU64,
+    save_timestamps_nanos: AtomicU64,
+}
+
+impl Counters {
+    fn phase_nanos(&self, phase: Phase) -> &AtomicU64 {
+        match phase {
+            Phase::Load => &self.load_nanos,
+            Phase::Save => &self.save_nanos,
+            Phase::FindPlugins => &self.find_plugins_nanos,
+            Phase::ParseHeaders => &self.parse_headers_nanos,
+            Phase::Unghost => &self.unghost_nanos,
+            Phase::HoistMasters => &self.hoist_masters_nanos,
+            Phase::Validate => &self.validate_nanos,
+            Phase::SaveTimestamps => &self.save_timestamps_nanos,
+        }
+    }
+
+    fn all(&self) -> [&AtomicU64; 12] {
+        [
+            &self.files_stated,
+            &self.headers_parsed,
+            &self.bytes_read,
+            &self.files_written,
+            &self.load_nanos,
+            &self.save_nanos,
+            &self.find_plugins_nanos,
+            &self.parse_headers_nanos,
+            &self.unghost_nanos,
+            &self.hoist_masters_nanos,
+            &self.validate_nanos,
+            &self.save_timestamps_nanos,
+        ]
+    }
+}
+
+/// Records metrics for a load order. Clones share their counters, so metrics
+/// recorded while working on a copy of a load order are also counted for the
+/// original.
+///
+/// Recording is always on, as it only involves relaxed atomic additions, which
+/// are much cheaper than the I/O being counted.
+#[derive(Clone, Debug, Default)]
+pub(crate) struct MetricsRecorder {
+    counters: Arc<Counters>,
+}
+
+impl MetricsRecorder {
+    /// Start timing a phase, which ends when the returned timer is dropped.
+    pub(crate) fn time(&self, phase: Phase) -> PhaseTimer {
+        PhaseTimer {
+            counters: Arc::clone(&self.counters),
+            phase,
+            start: Instant::now(),
+            #[cfg(feature = "tracing")]
+            _span: tracing::debug_span!("libloadorder", phase = phase.name()).entered(),
+        }
+    }
+
+    pub(crate) fn add_files_stated(&self, count: usize) {
+        add(&self.counters.files_stated, to_u64(count));
+    }
+
+    pub(crate) fn add_header_parsed(&self, bytes_read: u64) {
+        add(&self.counters.headers_parsed, 1);
+        add(&self.counters.bytes_read, bytes_read);
+    }
+
+    pub(crate) fn add_bytes_read(&self, count: usize) {
+        add(&self.counters.bytes_read, to_u64(count));
+    }
+
+    pub(crate) fn add_files_written(&self, count: usize) {
+        add(&self.counters.files_written, to_u64(count));
+    }
+
+    pub(crate) fn snapshot(&self) -> Metrics {
+        let counters = &*self.counters;
+        let duration = |phase| Duration::from_nanos(get(counters.phase_nanos(phase)));
+
+        Metrics {
+            files_stated: get(&counters.files_stated),
+            headers_parsed: get(&counters.headers_parsed),
+            bytes_read: get(&counters.bytes_read),
+            files_written: get(&counters.files_written),
+            load_time: duration(Phase::Load),
+            save_time: duration(Phase::Save),
+            find_plugins_time: duration(Phase::FindPlugins),
+            parse_headers_time: duration(Phase::ParseHeaders),
+            unghost_time: duration(Phase::Unghost),
+            hoist_masters_time: duration(Phase::HoistMasters),
+            validate_time: duration(Phase::Validate),
+            save_timestamps_time: duration(Phase::SaveTimestamps),
+        }
+    }
+
+    pub(crate) fn reset(&self) {
+        for counter in self.counters.all() {
+            counter.store(0, AtomicOrdering::Relaxed);
+        }
+    }
+}
+
+// Metrics don't affect how a load order behaves, so they're ignored when
+// comparing game settings.
+impl PartialEq for MetricsRecorder {
+    fn eq(&self, _other: &Self) -> bool {
+        true
+    }
+}
+
+impl Eq for MetricsRecorder {}
+
+impl PartialOrd for MetricsRecorder {
+    fn partial_cmp(&self, other: &Self) -> Option<Ordering> {
+        Some(self.cmp(other))
+    }
+}
+
+impl Ord for MetricsRecorder {
+    fn cmp(&self, _other: &Self) -> Ordering {
+        Ordering::Equal
+    }
+}
+
+impl Hash for MetricsRecorder {
+    fn hash<H: Hasher>(&self, _state: &mut H) {}
+}
+
+#[must_use]
+pub(crate) struct PhaseTimer {
+    counters: Arc<Counters>,
+    phase: Phase,
+    start: Instant,
+    #[cfg(feature = "tracing")]
+    _span: tracing::span::EnteredSpan,
+}
+
+impl Drop for PhaseTimer {
+    fn drop(&mut self) {
+        let nanos = u64::try_from(self.start.elapsed().as_nanos()).unwrap_or(u64::MAX);
+        add(self.counters.phase_nanos(self.phase), nanos);
+    }
+}
+
+fn add(counter: &AtomicU64, value: u64) {
+    counter.fetch_add(value, AtomicOrdering::Relaxed);
+}
+
+fn get(counter: &AtomicU64) -> u64 {
+    counter.load(AtomicOrdering::Relaxed)
+}
+
+fn to_u64(value: usize) -> u64 {
+    u64::try_from(value).unwrap_or(u64::MAX)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn clones_should_share_counters() {
+        let recorder = MetricsRecorder::default();
+        let clone = recorder.clone();
+
+        clone.add_files_stated(2);
+        clone.add_header_parsed(100);
+        clone.add_bytes_read(20);
+        clone.add_files_written(1);
+
+        let metrics = recorder.snapshot();
+        assert_eq!(2, metrics.files_stated);
+        assert_eq!(1, metrics.headers_parsed);
+        assert_eq!(120, metrics.bytes_read);
+        assert_eq!(1, metrics.files_written);
+    }
+
+    #[test]
+    fn timer_should_add_the_elapsed_time_to_its_phase_when_dropped() {
+        let recorder = MetricsRecorder::default();
+
+        let timer = recorder.time(Phase::HoistMasters);
+        std::thread::sleep(Duration::from_millis(1));
+        assert_eq!(Duration::ZERO, recorder.snapshot().hoist_masters_time);
+
+        drop(timer);
+
+        let metrics = recorder.snapshot();
+        assert!(metrics.hoist_masters_time >= Duration::from_millis(1));
+        assert_eq!(Duration::ZERO, metrics.load_time);
+    }
+
+    #[test]
+    fn reset_should_zero_all_metrics() {
+        let recorder = MetricsRecorder::default();
+
+        recorder.add_files_written(3);
+        drop(recorder.time(Phase::Load));
+        recorder.reset();
+
+        assert_eq!(Metrics::default(), recorder.snapshot());
+    }
+}
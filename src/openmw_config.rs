@@ -51,13 +51,43 @@ pub(crate) fn user_config_dir(game_path: &Path) -> Result<PathBuf, Error> {
 pub(crate) fn resources_vfs_path(game_path: &Path, local_path: &Path) -> Result<PathBuf, Error> {
     let config = load_game_config_with_user_config_dir(game_path, local_path)?;
 
-    // Default value is relative to OpenMW's current working directory, assume
-    // that's the OpenMW executable's directory, i.e. the game path.
-    // <https://gitlab.com/OpenMW/openmw/-/blob/openmw-49-rc4/components/config/gamesettings.cpp?ref_type=tags#L61>
-    Ok(config
-        .resources
-        .unwrap_or_else(|| game_path.join("resources"))
-        .join("vfs"))
+    Ok(config.resources_vfs_path(game_path))
+}
+
+/// The directories that plugins can be installed in, and the paths of the
+/// files that they were resolved from.
+pub(crate) struct DataPaths {
+    pub(crate) resources_vfs_path: PathBuf,
+    pub(crate) additional_paths: Vec<PathBuf>,
+    /// The config files that were read or looked for, whether or not they
+    /// exist, and the Flatpak metadata file.
+    pub(crate) source_paths: Vec<PathBuf>,
+}
+
+/// Get the same paths as `resources_vfs_path()` and `additional_data_paths()`
+/// while only reading the config files once.
+pub(crate) fn data_paths(game_path: &Path, local_path: &Path) -> Result<DataPaths, Error> {
+    let fixed_paths = FixedPaths::new(game_path)?;
+    let config_state = load_game_configs(&fixed_paths)?;
+
+    let mut source_paths: Vec<_> = config_state
+        .config_dirs
+        .iter()
+        .map(|d| d.join("openmw.cfg"))
+        .collect();
+    source_paths.push(local_path.join("openmw.cfg"));
+
+    if cfg!(not(windows)) {
+        source_paths.push(flatpak_metadata_path(game_path));
+    }
+
+    let config = reduce_with_user_config_dir(config_state, local_path, &fixed_paths)?;
+
+    Ok(DataPaths {
+        resources_vfs_path: config.resources_vfs_path(game_path),
+        additional_paths: config.into_additional_data_paths(),
+        source_paths,
+    })
 }
 
 pub(crate) fn additional_data_paths(
@@ -238,16 +268,18 @@ fn is_absolute_path(value: OsString) -> Option<PathBuf> {
     path.is_absolute().then_some(path)
 }
 
+fn flatpak_metadata_path(game_path: &Path) -> PathBuf {
+    // The game path is expected to be files/share/games/openmw, relative to the
+    // Flatpak app's top-level deploy directory (where the metadata file is).
+    game_path.join("../../metadata")
+}
+
 #[cfg(not(windows))]
 fn is_flatpak_install(game_path: &Path) -> bool {
     // The presence of a metadata file seems to be the most reliable indicator
     // of a Flatpak install.
     // <https://docs.flatpak.org/en/latest/flatpak-command-reference.html#flatpak-metadata>
-    // The game path is expected to be files/share/games/openmw, relative to the
-    // Flatpak app's top-level deploy directory (where the metadata file is).
-    let metadata_file_path = game_path.join("../../metadata");
-
-    ini::Ini::load_from_file(metadata_file_path)
+    ini::Ini::load_from_file(flatpak_metadata_path(game_path))
         .map(|ini| {
             if let Some(name) = ini.get_from(Some("Application"), "name") {
                 name == "org.openmw.OpenMW"
@@ -361,6 +393,16 @@ impl OpenMWConfig {
         }
     }
 
+    fn resources_vfs_path(&self, game_path: &Path) -> PathBuf {
+        // Default value is relative to OpenMW's current working directory, assume
+        // that's the OpenMW executable's directory, i.e. the game path.
+        // <https://gitlab.com/OpenMW/openmw/-/blob/openmw-49-rc4/components/config/gamesettings.cpp?ref_type=tags#L61>
+        self.resources
+            .clone()
+            .unwrap_or_else(|| game_path.join("resources"))
+            .join("vfs")
+    }
+
     // This includes the value of data-local and the data values, but not the value of
     // <resources>/vfs. The value of user-data is of no interest to libloadorder.
     fn into_additional_data_paths(self) -> Vec<PathBuf> {
@@ -501,6 +543,8 @@ fn load_config(
 struct OpenMWConfigState {
     loaded_configs: Vec<OpenMWConfig>,
     user_config_dir: PathBuf,
+    /// The directories that config files were read from or looked for in.
+    config_dirs: Vec<PathBuf>,
 }
 
 fn load_game_configs(fixed_paths: &FixedPaths) -> Result<OpenMWConfigState, Error> {
@@ -509,12 +553,14 @@ fn load_game_configs(fixed_paths: &FixedPaths) -> Result<OpenMWConfigState, Erro
     // but skips handling of config provided as CLI parameters.
 
     let mut active_config_paths = Vec::new();
+    let mut config_dirs = vec![fixed_paths.local.clone()];
 
     let mut config = load_config(&fixed_paths.local, fixed_paths)?;
     if config.is_some() {
         active_config_paths.push(fixed_paths.local.clone());
     } else {
         active_config_paths.push(fixed_paths.global_config.clone());
+        config_dirs.push(fixed_paths.global_config.clone());
         config = load_config(&fixed_paths.global_config, fixed_paths)?;
     }
 
@@ -522,6 +568,7 @@ fn load_game_configs(fixed_paths: &FixedPaths) -> Result<OpenMWConfigState, Erro
         return Ok(OpenMWConfigState {
             loaded_configs: Vec::new(),
             user_config_dir: fixed_paths.global_config.clone(),
+            config_dirs,
         });
     };
 
@@ -540,6 +587,7 @@ fn load_game_configs(fixed_paths: &FixedPaths) -> Result<OpenMWConfigState, Erro
         }
 
         already_parsed_paths.insert(path.clone());
+        config_dirs.push(path.clone());
 
         if let Some(config) = load_config(&path, fixed_paths)? {
             if config.replace.iter().any(|r| r == "config") && parsed_configs.len() > 1 {
@@ -564,6 +612,7 @@ fn load_game_configs(fixed_paths: &FixedPaths) -> Result<OpenMWConfigState, Erro
             .last()
             .ok_or(Error::NoUserConfigPath)?
             .clone(),
+        config_dirs,
     })
 }
 
@@ -572,11 +621,19 @@ fn load_game_config_with_user_config_dir(
     user_config_dir: &Path,
 ) -> Result<OpenMWConfig, Error> {
     let fixed_paths = FixedPaths::new(game_path)?;
-    let mut config_state = load_game_configs(&fixed_paths)?;
+    let config_state = load_game_configs(&fixed_paths)?;
+
+    reduce_with_user_config_dir(config_state, user_config_dir, &fixed_paths)
+}
 
+fn reduce_with_user_config_dir(
+    mut config_state: OpenMWConfigState,
+    user_config_dir: &Path,
+    fixed_paths: &FixedPaths,
+) -> Result<OpenMWConfig, Error> {
     if config_state.user_config_dir != user_config_dir {
         // Replace the last config with one from the given dir.
-        let new_config = load_config(user_config_dir, &fixed_paths)?.unwrap_or_default();
+        let new_config = load_config(user_config_dir, fixed_paths)?.unwrap_or_default();
 
         config_state.loaded_configs.pop();
         config_state.loaded_configs.push(new_config);
@@ -0,0 +1,328 @@
+/*
+ * This file is part of libloadorder
+ *
+ * Copyright (C) 2017 Oliver Hamlet
+ *
+ * libloadorder is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libloadorder is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
+ */
+use std::cmp::Ordering;
+use std::hash::{Hash, Hasher};
+use std::sync::Arc;
+
+use rayon::prelude::*;
+use rayon::{ThreadPool, ThreadPoolBuilder};
+
+use crate::enums::Error;
+
+/// The minimum number of items that work which reads files for each item, like
+/// loading plugins or scanning directories, is split across threads for.
+pub(crate) const MIN_PARALLEL_FILE_READS: usize = 4;
+
+/// The minimum number of items that work which only gets or sets file metadata
+/// or copies data for each item is split across threads for.
+pub(crate) const MIN_PARALLEL_METADATA_OPERATIONS: usize = 64;
+
+/// The minimum number of items that a sort is split across threads for, as
+/// comparisons are cheap.
+pub(crate) const MIN_PARALLEL_SORT_LEN: usize = 1024;
+
+/// How libloadorder spreads its work across threads.
+///
+/// Work is only ever split across threads if there's enough of it to outweigh
+/// the cost of doing so, and is otherwise done on the calling thread.
+#[derive(Clone, Debug, Default)]
+#[non_exhaustive]
+pub enum Parallelism {
+    /// Use rayon's global thread pool.
+    #[default]
+    Global,
+    /// Do all work on the calling thread.
+    Serial,
+    /// Use the given thread pool, e.g. to share a pool with other work, or to
+    /// avoid competing with work in rayon's global pool.
+    Pool(Arc<ThreadPool>),
+}
+
+impl Parallelism {
+    /// Use a dedicated thread pool with the given number of threads. If the
+    /// number of threads is zero, rayon chooses it.
+    pub fn with_threads(threads: usize) -> Result<Self, Error> {
+        let pool = ThreadPoolBuilder::new()
+            .num_threads(threads)
+            .thread_name(|index| format!("libloadorder-{index}"))
+            .build()
+            .map_err(|e| Error::ThreadPoolError(e.to_string()))?;
+
+        Ok(Parallelism::Pool(Arc::new(pool)))
+    }
+
+    /// Run the given operation in the background, in the thread pool if there
+    /// is one, or otherwise on a new thread.
+    pub fn spawn<F: FnOnce() + Send + 'static>(&self, operation: F) {
+        match self {
+            Parallelism::Global => rayon::spawn(operation),
+            Parallelism::Serial => drop(std::thread::spawn(operation)),
+            Parallelism::Pool(pool) => pool.spawn(operation),
+        }
+    }
+
+    /// Apply `f` to all the items, in parallel if there are at least
+    /// `min_parallel_len` items.
+    pub(crate) fn map<T, R, C, F>(&self, items: &[T], min_parallel_len: usize, f: F) -> C
+    where
+        T: Sync,
+        R: Send,
+        C: FromIterator<R> + FromParallelIterator<R> + Send,
+        F: Fn(&T) -> R + Sync + Send,
+    {
+        self.run(
+            items.len(),
+            min_parallel_len,
+            || items.par_iter().map(&f).collect(),
+            || items.iter().map(&f).collect(),
+        )
+    }
+
+    /// Apply `f` to all the items and collect the results that aren't `None`,
+    /// in parallel if there are at least `min_parallel_len` items.
+    pub(crate) fn filter_map<T, R, C, F>(&self, items: &[T], min_parallel_len: usize, f: F) -> C
+    where
+        T: Sync,
+        R: Send,
+        C: FromIterator<R> + FromParallelIterator<R> + Send,
+        F: Fn(&T) -> Option<R> + Sync + Send,
+    {
+        self.run(
+            items.len(),
+            min_parallel_len,
+            || items.par_iter().filter_map(&f).collect(),
+            || items.iter().filter_map(&f).collect(),
+        )
+    }
+
+    /// Apply `f` to each item, in parallel if there are at least
+    /// `min_parallel_len` items.
+    pub(crate) fn map_mut<T, R, C, F>(&self, items: &mut [T], min_parallel_len: usize, f: F) -> C
+    where
+        T: Send,
+        R: Send,
+        C: FromIterator<R> + FromParallelIterator<R> + Send,
+        F: Fn(&mut T) -> R + Sync + Send,
+    {
+        if self.is_parallel(items.len(), min_parallel_len) {
+            self.install(|| items.par_iter_mut().map(&f).collect())
+        } else {
+            items.iter_mut().map(&f).collect()
+        }
+    }
+
+    /// Apply `f` to each item paired with the value at the same index, in
+    /// parallel if there are at least `min_parallel_len` items.
+    pub(crate) fn zip_map_mut<T, U, R, C, F>(
+        &self,
+        items: &mut [T],
+        values: Vec<U>,
+        min_parallel_len: usize,
+        f: F,
+    ) -> C
+    where
+        T: Send,
+        U: Send,
+        R: Send,
+        C: FromIterator<R> + FromParallelIterator<R> + Send,
+        F: Fn(&mut T, U) -> R + Sync + Send,
+    {
+        let len = items.len();
+        if self.is_parallel(len, min_parallel_len) {
+            self.install(|| {
+                items
+                    .par_iter_mut()
+                    .zip(values.into_par_iter())
+                    .map(|(item, value)| f(item, value))
+                    .collect()
+            })
+        } else {
+            items
+                .iter_mut()
+                .zip(values)
+                .map(|(item, value)| f(item, value))
+                .collect()
+        }
+    }
+
+    /// Sort the items, in parallel if there are at least `min_parallel_len`
+    /// items. The sort is stable.
+    pub(crate) fn sort_by<T, F>(&self, items: &mut [T], min_parallel_len: usize, compare: F)
+    where
+        T: Send,
+        F: Fn(&T, &T) -> Ordering + Sync + Send,
+    {
+        if self.is_parallel(items.len(), min_parallel_len) {
+            self.install(|| items.par_sort_by(compare));
+        } else {
+            items.sort_by(compare);
+        }
+    }
+
+    fn run<R: Send>(
+        &self,
+        len: usize,
+        min_parallel_len: usize,
+        parallel: impl FnOnce() -> R + Send,
+        serial: impl FnOnce() -> R,
+    ) -> R {
+        if self.is_parallel(len, min_parallel_len) {
+            self.install(parallel)
+        } else {
+            serial()
+        }
+    }
+
+    fn is_parallel(&self, len: usize, min_parallel_len: usize) -> bool {
+        let threads = match self {
+            Parallelism::Global => rayon::current_num_threads(),
+            Parallelism::Serial => 1,
+            Parallelism::Pool(pool) => pool.current_num_threads(),
+        };
+
+        threads > 1 && len >= min_parallel_len.max(2)
+    }
+
+    fn install<R: Send>(&self, operation: impl FnOnce() -> R + Send) -> R {
+        match self {
+            Parallelism::Pool(pool) => pool.install(operation),
+            _ => operation(),
+        }
+    }
+
+    /// Pools are compared by identity, as two pools with the same number of
+    /// threads still compete with different work.
+    fn key(&self) -> (u8, usize) {
+        match self {
+            Parallelism::Global => (0, 0),
+            Parallelism::Serial => (1, 0),
+            Parallelism::Pool(pool) => (2, Arc::as_ptr(pool).addr()),
+        }
+    }
+}
+
+impl PartialEq for Parallelism {
+    fn eq(&self, other: &Self) -> bool {
+        self.key() == other.key()
+    }
+}
+
+impl Eq for Parallelism {}
+
+impl PartialOrd for Parallelism {
+    fn partial_cmp(&self, other: &Self) -> Option<Ordering> {
+        Some(self.cmp(other))
+    }
+}
+
+impl Ord for Parallelism {
+    fn cmp(&self, other: &Self) -> Ordering {
+        self.key().cmp(&other.key())
+    }
+}
+
+impl Hash for Parallelism {
+    fn hash<H: Hasher>(&self, state: &mut H) {
+        self.key().hash(state);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn serial_parallelism_should_never_be_parallel() {
+        assert!(!Parallelism::Serial.is_parallel(1000, 0));
+    }
+
+    #[test]
+    fn parallelism_should_not_be_parallel_below_the_minimum_length() {
+        let parallelism = Parallelism::with_threads(2).unwrap();
+
+        assert!(!parallelism.is_parallel(3, 4));
+        assert!(!parallelism.is_parallel(1, 0));
+    }
+
+    #[test]
+    fn map_should_give_the_same_results_in_parallel_and_serially() {
+        let items: Vec<u32> = (0..100).collect();
+        let parallel: Vec<u32> = Parallelism::with_threads(2)
+            .unwrap()
+            .map(&items, 1, |i| i * 2);
+        let serial: Vec<u32> = Parallelism::Serial.map(&items, 1, |i| i * 2);
+
+        assert_eq!(serial, parallel);
+        assert_eq!(Some(&198), parallel.last());
+    }
+
+    #[test]
+    fn filter_map_should_keep_item_order() {
+        let items: Vec<u32> = (0..100).collect();
+        let large: Vec<u32> = Parallelism::with_threads(2)
+            .unwrap()
+            .filter_map(&items, 1, |i| (*i >= 50).then_some(*i));
+
+        assert_eq!((50..100).collect::<Vec<u32>>(), large);
+    }
+
+    #[test]
+    fn map_mut_should_give_the_same_results_in_parallel_and_serially() {
+        let mut parallel_items: Vec<u32> = (0..100).collect();
+        let mut serial_items = parallel_items.clone();
+        let double = |i: &mut u32| {
+            *i *= 2;
+            *i
+        };
+
+        let parallel: Vec<u32> =
+            Parallelism::with_threads(2)
+                .unwrap()
+                .map_mut(&mut parallel_items, 1, double);
+        let serial: Vec<u32> = Parallelism::Serial.map_mut(&mut serial_items, 1, double);
+
+        assert_eq!(serial, parallel);
+        assert_eq!(serial_items, parallel_items);
+        assert_eq!(Some(&198), parallel.last());
+    }
+
+    #[test]
+    fn zip_map_mut_should_pair_items_with_values_at_the_same_index() {
+        let mut items: Vec<u32> = vec![1, 2, 3];
+        let changed: Vec<bool> =
+            Parallelism::Serial.zip_map_mut(&mut items, vec![1, 5, 3], 1, |item, value| {
+                let changed = *item != value;
+                *item = value;
+                changed
+            });
+
+        assert_eq!(vec![1, 5, 3], items);
+        assert_eq!(vec![false, true, false], changed);
+    }
+
+    #[test]
+    fn pools_should_be_equal_only_to_themselves() {
+        let pool = Parallelism::with_threads(2).unwrap();
+        let other_pool = Parallelism::with_threads(2).unwrap();
+
+        assert_eq!(pool, pool.clone());
+        assert_ne!(pool, other_pool);
+        assert_ne!(Parallelism::Global, Parallelism::Serial);
+    }
+}
@@ -18,7 +18,9 @@ use std::ffi::OsStr;
  * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
  */
 use std::fs::{File, FileTimes};
-use std::path::Path;
+use std::io::Seek;
+use std::path::{Path, PathBuf};
+use std::sync::Arc;
 use std::time::SystemTime;
 
 use esplugin::ParseOptions;
@@ -26,6 +28,8 @@ use unicase::eq;
 
 use crate::enums::{Error, GameId};
 use crate::game_settings::GameSettings;
+use crate::ghostable_path::GhostablePath;
+use crate::metrics::{MetricsRecorder, Phase};
 
 const VALID_EXTENSIONS: &[&str] = &[".esp", ".esm", ".esp.ghost", ".esm.ghost"];
 
@@ -40,15 +44,71 @@ const VALID_EXTENSIONS_WITH_ESL: &[&str] = &[
 
 const VALID_EXTENSIONS_OPENMW: &[&str] = &[".esp", ".esm", ".omwaddon", ".omwgame", ".omwscripts"];
 
+/// The path, name and header data are immutable once read and are shared
+/// between clones, so that copying plugins to build a new load order doesn't
+/// copy their strings and masters.
 #[derive(Clone, Debug, Eq, PartialEq, Hash)]
 pub struct Plugin {
     active: bool,
     modification_time: SystemTime,
-    data: esplugin::Plugin,
-    name: String,
+    file_size: u64,
+    path: Arc<Path>,
+    header: Arc<PluginHeader>,
+    name: Arc<str>,
     game_id: GameId,
 }
 
+/// The data that libloadorder uses from a plugin's header. It's read once on
+/// parsing, as it's used when validating and calculating load order positions
+/// for every plugin.
+#[derive(Clone, Debug, Default, Eq, PartialEq, Hash)]
+#[expect(
+    clippy::struct_excessive_bools,
+    reason = "The bools mirror independent header flags"
+)]
+pub(crate) struct PluginHeader {
+    pub(crate) is_master_file: bool,
+    pub(crate) is_light_plugin: bool,
+    pub(crate) is_medium_plugin: bool,
+    pub(crate) is_blueprint_plugin: bool,
+    pub(crate) masters: Vec<String>,
+}
+
+impl PluginHeader {
+    fn read(
+        path: &Path,
+        mut file: File,
+        game_id: GameId,
+        metrics: &MetricsRecorder,
+    ) -> Result<PluginHeader, Error> {
+        let filename = path.file_name().and_then(OsStr::to_str).unwrap_or_default();
+
+        // OpenMW has .omwscripts plugins that form part of the load order but
+        // are not of the same file format as the .esm/.esp/.omwgame/.omwaddon
+        // files.
+        if iends_with_ascii(filename, ".omwscripts") {
+            return Ok(PluginHeader::default());
+        }
+
+        let _timer = metrics.time(Phase::ParseHeaders);
+        let mut data = esplugin::Plugin::new(game_id.to_esplugin_id(), path);
+        data.parse_reader(&mut file, ParseOptions::header_only())
+            .map_err(|e| file_error(path, e))?;
+
+        // Parsing stops at the end of the header, so the file position is the
+        // number of bytes that were read.
+        metrics.add_header_parsed(file.stream_position().unwrap_or_default());
+
+        Ok(PluginHeader {
+            is_master_file: data.is_master_file(),
+            is_light_plugin: data.is_light_plugin(),
+            is_medium_plugin: data.is_medium_plugin(),
+            is_blueprint_plugin: data.is_blueprint_plugin(),
+            masters: data.masters().map_err(|e| file_error(path, e))?,
+        })
+    }
+}
+
 impl Plugin {
     pub fn new(filename: &str, game_settings: &GameSettings) -> Result<Plugin, Error> {
         Plugin::with_active(filename, game_settings, false)
@@ -59,53 +119,101 @@ impl Plugin {
         game_settings: &GameSettings,
         active: bool,
     ) -> Result<Plugin, Error> {
-        let filepath = game_settings.plugin_path(filename);
-
-        let filepath = if game_settings.id().allow_plugin_ghosting() {
-            use crate::ghostable_path::GhostablePath;
-
-            if active {
-                filepath.unghost()?
-            } else {
-                filepath.resolve_path()?
-            }
-        } else {
-            filepath
-        };
+        let filepath = resolve_plugin_path(filename, game_settings, active)?;
 
-        Plugin::with_path(&filepath, game_settings.id(), active)
+        Plugin::with_path(
+            &filepath,
+            game_settings.id(),
+            active,
+            game_settings.metrics_recorder(),
+        )
     }
 
-    pub(crate) fn with_path(path: &Path, game_id: GameId, active: bool) -> Result<Plugin, Error> {
-        let Some(filename) = path.file_name().and_then(OsStr::to_str) else {
-            return Err(Error::NoFilename(path.to_path_buf()));
-        };
-
-        if !has_plugin_extension(filename, game_id) {
-            return Err(Error::InvalidPath(path.to_path_buf()));
-        }
+    pub(crate) fn with_path(
+        path: &Path,
+        game_id: GameId,
+        active: bool,
+        metrics: &MetricsRecorder,
+    ) -> Result<Plugin, Error> {
+        let filename = plugin_filename(path, game_id)?;
 
         let file = File::open(path).map_err(|e| Error::IoError(path.to_path_buf(), e))?;
-        let modification_time = file
+        let (modification_time, file_size) = file
             .metadata()
-            .and_then(|m| m.modified())
+            .and_then(|m| Ok((m.modified()?, m.len())))
             .map_err(|e| Error::IoError(path.to_path_buf(), e))?;
 
-        let mut data = esplugin::Plugin::new(game_id.to_esplugin_id(), path);
+        let header = PluginHeader::read(path, file, game_id, metrics)?;
 
-        // OpenMW has .omwscripts plugins that form part of the load order but
-        // are not of the same file format as the .esm/.esp/.omwgame/.omwaddon
-        // files.
-        if !iends_with_ascii(filename, ".omwscripts") {
-            data.parse_reader(file, ParseOptions::header_only())
-                .map_err(|e| file_error(path, e))?;
-        }
+        Ok(Plugin {
+            active,
+            modification_time,
+            file_size,
+            path: Arc::from(path),
+            header: Arc::new(header),
+            name: Arc::from(trim_dot_ghost(filename, game_id)),
+            game_id,
+        })
+    }
+
+    /// Read the plugin at the given path, using the given modification time
+    /// and size that were already read for its file instead of reading them
+    /// again.
+    ///
+    /// If the game settings have a shared header cache, the plugin's header is
+    /// taken from it or added to it.
+    pub(crate) fn with_metadata(
+        path: &Path,
+        game_settings: &GameSettings,
+        active: bool,
+        modification_time: SystemTime,
+        file_size: u64,
+    ) -> Result<Plugin, Error> {
+        let game_id = game_settings.id();
+        let filename = plugin_filename(path, game_id)?;
+
+        let read_header = || {
+            let file = File::open(path).map_err(|e| Error::IoError(path.to_path_buf(), e))?;
+            PluginHeader::read(path, file, game_id, game_settings.metrics_recorder())
+        };
+
+        let header = match game_settings.shared_header_cache() {
+            Some(cache) => {
+                cache.get_or_read(path, game_id, modification_time, file_size, read_header)?
+            }
+            None => Arc::new(read_header()?),
+        };
 
         Ok(Plugin {
             active,
             modification_time,
-            data,
-            name: trim_dot_ghost(filename, game_id).to_owned(),
+            file_size,
+            path: Arc::from(path),
+            header,
+            name: Arc::from(trim_dot_ghost(filename, game_id)),
+            game_id,
+        })
+    }
+
+    /// Create a plugin using header data that was previously read from the
+    /// file at the given path, when it had the given modification time and
+    /// size.
+    pub(crate) fn with_header(
+        path: &Path,
+        game_id: GameId,
+        modification_time: SystemTime,
+        file_size: u64,
+        header: PluginHeader,
+    ) -> Result<Plugin, Error> {
+        let filename = plugin_filename(path, game_id)?;
+
+        Ok(Plugin {
+            active: false,
+            modification_time,
+            file_size,
+            path: Arc::from(path),
+            header: Arc::new(header),
+            name: Arc::from(trim_dot_ghost(filename, game_id)),
             game_id,
         })
     }
@@ -114,6 +222,26 @@ impl Plugin {
         &self.name
     }
 
+    pub(crate) fn path(&self) -> &Path {
+        &self.path
+    }
+
+    pub(crate) fn file_size(&self) -> u64 {
+        self.file_size
+    }
+
+    pub(crate) fn header(&self) -> &PluginHeader {
+        &self.header
+    }
+
+    /// Check if the plugin's file still has the modification time and size
+    /// that it had when the plugin was read.
+    pub(crate) fn is_unchanged_on_disk(&self) -> bool {
+        std::fs::metadata(&self.path).is_ok_and(|m| {
+            m.len() == self.file_size && m.modified().is_ok_and(|t| t == self.modification_time)
+        })
+    }
+
     pub fn name_matches(&self, string: &str) -> bool {
         eq(self.name(), trim_dot_ghost(string, self.game_id))
     }
@@ -126,38 +254,37 @@ impl Plugin {
         self.active
     }
 
+    pub fn is_ghosted(&self) -> bool {
+        self.game_id.allow_plugin_ghosting() && self.path.has_ghost_extension()
+    }
+
     pub fn is_master_file(&self) -> bool {
-        self.game_id.treats_master_files_differently() && self.data.is_master_file()
+        self.game_id.treats_master_files_differently() && self.header.is_master_file
     }
 
     pub fn is_light_plugin(&self) -> bool {
-        self.data.is_light_plugin()
+        self.header.is_light_plugin
     }
 
     pub fn is_medium_plugin(&self) -> bool {
-        self.data.is_medium_plugin()
+        self.header.is_medium_plugin
     }
 
     pub fn is_blueprint_master(&self) -> bool {
-        self.data.is_blueprint_plugin() && self.is_master_file()
+        self.header.is_blueprint_plugin && self.is_master_file()
     }
 
-    pub fn masters(&self) -> Result<Vec<String>, Error> {
-        self.data
-            .masters()
-            .map_err(|e| file_error(self.data.path(), e))
+    pub fn masters(&self) -> &[String] {
+        &self.header.masters
     }
 
     pub fn has_master(&self, master: &str) -> bool {
-        self.masters()
-            .unwrap_or_default()
-            .iter()
-            .any(|m| eq(m.as_str(), master))
+        self.header.masters.iter().any(|m| eq(m.as_str(), master))
     }
 
     pub fn set_modification_time(&mut self, time: SystemTime) -> Result<(), Error> {
-        // Always write the file time. This has a huge performance impact, but
-        // is important for correctness, as otherwise external changes to plugin
+        // Always write the file time, even if the plugin's recorded time is
+        // already the given time, as otherwise external changes to plugin
         // timestamps between calls to WritableLoadOrder::load() and
         // WritableLoadOrder::save() could lead to libloadorder not setting all
         // the timestamps it needs to and producing an incorrect load order.
@@ -167,29 +294,45 @@ impl Plugin {
 
         File::options()
             .write(true)
-            .open(self.data.path())
+            .open(&self.path)
             .and_then(|f| f.set_times(times))
-            .map_err(|e| Error::IoError(self.data.path().to_path_buf(), e))?;
+            .map_err(|e| Error::IoError(self.path.to_path_buf(), e))?;
 
         self.modification_time = time;
         Ok(())
     }
 
-    pub fn activate(&mut self) -> Result<(), Error> {
+    /// Set the plugin's modification time, only writing it to the plugin's
+    /// file if the file currently has a different modification time. This
+    /// reads the file's current time instead of relying on the recorded time,
+    /// so it's as correct as always writing the time, but opening a file for
+    /// writing is much slower than reading its metadata, and not writing
+    /// avoids unnecessarily triggering tools that watch for file changes.
+    ///
+    /// Returns true if the file's modification time was written.
+    pub(crate) fn set_modification_time_if_changed(
+        &mut self,
+        time: SystemTime,
+    ) -> Result<bool, Error> {
+        let current_time = std::fs::metadata(&self.path).and_then(|m| m.modified());
+
+        if current_time.is_ok_and(|t| t == time) {
+            self.modification_time = time;
+            Ok(false)
+        } else {
+            self.set_modification_time(time).map(|()| true)
+        }
+    }
+
+    pub(crate) fn activate(&mut self, metrics: &MetricsRecorder) -> Result<(), Error> {
         if !self.is_active() {
-            if self.game_id.allow_plugin_ghosting() {
-                use crate::ghostable_path::GhostablePath;
-
-                if self.data.path().has_ghost_extension() {
-                    let new_path = self.data.path().unghost()?;
-
-                    self.data = esplugin::Plugin::new(self.data.game_id(), &new_path);
-                    self.data
-                        .parse_file(ParseOptions::header_only())
-                        .map_err(|e| file_error(self.data.path(), e))?;
-                    let modification_time = self.modification_time();
-                    self.set_modification_time(modification_time)?;
-                }
+            if self.is_ghosted() {
+                // Unghosting only renames the file, so the header that was
+                // already read from it is still correct and can be kept.
+                let new_path = unghost(&self.path, metrics)?;
+                self.path = Arc::from(new_path);
+                let modification_time = self.modification_time();
+                self.set_modification_time(modification_time)?;
             }
 
             self.active = true;
@@ -200,6 +343,59 @@ impl Plugin {
     pub fn deactivate(&mut self) {
         self.active = false;
     }
+
+    /// Use the path of the given copy of this plugin, which has since been
+    /// unghosted.
+    pub(crate) fn use_unghosted_path(&mut self, unghosted: &Plugin) {
+        self.path = Arc::clone(&unghosted.path);
+    }
+}
+
+/// Get the filename of the plugin at the given path, if it has a valid plugin
+/// file extension.
+fn plugin_filename(path: &Path, game_id: GameId) -> Result<&str, Error> {
+    let Some(filename) = path.file_name().and_then(OsStr::to_str) else {
+        return Err(Error::NoFilename(path.to_path_buf()));
+    };
+
+    if has_plugin_extension(filename, game_id) {
+        Ok(filename)
+    } else {
+        Err(Error::InvalidPath(path.to_path_buf()))
+    }
+}
+
+/// Get the path to the named plugin, resolving any ghosting. If the plugin is
+/// to be active, it's unghosted.
+pub(crate) fn resolve_plugin_path(
+    filename: &str,
+    game_settings: &GameSettings,
+    active: bool,
+) -> Result<PathBuf, Error> {
+    let filepath = game_settings.plugin_path(filename);
+
+    if game_settings.id().allow_plugin_ghosting() {
+        if active {
+            unghost(&filepath, game_settings.metrics_recorder())
+        } else {
+            filepath.resolve_path()
+        }
+    } else {
+        Ok(filepath)
+    }
+}
+
+/// Unghost the plugin at the given path, recording the rename if it's ghosted.
+fn unghost(path: &Path, metrics: &MetricsRecorder) -> Result<PathBuf, Error> {
+    if !path.has_ghost_extension() {
+        return Ok(path.to_path_buf());
+    }
+
+    let _timer = metrics.time(Phase::Unghost);
+    let new_path = path.unghost()?;
+    metrics.add_files_written(1);
+
+    Ok(new_path)
 }
 
 pub(crate) fn has_plugin_extension(filename: &str, game: GameId) -> bool {
@@ -263,7 +459,6 @@ mod tests {
     use super::*;
 
     use crate::tests::{copy_to_test_dir, create_file};
-    use std::path::PathBuf;
     use std::time::{Duration, UNIX_EPOCH};
     use tempfile::tempdir;
 
@@ -549,7 +744,7 @@ mod tests {
         create_file(&settings.plugins_directory().join(name));
         let plugin = Plugin::new(name, &settings).unwrap();
 
-        assert!(plugin.masters().unwrap().is_empty());
+        assert!(plugin.masters().is_empty());
     }
 
     #[test]
@@ -578,6 +773,48 @@ mod tests {
         assert_eq!(file_size, new_size);
     }
 
+    #[test]
+    fn set_modification_time_if_changed_should_not_write_an_unchanged_time() {
+        let tmp_dir = tempdir().unwrap();
+        let game_dir = tmp_dir.path();
+
+        let settings = game_settings(GameId::Oblivion, game_dir);
+        copy_to_test_dir("Blank.esp", "Blank.esp", &settings);
+        let mut plugin = Plugin::new("Blank.esp", &settings).unwrap();
+
+        let path = game_dir.join("Data").join("Blank.esp");
+        let mtime = plugin.modification_time();
+
+        assert!(!plugin.set_modification_time_if_changed(mtime).unwrap());
+        assert_eq!(mtime, path.metadata().unwrap().modified().unwrap());
+
+        assert!(plugin.set_modification_time_if_changed(UNIX_EPOCH).unwrap());
+        assert_eq!(UNIX_EPOCH, plugin.modification_time());
+        assert_eq!(UNIX_EPOCH, path.metadata().unwrap().modified().unwrap());
+    }
+
+    #[test]
+    fn set_modification_time_if_changed_should_write_a_time_changed_externally() {
+        let tmp_dir = tempdir().unwrap();
+        let game_dir = tmp_dir.path();
+
+        let settings = game_settings(GameId::Oblivion, game_dir);
+        copy_to_test_dir("Blank.esp", "Blank.esp", &settings);
+        let mut plugin = Plugin::new("Blank.esp", &settings).unwrap();
+
+        let path = game_dir.join("Data").join("Blank.esp");
+        let mtime = plugin.modification_time();
+        File::options()
+            .write(true)
+            .open(&path)
+            .unwrap()
+            .set_modified(UNIX_EPOCH)
+            .unwrap();
+
+        assert!(plugin.set_modification_time_if_changed(mtime).unwrap());
+        assert_eq!(mtime, path.metadata().unwrap().modified().unwrap());
+    }
+
     #[test]
     fn set_modification_time_should_be_able_to_handle_pre_unix_timestamps() {
         let tmp_dir = tempdir().unwrap();
@@ -603,6 +840,45 @@ mod tests {
         assert_eq!(target_mtime, new_mtime);
     }
 
+    #[test]
+    fn clone_should_share_the_name_path_and_header() {
+        let tmp_dir = tempdir().unwrap();
+        let game_dir = tmp_dir.path();
+
+        let settings = game_settings(GameId::Oblivion, game_dir);
+
+        copy_to_test_dir(
+            "Blank - Master Dependent.esp",
+            "Blank - Master Dependent.esp",
+            &settings,
+        );
+        let plugin = Plugin::new("Blank - Master Dependent.esp", &settings).unwrap();
+        let clone = plugin.clone();
+
+        assert!(Arc::ptr_eq(&plugin.name, &clone.name));
+        assert!(Arc::ptr_eq(&plugin.path, &clone.path));
+        assert!(Arc::ptr_eq(&plugin.header, &clone.header));
+    }
+
+    #[test]
+    fn activating_a_clone_should_not_change_the_original_plugin() {
+        let tmp_dir = tempdir().unwrap();
+        let game_dir = tmp_dir.path();
+
+        let settings = game_settings(GameId::Oblivion, game_dir);
+
+        copy_to_test_dir("Blank.esp", "Blank.esp.ghost", &settings);
+        let plugin = Plugin::new("Blank.esp", &settings).unwrap();
+        let mut clone = plugin.clone();
+
+        clone.activate(&MetricsRecorder::default()).unwrap();
+
+        assert!(clone.is_active());
+        assert!(!clone.is_ghosted());
+        assert!(!plugin.is_active());
+        assert!(plugin.is_ghosted());
+    }
+
     #[test]
     fn activate_should_unghost_a_ghosted_plugin() {
         let tmp_dir = tempdir().unwrap();
@@ -613,13 +889,33 @@ mod tests {
         copy_to_test_dir("Blank.esp", "Blank.esp.ghost", &settings);
         let mut plugin = Plugin::new("Blank.esp", &settings).unwrap();
 
-        plugin.activate().unwrap();
+        plugin.activate(&MetricsRecorder::default()).unwrap();
 
         assert!(plugin.is_active());
         assert_eq!("Blank.esp", plugin.name());
         assert!(game_dir.join("Data").join("Blank.esp").exists());
     }
 
+    #[test]
+    fn activate_should_not_parse_the_header_of_a_ghosted_plugin_again() {
+        let tmp_dir = tempdir().unwrap();
+        let game_dir = tmp_dir.path();
+
+        let settings = game_settings(GameId::Oblivion, game_dir);
+
+        copy_to_test_dir("Blank.esm", "Blank.esm.ghost", &settings);
+        let mut plugin = Plugin::new("Blank.esm", &settings).unwrap();
+        let header = Arc::clone(&plugin.header);
+
+        let metrics = MetricsRecorder::default();
+        plugin.activate(&metrics).unwrap();
+
+        assert!(plugin.is_master_file());
+        assert!(Arc::ptr_eq(&header, &plugin.header));
+        assert_eq!(0, metrics.snapshot().headers_parsed);
+        assert_eq!(game_dir.join("Data").join("Blank.esm"), plugin.path());
+    }
+
     #[test]
     fn activate_should_not_unghost_an_openmw_plugin() {
         // It's not possible to create an OpenMW Plugin from a path ending in
@@ -633,20 +929,17 @@ mod tests {
         let plugin_name = "Blank.esp.ghost";
         copy_to_test_dir("Blank.esp", plugin_name, &settings);
 
-        let data = esplugin::Plugin::new(
-            GameId::OpenMW.to_esplugin_id(),
-            &game_dir.join("Data Files").join(plugin_name),
-        );
-
         let mut plugin = Plugin {
             active: false,
             modification_time: SystemTime::now(),
-            data,
-            name: plugin_name.to_owned(),
+            file_size: 0,
+            path: Arc::from(game_dir.join("Data Files").join(plugin_name)),
+            header: Arc::default(),
+            name: Arc::from(plugin_name),
             game_id: GameId::OpenMW,
         };
 
-        plugin.activate().unwrap();
+        plugin.activate(&MetricsRecorder::default()).unwrap();
         assert!(plugin.is_active());
         assert_eq!(plugin_name, plugin.name());
     }
@@ -0,0 +1,447 @@
+/*
+ * This file is part of libloadorder
+ *
+ * Copyright (C) 2017 Oliver Hamlet
+ *
+ * libloadorder is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libloadorder is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
+ */
+use std::cmp::Ordering;
+use std::collections::{BTreeMap, HashMap};
+use std::hash::{Hash, Hasher};
+use std::mem::{discriminant, Discriminant};
+use std::path::{Path, PathBuf};
+use std::sync::{Arc, Mutex, MutexGuard, OnceLock, PoisonError};
+use std::time::SystemTime;
+
+use crate::enums::{Error, GameId};
+use crate::plugin::PluginHeader;
+
+/// The capacity of the global cache, which is enough for the headers of
+/// several thousand plugins with a typical number of masters.
+pub(crate) const DEFAULT_CAPACITY: usize = 32 * 1024 * 1024;
+
+/// A thread-safe cache of parsed plugin headers that can be shared between
+/// load orders, including load orders for different games that share plugins
+/// directories, so that each plugin's header is only parsed and stored once.
+///
+/// Headers are keyed by the canonical path of the plugin file, and are only
+/// reused while the file has the same modification time and size as when its
+/// header was cached. When the estimated size of the cached headers exceeds
+/// the cache's capacity, the least recently used headers are evicted.
+#[derive(Debug)]
+pub struct SharedHeaderCache {
+    state: Mutex<CacheState>,
+}
+
+// Headers are parsed according to esplugin's game ID, so games that map to
+// the same ID can share them.
+type CacheKey = (PathBuf, Discriminant<esplugin::GameId>);
+
+#[derive(Debug, Default)]
+struct CacheState {
+    capacity: usize,
+    size: usize,
+    last_tick: u64,
+    entries: HashMap<CacheKey, CacheEntry>,
+    /// The keys of the cached entries, from least to most recently used.
+    recency: BTreeMap<u64, CacheKey>,
+}
+
+#[derive(Debug)]
+struct CacheEntry {
+    modification_time: SystemTime,
+    file_size: u64,
+    header: Arc<PluginHeader>,
+    size: usize,
+    last_used: u64,
+}
+
+impl SharedHeaderCache {
+    /// Create an empty cache that holds at most about `capacity` bytes of
+    /// header data.
+    pub fn new(capacity: usize) -> Self {
+        SharedHeaderCache {
+            state: Mutex::new(CacheState {
+                capacity,
+                ..CacheState::default()
+            }),
+        }
+    }
+
+    /// Get the process-wide cache, which is created with a capacity of 32 MiB
+    /// when it's first used.
+    pub fn global() -> Arc<SharedHeaderCache> {
+        static GLOBAL: OnceLock<Arc<SharedHeaderCache>> = OnceLock::new();
+
+        Arc::clone(GLOBAL.get_or_init(|| Arc::new(SharedHeaderCache::new(DEFAULT_CAPACITY))))
+    }
+
+    pub fn capacity(&self) -> usize {
+        self.lock().capacity
+    }
+
+    /// Set the capacity of the cache in bytes, evicting the least recently
+    /// used headers if they no longer fit.
+    pub fn set_capacity(&self, capacity: usize) {
+        let mut state = self.lock();
+        state.capacity = capacity;
+        state.evict();
+    }
+
+    /// The estimated number of bytes of header data in the cache.
+    pub fn size(&self) -> usize {
+        self.lock().size
+    }
+
+    /// The number of headers in the cache.
+    pub fn len(&self) -> usize {
+        self.lock().entries.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    pub fn clear(&self) {
+        let mut state = self.lock();
+        state.entries.clear();
+        state.recency.clear();
+        state.size = 0;
+    }
+
+    /// Get the cached header for the plugin at the given path if its file
+    /// still has the given modification time and size, or otherwise read it
+    /// using `read` and cache it.
+    ///
+    /// The cache isn't locked while reading, so the same header may be read
+    /// more than once if several threads ask for it at the same time.
+    pub(crate) fn get_or_read<F>(
+        &self,
+        path: &Path,
+        game_id: GameId,
+        modification_time: SystemTime,
+        file_size: u64,
+        read: F,
+    ) -> Result<Arc<PluginHeader>, Error>
+    where
+        F: FnOnce() -> Result<PluginHeader, Error>,
+    {
+        // Plugins that can't be canonicalised can't be safely shared, so
+        // they just don't get cached.
+        let Ok(canonical_path) = path.canonicalize() else {
+            return read().map(Arc::new);
+        };
+        let key = (canonical_path, discriminant(&game_id.to_esplugin_id()));
+
+        if let Some(header) = self.lock().get(&key, modification_time, file_size) {
+            return Ok(header);
+        }
+
+        let header = Arc::new(read()?);
+
+        self.lock().insert(
+            key,
+            CacheEntry {
+                modification_time,
+                file_size,
+                header: Arc::clone(&header),
+                size: 0,
+                last_used: 0,
+            },
+        );
+
+        Ok(header)
+    }
+
+    fn lock(&self) -> MutexGuard<'_, CacheState> {
+        // The state is never left inconsistent by a panic, as nothing that
+        // modifies it can panic part-way through.
+        self.state.lock().unwrap_or_else(PoisonError::into_inner)
+    }
+
+    /// Caches are compared by identity, as they're shared.
+    fn address(&self) -> usize {
+        std::ptr::from_ref(self).addr()
+    }
+}
+
+impl Default for SharedHeaderCache {
+    fn default() -> Self {
+        SharedHeaderCache::new(DEFAULT_CAPACITY)
+    }
+}
+
+impl PartialEq for SharedHeaderCache {
+    fn eq(&self, other: &Self) -> bool {
+        self.address() == other.address()
+    }
+}
+
+impl Eq for SharedHeaderCache {}
+
+impl PartialOrd for SharedHeaderCache {
+    fn partial_cmp(&self, other: &Self) -> Option<Ordering> {
+        Some(self.cmp(other))
+    }
+}
+
+impl Ord for SharedHeaderCache {
+    fn cmp(&self, other: &Self) -> Ordering {
+        self.address().cmp(&other.address())
+    }
+}
+
+impl Hash for SharedHeaderCache {
+    fn hash<H: Hasher>(&self, state: &mut H) {
+        self.address().hash(state);
+    }
+}
+
+impl CacheState {
+    fn get(
+        &mut self,
+        key: &CacheKey,
+        modification_time: SystemTime,
+        file_size: u64,
+    ) -> Option<Arc<PluginHeader>> {
+        let tick = self.next_tick();
+        let entry = self.entries.get_mut(key)?;
+
+        if entry.modification_time != modification_time || entry.file_size != file_size {
+            return None;
+        }
+
+        let previous_tick = std::mem::replace(&mut entry.last_used, tick);
+        let header = Arc::clone(&entry.header);
+
+        if let Some(key) = self.recency.remove(&previous_tick) {
+            self.recency.insert(tick, key);
+        }
+
+        Some(header)
+    }
+
+    fn insert(&mut self, key: CacheKey, mut entry: CacheEntry) {
+        if let Some(replaced) = self.entries.remove(&key) {
+            self.recency.remove(&replaced.last_used);
+            self.size = self.size.saturating_sub(replaced.size);
+        }
+
+        entry.size = estimated_size(&key.0, &entry.header);
+        entry.last_used = self.next_tick();
+
+        // Don't evict everything else for a header that would never fit.
+        if entry.size > self.capacity {
+            return;
+        }
+
+        self.size = self.size.saturating_add(entry.size);
+        self.recency.insert(entry.last_used, key.clone());
+        self.entries.insert(key, entry);
+
+        self.evict();
+    }
+
+    fn evict(&mut self) {
+        while self.size > self.capacity {
+            let Some((_, key)) = self.recency.pop_first() else {
+                break;
+            };
+
+            if let Some(evicted) = self.entries.remove(&key) {
+                self.size = self.size.saturating_sub(evicted.size);
+            }
+        }
+    }
+
+    fn next_tick(&mut self) -> u64 {
+        self.last_tick = self.last_tick.saturating_add(1);
+        self.last_tick
+    }
+}
+
+/// Estimate the memory used by a cache entry, counting its path twice as it
+/// is stored in both of the cache's maps.
+fn estimated_size(path: &Path, header: &PluginHeader) -> usize {
+    let masters_size: usize = header
+        .masters
+        .iter()
+        .map(|m| size_of::<String>().saturating_add(m.capacity()))
+        .sum();
+
+    size_of::<CacheKey>()
+        .saturating_add(size_of::<CacheEntry>())
+        .saturating_add(size_of::<PluginHeader>())
+        .saturating_add(path.as_os_str().len().saturating_mul(2))
+        .saturating_add(masters_size)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    use std::fs::write;
+
+    use tempfile::tempdir;
+
+    fn header(masters: &[&str]) -> PluginHeader {
+        PluginHeader {
+            masters: masters.iter().map(|m| (*m).to_owned()).collect(),
+            ..PluginHeader::default()
+        }
+    }
+
+    fn read_header(
+        cache: &SharedHeaderCache,
+        path: &Path,
+        game_id: GameId,
+        file_size: u64,
+    ) -> (Arc<PluginHeader>, bool) {
+        let mut was_read = false;
+        let header = cache
+            .get_or_read(path, game_id, SystemTime::UNIX_EPOCH, file_size, || {
+                was_read = true;
+                Ok(header(&["Blank.esm"]))
+            })
+            .unwrap();
+
+        (header, was_read)
+    }
+
+    #[test]
+    fn get_or_read_should_reuse_a_header_until_the_file_changes() {
+        let tmp_dir = tempdir().unwrap();
+        let path = tmp_dir.path().join("Blank.esp");
+        write(&path, "").unwrap();
+
+        let cache = SharedHeaderCache::default();
+        let (first, first_was_read) = read_header(&cache, &path, GameId::SkyrimSE, 1);
+        let (second, second_was_read) = read_header(&cache, &path, GameId::SkyrimSE, 1);
+        let (_, third_was_read) = read_header(&cache, &path, GameId::SkyrimSE, 2);
+
+        assert!(first_was_read);
+        assert!(!second_was_read);
+        assert!(Arc::ptr_eq(&first, &second));
+        assert!(third_was_read);
+        assert_eq!(1, cache.len());
+    }
+
+    #[test]
+    fn get_or_read_should_share_headers_between_games_that_parse_them_the_same_way() {
+        let tmp_dir = tempdir().unwrap();
+        let path = tmp_dir.path().join("Blank.esp");
+        write(&path, "").unwrap();
+
+        let cache = SharedHeaderCache::default();
+        read_header(&cache, &path, GameId::SkyrimSE, 1);
+
+        let (_, vr_was_read) = read_header(&cache, &path, GameId::SkyrimVR, 1);
+        let (_, oldrim_was_read) = read_header(&cache, &path, GameId::Skyrim, 1);
+
+        assert!(!vr_was_read);
+        assert!(oldrim_was_read);
+    }
+
+    #[test]
+    fn get_or_read_should_use_canonical_paths() {
+        let tmp_dir = tempdir().unwrap();
+        let path = tmp_dir.path().join("Blank.esp");
+        write(&path, "").unwrap();
+        let other_path = tmp_dir.path().join(".").join("Blank.esp");
+
+        let cache = SharedHeaderCache::default();
+        read_header(&cache, &path, GameId::SkyrimSE, 1);
+        let (_, was_read) = read_header(&cache, &other_path, GameId::SkyrimSE, 1);
+
+        assert!(!was_read);
+    }
+
+    #[test]
+    fn get_or_read_should_not_cache_a_header_for_a_path_that_does_not_exist() {
+        let tmp_dir = tempdir().unwrap();
+        let path = tmp_dir.path().join("Blank.esp");
+
+        let cache = SharedHeaderCache::default();
+        read_header(&cache, &path, GameId::SkyrimSE, 1);
+
+        assert!(cache.is_empty());
+    }
+
+    #[test]
+    fn inserting_should_evict_the_least_recently_used_headers_over_capacity() {
+        let tmp_dir = tempdir().unwrap();
+        let paths: Vec<_> = ["A.esp", "B.esp", "C.esp"]
+            .into_iter()
+            .map(|f| tmp_dir.path().join(f))
+            .collect();
+        for path in &paths {
+            write(path, "").unwrap();
+        }
+
+        let cache = SharedHeaderCache::default();
+        read_header(&cache, &paths[0], GameId::SkyrimSE, 1);
+        let entry_size = cache.size();
+        cache.set_capacity(entry_size * 2);
+
+        read_header(&cache, &paths[1], GameId::SkyrimSE, 1);
+        // Use A so that B is the least recently used.
+        read_header(&cache, &paths[0], GameId::SkyrimSE, 1);
+        read_header(&cache, &paths[2], GameId::SkyrimSE, 1);
+
+        assert_eq!(2, cache.len());
+        assert!(!read_header(&cache, &paths[0], GameId::SkyrimSE, 1).1);
+        assert!(!read_header(&cache, &paths[2], GameId::SkyrimSE, 1).1);
+        assert!(read_header(&cache, &paths[1], GameId::SkyrimSE, 1).1);
+    }
+
+    #[test]
+    fn set_capacity_should_evict_headers_that_no_longer_fit() {
+        let tmp_dir = tempdir().unwrap();
+        let path = tmp_dir.path().join("Blank.esp");
+        write(&path, "").unwrap();
+
+        let cache = SharedHeaderCache::default();
+        read_header(&cache, &path, GameId::SkyrimSE, 1);
+        assert_eq!(1, cache.len());
+
+        cache.set_capacity(0);
+
+        assert!(cache.is_empty());
+        assert_eq!(0, cache.size());
+    }
+
+    #[test]
+    fn clear_should_remove_all_headers() {
+        let tmp_dir = tempdir().unwrap();
+        let path = tmp_dir.path().join("Blank.esp");
+        write(&path, "").unwrap();
+
+        let cache = SharedHeaderCache::default();
+        read_header(&cache, &path, GameId::SkyrimSE, 1);
+        cache.clear();
+
+        assert!(cache.is_empty());
+        assert_eq!(0, cache.size());
+    }
+
+    #[test]
+    fn caches_should_be_equal_only_to_themselves() {
+        let cache = SharedHeaderCache::default();
+        let other_cache = SharedHeaderCache::default();
+
+        assert_eq!(cache, cache);
+        assert_ne!(cache, other_cache);
+        assert_eq!(SharedHeaderCache::global(), SharedHeaderCache::global());
+    }
+}